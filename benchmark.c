@@ -0,0 +1,2198 @@
+/*
+ * PRIORITY SOCIAL MEDIA - Backend Benchmarks
+ * Measures the storage and lookup paths of libpriority, plus the
+ * shared headers used by main.c (feed_rank.h, json_writer.h).
+ *
+ * Build: make bench        (make bench-json also times json-c in json_feed)
+ * Run:   ./benchmark [name]   (no name runs every benchmark)
+ *        BENCH_MAX_USERS caps the largest user_lookup size (default 10M)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "priority.h"
+#include "feed_rank.h"
+#include "json_writer.h"
+#include "dat_codec.h"
+
+#ifdef HAVE_JSON_C
+#include <json-c/json.h>
+#endif
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+// =============================================================================
+// Harness helpers
+// =============================================================================
+
+static PriorityContext engine; // Every benchmark starts and ends with it empty
+static int saved_stdout = -1;
+static int checks_failed = 0; // Correctness checks that failed; main then exits with 1
+
+// display_feed prints every post; silence it while timing
+static void quiet_begin() {
+    fflush(stdout);
+    saved_stdout = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull >= 0) {
+        dup2(devnull, STDOUT_FILENO);
+        close(devnull);
+    }
+}
+
+static void quiet_end() {
+    fflush(stdout);
+    if (saved_stdout >= 0) {
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+        saved_stdout = -1;
+    }
+}
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// =============================================================================
+// Benchmark: record footprint
+// =============================================================================
+
+// Record layouts before the string arena, kept only for sizeof comparisons
+#define LEGACY_MAX_USERNAME 500000
+#define LEGACY_MAX_PASSWORD 500000
+#define LEGACY_MAX_POST_CONTENT 5000000
+#define LEGACY_MAX_MESSAGE_CONTENT 300000
+#define LEGACY_MAX_FILENAME 1000000
+
+typedef struct LegacyUser {
+    int user_id;
+    char username[LEGACY_MAX_USERNAME];
+    char password[LEGACY_MAX_PASSWORD];
+    time_t created_at;
+    struct LegacyUser* next;
+} LegacyUser;
+
+typedef struct LegacyPost {
+    int post_id;
+    int author_id;
+    char author_name[LEGACY_MAX_USERNAME];
+    char content[LEGACY_MAX_POST_CONTENT];
+    time_t created_at;
+    int priority;
+    MediaType media_type;
+    char media_path[LEGACY_MAX_FILENAME];
+    char media_description[500];
+    struct LegacyPost* next;
+} LegacyPost;
+
+typedef struct LegacyMessage {
+    int message_id;
+    int sender_id;
+    int receiver_id;
+    char sender_name[LEGACY_MAX_USERNAME];
+    char content[LEGACY_MAX_MESSAGE_CONTENT];
+    time_t timestamp;
+    int priority;
+    struct LegacyMessage* next;
+} LegacyMessage;
+
+typedef struct LegacyNotification {
+    int notif_id;
+    int user_id;
+    char content[LEGACY_MAX_MESSAGE_CONTENT];
+    time_t timestamp;
+    int priority;
+    int is_read;
+    struct LegacyNotification* next;
+} LegacyNotification;
+
+static void bench_records() {
+    const int user_count = 1000;
+    const int post_count = 200000;
+    const double gib = 1024.0 * 1024.0 * 1024.0;
+
+    printf("\n=== BENCHMARK: record footprint ===\n");
+    printf("%-14s %14s %10s\n", "record", "before (B)", "after (B)");
+    printf("%-14s %14zu %10zu\n", "User", sizeof(LegacyUser), sizeof(User));
+    printf("%-14s %14zu %10zu\n", "Post", sizeof(LegacyPost), sizeof(Post));
+    printf("%-14s %14zu %10zu\n", "Message", sizeof(LegacyMessage), sizeof(Message));
+    printf("%-14s %14zu %10zu\n", "Notification", sizeof(LegacyNotification), sizeof(Notification));
+
+    char name[MAX_USERNAME];
+    for (int i = 0; i < user_count; i++) {
+        sprintf(name, "user%d", i);
+        register_user(&engine, name, "password123");
+    }
+    size_t arena_before = engine.text_arena.used;
+
+    // Typical short-form posts: 60-200 characters of text
+    char content[MAX_POST_CONTENT];
+    engine.current_user = engine.users_head;
+    for (int i = 0; i < post_count; i++) {
+        int len = 60 + (i * 37) % 140;
+        for (int j = 0; j < len; j++) {
+            content[j] = 'a' + (i + j) % 26;
+        }
+        content[len] = '\0';
+        create_post(&engine, content);
+    }
+
+    double arena_per_post = (double)(engine.text_arena.used - arena_before) / post_count;
+    double after_per_post = sizeof(Post) + arena_per_post;
+    printf("\nPosts created: %d (avg text %.1f B in arena)\n", post_count, arena_per_post);
+    printf("Bytes per post:  before %zu, after %.1f\n", sizeof(LegacyPost), after_per_post);
+    printf("Posts per GiB:   before %.0f, after %.0f\n",
+           gib / sizeof(LegacyPost), gib / after_per_post);
+    cleanup_data(&engine);
+}
+
+// =============================================================================
+// Benchmark: feeds served from small-stack worker threads
+// =============================================================================
+
+#define FEED_THREADS 4
+#define FEED_THREAD_STACK (256 * 1024)
+#define FEEDS_PER_THREAD 50
+
+typedef struct FeedWorker {
+    size_t grows_after_warmup;
+    int ok;
+} FeedWorker;
+
+static void* feed_worker(void* arg) {
+    FeedWorker* worker = (FeedWorker*)arg;
+
+    display_feed(&engine); // Warm-up sizes this thread's scratch buffers
+    size_t warm = scratch_grow_count();
+    for (int i = 0; i < FEEDS_PER_THREAD; i++) {
+        display_feed(&engine);
+    }
+    worker->grows_after_warmup = scratch_grow_count() - warm;
+    worker->ok = 1;
+
+    scratch_pool_free();
+    return NULL;
+}
+
+static void bench_feed_threads() {
+    const int user_count = 2000;
+    const int followed = 300;
+    const int close_friends = 50;
+    const int posts_per_author = 20;
+
+    printf("\n=== BENCHMARK: feeds on %d threads with %d KB stacks ===\n",
+           FEED_THREADS, FEED_THREAD_STACK / 1024);
+
+    quiet_begin();
+    char name[MAX_USERNAME];
+    for (int i = 0; i < user_count; i++) {
+        sprintf(name, "user%d", i);
+        register_user(&engine, name, "password123");
+    }
+    for (User* author = engine.users_head; author != NULL; author = author->next) {
+        if (author->user_id > followed + 1) continue;
+        engine.current_user = author;
+        for (int p = 0; p < posts_per_author; p++) {
+            create_post(&engine, "Benchmark post body with a few words of text");
+        }
+    }
+    engine.current_user = find_user_by_id(&engine, 1);
+    for (int id = 2; id <= followed + 1; id++) {
+        follow_user(&engine, id);
+        if (id <= close_friends + 1) {
+            add_close_friend(&engine, id);
+        }
+    }
+    display_feed(&engine); // Builds the shared timeline so worker reads do not write
+    quiet_end();
+
+    int page[TIMELINE_LANE_CAPACITY];
+    int shown = timeline_page(&engine, 1, TIMELINE_PRIORITY, page, TIMELINE_LANE_CAPACITY) +
+                timeline_page(&engine, 1, TIMELINE_REGULAR, page, TIMELINE_LANE_CAPACITY);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, FEED_THREAD_STACK);
+
+    pthread_t threads[FEED_THREADS];
+    FeedWorker workers[FEED_THREADS];
+    memset(workers, 0, sizeof(workers));
+
+    quiet_begin();
+    double start = now_seconds();
+    int started = 0;
+    for (int i = 0; i < FEED_THREADS; i++) {
+        if (pthread_create(&threads[i], &attr, feed_worker, &workers[i]) == 0) {
+            started++;
+        }
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = now_seconds() - start;
+    quiet_end();
+    pthread_attr_destroy(&attr);
+
+    size_t grows = 0;
+    int ok = 0;
+    for (int i = 0; i < started; i++) {
+        grows += workers[i].grows_after_warmup;
+        ok += workers[i].ok;
+    }
+    int feeds = ok * (FEEDS_PER_THREAD + 1);
+    printf("Threads completed: %d/%d\n", ok, FEED_THREADS);
+    printf("Feeds served: %d (%d posts each) in %.2f s, %.0f feeds/sec\n",
+           feeds, shown, elapsed, feeds / elapsed);
+    printf("Scratch reallocations after warm-up: %zu\n", grows);
+    cleanup_data(&engine);
+}
+
+// =============================================================================
+// Benchmark: user lookups by id and username
+// =============================================================================
+
+#define LOOKUP_QUERIES 2000000
+#define LIST_SCAN_QUERIES 2000
+#define LIST_SCAN_MAX_USERS 100000
+
+// The pre-index lookup path, kept for comparison
+static User* list_find_user_by_id(int user_id) {
+    for (User* temp = engine.users_head; temp != NULL; temp = temp->next) {
+        if (temp->user_id == user_id) {
+            return temp;
+        }
+    }
+    return NULL;
+}
+
+static void bench_user_lookup() {
+    const int sizes[] = {10000, 100000, 1000000, 10000000};
+    int size_count = (int)(sizeof(sizes) / sizeof(sizes[0]));
+    const char* limit = getenv("BENCH_MAX_USERS");
+    int max_users = limit ? atoi(limit) : sizes[size_count - 1];
+
+    printf("\n=== BENCHMARK: user lookups ===\n");
+    printf("%10s %16s %16s %16s\n", "users", "by id/s", "by name/s", "list scan/s");
+
+    char name[MAX_USERNAME];
+    for (int s = 0; s < size_count && sizes[s] <= max_users; s++) {
+        int users = sizes[s];
+        for (int i = 0; i < users; i++) {
+            sprintf(name, "user%d", i);
+            register_user(&engine, name, "password123");
+        }
+
+        // Pseudo-random ids so probes do not walk the table in order
+        unsigned int seed = 12345;
+        long found = 0;
+        double start = now_seconds();
+        for (int q = 0; q < LOOKUP_QUERIES; q++) {
+            seed = seed * 1103515245u + 12345u;
+            found += find_user_by_id(&engine, 1 + (int)(seed % (unsigned int)users)) != NULL;
+        }
+        double by_id = LOOKUP_QUERIES / (now_seconds() - start);
+
+        // Names are formatted ahead of time so only the lookup is timed
+        const int name_batch = 4096;
+        char (*names)[MAX_USERNAME] = malloc((size_t)name_batch * MAX_USERNAME);
+        for (int i = 0; i < name_batch; i++) {
+            seed = seed * 1103515245u + 12345u;
+            sprintf(names[i], "user%u", seed % (unsigned int)users);
+        }
+        start = now_seconds();
+        for (int q = 0; q < LOOKUP_QUERIES; q++) {
+            found += find_user_by_username(&engine, names[q % name_batch]) != NULL;
+        }
+        double by_name = LOOKUP_QUERIES / (now_seconds() - start);
+        free(names);
+
+        double by_scan = 0;
+        if (users <= LIST_SCAN_MAX_USERS) {
+            start = now_seconds();
+            for (int q = 0; q < LIST_SCAN_QUERIES; q++) {
+                seed = seed * 1103515245u + 12345u;
+                found += list_find_user_by_id(1 + (int)(seed % (unsigned int)users)) != NULL;
+            }
+            by_scan = LIST_SCAN_QUERIES / (now_seconds() - start);
+        }
+
+        if (by_scan > 0) {
+            printf("%10d %16.0f %16.0f %16.0f\n", users, by_id, by_name, by_scan);
+        } else {
+            printf("%10d %16.0f %16.0f %16s\n", users, by_id, by_name, "-");
+        }
+        if (found == 0) {
+            printf("(no users found?)\n");
+        }
+        cleanup_data(&engine);
+    }
+}
+
+// =============================================================================
+// Benchmark: follow graph
+// =============================================================================
+
+#define GRAPH_USERS 200000
+#define GRAPH_EDGES 4000000
+#define GRAPH_QUERIES 4000000
+
+static void bench_follow_graph() {
+    printf("\n=== BENCHMARK: follow graph (%d users, %d edges) ===\n", GRAPH_USERS, GRAPH_EDGES);
+
+    // Skewed targets: a quarter of all follows go to the first 1000 users
+    unsigned int seed = 42;
+    Follow* edges = malloc((size_t)GRAPH_EDGES * sizeof(Follow));
+    for (int i = 0; i < GRAPH_EDGES; i++) {
+        seed = seed * 1103515245u + 12345u;
+        edges[i].follower_id = 1 + (int)(seed % GRAPH_USERS);
+        seed = seed * 1103515245u + 12345u;
+        int popular = (seed >> 4) % 4 == 0;
+        seed = seed * 1103515245u + 12345u;
+        edges[i].following_id = 1 + (int)(seed % (popular ? 1000 : GRAPH_USERS));
+    }
+
+    // Bulk build, as load_data does
+    double start = now_seconds();
+    follow_graph_build(&engine.follow_graph, edges, GRAPH_EDGES);
+    double build = now_seconds() - start;
+    printf("Bulk build:           %10.0f edges/sec (%zu unique)\n",
+           GRAPH_EDGES / build, engine.follow_graph.edge_count);
+    follow_graph_free(&engine.follow_graph);
+
+    // Incremental inserts, as follow_user does
+    start = now_seconds();
+    for (int i = 0; i < GRAPH_EDGES; i++) {
+        follow_graph_add(&engine.follow_graph, edges[i].follower_id, edges[i].following_id);
+    }
+    double inserts = now_seconds() - start;
+    printf("Incremental insert:   %10.0f edges/sec\n", GRAPH_EDGES / inserts);
+
+    long hits = 0;
+    start = now_seconds();
+    for (int q = 0; q < GRAPH_QUERIES; q++) {
+        seed = seed * 1103515245u + 12345u;
+        const Follow* edge = &edges[seed % GRAPH_EDGES];
+        hits += follow_graph_has(&engine.follow_graph, edge->follower_id, edge->following_id);
+        hits += follow_graph_has(&engine.follow_graph, edge->following_id, edge->follower_id);
+    }
+    double lookups = now_seconds() - start;
+    printf("is_following:         %10.0f lookups/sec\n", 2.0 * GRAPH_QUERIES / lookups);
+
+    start = now_seconds();
+    for (int q = 0; q < GRAPH_QUERIES; q++) {
+        int user_id = 1 + q % GRAPH_USERS;
+        hits += follow_graph_follower_count(&engine.follow_graph, user_id);
+        hits += follow_graph_following_count(&engine.follow_graph, user_id);
+    }
+    double counts = now_seconds() - start;
+    printf("Follower counts:      %10.0f lookups/sec\n", 2.0 * GRAPH_QUERIES / counts);
+
+    start = now_seconds();
+    for (int i = 0; i < GRAPH_EDGES; i += 10) {
+        follow_graph_remove(&engine.follow_graph, edges[i].follower_id, edges[i].following_id);
+    }
+    double removes = now_seconds() - start;
+    printf("Unfollow:             %10.0f edges/sec\n", (GRAPH_EDGES / 10) / removes);
+    printf("Edges remaining: %zu (checksum %ld)\n", engine.follow_graph.edge_count, hits);
+
+    free(edges);
+    cleanup_data(&engine);
+}
+
+// =============================================================================
+// Driver
+// =============================================================================
+
+typedef struct Benchmark {
+    const char* name;
+    void (*run)();
+} Benchmark;
+
+#define FANOUT_FOLLOWERS 100000
+#define FANOUT_FRIENDS_PER_USER 20
+#define FANOUT_ROUNDS 50
+
+static void bench_close_friend_fanout() {
+    printf("\n=== BENCHMARK: close-friend fan-out (%d followers) ===\n", FANOUT_FOLLOWERS);
+
+    register_user(&engine, "author", "pw");
+    login_user(&engine, "author", "pw");
+    int author_id = engine.current_user->user_id;
+
+    // Every follower keeps a close-friends list; one in ten includes the author
+    unsigned int seed = 7;
+    size_t pair_count = (size_t)FANOUT_FOLLOWERS * FANOUT_FRIENDS_PER_USER;
+    Follow* edges = malloc(FANOUT_FOLLOWERS * sizeof(Follow));
+    Follow* pairs = malloc(pair_count * sizeof(Follow));
+    size_t p = 0;
+    for (int i = 0; i < FANOUT_FOLLOWERS; i++) {
+        int follower_id = author_id + 1 + i;
+        edges[i].follower_id = follower_id;
+        edges[i].following_id = author_id;
+        for (int f = 0; f < FANOUT_FRIENDS_PER_USER; f++) {
+            seed = seed * 1103515245u + 12345u;
+            pairs[p].follower_id = follower_id;
+            pairs[p].following_id = (f == 0 && i % 10 == 0) ?
+                author_id : author_id + 1 + (int)(seed % FANOUT_FOLLOWERS);
+            p++;
+        }
+    }
+    follow_graph_build(&engine.follow_graph, edges, FANOUT_FOLLOWERS);
+    close_friends_build(&engine.close_friends, pairs, pair_count);
+
+    int* ids = malloc(FANOUT_FOLLOWERS * sizeof(int));
+    unsigned char* bitmap = malloc((FANOUT_FOLLOWERS + 7) / 8);
+    EdgeIter iter;
+    int n = 0, id;
+    follow_graph_followers(&engine.follow_graph, author_id, &iter);
+    while (edge_iter_next(&iter, &id)) {
+        ids[n++] = id;
+    }
+
+    // Baseline: one is_close_friend probe per follower
+    long single_hits = 0;
+    double start = now_seconds();
+    for (int r = 0; r < FANOUT_ROUNDS; r++) {
+        for (int i = 0; i < n; i++) {
+            single_hits += is_close_friend(&engine, ids[i], author_id);
+        }
+    }
+    double single = now_seconds() - start;
+
+    long batch_hits = 0;
+    start = now_seconds();
+    for (int r = 0; r < FANOUT_ROUNDS; r++) {
+        close_friends_priority_bitmap(&engine.close_friends, author_id, ids, n, bitmap);
+        for (int i = 0; i < n; i++) {
+            batch_hits += BITMAP_TEST(bitmap, i);
+        }
+    }
+    double batch = now_seconds() - start;
+
+    printf("Per-follower lookups: %10.2f ms per fan-out\n", single * 1000 / FANOUT_ROUNDS);
+    printf("Batched bitmap:       %10.2f ms per fan-out\n", batch * 1000 / FANOUT_ROUNDS);
+    printf("Priority followers:   %ld of %d (%s)\n", batch_hits / FANOUT_ROUNDS, n,
+           batch_hits == single_hits ? "results match" : "MISMATCH");
+
+    // Whole create_post path, including notification allocation
+    start = now_seconds();
+    create_post(&engine, "fan-out benchmark post");
+    double post = now_seconds() - start;
+    printf("create_post fan-out:  %10.2f ms (%d notifications)\n",
+           post * 1000, engine.next_notif_id - 1);
+
+    free(ids);
+    free(bitmap);
+    free(edges);
+    free(pairs);
+    cleanup_data(&engine);
+}
+
+#define TIMELINE_USERS 20000
+#define TIMELINE_FOLLOWS 50
+#define TIMELINE_POSTS 50000
+#define TIMELINE_READS 2000
+
+// Old display_feed: scan every post and test follows and priority per post
+static int scan_feed(int reader_id, int* priority_page, int* regular_page) {
+    int priority_count = 0, regular_count = 0;
+    for (size_t i = engine.post_store.post_count; i-- > 0;) {
+        const Post* post = post_store_at(&engine.post_store, i);
+        if (post->author_id != reader_id && !is_following(&engine, reader_id, post->author_id)) {
+            continue;
+        }
+        if (post->author_id == reader_id || is_close_friend(&engine, reader_id, post->author_id)) {
+            if (priority_count < TIMELINE_LANE_CAPACITY) {
+                priority_page[priority_count++] = post->post_id;
+            }
+        } else if (regular_count < TIMELINE_LANE_CAPACITY) {
+            regular_page[regular_count++] = post->post_id;
+        }
+    }
+    return priority_count + regular_count;
+}
+
+static void bench_home_timeline() {
+    printf("\n=== BENCHMARK: home timeline (%d users, %d posts, celebrity with %d followers) ===\n",
+           TIMELINE_USERS, TIMELINE_POSTS, TIMELINE_USERS - 1);
+
+    char name[MAX_USERNAME];
+    for (int i = 1; i <= TIMELINE_USERS; i++) {
+        sprintf(name, "user%d", i);
+        register_user(&engine, name, "pw");
+    }
+    // User 1 is followed by everyone, so their posts are pulled on read
+    unsigned int seed = 11;
+    for (int id = 2; id <= TIMELINE_USERS; id++) {
+        follow_graph_add(&engine.follow_graph, id, 1);
+        for (int f = 0; f < TIMELINE_FOLLOWS; f++) {
+            seed = seed * 1103515245u + 12345u;
+            int target = 2 + (int)(seed % (TIMELINE_USERS - 1));
+            if (target != id) {
+                follow_graph_add(&engine.follow_graph, id, target);
+            }
+        }
+    }
+    // Every reader has built a timeline before posting starts
+    int page[TIMELINE_LANE_CAPACITY], regular[TIMELINE_LANE_CAPACITY];
+    for (int id = 1; id <= TIMELINE_USERS; id++) {
+        timeline_page(&engine, id, TIMELINE_REGULAR, page, TIMELINE_LANE_CAPACITY);
+    }
+    double start = now_seconds();
+    for (int p = 0; p < TIMELINE_POSTS; p++) {
+        seed = seed * 1103515245u + 12345u;
+        engine.current_user = find_user_by_id(&engine, p % 1000 == 0 ? 1 : 1 + (int)(seed % TIMELINE_USERS));
+        create_post(&engine, "Timeline benchmark post");
+    }
+    double writes = now_seconds() - start;
+    printf("Posts with fan-out:   %10.0f posts/sec (%d notifications)\n",
+           TIMELINE_POSTS / writes, engine.next_notif_id - 1);
+
+    long checksum = 0;
+    start = now_seconds();
+    for (int r = 0; r < TIMELINE_READS / 100; r++) {
+        checksum += scan_feed(2 + r, page, regular);
+    }
+    double scan = (now_seconds() - start) / (TIMELINE_READS / 100);
+
+    start = now_seconds();
+    for (int r = 0; r < TIMELINE_READS; r++) {
+        int reader = 2 + r % (TIMELINE_USERS - 1);
+        checksum += timeline_page(&engine, reader, TIMELINE_PRIORITY, page, TIMELINE_LANE_CAPACITY);
+        checksum += timeline_page(&engine, reader, TIMELINE_REGULAR, page, TIMELINE_LANE_CAPACITY);
+    }
+    double read = (now_seconds() - start) / TIMELINE_READS;
+
+    printf("Full-scan feed:       %10.3f ms per read\n", scan * 1000);
+    printf("Timeline page:        %10.3f ms per read (checksum %ld)\n", read * 1000, checksum);
+    cleanup_data(&engine);
+}
+
+#define PAGED_AUTHORS 2000
+#define PAGED_POSTS_PER_AUTHOR 100
+#define PAGED_QUERIES 2000
+
+static void bench_feed_pages() {
+    printf("\n=== BENCHMARK: paged feed (reader follows %d authors, %d posts) ===\n",
+           PAGED_AUTHORS, PAGED_AUTHORS * PAGED_POSTS_PER_AUTHOR);
+
+    char name[MAX_USERNAME];
+    for (int i = 0; i <= PAGED_AUTHORS; i++) {
+        sprintf(name, "user%d", i);
+        register_user(&engine, name, "pw");
+    }
+    engine.current_user = find_user_by_id(&engine, 1);
+    for (int id = 2; id <= PAGED_AUTHORS + 1; id++) {
+        follow_user(&engine, id);
+        if (id % 10 == 0) {
+            add_close_friend(&engine, id);
+        }
+    }
+    for (int p = 0; p < PAGED_POSTS_PER_AUTHOR; p++) {
+        for (int id = 2; id <= PAGED_AUTHORS + 1; id++) {
+            engine.current_user = find_user_by_id(&engine, id);
+            create_post(&engine, "Paged feed benchmark post");
+        }
+    }
+
+    int page_ids[TIMELINE_LANE_CAPACITY], regular[TIMELINE_LANE_CAPACITY];
+    long checksum = 0;
+    double start = now_seconds();
+    for (int q = 0; q < PAGED_QUERIES / 100; q++) {
+        checksum += scan_feed(1, page_ids, regular);
+    }
+    double scan = (now_seconds() - start) / (PAGED_QUERIES / 100);
+
+    FeedPage page;
+    FeedCursor first = {TIMELINE_PRIORITY, 0};
+    start = now_seconds();
+    for (int q = 0; q < PAGED_QUERIES; q++) {
+        checksum += feed_query(&engine, 1, first, FEED_PAGE_SIZE, &page);
+    }
+    double first_page = (now_seconds() - start) / PAGED_QUERIES;
+
+    // Walk 50 pages in, past what the home timeline holds
+    FeedCursor deep = first;
+    for (int p = 0; p < 50; p++) {
+        feed_query(&engine, 1, deep, FEED_PAGE_SIZE, &page);
+        deep = page.next;
+    }
+    start = now_seconds();
+    for (int q = 0; q < PAGED_QUERIES; q++) {
+        checksum += feed_query(&engine, 1, deep, FEED_PAGE_SIZE, &page);
+    }
+    double deep_page = (now_seconds() - start) / PAGED_QUERIES;
+
+    printf("Full-scan feed:       %10.3f ms per read\n", scan * 1000);
+    printf("First page of %d:     %10.3f ms per read\n", FEED_PAGE_SIZE, first_page * 1000);
+    printf("Page 51 (heap merge): %10.3f ms per read (checksum %ld)\n", deep_page * 1000, checksum);
+    cleanup_data(&engine);
+}
+
+#define STORE_POSTS 1000000
+#define STORE_AUTHORS 10000
+#define STORE_QUERIES 200000
+#define STORE_SCANS 20
+
+static void bench_post_store() {
+    printf("\n=== BENCHMARK: post store (%d posts, %d authors) ===\n", STORE_POSTS, STORE_AUTHORS);
+
+    unsigned int seed = 5;
+    time_t base = 1700000000;
+    double start = now_seconds();
+    for (int i = 1; i <= STORE_POSTS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        Post post = {0};
+        post.post_id = i;
+        post.author_id = 1 + (int)(seed % STORE_AUTHORS);
+        post.created_at = base + i;
+        post_store_append(&engine.post_store, &post);
+    }
+    double append = now_seconds() - start;
+    printf("Append:               %10.0f posts/sec (%d chunks)\n",
+           STORE_POSTS / append, engine.post_store.chunk_count);
+
+    Post* out[10];
+    long checksum = 0;
+    start = now_seconds();
+    for (int q = 0; q < STORE_QUERIES; q++) {
+        checksum += post_store_latest(&engine.post_store, 1 + q % STORE_AUTHORS, 10, out);
+    }
+    double latest = now_seconds() - start;
+
+    // "Since T" for the newest 1% of the timeline
+    time_t since = base + STORE_POSTS - STORE_POSTS / 100;
+    start = now_seconds();
+    for (int q = 0; q < STORE_QUERIES; q++) {
+        checksum += post_store_since(&engine.post_store, 1 + q % STORE_AUTHORS, since, out, 10);
+    }
+    double recent = now_seconds() - start;
+
+    // Baseline: walk every post, as display_user_posts did over posts_head
+    start = now_seconds();
+    for (int q = 0; q < STORE_SCANS; q++) {
+        int author_id = 1 + q % STORE_AUTHORS;
+        for (size_t i = engine.post_store.post_count; i-- > 0;) {
+            const Post* post = post_store_at(&engine.post_store, i);
+            checksum += post->author_id == author_id && post->created_at >= since;
+        }
+    }
+    double scan = now_seconds() - start;
+
+    printf("Latest 10 by author:  %10.0f queries/sec\n", STORE_QUERIES / latest);
+    printf("By author since T:    %10.0f queries/sec\n", STORE_QUERIES / recent);
+    printf("Full scan baseline:   %10.0f queries/sec (checksum %ld)\n", STORE_SCANS / scan, checksum);
+    cleanup_data(&engine);
+}
+
+#define RANK_POSTS 1000000
+#define RANK_AUTHORS 10000
+#define RANK_FOLLOWED 500
+#define RANK_TOGGLES 200
+#define LEGACY_RANK_POSTS 20000
+
+// The move-to-front prioritize_posts this replaces, over main.c-style lists
+typedef struct LegacyRankPost {
+    int author_id;
+    struct LegacyRankPost* next;
+} LegacyRankPost;
+
+typedef struct LegacyRankFollow {
+    int follower_id;
+    int following_id;
+    struct LegacyRankFollow* next;
+} LegacyRankFollow;
+
+static LegacyRankPost* legacy_prioritize(LegacyRankPost* posts, LegacyRankFollow* follows, int viewer) {
+    LegacyRankPost* prev = NULL;
+    LegacyRankPost* current = posts;
+    LegacyRankPost* priority_posts = NULL;
+    while (current != NULL) {
+        LegacyRankPost* next = current->next;
+        int followed = 0;
+        for (LegacyRankFollow* f = follows; f != NULL; f = f->next) {
+            if (f->follower_id == viewer && f->following_id == current->author_id) {
+                followed = 1;
+                break;
+            }
+        }
+        if (followed) {
+            if (prev != NULL) prev->next = next; else posts = next;
+            current->next = priority_posts;
+            priority_posts = current;
+        } else {
+            prev = current;
+        }
+        current = next;
+    }
+    if (priority_posts != NULL) {
+        LegacyRankPost* last = priority_posts;
+        while (last->next != NULL) last = last->next;
+        last->next = posts;
+        posts = priority_posts;
+    }
+    return posts;
+}
+
+static void rank_entries(FeedRankEntry* entries, int count) {
+    for (int i = 0; i < count; i++) {
+        entries[i].post_id = i + 1;
+        entries[i].author_id = 1 + (int)(((unsigned)i * 2654435761u) % RANK_AUTHORS);
+        entries[i].timestamp = 1700000000LL + i / 3; // Several posts share a second
+        entries[i].flags = (i % 97 == 0) ? FEED_RANK_PINNED : 0;
+        entries[i].record = NULL;
+    }
+}
+
+static FeedRankLane rank_lane(const FeedRankEntry* entry, const char* followed) {
+    return ((entry->flags & FEED_RANK_PINNED) || followed[entry->author_id]) ?
+           FEED_RANK_PRIORITY : FEED_RANK_REGULAR;
+}
+
+static int rank_same_order(const FeedRank* a, const FeedRank* b) {
+    if (feed_rank_count(a) != feed_rank_count(b)) return 0;
+    for (size_t i = 0; i < feed_rank_count(a); i++) {
+        if (feed_rank_at(a, i, NULL)->post_id != feed_rank_at(b, i, NULL)->post_id) return 0;
+    }
+    return 1;
+}
+
+static void bench_feed_rank() {
+    printf("\n=== BENCHMARK: incremental feed ranking (%d posts, %d authors) ===\n",
+           RANK_POSTS, RANK_AUTHORS);
+
+    char* followed = calloc(RANK_AUTHORS + 1, 1);
+    for (int i = 0; i < RANK_FOLLOWED; i++) {
+        followed[1 + i * (RANK_AUTHORS / RANK_FOLLOWED)] = 1;
+    }
+    FeedRankEntry* entries = malloc(RANK_POSTS * sizeof(FeedRankEntry));
+    rank_entries(entries, RANK_POSTS);
+
+    // Posts arriving in time order, as new posts do
+    FeedRank in_order;
+    feed_rank_init(&in_order, 1);
+    double start = now_seconds();
+    for (int i = 0; i < RANK_POSTS; i++) {
+        feed_rank_add(&in_order, &entries[i], rank_lane(&entries[i], followed));
+    }
+    double append = now_seconds() - start;
+
+    // A sample added in shuffled order, forwards and backwards, must rank identically
+    unsigned int seed = 3;
+    for (int i = RANK_POSTS - 1; i > 0; i--) {
+        seed = seed * 1103515245u + 12345u;
+        int j = (int)(seed % (unsigned)(i + 1));
+        FeedRankEntry swap = entries[i];
+        entries[i] = entries[j];
+        entries[j] = swap;
+    }
+    FeedRank forward, backward;
+    feed_rank_init(&forward, 1);
+    feed_rank_init(&backward, 1);
+    for (int i = 0; i < RANK_POSTS / 100; i++) {
+        feed_rank_add(&forward, &entries[i], rank_lane(&entries[i], followed));
+    }
+    for (int i = RANK_POSTS / 100 - 1; i >= 0; i--) {
+        feed_rank_add(&backward, &entries[i], rank_lane(&entries[i], followed));
+    }
+    int deterministic = rank_same_order(&forward, &backward);
+
+    // Follow then unfollow, checking the order returns exactly
+    FeedRank before;
+    feed_rank_init(&before, 1);
+    for (size_t i = feed_rank_count(&in_order); i-- > 0;) {
+        FeedRankLane lane = FEED_RANK_PRIORITY;
+        const FeedRankEntry* entry = feed_rank_at(&in_order, i, &lane);
+        feed_rank_add(&before, entry, lane);
+    }
+    start = now_seconds();
+    for (int t = 0; t < RANK_TOGGLES; t++) {
+        int author = 2 + t * 7;
+        int priority = !followed[author];
+        feed_rank_set_author(&in_order, author, priority);
+        feed_rank_set_author(&in_order, author, !priority);
+    }
+    double toggles = now_seconds() - start;
+    deterministic = deterministic && rank_same_order(&in_order, &before);
+
+    // Legacy move-to-front on a smaller feed
+    LegacyRankPost* legacy_posts = NULL;
+    LegacyRankFollow* legacy_follows = NULL;
+    LegacyRankPost* post_nodes = malloc(LEGACY_RANK_POSTS * sizeof(LegacyRankPost));
+    LegacyRankFollow* follow_nodes = malloc(RANK_FOLLOWED * sizeof(LegacyRankFollow));
+    for (int i = 0; i < LEGACY_RANK_POSTS; i++) {
+        post_nodes[i].author_id = 1 + (int)(((unsigned)i * 2654435761u) % RANK_AUTHORS);
+        post_nodes[i].next = legacy_posts;
+        legacy_posts = &post_nodes[i];
+    }
+    for (int i = 0; i < RANK_FOLLOWED; i++) {
+        follow_nodes[i].follower_id = 1;
+        follow_nodes[i].following_id = 1 + i * (RANK_AUTHORS / RANK_FOLLOWED);
+        follow_nodes[i].next = legacy_follows;
+        legacy_follows = &follow_nodes[i];
+    }
+    start = now_seconds();
+    legacy_posts = legacy_prioritize(legacy_posts, legacy_follows, 1);
+    double legacy = now_seconds() - start;
+
+    printf("Insert new posts:     %10.0f posts/sec\n", RANK_POSTS / append);
+    printf("Follow/unfollow:      %10.2f ms per change (%zu ranked posts)\n",
+           toggles * 1000 / (2 * RANK_TOGGLES), feed_rank_count(&in_order));
+    printf("Legacy full re-rank:  %10.2f ms for %d posts, %d follows\n",
+           legacy * 1000, LEGACY_RANK_POSTS, RANK_FOLLOWED);
+    printf("Deterministic order:  %s\n", deterministic ? "yes" : "NO");
+    checks_failed += !deterministic;
+
+    feed_rank_free(&in_order);
+    feed_rank_free(&forward);
+    feed_rank_free(&backward);
+    feed_rank_free(&before);
+    free(post_nodes);
+    free(follow_nodes);
+    free(entries);
+    free(followed);
+}
+
+// =============================================================================
+// Benchmark: feed JSON serialization
+// =============================================================================
+
+// The post fields main.c sends to the frontend
+typedef struct JsonBenchPost {
+    int id;
+    int author_id;
+    char author_name[50];
+    char content[500];
+    long long timestamp;
+    int is_close_friends_only;
+    char media_type[20];
+    char media_path[200];
+    char media_description[200];
+} JsonBenchPost;
+
+#define JSON_POSTS 100000
+#define JSON_ROUNDS 5
+
+static void json_bench_posts(JsonBenchPost* posts, int count) {
+    for (int i = 0; i < count; i++) {
+        JsonBenchPost* post = &posts[i];
+        memset(post, 0, sizeof(*post));
+        post->id = i + 1;
+        post->author_id = 1 + i % 1000;
+        post->timestamp = 1700000000000LL + i;
+        post->is_close_friends_only = (i % 10 == 0);
+        snprintf(post->author_name, sizeof(post->author_name), "user_%d", post->author_id);
+        snprintf(post->content, sizeof(post->content),
+                 "Post %d: \"quoted\" text,\nsecond line with a tab\there and some ordinary "
+                 "words to make it a realistic length for a status update", i);
+        strcpy(post->media_type, i % 3 ? "text" : "image");
+        snprintf(post->media_path, sizeof(post->media_path), "media/images/photo_%d.jpg", i);
+        strcpy(post->media_description, "A caption for the picture");
+    }
+}
+
+static void json_bench_write(JsonWriter* w, const JsonBenchPost* posts, int count) {
+    json_writer_begin_array(w);
+    for (int i = 0; i < count; i++) {
+        const JsonBenchPost* post = &posts[i];
+        json_writer_begin_object(w);
+        json_writer_key(w, "id"); json_writer_int(w, post->id);
+        json_writer_key(w, "authorId"); json_writer_int(w, post->author_id);
+        json_writer_key(w, "authorName"); json_writer_string(w, post->author_name);
+        json_writer_key(w, "content"); json_writer_string(w, post->content);
+        json_writer_key(w, "timestamp"); json_writer_int64(w, post->timestamp);
+        json_writer_key(w, "isCloseFriendsOnly"); json_writer_bool(w, post->is_close_friends_only);
+        json_writer_key(w, "mediaType"); json_writer_string(w, post->media_type);
+        json_writer_key(w, "mediaPath"); json_writer_string(w, post->media_path);
+        json_writer_key(w, "mediaDescription"); json_writer_string(w, post->media_description);
+        json_writer_key(w, "priorityWeight"); json_writer_int(w, post->is_close_friends_only ? 10 : 1);
+        json_writer_end_object(w);
+    }
+    json_writer_end_array(w);
+}
+
+#ifdef HAVE_JSON_C
+// The object-tree path main.c used before json_writer.h
+static char* json_bench_json_c(const JsonBenchPost* posts, int count) {
+    json_object* array = json_object_new_array();
+    for (int i = 0; i < count; i++) {
+        const JsonBenchPost* post = &posts[i];
+        json_object* obj = json_object_new_object();
+        json_object_object_add(obj, "id", json_object_new_int(post->id));
+        json_object_object_add(obj, "authorId", json_object_new_int(post->author_id));
+        json_object_object_add(obj, "authorName", json_object_new_string(post->author_name));
+        json_object_object_add(obj, "content", json_object_new_string(post->content));
+        json_object_object_add(obj, "timestamp", json_object_new_int64(post->timestamp));
+        json_object_object_add(obj, "isCloseFriendsOnly", json_object_new_boolean(post->is_close_friends_only));
+        json_object_object_add(obj, "mediaType", json_object_new_string(post->media_type));
+        json_object_object_add(obj, "mediaPath", json_object_new_string(post->media_path));
+        json_object_object_add(obj, "mediaDescription", json_object_new_string(post->media_description));
+        json_object_object_add(obj, "priorityWeight", json_object_new_int(post->is_close_friends_only ? 10 : 1));
+        json_object_array_add(array, obj);
+    }
+    const char* text = json_object_to_json_string(array);
+    char* result = malloc(strlen(text) + 1);
+    strcpy(result, text);
+    json_object_put(array);
+    return result;
+}
+#endif
+
+static void bench_json_feed() {
+    printf("\n=== BENCHMARK: feed JSON serialization (%d posts) ===\n", JSON_POSTS);
+
+    JsonBenchPost* posts = malloc(JSON_POSTS * sizeof(JsonBenchPost));
+    json_bench_posts(posts, JSON_POSTS);
+
+    size_t bytes = 0;
+    double start = now_seconds();
+    for (int r = 0; r < JSON_ROUNDS; r++) {
+        JsonWriter w;
+        json_writer_init(&w);
+        json_bench_write(&w, posts, JSON_POSTS);
+        char* text = json_writer_take(&w);
+        bytes = text ? strlen(text) : 0;
+        free(text);
+    }
+    double buffered = (now_seconds() - start) / JSON_ROUNDS;
+
+    // Streaming to a descriptor keeps only about one chunk in memory
+    int devnull = open("/dev/null", O_WRONLY);
+    size_t peak = 0;
+    int streamed_ok = 1;
+    start = now_seconds();
+    for (int r = 0; r < JSON_ROUNDS; r++) {
+        JsonWriter w;
+        json_writer_init_fd(&w, devnull, JSON_WRITER_CHUNK_SIZE);
+        json_bench_write(&w, posts, JSON_POSTS);
+        streamed_ok = json_writer_finish(&w) && streamed_ok;
+        peak = w.capacity;
+        json_writer_free(&w);
+    }
+    double streamed = (now_seconds() - start) / JSON_ROUNDS;
+    if (devnull >= 0) {
+        close(devnull);
+    }
+
+    printf("Output size:          %10.1f MB\n", bytes / 1e6);
+    printf("Writer to buffer:     %10.2f ms (%.0f MB/s)\n", buffered * 1000, bytes / buffered / 1e6);
+    printf("Writer to fd:         %10.2f ms (buffer peak %zu KB%s)\n",
+           streamed * 1000, peak / 1024, streamed_ok ? "" : ", WRITE FAILED");
+#ifdef HAVE_JSON_C
+    size_t json_c_bytes = 0;
+    start = now_seconds();
+    for (int r = 0; r < JSON_ROUNDS; r++) {
+        char* text = json_bench_json_c(posts, JSON_POSTS);
+        json_c_bytes = strlen(text);
+        free(text);
+    }
+    double json_c = (now_seconds() - start) / JSON_ROUNDS;
+    printf("json-c object tree:   %10.2f ms (%.1f MB output)\n", json_c * 1000, json_c_bytes / 1e6);
+#else
+    printf("json-c object tree:   (build with make bench-json to compare)\n");
+#endif
+    free(posts);
+}
+
+// =============================================================================
+// Benchmark: lock-free reads under concurrent writes
+// =============================================================================
+
+#define CONCURRENT_USERS 20000
+#define CONCURRENT_FOLLOWS 20
+#define CONCURRENT_FRIENDS 5
+#define CONCURRENT_OPS 200000 // Per thread
+#define CONCURRENT_WRITE_EVERY 100 // 1% writes
+
+static const int concurrent_threads[] = {1, 2, 4, 8, 16};
+static pthread_rwlock_t concurrent_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+
+typedef struct ConcurrentWorker {
+    int use_rwlock; // Baseline: readers share a rwlock with the writers
+    unsigned int seed;
+    long checksum;
+    int ok;
+} ConcurrentWorker;
+
+static unsigned int concurrent_next(unsigned int* seed) {
+    *seed = *seed * 1103515245u + 12345u;
+    return *seed >> 4;
+}
+
+// One of the read paths served by the feed and profile endpoints
+static long concurrent_read(unsigned int* seed) {
+    int user_id = 1 + (int)(concurrent_next(seed) % CONCURRENT_USERS);
+    int other_id = 1 + (int)(concurrent_next(seed) % CONCURRENT_USERS);
+    long hits = 0;
+    switch (concurrent_next(seed) % 4) {
+        case 0:
+            hits += is_following(&engine, user_id, other_id);
+            hits += follow_graph_follower_count(&engine.follow_graph, other_id);
+            break;
+        case 1: {
+            User* user = find_user_by_id(&engine, user_id);
+            if (user != NULL) {
+                hits += find_user_by_username(&engine, arena_str(&engine, user->username)) == user;
+            }
+            break;
+        }
+        case 2:
+            hits += is_close_friend(&engine, user_id, other_id);
+            break;
+        default: {
+            EdgeIter iter;
+            int friend_id;
+            close_friends_list(&engine.close_friends, user_id, &iter);
+            while (edge_iter_next(&iter, &friend_id)) {
+                hits += friend_id;
+            }
+            break;
+        }
+    }
+    return hits;
+}
+
+// Toggles a follow or a close friend, as the API handlers do
+static void concurrent_write(unsigned int* seed) {
+    int user_id = 1 + (int)(concurrent_next(seed) % CONCURRENT_USERS);
+    int other_id = 1 + (int)(concurrent_next(seed) % CONCURRENT_USERS);
+    priority_write_begin(&engine);
+    engine.current_user = find_user_by_id(&engine, user_id);
+    if (!is_following(&engine, user_id, other_id)) {
+        follow_user(&engine, other_id);
+    } else if (is_close_friend(&engine, user_id, other_id)) {
+        remove_close_friend(&engine, other_id);
+    } else if (concurrent_next(seed) % 2) {
+        add_close_friend(&engine, other_id);
+    } else {
+        unfollow_user(&engine, other_id);
+    }
+    engine.current_user = NULL;
+    priority_write_end(&engine);
+}
+
+static void* concurrent_worker(void* arg) {
+    ConcurrentWorker* worker = (ConcurrentWorker*)arg;
+    int reader = priority_reader_register(&engine);
+    if (reader < 0) {
+        return NULL;
+    }
+    
+    for (int op = 0; op < CONCURRENT_OPS; op++) {
+        if (op % CONCURRENT_WRITE_EVERY == 0) {
+            if (worker->use_rwlock) pthread_rwlock_wrlock(&concurrent_rwlock);
+            concurrent_write(&worker->seed);
+            if (worker->use_rwlock) pthread_rwlock_unlock(&concurrent_rwlock);
+        } else if (worker->use_rwlock) {
+            pthread_rwlock_rdlock(&concurrent_rwlock);
+            worker->checksum += concurrent_read(&worker->seed);
+            pthread_rwlock_unlock(&concurrent_rwlock);
+        } else {
+            priority_read_begin(&engine, reader);
+            worker->checksum += concurrent_read(&worker->seed);
+            priority_read_end(&engine, reader);
+        }
+    }
+    
+    priority_reader_unregister(&engine, reader);
+    worker->ok = 1;
+    return NULL;
+}
+
+// Returns operations per second over all threads
+static double concurrent_run(int thread_count, int use_rwlock) {
+    pthread_t threads[16];
+    ConcurrentWorker workers[16];
+    memset(workers, 0, sizeof(workers));
+    
+    double start = now_seconds();
+    int started = 0;
+    for (int i = 0; i < thread_count; i++) {
+        workers[i].use_rwlock = use_rwlock;
+        workers[i].seed = 1000u + (unsigned int)i;
+        if (pthread_create(&threads[started], NULL, concurrent_worker, &workers[i]) == 0) {
+            started++;
+        }
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = now_seconds() - start;
+    
+    int ok = 0;
+    for (int i = 0; i < started; i++) {
+        ok += workers[i].ok;
+    }
+    return (double)ok * CONCURRENT_OPS / elapsed;
+}
+
+static void bench_concurrent_reads() {
+    printf("\n=== BENCHMARK: concurrent reads (%d users, 1%% writes) ===\n", CONCURRENT_USERS);
+    
+    char name[MAX_USERNAME];
+    for (int i = 0; i < CONCURRENT_USERS; i++) {
+        sprintf(name, "user%d", i);
+        register_user(&engine, name, "password123");
+    }
+    
+    unsigned int seed = 11;
+    size_t edge_count = (size_t)CONCURRENT_USERS * CONCURRENT_FOLLOWS;
+    size_t pair_count = (size_t)CONCURRENT_USERS * CONCURRENT_FRIENDS;
+    Follow* edges = malloc(edge_count * sizeof(Follow));
+    Follow* pairs = malloc(pair_count * sizeof(Follow));
+    for (size_t i = 0; i < edge_count; i++) {
+        edges[i].follower_id = 1 + (int)(i / CONCURRENT_FOLLOWS);
+        edges[i].following_id = 1 + (int)(concurrent_next(&seed) % CONCURRENT_USERS);
+        if (i % CONCURRENT_FOLLOWS < CONCURRENT_FRIENDS) {
+            pairs[i / CONCURRENT_FOLLOWS * CONCURRENT_FRIENDS + i % CONCURRENT_FOLLOWS] = edges[i];
+        }
+    }
+    follow_graph_build(&engine.follow_graph, edges, edge_count);
+    close_friends_build(&engine.close_friends, pairs, pair_count);
+    free(edges);
+    free(pairs);
+    
+    printf("Threads   rwlock ops/sec   epoch ops/sec   speedup\n");
+    for (size_t t = 0; t < sizeof(concurrent_threads) / sizeof(concurrent_threads[0]); t++) {
+        int thread_count = concurrent_threads[t];
+        double locked = concurrent_run(thread_count, 1);
+        double epoch = concurrent_run(thread_count, 0);
+        printf("%7d   %14.0f   %13.0f   %6.2fx\n", thread_count, locked, epoch, epoch / locked);
+    }
+    printf("Retired blocks freed: %zu (%zu pending)\n",
+           engine.epoch.freed_count, engine.epoch.retired_count);
+    cleanup_data(&engine);
+}
+
+// =============================================================================
+// Benchmark: write-ahead log
+// =============================================================================
+
+#define WAL_BENCH_USERS 20000
+#define WAL_BENCH_FOLLOWS 5 // Per user
+#define WAL_BENCH_SINGLE_OPS 2000 // Mutations timed with one fsync each
+
+static size_t wal_bench_mutate(int user_count, int follows) {
+    char name[MAX_USERNAME];
+    int first = engine.next_user_id;
+    for (int i = 0; i < user_count; i++) {
+        sprintf(name, "wal%d", first + i);
+        register_user(&engine, name, "password123");
+    }
+    size_t ops = (size_t)user_count;
+    unsigned int seed = 5;
+    for (int id = first; id < first + user_count; id++) {
+        engine.current_user = find_user_by_id(&engine, id);
+        for (int f = 0; f < follows; f++) {
+            seed = seed * 1103515245u + 12345u;
+            ops += follow_user(&engine, first + (int)((seed >> 4) % user_count));
+        }
+        ops += create_post(&engine, "Benchmark post body with a few words of text") > 0;
+    }
+    engine.current_user = NULL;
+    return ops;
+}
+
+static void bench_wal() {
+    printf("\n=== BENCHMARK: write-ahead log (%d users) ===\n", WAL_BENCH_USERS);
+    
+    char dir[] = "/tmp/priority_walXXXXXX";
+    char cwd[4096];
+    if (getcwd(cwd, sizeof(cwd)) == NULL || mkdtemp(dir) == NULL || chdir(dir) != 0) {
+        printf("Could not create a scratch directory\n");
+        return;
+    }
+    
+    // Every mutation logged, fsync'd in groups
+    wal_open(&engine, WAL_PATH);
+    double start = now_seconds();
+    size_t ops = wal_bench_mutate(WAL_BENCH_USERS, WAL_BENCH_FOLLOWS);
+    wal_sync(&engine);
+    double grouped = now_seconds() - start;
+    size_t records = (size_t)engine.wal.next_lsn - 1;
+    size_t syncs = engine.wal.sync_count;
+    printf("Group commit:         %10.0f mutations/sec (%zu records, %zu fsyncs)\n",
+           ops / grouped, records, syncs);
+    
+    // Baseline: an fsync per mutation
+    start = now_seconds();
+    for (int i = 0; i < WAL_BENCH_SINGLE_OPS; i++) {
+        engine.current_user = find_user_by_id(&engine, 1 + i);
+        send_message(&engine, 2 + i, "hi");
+        wal_sync(&engine);
+    }
+    double single = now_seconds() - start;
+    printf("fsync per mutation:   %10.0f mutations/sec\n", WAL_BENCH_SINGLE_OPS / single);
+    
+    // Startup: the last snapshot plus the log written since
+    wal_close(&engine);
+    struct stat info;
+    stat(WAL_PATH, &info);
+    cleanup_data(&engine);
+    start = now_seconds();
+    load_data(&engine);
+    wal_open(&engine, WAL_PATH);
+    double startup = now_seconds() - start;
+    printf("Startup:              %10.2f ms (%.1f MB log replayed, %zu posts)\n",
+           startup * 1000, info.st_size / 1e6, engine.post_store.post_count);
+    
+    // What every save used to cost, now paid once per WAL_SNAPSHOT_RECORDS
+    start = now_seconds();
+    wal_snapshot(&engine);
+    double snapshot = now_seconds() - start;
+    printf("Snapshot (data.snap): %10.2f ms\n", snapshot * 1000);
+    
+    cleanup_data(&engine);
+    const char* files[] = {WAL_PATH, SNAPSHOT_PATH};
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        unlink(files[i]);
+    }
+    if (chdir(cwd) == 0) {
+        rmdir(dir);
+    }
+}
+
+// =============================================================================
+// Benchmark: binary snapshot
+// =============================================================================
+
+#define SNAPSHOT_BENCH_USERS 20000
+#define SNAPSHOT_BENCH_POSTS 25 // Per user
+#define SNAPSHOT_BENCH_FOLLOWS 10 // Per user
+
+static const char* snapshot_bench_files[] = {
+    SNAPSHOT_PATH, "users.dat", "posts.dat", "messages.dat", "follows.dat",
+    "close_friends.dat", "notifications.dat", "counters.dat"
+};
+
+static void snapshot_bench_fill() {
+    char name[MAX_USERNAME];
+    char text[128];
+    for (int i = 1; i <= SNAPSHOT_BENCH_USERS; i++) {
+        sprintf(name, "snap%d", i);
+        register_user(&engine, name, "password123");
+    }
+    unsigned int seed = 11;
+    for (int id = 1; id <= SNAPSHOT_BENCH_USERS; id++) {
+        engine.current_user = find_user_by_id(&engine, id);
+        for (int f = 0; f < SNAPSHOT_BENCH_FOLLOWS; f++) {
+            seed = seed * 1103515245u + 12345u;
+            follow_user(&engine, 1 + (int)((seed >> 4) % SNAPSHOT_BENCH_USERS));
+        }
+        add_close_friend(&engine, id % SNAPSHOT_BENCH_USERS + 1);
+        send_message(&engine, id % SNAPSHOT_BENCH_USERS + 1, "See you at the meetup tonight");
+    }
+    // Posts interleave across authors, as they would arrive
+    for (int p = 0; p < SNAPSHOT_BENCH_POSTS; p++) {
+        for (int id = 1; id <= SNAPSHOT_BENCH_USERS; id++) {
+            engine.current_user = find_user_by_id(&engine, id);
+            sprintf(text, "Post %d from user %d with a sentence or two of body text", p, id);
+            create_post(&engine, text);
+        }
+    }
+    engine.current_user = NULL;
+}
+
+static double snapshot_bench_first_page() {
+    FeedPage page;
+    FeedCursor cursor = {TIMELINE_PRIORITY, 0};
+    double start = now_seconds();
+    feed_query(&engine, SNAPSHOT_BENCH_USERS / 2, cursor, FEED_PAGE_MAX, &page);
+    return now_seconds() - start;
+}
+
+static void bench_snapshot() {
+    printf("\n=== BENCHMARK: startup from text files vs mapped snapshot (%d users, %d posts) ===\n",
+           SNAPSHOT_BENCH_USERS, SNAPSHOT_BENCH_USERS * SNAPSHOT_BENCH_POSTS);
+    
+    char dir[] = "/tmp/priority_snapXXXXXX";
+    char cwd[4096];
+    if (getcwd(cwd, sizeof(cwd)) == NULL || mkdtemp(dir) == NULL || chdir(dir) != 0) {
+        printf("Could not create a scratch directory\n");
+        return;
+    }
+    
+    snapshot_bench_fill();
+    size_t posts = engine.post_store.post_count;
+    size_t edges = engine.follow_graph.edge_count;
+    double start = now_seconds();
+    save_data(&engine);
+    double text_save = now_seconds() - start;
+    start = now_seconds();
+    snapshot_save(&engine, SNAPSHOT_PATH);
+    double snap_save = now_seconds() - start;
+    cleanup_data(&engine);
+    
+    struct stat info;
+    off_t text_bytes = 0;
+    for (size_t i = 1; i < sizeof(snapshot_bench_files) / sizeof(snapshot_bench_files[0]); i++) {
+        if (stat(snapshot_bench_files[i], &info) == 0) {
+            text_bytes += info.st_size;
+        }
+    }
+    stat(SNAPSHOT_PATH, &info);
+    
+    // The text loader runs whenever there is no snapshot
+    rename(SNAPSHOT_PATH, "keep.snap");
+    start = now_seconds();
+    load_data(&engine);
+    double text_load = now_seconds() - start;
+    int text_ok = engine.post_store.post_count == posts && engine.follow_graph.edge_count == edges;
+    double text_page = snapshot_bench_first_page();
+    cleanup_data(&engine);
+    rename("keep.snap", SNAPSHOT_PATH);
+    
+    start = now_seconds();
+    load_data(&engine);
+    double snap_load = now_seconds() - start;
+    int snap_ok = engine.post_store.post_count == posts && engine.follow_graph.edge_count == edges;
+    double snap_page = snapshot_bench_first_page();
+    
+    printf("Format       Size (MB)   Save (ms)   Load (ms)   First page (ms)   Complete\n");
+    printf("text .dat    %9.1f   %9.1f   %9.1f   %15.2f   %s\n", text_bytes / 1e6,
+           text_save * 1000, text_load * 1000, text_page * 1000, text_ok ? "yes" : "NO");
+    printf("data.snap    %9.1f   %9.1f   %9.1f   %15.2f   %s\n", info.st_size / 1e6,
+           snap_save * 1000, snap_load * 1000, snap_page * 1000, snap_ok ? "yes" : "NO");
+    printf("Startup speedup: %.1fx\n", text_load / snap_load);
+    
+    cleanup_data(&engine);
+    for (size_t i = 0; i < sizeof(snapshot_bench_files) / sizeof(snapshot_bench_files[0]); i++) {
+        unlink(snapshot_bench_files[i]);
+    }
+    if (chdir(cwd) == 0) {
+        rmdir(dir);
+    }
+}
+
+// =============================================================================
+// Benchmark: .dat text codec
+// =============================================================================
+
+#define TEXT_BENCH_USERS 2000
+#define TEXT_BENCH_POSTS 200000
+#define TEXT_BENCH_ROUNDS 3
+
+static const char* text_bench_files[] = {
+    "users.dat", "posts.dat", "messages.dat", "follows.dat",
+    "close_friends.dat", "notifications.dat", "counters.dat", "legacy_posts.dat"
+};
+
+// Mostly plain text; some posts carry separators, some are longer than the
+// old 1000-byte line buffer
+static void text_bench_content(char* text, size_t size, int i) {
+    static const char words[] = "the quick brown fox jumps over a lazy dog while ";
+    size_t len = i % 100 == 0 ? 6000 : 40 + (size_t)(i * 37) % 260;
+    if (len >= size) {
+        len = size - 1;
+    }
+    for (size_t k = 0; k < len; k++) {
+        text[k] = words[(k + (size_t)i) % (sizeof(words) - 1)];
+    }
+    text[len] = '\0';
+    if (i % 20 == 1) {
+        text[len / 2] = '|';
+    } else if (i % 20 == 2) {
+        text[len / 3] = '\n';
+    }
+}
+
+// The loader before the codec: fgets into a fixed line, sscanf into fixed fields
+static size_t text_bench_legacy_parse(const char* path, size_t* intact) {
+    FILE* file = fopen(path, "r");
+    char line[1000];
+    size_t parsed = 0;
+    *intact = 0;
+    if (file == NULL) {
+        return 0;
+    }
+    while (fgets(line, sizeof(line), file)) {
+        Post post;
+        int media_type_int = MEDIA_NONE;
+        char author_name[MAX_USERNAME] = "";
+        char content[MAX_POST_CONTENT] = "";
+        char media_path[MAX_FILENAME] = "";
+        char media_description[MAX_MEDIA_DESCRIPTION] = "";
+        if (sscanf(line, "%d|%d|%49[^|]|%4999[^|]|%ld|%d|%d|%999[^|]|%499[^|\n]",
+                   &post.post_id, &post.author_id, author_name, content, &post.created_at,
+                   &post.priority, &media_type_int, media_path, media_description) >= 6) {
+            parsed++;
+            Post* stored = post_store_find(&engine.post_store, post.post_id);
+            *intact += stored != NULL && strcmp(arena_str(&engine, stored->content), content) == 0;
+        }
+    }
+    fclose(file);
+    return parsed;
+}
+
+static size_t text_bench_codec_parse(const char* path, size_t* intact) {
+    FILE* file = fopen(path, "r");
+    DatReader reader;
+    size_t parsed = 0;
+    *intact = 0;
+    if (file == NULL) {
+        return 0;
+    }
+    dat_reader_open(&reader, file);
+    while (dat_reader_next(&reader)) {
+        int post_id, author_id, priority, media_type;
+        long long created_at;
+        if (dat_field_int(&reader, 0, &post_id) && dat_field_int(&reader, 1, &author_id) &&
+            dat_field_long(&reader, 4, &created_at) && dat_field_int(&reader, 5, &priority)) {
+            dat_field_int(&reader, 6, &media_type);
+            parsed++;
+            Post* stored = post_store_find(&engine.post_store, post_id);
+            *intact += stored != NULL && strcmp(arena_str(&engine, stored->content), dat_field_str(&reader, 3)) == 0;
+        }
+    }
+    dat_reader_free(&reader);
+    fclose(file);
+    return parsed;
+}
+
+static double text_bench_mb(const char* path) {
+    struct stat info;
+    return stat(path, &info) == 0 ? info.st_size / 1e6 : 0;
+}
+
+static void bench_text_codec() {
+    printf("\n=== BENCHMARK: .dat text codec (%d posts) ===\n", TEXT_BENCH_POSTS);
+    
+    char dir[] = "/tmp/priority_textXXXXXX";
+    char cwd[4096];
+    if (getcwd(cwd, sizeof(cwd)) == NULL || mkdtemp(dir) == NULL || chdir(dir) != 0) {
+        printf("Could not create a scratch directory\n");
+        return;
+    }
+    
+    char name[MAX_USERNAME];
+    for (int i = 1; i <= TEXT_BENCH_USERS; i++) {
+        sprintf(name, "text%d", i);
+        register_user(&engine, name, "password123");
+    }
+    static char text[8192];
+    for (int i = 0; i < TEXT_BENCH_POSTS; i++) {
+        engine.current_user = find_user_by_id(&engine, 1 + i % TEXT_BENCH_USERS);
+        text_bench_content(text, sizeof(text), i);
+        create_post(&engine, text);
+    }
+    engine.current_user = NULL;
+    
+    // Same posts in the old unescaped layout
+    FILE* legacy = fopen("legacy_posts.dat", "w");
+    for (size_t i = 0; legacy != NULL && i < engine.post_store.post_count; i++) {
+        Post* post = post_store_at(&engine.post_store, i);
+        fprintf(legacy, "%d|%d|%s|%s|%ld|%d|%d|%s|%s\n",
+                post->post_id, post->author_id, arena_str(&engine, post->author_name),
+                arena_str(&engine, post->content), (long)post->created_at, post->priority,
+                post->media_type, arena_str(&engine, post->media_path),
+                arena_str(&engine, post->media_description));
+    }
+    if (legacy != NULL) {
+        fclose(legacy);
+    }
+    double start = now_seconds();
+    save_data(&engine);
+    double save = now_seconds() - start;
+    
+    // Parse only: posts.dat records to fields, nothing interned
+    size_t legacy_parsed = 0, legacy_intact = 0, codec_parsed = 0, codec_intact = 0;
+    double legacy_best = 1e9, codec_best = 1e9;
+    for (int round = 0; round < TEXT_BENCH_ROUNDS; round++) {
+        start = now_seconds();
+        legacy_parsed = text_bench_legacy_parse("legacy_posts.dat", &legacy_intact);
+        double elapsed = now_seconds() - start;
+        legacy_best = elapsed < legacy_best ? elapsed : legacy_best;
+        
+        start = now_seconds();
+        codec_parsed = text_bench_codec_parse("posts.dat", &codec_intact);
+        elapsed = now_seconds() - start;
+        codec_best = elapsed < codec_best ? elapsed : codec_best;
+    }
+    size_t posts = engine.post_store.post_count;
+    double legacy_mb = text_bench_mb("legacy_posts.dat");
+    double codec_mb = text_bench_mb("posts.dat");
+    printf("Parser          MB/s   Records   Intact\n");
+    printf("fgets+sscanf  %6.0f   %7zu   %6zu / %zu\n", legacy_mb / legacy_best, legacy_parsed, legacy_intact, posts);
+    printf("dat_codec     %6.0f   %7zu   %6zu / %zu\n", codec_mb / codec_best, codec_parsed, codec_intact, posts);
+    
+    // Whole load_data over every file, strings interned and indexes built
+    double total_mb = 0;
+    for (size_t i = 0; i + 1 < sizeof(text_bench_files) / sizeof(text_bench_files[0]); i++) {
+        total_mb += text_bench_mb(text_bench_files[i]);
+    }
+    cleanup_data(&engine);
+    start = now_seconds();
+    load_data(&engine);
+    double load = now_seconds() - start;
+    printf("save_data: %.1f MB in %.1f ms (%.0f MB/s)\n", total_mb, save * 1000, total_mb / save);
+    printf("load_data: %.1f MB in %.1f ms (%.0f MB/s, %zu posts)\n",
+           total_mb, load * 1000, total_mb / load, engine.post_store.post_count);
+    
+    cleanup_data(&engine);
+    for (size_t i = 0; i < sizeof(text_bench_files) / sizeof(text_bench_files[0]); i++) {
+        unlink(text_bench_files[i]);
+    }
+    if (chdir(cwd) == 0) {
+        rmdir(dir);
+    }
+}
+
+// =============================================================================
+// Benchmark: parallel .dat load
+// =============================================================================
+
+#define PARALLEL_BENCH_ROUNDS 2
+
+static void bench_parallel_load() {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("\n=== BENCHMARK: load_data from .dat files by thread count (%ld cores) ===\n", cores);
+    
+    char dir[] = "/tmp/priority_loadXXXXXX";
+    char cwd[4096];
+    if (getcwd(cwd, sizeof(cwd)) == NULL || mkdtemp(dir) == NULL || chdir(dir) != 0) {
+        printf("Could not create a scratch directory\n");
+        return;
+    }
+    
+    snapshot_bench_fill();
+    size_t posts = engine.post_store.post_count;
+    size_t edges = engine.follow_graph.edge_count;
+    save_data(&engine);
+    cleanup_data(&engine);
+    double total_mb = 0;
+    for (size_t i = 1; i < sizeof(snapshot_bench_files) / sizeof(snapshot_bench_files[0]); i++) {
+        total_mb += text_bench_mb(snapshot_bench_files[i]);
+    }
+    
+    static const int thread_counts[] = {1, 2, 4, 8};
+    double single = 0;
+    printf("Threads   Load (ms)    MB/s   Speedup   Complete\n");
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        double best = 1e9;
+        int complete = 1;
+        for (int round = 0; round < PARALLEL_BENCH_ROUNDS; round++) {
+            engine.load_threads = thread_counts[t];
+            double start = now_seconds();
+            load_data(&engine);
+            double elapsed = now_seconds() - start;
+            best = elapsed < best ? elapsed : best;
+            complete = complete && engine.post_store.post_count == posts && engine.follow_graph.edge_count == edges;
+            cleanup_data(&engine);
+        }
+        single = t == 0 ? best : single;
+        printf("%7d   %9.1f   %5.0f   %6.2fx   %s\n", thread_counts[t], best * 1000,
+               total_mb / best, single / best, complete ? "yes" : "NO");
+    }
+    engine.load_threads = 0;
+    
+    for (size_t i = 0; i < sizeof(snapshot_bench_files) / sizeof(snapshot_bench_files[0]); i++) {
+        unlink(snapshot_bench_files[i]);
+    }
+    if (chdir(cwd) == 0) {
+        rmdir(dir);
+    }
+}
+
+// =============================================================================
+// Benchmark: slab allocation of records
+// =============================================================================
+
+#define SLAB_BENCH_RECORDS 5000000
+#define SLAB_BENCH_ENGINE_NOTIFICATIONS 1000000
+
+static long slab_bench_rss_kb() {
+    long size = 0, resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm == NULL || fscanf(statm, "%ld %ld", &size, &resident) != 2) {
+        resident = 0;
+    }
+    if (statm != NULL) {
+        fclose(statm);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// One allocator per child process, so neither inherits the other's heap
+static void slab_bench_run(int use_slab) {
+    SlabAllocator slab;
+    slab_init(&slab, sizeof(Notification));
+    // Written up front so the pointer table is not counted as record memory
+    // (not with zeros, which the compiler may turn into an untouched calloc)
+    Notification** nodes = (Notification**)malloc(SLAB_BENCH_RECORDS * sizeof(Notification*));
+    if (nodes == NULL) {
+        return;
+    }
+    memset(nodes, 0xff, SLAB_BENCH_RECORDS * sizeof(Notification*));
+    int count = 0;
+    long rss_before = slab_bench_rss_kb();
+    double start = now_seconds();
+    for (int i = 0; i < SLAB_BENCH_RECORDS; i++) {
+        Notification* notif = use_slab ? (Notification*)slab_alloc(&slab)
+                                       : (Notification*)malloc(sizeof(Notification));
+        if (notif == NULL) {
+            break;
+        }
+        notif->notif_id = i;
+        notif->user_id = i % 1000;
+        notif->content = 0;
+        notif->timestamp = 0;
+        notif->priority = i & 1;
+        notif->is_read = 0;
+        nodes[count++] = notif;
+    }
+    double insert = now_seconds() - start;
+    long rss = slab_bench_rss_kb() - rss_before;
+    
+    start = now_seconds();
+    if (use_slab) {
+        slab_release(&slab);
+    } else {
+        for (int i = 0; i < count; i++) {
+            free(nodes[i]);
+        }
+    }
+    free(nodes);
+    double teardown = now_seconds() - start;
+    printf("%-8s %10.1f   %8.1f   %11.1f   %13.1f\n", use_slab ? "slab" : "malloc",
+           SLAB_BENCH_RECORDS / insert / 1e6, rss / 1024.0,
+           rss * 1024.0 / SLAB_BENCH_RECORDS, teardown * 1000);
+}
+
+static void bench_slab() {
+    printf("\n=== BENCHMARK: %d notification nodes, malloc vs slab (%zu-byte records) ===\n",
+           SLAB_BENCH_RECORDS, sizeof(Notification));
+    printf("Alloc    Minserts/s   RSS (MB)   Bytes/record   Teardown (ms)\n");
+    for (int use_slab = 0; use_slab <= 1; use_slab++) {
+        fflush(stdout);
+        pid_t child = fork();
+        if (child == 0) {
+            slab_bench_run(use_slab);
+            fflush(stdout);
+            _exit(0);
+        }
+        if (child > 0) {
+            waitpid(child, NULL, 0);
+        }
+    }
+    
+    // The same counters the web server reports at /api/stats
+    double start = now_seconds();
+    for (int i = 0; i < SLAB_BENCH_ENGINE_NOTIFICATIONS; i++) {
+        add_notification(&engine, 1 + i % 1000, "Someone started following you", i & 1);
+    }
+    double elapsed = now_seconds() - start;
+    const SlabAllocator* slab = &engine.notification_slab;
+    printf("add_notification: %.2f M/s; slab live %zu, blocks %zu, reserved %.1f MB\n",
+           SLAB_BENCH_ENGINE_NOTIFICATIONS / elapsed / 1e6, slab->live, slab->block_count,
+           slab_reserved_bytes(slab) / 1e6);
+    cleanup_data(&engine);
+}
+
+// =============================================================================
+// Benchmark: conversation reads
+// =============================================================================
+
+#define CONVERSATION_BENCH_USERS 10000
+#define CONVERSATION_BENCH_MESSAGES 1000000
+#define CONVERSATION_BENCH_PAIR_MESSAGES 2000 // Between users 1 and 2
+#define CONVERSATION_BENCH_READS 20
+
+// display_conversation before the store: scan every message, bubble sort
+static int conversation_bench_legacy(int user_id, int other_id, Message** out) {
+    int count = 0;
+    for (Message* msg = engine.messages_head; msg != NULL; msg = msg->next) {
+        if ((msg->sender_id == user_id && msg->receiver_id == other_id) ||
+            (msg->sender_id == other_id && msg->receiver_id == user_id)) {
+            out[count++] = msg;
+        }
+    }
+    for (int i = 0; i < count - 1; i++) {
+        for (int j = 0; j < count - i - 1; j++) {
+            if (out[j]->timestamp > out[j + 1]->timestamp) {
+                Message* temp = out[j];
+                out[j] = out[j + 1];
+                out[j + 1] = temp;
+            }
+        }
+    }
+    return count;
+}
+
+static void bench_conversation() {
+    printf("\n=== BENCHMARK: one %d-message conversation among %d messages ===\n",
+           CONVERSATION_BENCH_PAIR_MESSAGES, CONVERSATION_BENCH_MESSAGES);
+    
+    char name[MAX_USERNAME];
+    for (int i = 1; i <= CONVERSATION_BENCH_USERS; i++) {
+        sprintf(name, "chat%d", i);
+        register_user(&engine, name, "password123");
+    }
+    unsigned int seed = 5;
+    int pair_every = CONVERSATION_BENCH_MESSAGES / CONVERSATION_BENCH_PAIR_MESSAGES;
+    double start = now_seconds();
+    for (int i = 0; i < CONVERSATION_BENCH_MESSAGES; i++) {
+        int sender, receiver;
+        if (i % pair_every == 0) {
+            sender = 1 + (i / pair_every) % 2;
+            receiver = 3 - sender;
+        } else {
+            seed = seed * 1103515245u + 12345u;
+            sender = 3 + (int)((seed >> 4) % (CONVERSATION_BENCH_USERS - 2));
+            receiver = 3 + (int)((seed >> 12) % (CONVERSATION_BENCH_USERS - 2));
+            receiver = receiver == sender ? 1 + receiver % CONVERSATION_BENCH_USERS : receiver;
+        }
+        engine.current_user = find_user_by_id(&engine, sender);
+        send_message(&engine, receiver, "Are we still on for tomorrow?");
+    }
+    engine.current_user = NULL;
+    double send = now_seconds() - start;
+    
+    static Message* legacy[CONVERSATION_BENCH_PAIR_MESSAGES];
+    int legacy_count = 0;
+    start = now_seconds();
+    for (int r = 0; r < CONVERSATION_BENCH_READS; r++) {
+        legacy_count = conversation_bench_legacy(1, 2, legacy);
+    }
+    double legacy_read = (now_seconds() - start) / CONVERSATION_BENCH_READS;
+    
+    const Conversation* conv = NULL;
+    start = now_seconds();
+    for (int r = 0; r < CONVERSATION_BENCH_READS; r++) {
+        conv = conversation_find(&engine, 1, 2);
+    }
+    double full_read = (now_seconds() - start) / CONVERSATION_BENCH_READS;
+    
+    // Walk the whole conversation back page by page
+    ConversationPage page;
+    int pages = 0, paged = 0;
+    start = now_seconds();
+    for (int before = 0;; before = page.next_before_id) {
+        paged += conversation_page(&engine, 2, 1, before, CONVERSATION_PAGE_SIZE, &page);
+        pages++;
+        if (!page.has_more) {
+            break;
+        }
+    }
+    double page_read = (now_seconds() - start) / pages;
+    
+    const Conversation* recent[20];
+    start = now_seconds();
+    int recent_count = conversation_recent(&engine, 1, recent, 20);
+    double recent_read = now_seconds() - start;
+    
+    printf("send_message with conversation index: %.2f M/s\n", CONVERSATION_BENCH_MESSAGES / send / 1e6);
+    printf("Read                          Messages   Time (us)\n");
+    printf("scan + bubble sort (before)   %8d   %9.1f\n", legacy_count, legacy_read * 1e6);
+    printf("conversation_find             %8d   %9.1f\n", conv ? conv->count : 0, full_read * 1e6);
+    printf("conversation_page (%d/page)   %8d   %9.1f per page\n", CONVERSATION_PAGE_SIZE, paged, page_read * 1e6);
+    printf("conversation_recent (user 1)  %8d   %9.1f\n", recent_count, recent_read * 1e6);
+    cleanup_data(&engine);
+}
+
+// =============================================================================
+// Benchmark: two-lane inboxes
+// =============================================================================
+
+#define INBOX_BENCH_USERS 10000
+#define INBOX_BENCH_MESSAGES 1000000
+#define INBOX_BENCH_CLOSE_FRIENDS 10 // Of user 1, who gets every 100th message
+#define INBOX_BENCH_SCANS 20
+#define INBOX_BENCH_BATCH 100
+
+// Next unread message before the inbox: scan every message, close friends
+// first, oldest first
+static Message* inbox_bench_legacy(int user_id) {
+    Message* best = NULL;
+    for (Message* msg = engine.messages_head; msg != NULL; msg = msg->next) {
+        if (msg->receiver_id != user_id || msg->is_read) {
+            continue;
+        }
+        if (best == NULL || msg->priority > best->priority ||
+            (msg->priority == best->priority && msg->message_id < best->message_id)) {
+            best = msg;
+        }
+    }
+    return best;
+}
+
+static void bench_inbox() {
+    printf("\n=== BENCHMARK: inboxes for %d users, %d messages ===\n",
+           INBOX_BENCH_USERS, INBOX_BENCH_MESSAGES);
+    
+    char name[MAX_USERNAME];
+    for (int i = 1; i <= INBOX_BENCH_USERS; i++) {
+        sprintf(name, "inbox%d", i);
+        register_user(&engine, name, "password123");
+    }
+    engine.current_user = find_user_by_id(&engine, 1);
+    for (int id = 2; id <= 1 + INBOX_BENCH_CLOSE_FRIENDS; id++) {
+        follow_user(&engine, id);
+        add_close_friend(&engine, id);
+    }
+    
+    unsigned int seed = 11;
+    double start = now_seconds();
+    for (int i = 0; i < INBOX_BENCH_MESSAGES; i++) {
+        seed = seed * 1103515245u + 12345u;
+        int sender = 2 + (int)((seed >> 4) % (INBOX_BENCH_USERS - 1));
+        int receiver = 1;
+        if (i % 200 == 0) {
+            sender = 2 + (i / 200) % INBOX_BENCH_CLOSE_FRIENDS; // Half of user 1's mail
+        } else if (i % 100 != 0) {
+            receiver = 2 + (int)((seed >> 12) % (INBOX_BENCH_USERS - 1));
+            receiver = receiver == sender ? 1 + receiver % INBOX_BENCH_USERS : receiver;
+        }
+        engine.current_user = find_user_by_id(&engine, sender);
+        send_message(&engine, receiver, "Are we still on for tomorrow?");
+    }
+    engine.current_user = NULL;
+    double send = now_seconds() - start;
+    
+    int priority_unread;
+    int unread = inbox_unread(&engine, 1, &priority_unread, NULL);
+    Message* legacy = NULL;
+    start = now_seconds();
+    for (int r = 0; r < INBOX_BENCH_SCANS; r++) {
+        legacy = inbox_bench_legacy(1);
+    }
+    double legacy_next = (now_seconds() - start) / INBOX_BENCH_SCANS;
+    
+    // User 1 reads one message at a time, then everyone else drains in batches
+    Message* first = NULL;
+    start = now_seconds();
+    for (int r = 0; r < unread; r++) {
+        Message* msg = inbox_next(&engine, 1);
+        first = first ? first : msg;
+    }
+    double next = (now_seconds() - start) / (unread ? unread : 1);
+    
+    static Message* batch[INBOX_BENCH_BATCH];
+    long drained = 0;
+    start = now_seconds();
+    for (int id = 2; id <= INBOX_BENCH_USERS; id++) {
+        int got;
+        while ((got = inbox_drain(&engine, id, batch, INBOX_BENCH_BATCH)) > 0) {
+            drained += got;
+        }
+    }
+    double drain = now_seconds() - start;
+    
+    printf("send_message with inbox enqueue: %.2f M/s\n", INBOX_BENCH_MESSAGES / send / 1e6);
+    printf("User 1: %d unread, %d from close friends (same first message: %s)\n",
+           unread, priority_unread, legacy == first ? "yes" : "NO");
+    printf("Next unread                   Time (us)\n");
+    printf("scan messages_head (before)   %9.1f\n", legacy_next * 1e6);
+    printf("inbox_next                    %9.3f\n", next * 1e6);
+    printf("inbox_drain (batches of %d): %ld messages, %.2f M/s\n",
+           INBOX_BENCH_BATCH, drained, drained / drain / 1e6);
+    cleanup_data(&engine);
+}
+
+// =============================================================================
+// Benchmark: per-user notification stores
+// =============================================================================
+
+#define NOTIFICATION_BENCH_USERS 10000
+#define NOTIFICATION_BENCH_COUNT 1000000
+#define NOTIFICATION_BENCH_READS 20
+
+static void bench_notifications() {
+    printf("\n=== BENCHMARK: %d notifications for %d users ===\n",
+           NOTIFICATION_BENCH_COUNT, NOTIFICATION_BENCH_USERS);
+    
+    // Stands in for the old global list, newest last
+    Notification** all = (Notification**)malloc(NOTIFICATION_BENCH_COUNT * sizeof(Notification*));
+    if (all == NULL) {
+        return;
+    }
+    double start = now_seconds();
+    for (int i = 0; i < NOTIFICATION_BENCH_COUNT; i++) {
+        int user_id = i % 100 == 0 ? 1 : 2 + i % (NOTIFICATION_BENCH_USERS - 1);
+        add_notification(&engine, user_id, "Someone started following you", i % 300 == 0);
+    }
+    double add = now_seconds() - start;
+    for (int i = 0; i < NOTIFICATION_BENCH_COUNT; i++) {
+        all[i] = notification_find(&engine, i + 1);
+    }
+    
+    // User 1's notifications, priority first: scan everything vs read the box
+    int legacy_count = 0;
+    start = now_seconds();
+    for (int r = 0; r < NOTIFICATION_BENCH_READS; r++) {
+        legacy_count = 0;
+        for (int priority = 1; priority >= 0; priority--) {
+            for (int i = NOTIFICATION_BENCH_COUNT - 1; i >= 0; i--) {
+                legacy_count += all[i]->user_id == 1 && all[i]->priority == priority;
+            }
+        }
+    }
+    double legacy_list = (now_seconds() - start) / NOTIFICATION_BENCH_READS;
+    
+    int box_count = 0;
+    long checksum = 0;
+    start = now_seconds();
+    for (int r = 0; r < NOTIFICATION_BENCH_READS; r++) {
+        const NotificationBox* box = notification_box(&engine, 1);
+        box_count = 0;
+        for (int lane = 1; lane >= 0; lane--) {
+            for (int i = box->lanes[lane].count - 1; i >= 0; i--, box_count++) {
+                checksum += box->lanes[lane].items[i]->notif_id;
+            }
+        }
+    }
+    double box_list = (now_seconds() - start) / NOTIFICATION_BENCH_READS;
+    
+    // Mark user 1's oldest notifications read: linear search vs the id index
+    start = now_seconds();
+    for (int r = 0; r < NOTIFICATION_BENCH_READS; r++) {
+        int target = 1 + r * 100;
+        for (int i = NOTIFICATION_BENCH_COUNT - 1; i >= 0; i--) {
+            if (all[i]->notif_id == target) {
+                checksum += i;
+                break;
+            }
+        }
+    }
+    double legacy_mark = (now_seconds() - start) / NOTIFICATION_BENCH_READS;
+    
+    engine.current_user = NULL;
+    register_user(&engine, "notified", "password123");
+    engine.current_user = find_user_by_id(&engine, 1);
+    int marks = 0;
+    start = now_seconds();
+    for (int id = 1; id <= NOTIFICATION_BENCH_COUNT; id += 100) {
+        marks += mark_notification_read(&engine, id);
+    }
+    double mark = (now_seconds() - start) / (marks ? marks : 1);
+    engine.current_user = NULL;
+    
+    // The next notifications push user 1 past the retention limit
+    for (int i = 0; i < NOTIFICATION_RETENTION; i++) {
+        add_notification(&engine, 1, "Someone started following you", 0);
+    }
+    const NotificationBox* box = notification_box(&engine, 1);
+    int priority_unread;
+    int unread = notification_unread(&engine, 1, &priority_unread, NULL);
+    printf("add_notification: %.2f M/s (checksum %ld)\n", NOTIFICATION_BENCH_COUNT / add / 1e6, checksum);
+    printf("Operation (user 1)             Items   Time (us)\n");
+    printf("list, scan everything (before) %6d   %9.1f\n", legacy_count, legacy_list * 1e6);
+    printf("list, notification_box         %6d   %9.1f\n", box_count, box_list * 1e6);
+    printf("mark read, linear (before)     %6d   %9.1f\n", 1, legacy_mark * 1e6);
+    printf("mark read, id index            %6d   %9.3f\n", marks, mark * 1e6);
+    printf("User 1 after %d more: %d held, %d unread (%d priority); %zu read ones evicted\n",
+           NOTIFICATION_RETENTION, box->lanes[0].count + box->lanes[1].count, unread, priority_unread,
+           engine.notifications.evicted);
+    free(all);
+    cleanup_data(&engine);
+}
+
+// =============================================================================
+// Benchmark: background fan-out of new posts
+// =============================================================================
+
+#define FANOUT_BENCH_AUTHORS 16
+#define FANOUT_BENCH_FOLLOWERS 20000 // Each follows every author
+#define FANOUT_BENCH_POSTS 256
+
+static void fanout_bench_setup() {
+    char name[MAX_USERNAME];
+    for (int i = 1; i <= FANOUT_BENCH_AUTHORS; i++) {
+        sprintf(name, "author%d", i);
+        register_user(&engine, name, "pw");
+    }
+    for (int f = 0; f < FANOUT_BENCH_FOLLOWERS; f++) {
+        for (int a = 1; a <= FANOUT_BENCH_AUTHORS; a++) {
+            follow_graph_add(&engine.follow_graph, FANOUT_BENCH_AUTHORS + 1 + f, a);
+        }
+    }
+    memset(&engine.fanout.stats, 0, sizeof(engine.fanout.stats));
+}
+
+// Posts round-robin across the authors on a fresh engine, with threads
+// fan-out workers (0: inline), until every notification is delivered
+static void fanout_bench_run(int threads) {
+    fanout_bench_setup();
+    if (threads > 0 && !fanout_start(&engine, threads)) {
+        printf("fanout_start: %s\n", engine.error);
+        cleanup_data(&engine);
+        return;
+    }
+    double slowest = 0;
+    double begin = now_seconds();
+    for (int p = 0; p < FANOUT_BENCH_POSTS; p++) {
+        engine.current_user = find_user_by_id(&engine, 1 + p % FANOUT_BENCH_AUTHORS);
+        double start = now_seconds();
+        priority_write_begin(&engine); // As web_server.c does around every request
+        create_post(&engine, "Fan-out benchmark post");
+        priority_write_end(&engine);
+        double took = now_seconds() - start;
+        if (took > slowest) {
+            slowest = took;
+        }
+    }
+    double posted = now_seconds() - begin;
+    engine.current_user = NULL;
+    fanout_flush(&engine);
+    double delivered = now_seconds() - begin;
+    
+    FanoutStats stats;
+    fanout_stats(&engine, &stats);
+    printf("%-9s %13.3f  %13.3f  %12.1f  %13d  %6zu  %10d  %11lld\n",
+           threads ? (threads == 1 ? "1 worker" : threads == 2 ? "2 workers" : "4 workers") : "inline",
+           posted * 1000 / FANOUT_BENCH_POSTS, slowest * 1000, delivered * 1000,
+           engine.next_notif_id - 1, stats.jobs_inline, stats.depth_high_water, stats.max_lag_ms);
+    cleanup_data(&engine);
+}
+
+static void bench_fanout() {
+    printf("\n=== BENCHMARK: fan-out of %d posts from %d authors with %d followers each ===\n",
+           FANOUT_BENCH_POSTS, FANOUT_BENCH_AUTHORS, FANOUT_BENCH_FOLLOWERS);
+    printf("Mode      Post avg (ms)  Post max (ms)  Delivered (ms)  Notifications  Inline  Queue peak  Max lag (ms)\n");
+    for (int threads = 0; threads <= 4; threads = threads ? threads * 2 : 1) {
+        fanout_bench_run(threads);
+    }
+}
+
+// =============================================================================
+// Benchmark: templated and coalesced notifications
+// =============================================================================
+
+#define TEMPLATE_BENCH_FOLLOWERS 20000
+#define TEMPLATE_BENCH_AUTHORS 10 // Followed by everyone
+#define TEMPLATE_BENCH_BURST 5 // Posts each author makes in a row
+
+// A follow storm on user 1, then every author posting a burst to every
+// follower: formatted strings as before (templated = 0) or notify_user
+static void template_bench_run(int templated) {
+    char name[MAX_USERNAME];
+    char text[MAX_MESSAGE_CONTENT];
+    int first_follower = TEMPLATE_BENCH_AUTHORS + 1;
+    for (int i = 1; i < first_follower + TEMPLATE_BENCH_FOLLOWERS; i++) {
+        sprintf(name, "user%d", i);
+        register_user(&engine, name, "pw");
+    }
+    wal_open(&engine, WAL_PATH);
+    size_t arena_before = engine.text_arena.used;
+    
+    double start = now_seconds();
+    size_t events = 0;
+    for (int f = first_follower; f < first_follower + TEMPLATE_BENCH_FOLLOWERS; f++, events++) {
+        if (templated) {
+            notify_user(&engine, 1, NOTIFY_FOLLOW, f, 0, 0);
+        } else {
+            snprintf(text, sizeof(text), "%s started following you",
+                     arena_str(&engine, find_user_by_id(&engine, f)->username));
+            add_notification(&engine, 1, text, 0);
+        }
+    }
+    int post_id = 1;
+    for (int a = 1; a <= TEMPLATE_BENCH_AUTHORS; a++) {
+        for (int p = 0; p < TEMPLATE_BENCH_BURST; p++, post_id++) {
+            snprintf(text, sizeof(text), "%s created a new post",
+                     arena_str(&engine, find_user_by_id(&engine, a)->username));
+            for (int f = first_follower; f < first_follower + TEMPLATE_BENCH_FOLLOWERS; f++, events++) {
+                if (templated) {
+                    notify_user(&engine, f, NOTIFY_POST, a, post_id, 0);
+                } else {
+                    add_notification(&engine, f, text, 0);
+                }
+            }
+        }
+    }
+    wal_sync(&engine);
+    double took = now_seconds() - start;
+    
+    // Every later snapshot rewrites what is held
+    struct stat info;
+    wal_snapshot(&engine);
+    stat(SNAPSHOT_PATH, &info);
+    const SlabAllocator* slab = &engine.notification_slab;
+    size_t held = (size_t)engine.notifications.count;
+    size_t record_bytes = held * slab->item_size;
+    size_t text_bytes = engine.text_arena.used - arena_before;
+    const NotificationBox* box = notification_box(&engine, 1);
+    const Notification* newest = box->lanes[0].items[box->lanes[0].count - 1];
+    printf("%-10s %8zu %8.2f %10zu %9.1f %10.1f %10.1f  \"%s\"\n", templated ? "templated" : "strings",
+           held, events / took / 1e6, held * 1000 / events, (record_bytes + text_bytes) / 1e6, info.st_size / 1e6,
+           (double)held / TEMPLATE_BENCH_FOLLOWERS, notification_render(&engine, newest, text, sizeof(text)));
+    wal_close(&engine);
+    cleanup_data(&engine);
+    unlink(WAL_PATH);
+    unlink(SNAPSHOT_PATH);
+}
+
+static void bench_notification_templates() {
+    printf("\n=== BENCHMARK: %d follows of one user, then %d posts to %d followers ===\n",
+           TEMPLATE_BENCH_FOLLOWERS, TEMPLATE_BENCH_AUTHORS * TEMPLATE_BENCH_BURST, TEMPLATE_BENCH_FOLLOWERS);
+    
+    char dir[] = "/tmp/priority_notifyXXXXXX";
+    char cwd[4096];
+    if (getcwd(cwd, sizeof(cwd)) == NULL || mkdtemp(dir) == NULL || chdir(dir) != 0) {
+        printf("Could not create a scratch directory\n");
+        return;
+    }
+    printf("Storage       Held  M evt/s  Per 1000  Mem (MB)  Snap (MB)  Per user  User 1 sees\n");
+    template_bench_run(0);
+    template_bench_run(1);
+    if (chdir(cwd) == 0) {
+        rmdir(dir);
+    }
+}
+
+static const Benchmark benchmarks[] = {
+    {"records", bench_records},
+    {"feed_threads", bench_feed_threads},
+    {"user_lookup", bench_user_lookup},
+    {"follow_graph", bench_follow_graph},
+    {"close_friend_fanout", bench_close_friend_fanout},
+    {"home_timeline", bench_home_timeline},
+    {"feed_pages", bench_feed_pages},
+    {"post_store", bench_post_store},
+    {"feed_rank", bench_feed_rank},
+    {"json_feed", bench_json_feed},
+    {"concurrent_reads", bench_concurrent_reads},
+    {"wal", bench_wal},
+    {"snapshot", bench_snapshot},
+    {"text_codec", bench_text_codec},
+    {"parallel_load", bench_parallel_load},
+    {"slab", bench_slab},
+    {"conversation", bench_conversation},
+    {"inbox", bench_inbox},
+    {"notifications", bench_notifications},
+    {"fanout", bench_fanout},
+    {"notification_templates", bench_notification_templates},
+};
+
+int main(int argc, char** argv) {
+    priority_init(&engine);
+    int count = (int)(sizeof(benchmarks) / sizeof(benchmarks[0]));
+    int ran = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (argc < 2 || strcmp(argv[1], benchmarks[i].name) == 0) {
+            double start = now_seconds();
+            benchmarks[i].run();
+            printf("[%s finished in %.2f s]\n", benchmarks[i].name, now_seconds() - start);
+            ran++;
+        }
+    }
+
+    if (ran == 0) {
+        printf("Unknown benchmark '%s'. Available:", argv[1]);
+        for (int i = 0; i < count; i++) {
+            printf(" %s", benchmarks[i].name);
+        }
+        printf("\n");
+        return 1;
+    }
+    if (checks_failed > 0) {
+        printf("%d correctness check%s failed\n", checks_failed, checks_failed == 1 ? "" : "s");
+        return 1;
+    }
+    return 0;
+}
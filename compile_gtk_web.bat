@@ -12,6 +12,7 @@ echo Checking dependencies...
 REM Compile with GTK3 and WebKit2GTK
 gcc -o priority_social_media_gtk ^
     gtk_web_frontend.c ^
+    priority.c ^
     -I"C:\msys64\mingw64\include\gtk-3.0" ^
     -I"C:\msys64\mingw64\include\glib-2.0" ^
     -I"C:\msys64\mingw64\lib\glib-2.0\include" ^
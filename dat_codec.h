@@ -0,0 +1,267 @@
+/*
+ * PRIORITY SOCIAL MEDIA - .dat Text Codec
+ * Escaped pipe-delimited records and a streaming parser for them
+ *
+ * Used by save_data and load_data in libpriority. A file holds one record
+ * per line with fields separated by '|'. Inside a field, backslash, '|',
+ * newline and carriage return are written as \\, \p, \n and \r, so a raw
+ * newline always ends a record and a raw '|' always ends a field: tools that
+ * split lines on '|' still see the right fields, and a damaged record is
+ * skipped without losing the lines after it.
+ *
+ * Escaped files start with DAT_CODEC_HEADER. Files without it are the older
+ * unescaped format and are read with backslashes taken literally. The reader
+ * has no line or field length limit: it refills one growable buffer from the
+ * file, splits each line in place and hands out pointers into it. A reader
+ * can also be limited to a byte range of the file, so several threads can
+ * parse one large file in pieces.
+ */
+
+#ifndef DAT_CODEC_H
+#define DAT_CODEC_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#define DAT_CODEC_HEADER "#priority-dat 2"
+#define DAT_READER_CHUNK 65536 // Bytes read from the file at a time
+#define DAT_MAX_FIELDS 16 // Further separators stay in the last field
+
+// Writing: fields are written in order with a '|' between them
+
+static inline void dat_write_header(FILE* file) {
+    fputs(DAT_CODEC_HEADER "\n", file);
+}
+
+static inline void dat_write_str(FILE* file, const char* text) {
+    const char* run = text;
+    for (; *text; text++) {
+        const char* escape;
+        switch (*text) {
+            case '\\': escape = "\\\\"; break;
+            case '|':  escape = "\\p"; break;
+            case '\n': escape = "\\n"; break;
+            case '\r': escape = "\\r"; break;
+            default: continue;
+        }
+        fwrite(run, 1, (size_t)(text - run), file);
+        fwrite(escape, 1, 2, file);
+        run = text + 1;
+    }
+    fwrite(run, 1, (size_t)(text - run), file);
+}
+
+static inline void dat_write_int(FILE* file, long long value) {
+    char digits[24];
+    int pos = (int)sizeof(digits);
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    do {
+        digits[--pos] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) {
+        digits[--pos] = '-';
+    }
+    fwrite(digits + pos, 1, sizeof(digits) - (size_t)pos, file);
+}
+
+static inline void dat_write_sep(FILE* file) {
+    putc('|', file);
+}
+
+static inline void dat_write_end(FILE* file) {
+    putc('\n', file);
+}
+
+// Reading
+
+typedef struct DatReader {
+    FILE* file;
+    char* buf;
+    size_t len; // Bytes held in buf
+    size_t pos; // Start of the next line
+    size_t capacity;
+    size_t bytes; // Bytes of the file consumed so far
+    size_t limit; // Bytes still allowed to be read from the file
+    int eof;
+    int escaped; // The file started with DAT_CODEC_HEADER
+    int failed; // Out of memory or a read error
+    char* fields[DAT_MAX_FIELDS];
+    int field_count;
+} DatReader;
+
+// Pulls more of the file in, keeping the unread tail; 0 once nothing is left
+static inline int dat_reader_fill(DatReader* r) {
+    if (r->eof || r->failed) {
+        return 0;
+    }
+    if (r->pos > 0) {
+        memmove(r->buf, r->buf + r->pos, r->len - r->pos);
+        r->len -= r->pos;
+        r->pos = 0;
+    }
+    // Always keep one spare byte to terminate a last line without '\n'
+    if (r->capacity - r->len < DAT_READER_CHUNK + 1) {
+        size_t capacity = r->capacity ? r->capacity : DAT_READER_CHUNK + 1;
+        while (capacity - r->len < DAT_READER_CHUNK + 1) {
+            capacity *= 2;
+        }
+        char* buf = (char*)realloc(r->buf, capacity);
+        if (buf == NULL) {
+            r->failed = 1;
+            return 0;
+        }
+        r->buf = buf;
+        r->capacity = capacity;
+    }
+    size_t want = r->limit < DAT_READER_CHUNK ? r->limit : DAT_READER_CHUNK;
+    size_t got = want ? fread(r->buf + r->len, 1, want, r->file) : 0;
+    r->len += got;
+    r->limit -= got;
+    if (got < want || r->limit == 0) {
+        r->eof = 1;
+        r->failed = ferror(r->file) != 0;
+    }
+    return got > 0;
+}
+
+// Finds the next line and returns its start, with *end at its '\n' (or at
+// the end of the file); NULL when the file is exhausted
+static inline char* dat_reader_line(DatReader* r, char** end) {
+    size_t scanned = 0; // Bytes of this line already searched
+    for (;;) {
+        size_t unscanned = r->len - r->pos - scanned;
+        char* newline = unscanned ? (char*)memchr(r->buf + r->pos + scanned, '\n', unscanned) : NULL;
+        if (newline != NULL) {
+            *end = newline;
+            break;
+        }
+        scanned = r->len - r->pos;
+        if (!dat_reader_fill(r)) {
+            if (r->failed || r->pos == r->len) {
+                return NULL;
+            }
+            *end = r->buf + r->len; // Last line without '\n'
+            break;
+        }
+    }
+    char* line = r->buf + r->pos;
+    size_t used = (size_t)(*end - line) + (*end < r->buf + r->len);
+    r->pos += used;
+    r->bytes += used;
+    if (*end > line && (*end)[-1] == '\r') {
+        (*end)--; // Written on or copied through Windows
+    }
+    return line;
+}
+
+static inline void dat_reader_open(DatReader* r, FILE* file) {
+    memset(r, 0, sizeof(*r));
+    r->file = file;
+    r->limit = (size_t)-1;
+
+    char* end;
+    char* line = dat_reader_line(r, &end);
+    size_t header_len = sizeof(DAT_CODEC_HEADER) - 1;
+    if (line != NULL && (size_t)(end - line) == header_len && memcmp(line, DAT_CODEC_HEADER, header_len) == 0) {
+        r->escaped = 1;
+    } else if (line != NULL) {
+        r->pos = 0; // Older file: the first line is a record
+        r->bytes = 0;
+    }
+}
+
+// Reads only the next length bytes of file, which must start and end on
+// record boundaries; escaped comes from a reader opened at the file's start
+static inline void dat_reader_open_range(DatReader* r, FILE* file, int escaped, size_t length) {
+    memset(r, 0, sizeof(*r));
+    r->file = file;
+    r->escaped = escaped;
+    r->limit = length;
+}
+
+// Splits the next record into fields, unescaping in place. Returns 0 at the
+// end of the file or when reading failed (see failed).
+static inline int dat_reader_next(DatReader* r) {
+    char* end;
+    char* line;
+    do {
+        line = dat_reader_line(r, &end);
+        if (line == NULL) {
+            return 0;
+        }
+    } while (line == end || line[0] == '#'); // Blank lines and comments
+
+    char* out = line;
+    r->field_count = 1;
+    r->fields[0] = line;
+    for (char* in = line; in < end; in++) {
+        char c = *in;
+        if (c == '|' && r->field_count < DAT_MAX_FIELDS) {
+            *out++ = '\0';
+            r->fields[r->field_count++] = out;
+            continue;
+        }
+        if (c == '\\' && r->escaped && in + 1 < end) {
+            switch (in[1]) {
+                case '\\': c = '\\'; in++; break;
+                case 'p':  c = '|'; in++; break;
+                case 'n':  c = '\n'; in++; break;
+                case 'r':  c = '\r'; in++; break;
+                default: break; // Unknown escapes are kept as written
+            }
+        }
+        *out++ = c;
+    }
+    *out = '\0'; // Over the '\n', or the spare byte kept by dat_reader_fill
+    return 1;
+}
+
+static inline const char* dat_field_str(const DatReader* r, int i) {
+    return i < r->field_count ? r->fields[i] : "";
+}
+
+// Whole field as a decimal integer; 0 if missing, malformed or out of range
+static inline int dat_field_long(const DatReader* r, int i, long long* value) {
+    if (i >= r->field_count) {
+        return 0;
+    }
+    const char* p = r->fields[i];
+    int negative = *p == '-';
+    p += negative;
+    if (*p < '0' || *p > '9') {
+        return 0;
+    }
+    unsigned long long magnitude = 0;
+    for (; *p >= '0' && *p <= '9'; p++) {
+        unsigned digit = (unsigned)(*p - '0');
+        if (magnitude > (ULLONG_MAX - digit) / 10) {
+            return 0;
+        }
+        magnitude = magnitude * 10 + digit;
+    }
+    if (*p != '\0' || magnitude > (unsigned long long)LLONG_MAX + negative) {
+        return 0;
+    }
+    *value = negative ? (long long)(0ULL - magnitude) : (long long)magnitude;
+    return 1;
+}
+
+static inline int dat_field_int(const DatReader* r, int i, int* value) {
+    long long wide;
+    if (!dat_field_long(r, i, &wide) || wide < INT_MIN || wide > INT_MAX) {
+        return 0;
+    }
+    *value = (int)wide;
+    return 1;
+}
+
+static inline void dat_reader_free(DatReader* r) {
+    free(r->buf);
+    r->buf = NULL;
+    r->len = r->pos = r->capacity = 0;
+}
+
+#endif
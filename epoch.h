@@ -0,0 +1,190 @@
+/*
+ * PRIORITY SOCIAL MEDIA - Epoch-Based Reclamation
+ * Lock-free readers over structures that one writer at a time replaces
+ *
+ * Used by libpriority for the follow graph, the close-friends index, the
+ * user index and the string arena. Writers never change memory a reader can
+ * reach: they build a replacement, publish it with EPOCH_PUBLISH and hand
+ * the old block to epoch_retire. Readers bracket each lookup with
+ * epoch_read_begin/epoch_read_end on a slot from epoch_reader_register, and
+ * a retired block is freed only once every reader that might still hold it
+ * has left its read section. Writers must be serialized by the caller.
+ */
+
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#define EPOCH_MAX_READERS 64   // Reader threads per domain
+#define EPOCH_COLLECT_BATCH 64 // Retired blocks between collection passes
+#define EPOCH_SLOT_BYTES 64    // One cache line per reader slot
+
+// Pointer access for data shared with readers
+#define EPOCH_LOAD(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define EPOCH_PUBLISH(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+
+typedef void (*EpochFreeFn)(void* block);
+
+typedef struct EpochSlot {
+    unsigned long epoch; // Global epoch seen on entry, 0 outside a read section
+    int claimed;
+    char pad[EPOCH_SLOT_BYTES - sizeof(unsigned long) - sizeof(int)];
+} EpochSlot;
+
+typedef struct RetiredBlock {
+    void* block;
+    EpochFreeFn free_fn; // NULL means free()
+    unsigned long epoch; // Global epoch when the block was unpublished
+} RetiredBlock;
+
+typedef struct EpochDomain {
+    unsigned long epoch; // Starts at 1 and only grows
+    EpochSlot readers[EPOCH_MAX_READERS];
+
+    // Writer side only
+    RetiredBlock* retired;
+    size_t retired_count;
+    size_t retired_capacity;
+    size_t collect_at; // Next retired_count that triggers a collection
+    size_t freed_count;
+} EpochDomain;
+
+static inline void epoch_init(EpochDomain* domain) {
+    memset(domain, 0, sizeof(*domain));
+    domain->epoch = 1;
+    domain->collect_at = EPOCH_COLLECT_BATCH;
+}
+
+// Claims a reader slot for the calling thread; -1 when every slot is taken
+static inline int epoch_reader_register(EpochDomain* domain) {
+    for (int i = 0; i < EPOCH_MAX_READERS; i++) {
+        int expected = 0;
+        if (__atomic_compare_exchange_n(&domain->readers[i].claimed, &expected, 1, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static inline void epoch_reader_unregister(EpochDomain* domain, int slot) {
+    __atomic_store_n(&domain->readers[slot].epoch, 0UL, __ATOMIC_RELEASE);
+    __atomic_store_n(&domain->readers[slot].claimed, 0, __ATOMIC_RELEASE);
+}
+
+static inline void epoch_read_begin(EpochDomain* domain, int slot) {
+    __atomic_store_n(&domain->readers[slot].epoch,
+                     __atomic_load_n(&domain->epoch, __ATOMIC_ACQUIRE), __ATOMIC_RELAXED);
+    // Pairs with the fence in epoch_collect: either the writer sees this
+    // slot, or every load below sees what the writer unpublished
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void epoch_read_end(EpochDomain* domain, int slot) {
+    __atomic_store_n(&domain->readers[slot].epoch, 0UL, __ATOMIC_RELEASE);
+}
+
+static inline void epoch_release(const RetiredBlock* retired) {
+    if (retired->free_fn != NULL) {
+        retired->free_fn(retired->block);
+    } else {
+        free(retired->block);
+    }
+}
+
+// Starts a new epoch and returns the oldest one a reader is still in
+static inline unsigned long epoch_advance(EpochDomain* domain) {
+    unsigned long oldest = __atomic_add_fetch(&domain->epoch, 1UL, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (int i = 0; i < EPOCH_MAX_READERS; i++) {
+        unsigned long seen = __atomic_load_n(&domain->readers[i].epoch, __ATOMIC_ACQUIRE);
+        if (seen != 0 && seen < oldest) {
+            oldest = seen;
+        }
+    }
+    return oldest;
+}
+
+// Frees every retired block that no reader can still hold
+static inline void epoch_collect(EpochDomain* domain) {
+    unsigned long oldest = epoch_advance(domain);
+    size_t kept = 0;
+    for (size_t i = 0; i < domain->retired_count; i++) {
+        if (domain->retired[i].epoch < oldest) {
+            epoch_release(&domain->retired[i]);
+        } else {
+            domain->retired[kept++] = domain->retired[i];
+        }
+    }
+    domain->freed_count += domain->retired_count - kept;
+    domain->retired_count = kept;
+    domain->collect_at = kept + EPOCH_COLLECT_BATCH;
+}
+
+// Waits until every reader that entered before the call has left
+static inline void epoch_synchronize(EpochDomain* domain) {
+    unsigned long target = __atomic_add_fetch(&domain->epoch, 1UL, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (int i = 0; i < EPOCH_MAX_READERS; i++) {
+        unsigned long seen;
+        do {
+            seen = __atomic_load_n(&domain->readers[i].epoch, __ATOMIC_ACQUIRE);
+        } while (seen != 0 && seen < target);
+    }
+}
+
+// Frees block once no reader can reach it. A NULL domain has no readers, so
+// the block is freed at once.
+static inline void epoch_retire_with(EpochDomain* domain, void* block, EpochFreeFn free_fn) {
+    RetiredBlock retired = {block, free_fn, 0};
+    if (block == NULL) {
+        return;
+    }
+    if (domain == NULL) {
+        epoch_release(&retired);
+        return;
+    }
+
+    if (domain->retired_count == domain->retired_capacity) {
+        size_t capacity = domain->retired_capacity ? domain->retired_capacity * 2 : EPOCH_COLLECT_BATCH;
+        RetiredBlock* grown = (RetiredBlock*)realloc(domain->retired, capacity * sizeof(RetiredBlock));
+        if (grown == NULL) {
+            epoch_synchronize(domain); // No room to defer: wait out the readers instead
+            epoch_release(&retired);
+            return;
+        }
+        domain->retired = grown;
+        domain->retired_capacity = capacity;
+    }
+    retired.epoch = __atomic_load_n(&domain->epoch, __ATOMIC_RELAXED);
+    domain->retired[domain->retired_count++] = retired;
+    if (domain->retired_count >= domain->collect_at) {
+        epoch_collect(domain);
+    }
+}
+
+static inline void epoch_retire(EpochDomain* domain, void* block) {
+    epoch_retire_with(domain, block, NULL);
+}
+
+// Frees everything still retired; no reader may be inside a read section
+static inline void epoch_drain(EpochDomain* domain) {
+    for (size_t i = 0; i < domain->retired_count; i++) {
+        epoch_release(&domain->retired[i]);
+    }
+    domain->freed_count += domain->retired_count;
+    domain->retired_count = 0;
+    domain->collect_at = EPOCH_COLLECT_BATCH;
+}
+
+static inline void epoch_free(EpochDomain* domain) {
+    epoch_drain(domain);
+    free(domain->retired);
+    domain->retired = NULL;
+    domain->retired_capacity = 0;
+}
+
+#endif
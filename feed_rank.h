@@ -0,0 +1,197 @@
+/*
+ * PRIORITY SOCIAL MEDIA - Feed Ranking
+ * Incremental per-viewer ranking: priority posts first, then regular posts,
+ * each newest first
+ *
+ * Used by the WebView backend (main.c). Each lane is an array kept sorted by
+ * (timestamp, post id), so the output order is fully determined by the posts
+ * themselves and never by the order they were added in. New posts are
+ * inserted with a binary search (an append in the usual newest-post case),
+ * and a follow or unfollow moves just that author's posts between lanes in
+ * one linear merge. Records are opaque; the global post list is never touched.
+ */
+
+#ifndef FEED_RANK_H
+#define FEED_RANK_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#define FEED_RANK_INITIAL_CAPACITY 64
+
+#define FEED_RANK_PINNED 1 // Entry stays in the priority lane whoever wrote it
+
+typedef enum {
+    FEED_RANK_PRIORITY = 0,
+    FEED_RANK_REGULAR = 1,
+    FEED_RANK_LANES = 2
+} FeedRankLane;
+
+typedef struct FeedRankEntry {
+    long long timestamp;
+    int post_id;
+    int author_id;
+    int flags;
+    void* record;
+} FeedRankEntry;
+
+typedef struct FeedRankList {
+    FeedRankEntry* entries; // Ascending (timestamp, post_id); newest at the end
+    size_t count;
+    size_t capacity;
+} FeedRankList;
+
+typedef struct FeedRank {
+    int viewer_id;
+    FeedRankList lanes[FEED_RANK_LANES];
+} FeedRank;
+
+static inline void feed_rank_init(FeedRank* rank, int viewer_id) {
+    memset(rank, 0, sizeof(*rank));
+    rank->viewer_id = viewer_id;
+}
+
+static inline void feed_rank_free(FeedRank* rank) {
+    for (int lane = 0; lane < FEED_RANK_LANES; lane++) {
+        free(rank->lanes[lane].entries);
+    }
+    feed_rank_init(rank, 0);
+}
+
+// Negative when a sorts before (is older than) b
+static inline int feed_rank_compare(const FeedRankEntry* a, const FeedRankEntry* b) {
+    if (a->timestamp != b->timestamp) return a->timestamp < b->timestamp ? -1 : 1;
+    if (a->post_id != b->post_id) return a->post_id < b->post_id ? -1 : 1;
+    return 0;
+}
+
+static inline int feed_rank_reserve(FeedRankList* list, size_t needed) {
+    if (needed <= list->capacity) {
+        return 1;
+    }
+    size_t capacity = list->capacity ? list->capacity : FEED_RANK_INITIAL_CAPACITY;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    FeedRankEntry* entries = (FeedRankEntry*)realloc(list->entries, capacity * sizeof(FeedRankEntry));
+    if (entries == NULL) {
+        return 0;
+    }
+    list->entries = entries;
+    list->capacity = capacity;
+    return 1;
+}
+
+// First position whose entry sorts after key
+static inline size_t feed_rank_upper_bound(const FeedRankList* list, const FeedRankEntry* key) {
+    size_t low = 0, high = list->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (feed_rank_compare(&list->entries[mid], key) <= 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// Adds a post to one lane. Returns 0 when memory runs out.
+static inline int feed_rank_add(FeedRank* rank, const FeedRankEntry* entry, FeedRankLane lane) {
+    FeedRankList* list = &rank->lanes[lane];
+    if (!feed_rank_reserve(list, list->count + 1)) {
+        return 0;
+    }
+    size_t pos = feed_rank_upper_bound(list, entry);
+    memmove(&list->entries[pos + 1], &list->entries[pos], (list->count - pos) * sizeof(FeedRankEntry));
+    list->entries[pos] = *entry;
+    list->count++;
+    return 1;
+}
+
+// Moves an author's unpinned posts into the priority lane (priority = 1) or
+// back to the regular lane (priority = 0). O(posts in both lanes).
+static inline int feed_rank_set_author(FeedRank* rank, int author_id, int priority) {
+    FeedRankList* from = &rank->lanes[priority ? FEED_RANK_REGULAR : FEED_RANK_PRIORITY];
+    FeedRankList* to = &rank->lanes[priority ? FEED_RANK_PRIORITY : FEED_RANK_REGULAR];
+
+    size_t moving = 0;
+    for (size_t i = 0; i < from->count; i++) {
+        if (from->entries[i].author_id == author_id && !(from->entries[i].flags & FEED_RANK_PINNED)) {
+            moving++;
+        }
+    }
+    if (moving == 0) {
+        return 1;
+    }
+    if (!feed_rank_reserve(to, to->count + moving)) {
+        return 0;
+    }
+
+    // Merge from the back so the destination can be filled in place
+    size_t kept = from->count - moving;
+    size_t src = from->count, dst = to->count, out = to->count + moving;
+    while (src > 0) {
+        const FeedRankEntry* entry = &from->entries[src - 1];
+        if (entry->author_id != author_id || (entry->flags & FEED_RANK_PINNED)) {
+            src--;
+            continue;
+        }
+        while (dst > 0 && feed_rank_compare(&to->entries[dst - 1], entry) > 0) {
+            to->entries[--out] = to->entries[--dst];
+        }
+        to->entries[--out] = *entry;
+        src--;
+    }
+    to->count += moving;
+
+    // Compact what stays behind, preserving order
+    size_t write = 0;
+    for (size_t i = 0; i < from->count; i++) {
+        if (from->entries[i].author_id != author_id || (from->entries[i].flags & FEED_RANK_PINNED)) {
+            from->entries[write++] = from->entries[i];
+        }
+    }
+    from->count = kept;
+    return 1;
+}
+
+static inline size_t feed_rank_count(const FeedRank* rank) {
+    return rank->lanes[FEED_RANK_PRIORITY].count + rank->lanes[FEED_RANK_REGULAR].count;
+}
+
+// i-th entry of the ranked feed: priority posts newest first, then regular
+static inline const FeedRankEntry* feed_rank_at(const FeedRank* rank, size_t i, FeedRankLane* lane) {
+    const FeedRankList* priority = &rank->lanes[FEED_RANK_PRIORITY];
+    const FeedRankList* regular = &rank->lanes[FEED_RANK_REGULAR];
+    if (i < priority->count) {
+        if (lane) *lane = FEED_RANK_PRIORITY;
+        return &priority->entries[priority->count - 1 - i];
+    }
+    i -= priority->count;
+    if (i < regular->count) {
+        if (lane) *lane = FEED_RANK_REGULAR;
+        return &regular->entries[regular->count - 1 - i];
+    }
+    return NULL;
+}
+
+// Feed position just after the given entry, for cursor-based paging
+static inline size_t feed_rank_position_after(const FeedRank* rank, FeedRankLane lane,
+                                              const FeedRankEntry* key) {
+    const FeedRankList* list = &rank->lanes[lane];
+    size_t low = 0, high = list->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (feed_rank_compare(&list->entries[mid], key) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    // Entries below low are older than key and come next, newest first
+    size_t newer_in_lane = list->count - low;
+    return (lane == FEED_RANK_REGULAR ? rank->lanes[FEED_RANK_PRIORITY].count : 0) + newer_in_lane;
+}
+
+#endif
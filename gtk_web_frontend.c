@@ -12,14 +12,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <json-c/json.h>
+#include "json_writer.h"
 
 // Include our backend
-#include "fullcode_multimedia.c"
+#include "priority.h"
 
 // Global variables
 static WebKitWebView *web_view;
 static GtkWidget *window;
-static User* current_user = NULL;
+static PriorityContext engine; // The social data; engine.current_user is the logged-in user
 
 // Function prototypes
 static void initialize_backend(void);
@@ -32,7 +33,7 @@ static char* create_json_response(const char* status, const char* message, const
 static void js_register_user(const char* username, const char* password);
 static void js_login_user(const char* username, const char* password);
 static void js_create_post(const char* content, const char* media_type, const char* audience);
-static char* js_get_feed(void);
+static char* js_get_feed(const char* cursor);
 static char* js_get_users(void);
 static void js_follow_user(int user_id);
 static void js_send_message(int receiver_id, const char* content);
@@ -41,25 +42,101 @@ static void js_send_message(int receiver_id, const char* content);
 static void initialize_backend(void) {
     printf("🚀 Initializing Priority Social Media Backend...\n");
     
-    // Initialize global variables from backend
-    users = NULL;
-    posts = NULL;
-    messages = NULL;
-    follows = NULL;
-    close_friends = NULL;
-    notifications = NULL;
-    
-    next_user_id = 1;
-    next_post_id = 1;
-    next_message_id = 1;
-    next_notif_id = 1;
+    priority_init(&engine);
     
     // Load existing data
-    load_all_data();
+    if (!load_data(&engine)) {
+        printf("⚠️ %s\n", engine.error);
+    }
+    if (!wal_open(&engine, WAL_PATH)) {
+        printf("⚠️ %s\n", engine.error);
+    }
     
     printf("✅ Backend initialized successfully!\n");
 }
 
+// Ends the log's current group while the UI is idle
+static gboolean flush_log(gpointer data) {
+    (void)data;
+    wal_sync(&engine);
+    return TRUE;
+}
+
+static const char* media_icon(MediaType type) {
+    switch (type) {
+        case MEDIA_IMAGE: return "🖼️";
+        case MEDIA_VIDEO: return "🎬";
+        case MEDIA_AUDIO: return "🎵";
+        default: return "📝";
+    }
+}
+
+// One page of the feed: priority posts first, then regular, newest first.
+// The cursor is the next_cursor of the previous page (see feed_cursor_format).
+static char* js_get_feed(const char* cursor) {
+    JsonWriter w;
+    json_writer_init(&w);
+    json_writer_begin_object(&w);
+    json_writer_key(&w, "posts");
+    json_writer_begin_array(&w);
+
+    FeedCursor position;
+    feed_cursor_parse(cursor, &position); // A bad cursor restarts at the top
+
+    FeedPage page;
+    page.count = 0;
+    page.has_more = 0;
+    if (engine.current_user != NULL) {
+        feed_query(&engine, engine.current_user->user_id, position, FEED_PAGE_SIZE, &page);
+    }
+    for (int i = 0; i < page.count; i++) {
+        const Post* post = page.items[i].post;
+        json_writer_begin_object(&w);
+        json_writer_key(&w, "post_id"); json_writer_int(&w, post->post_id);
+        json_writer_key(&w, "author_name"); json_writer_string(&w, arena_str(&engine, post->author_name));
+        json_writer_key(&w, "content"); json_writer_string(&w, arena_str(&engine, post->content));
+        json_writer_key(&w, "created_at"); json_writer_int64(&w, (long long)post->created_at);
+        json_writer_key(&w, "media_icon"); json_writer_string(&w, media_icon(post->media_type));
+        json_writer_key(&w, "priority"); json_writer_bool(&w, page.items[i].priority);
+        json_writer_end_object(&w);
+    }
+    json_writer_end_array(&w);
+
+    json_writer_key(&w, "has_more");
+    json_writer_bool(&w, page.has_more);
+    json_writer_key(&w, "next_cursor");
+    if (page.has_more) {
+        char next_cursor[32];
+        feed_cursor_format(page.next, next_cursor, sizeof(next_cursor));
+        json_writer_string(&w, next_cursor);
+    } else {
+        json_writer_null(&w);
+    }
+    json_writer_end_object(&w);
+    return json_writer_take(&w);
+}
+
+// Every user except the one logged in
+static char* js_get_users(void) {
+    JsonWriter w;
+    json_writer_init(&w);
+    json_writer_begin_object(&w);
+    json_writer_key(&w, "users");
+    json_writer_begin_array(&w);
+    for (const User* user = engine.users_head; user != NULL; user = user->next) {
+        if (engine.current_user != NULL && user->user_id == engine.current_user->user_id) {
+            continue;
+        }
+        json_writer_begin_object(&w);
+        json_writer_key(&w, "user_id"); json_writer_int(&w, user->user_id);
+        json_writer_key(&w, "username"); json_writer_string(&w, arena_str(&engine, user->username));
+        json_writer_end_object(&w);
+    }
+    json_writer_end_array(&w);
+    json_writer_end_object(&w);
+    return json_writer_take(&w);
+}
+
 // Setup the web interface
 static void setup_web_interface(void) {
     // Create the main window
@@ -253,6 +330,7 @@ static const char* create_web_interface_html(void) {
     "                <div id='feed-section'>\n"
     "                    <h2 class='section-title'>📰 My Feed</h2>\n"
     "                    <div id='posts-container'></div>\n"
+    "                    <button id='load-more' class='hidden' onclick='loadFeed(true)'>Load more</button>\n"
     "                </div>\n"
     "                \n"
     "                <div id='create-post-section' class='hidden'>\n"
@@ -427,13 +505,18 @@ static const char* create_web_interface_html(void) {
     "            }\n"
     "        }\n"
     "        \n"
-    "        function loadFeed() {\n"
+    "        let feedCursor = null;\n"
+    "        \n"
+    "        function loadFeed(more) {\n"
     "            if (window.cBackend && window.cBackend.getFeed) {\n"
-    "                const feed = window.cBackend.getFeed();\n"
+    "                if (!more) feedCursor = null;\n"
+    "                const feed = window.cBackend.getFeed(feedCursor);\n"
     "                const container = document.getElementById('posts-container');\n"
+    "                feedCursor = feed.next_cursor;\n"
+    "                document.getElementById('load-more').classList.toggle('hidden', !feed.has_more);\n"
     "                \n"
     "                if (feed.posts && feed.posts.length > 0) {\n"
-    "                    container.innerHTML = feed.posts.map(post => \n"
+    "                    const html = feed.posts.map(post => \n"
     "                        `<div class='post ${post.priority ? 'priority' : ''}'>\n"
     "                            <h4>${post.media_icon} @${post.author_name}</h4>\n"
     "                            <p>${post.content}</p>\n"
@@ -441,7 +524,8 @@ static const char* create_web_interface_html(void) {
     "                            ${post.priority ? '<span style=\"color: #a855f7;\">⭐ Priority</span>' : ''}\n"
     "                        </div>`\n"
     "                    ).join('');\n"
-    "                } else {\n"
+    "                    container.innerHTML = more ? container.innerHTML + html : html;\n"
+    "                } else if (!more) {\n"
     "                    container.innerHTML = '<p>No posts yet. Create your first post!</p>';\n"
     "                }\n"
     "            }\n"
@@ -501,8 +585,8 @@ static void inject_javascript_api(WebKitWebView *web_view) {
     "    createPost: function(content, type, audience) {\n"
     "        return window.webkit.messageHandlers.createPost.postMessage({content: content, type: type, audience: audience});\n"
     "    },\n"
-    "    getFeed: function() {\n"
-    "        return window.webkit.messageHandlers.getFeed.postMessage({});\n"
+    "    getFeed: function(cursor) {\n"
+    "        return window.webkit.messageHandlers.getFeed.postMessage({cursor: cursor || ''});\n"
     "    },\n"
     "    getUsers: function() {\n"
     "        return window.webkit.messageHandlers.getUsers.postMessage({});\n"
@@ -533,10 +617,12 @@ int main(int argc, char *argv[]) {
     printf("🌐 Application ready! Open your web browser to use the platform.\n");
     
     // Start GTK main loop
+    g_timeout_add(WAL_GROUP_MS, flush_log, NULL);
     gtk_main();
     
     // Save data before exit
-    save_all_data();
+    sync_data(&engine);
+    cleanup_data(&engine);
     
     printf("👋 Priority Social Media closed. Data saved.\n");
     return 0;
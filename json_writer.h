@@ -0,0 +1,291 @@
+/*
+ * PRIORITY SOCIAL MEDIA - JSON Writer
+ * Streaming JSON serializer: values are escaped straight into one output
+ * buffer, with no intermediate object tree
+ *
+ * Used by the WebView backend (main.c) and the GTK frontend. The writer
+ * either grows its buffer until the caller takes the finished string, or
+ * hands the buffer to a sink (a file descriptor or any callback) whenever it
+ * passes the chunk size, so a huge feed streams out in bounded memory.
+ * Commas and nesting are tracked by the writer; callers just emit keys and
+ * values in order.
+ */
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define JSON_WRITER_INITIAL_CAPACITY 1024
+#define JSON_WRITER_CHUNK_SIZE 16384 // Default flush threshold for sinks
+#define JSON_WRITER_MAX_DEPTH 64     // One bit of need_comma per level
+
+// Receives each finished chunk. Returns 0 on failure, which stops the writer.
+typedef int (*JsonSinkFn)(void* ctx, const char* data, size_t len);
+
+typedef struct JsonWriter {
+    char* buf;
+    size_t len;
+    size_t capacity;
+
+    JsonSinkFn sink;    // NULL: keep everything in buf
+    void* sink_ctx;
+    size_t chunk_size;  // Flush to the sink once len reaches this
+    int fd;             // Target of json_writer_fd_sink
+
+    int depth;
+    uint64_t need_comma; // Bit d set once level d holds a value
+    int after_key;
+    int failed;
+} JsonWriter;
+
+static inline void json_writer_init(JsonWriter* w) {
+    memset(w, 0, sizeof(*w));
+    w->fd = -1;
+}
+
+static inline void json_writer_init_sink(JsonWriter* w, JsonSinkFn sink, void* ctx, size_t chunk_size) {
+    json_writer_init(w);
+    w->sink = sink;
+    w->sink_ctx = ctx;
+    w->chunk_size = chunk_size ? chunk_size : JSON_WRITER_CHUNK_SIZE;
+}
+
+static inline int json_writer_fd_sink(void* ctx, const char* data, size_t len) {
+    int fd = *(const int*)ctx;
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        data += written;
+        len -= (size_t)written;
+    }
+    return 1;
+}
+
+static inline void json_writer_init_fd(JsonWriter* w, int fd, size_t chunk_size) {
+    json_writer_init_sink(w, json_writer_fd_sink, NULL, chunk_size);
+    w->fd = fd;
+    w->sink_ctx = &w->fd;
+}
+
+// Starts a new document, keeping the buffer for reuse
+static inline void json_writer_reset(JsonWriter* w) {
+    w->len = 0;
+    w->depth = 0;
+    w->need_comma = 0;
+    w->after_key = 0;
+    w->failed = 0;
+}
+
+static inline void json_writer_free(JsonWriter* w) {
+    free(w->buf);
+    w->buf = NULL;
+    w->len = w->capacity = 0;
+}
+
+static inline int json_writer_reserve(JsonWriter* w, size_t extra) {
+    if (w->len + extra <= w->capacity) {
+        return 1;
+    }
+    size_t capacity = w->capacity ? w->capacity : JSON_WRITER_INITIAL_CAPACITY;
+    while (capacity < w->len + extra) {
+        capacity *= 2;
+    }
+    char* buf = (char*)realloc(w->buf, capacity);
+    if (buf == NULL) {
+        w->failed = 1;
+        return 0;
+    }
+    w->buf = buf;
+    w->capacity = capacity;
+    return 1;
+}
+
+// Hands everything buffered so far to the sink
+static inline int json_writer_flush(JsonWriter* w) {
+    if (w->sink == NULL || w->failed || w->len == 0) {
+        return !w->failed;
+    }
+    if (!w->sink(w->sink_ctx, w->buf, w->len)) {
+        w->failed = 1;
+        return 0;
+    }
+    w->len = 0;
+    return 1;
+}
+
+static inline void json_writer_append(JsonWriter* w, const char* data, size_t len) {
+    if (w->failed || !json_writer_reserve(w, len)) {
+        return;
+    }
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+static inline void json_writer_putc(JsonWriter* w, char c) {
+    if (w->failed || !json_writer_reserve(w, 1)) {
+        return;
+    }
+    w->buf[w->len++] = c;
+}
+
+// Comma and key bookkeeping before any value
+static inline void json_writer_prefix(JsonWriter* w) {
+    if (w->after_key) {
+        w->after_key = 0;
+        return;
+    }
+    if (w->depth > 0) {
+        uint64_t bit = (uint64_t)1 << (w->depth - 1);
+        if (w->need_comma & bit) {
+            json_writer_putc(w, ',');
+        }
+        w->need_comma |= bit;
+    }
+}
+
+// Flushes at value boundaries once a sink's chunk is full
+static inline void json_writer_value_done(JsonWriter* w) {
+    if (w->sink != NULL && w->len >= w->chunk_size) {
+        json_writer_flush(w);
+    }
+}
+
+static inline void json_writer_escape(JsonWriter* w, const char* s) {
+    static const char hex[] = "0123456789abcdef";
+    json_writer_putc(w, '"');
+    const char* run = s;
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\' && !(c == '/' && s > run && s[-1] == '<')) {
+            continue;
+        }
+        json_writer_append(w, run, (size_t)(s - run));
+        run = s + 1;
+        switch (c) {
+            case '"':  json_writer_append(w, "\\\"", 2); break;
+            case '\\': json_writer_append(w, "\\\\", 2); break;
+            case '/':  json_writer_append(w, "\\/", 2); break; // Keeps "</script>" out of inline scripts
+            case '\n': json_writer_append(w, "\\n", 2); break;
+            case '\r': json_writer_append(w, "\\r", 2); break;
+            case '\t': json_writer_append(w, "\\t", 2); break;
+            case '\b': json_writer_append(w, "\\b", 2); break;
+            case '\f': json_writer_append(w, "\\f", 2); break;
+            default: {
+                char esc[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 15]};
+                json_writer_append(w, esc, sizeof(esc));
+                break;
+            }
+        }
+    }
+    json_writer_append(w, run, (size_t)(s - run));
+    json_writer_putc(w, '"');
+}
+
+static inline void json_writer_begin(JsonWriter* w, char open) {
+    json_writer_prefix(w);
+    if (w->depth >= JSON_WRITER_MAX_DEPTH) {
+        w->failed = 1;
+        return;
+    }
+    json_writer_putc(w, open);
+    w->depth++;
+    w->need_comma &= ~((uint64_t)1 << (w->depth - 1));
+}
+
+static inline void json_writer_end(JsonWriter* w, char close) {
+    if (w->depth == 0) {
+        w->failed = 1;
+        return;
+    }
+    json_writer_putc(w, close);
+    w->depth--;
+    json_writer_value_done(w);
+}
+
+static inline void json_writer_begin_object(JsonWriter* w) { json_writer_begin(w, '{'); }
+static inline void json_writer_end_object(JsonWriter* w) { json_writer_end(w, '}'); }
+static inline void json_writer_begin_array(JsonWriter* w) { json_writer_begin(w, '['); }
+static inline void json_writer_end_array(JsonWriter* w) { json_writer_end(w, ']'); }
+
+static inline void json_writer_key(JsonWriter* w, const char* key) {
+    json_writer_prefix(w);
+    json_writer_escape(w, key);
+    json_writer_putc(w, ':');
+    w->after_key = 1;
+}
+
+static inline void json_writer_string(JsonWriter* w, const char* value) {
+    json_writer_prefix(w);
+    if (value == NULL) {
+        json_writer_append(w, "null", 4);
+    } else {
+        json_writer_escape(w, value);
+    }
+    json_writer_value_done(w);
+}
+
+static inline void json_writer_int64(JsonWriter* w, long long value) {
+    char digits[24];
+    int pos = (int)sizeof(digits);
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    do {
+        digits[--pos] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) {
+        digits[--pos] = '-';
+    }
+    json_writer_prefix(w);
+    json_writer_append(w, digits + pos, sizeof(digits) - (size_t)pos);
+    json_writer_value_done(w);
+}
+
+static inline void json_writer_int(JsonWriter* w, int value) {
+    json_writer_int64(w, value);
+}
+
+static inline void json_writer_bool(JsonWriter* w, int value) {
+    json_writer_prefix(w);
+    if (value) {
+        json_writer_append(w, "true", 4);
+    } else {
+        json_writer_append(w, "false", 5);
+    }
+    json_writer_value_done(w);
+}
+
+static inline void json_writer_null(JsonWriter* w) {
+    json_writer_prefix(w);
+    json_writer_append(w, "null", 4);
+    json_writer_value_done(w);
+}
+
+// Sink mode: flushes the tail. Returns 0 if any write or allocation failed.
+static inline int json_writer_finish(JsonWriter* w) {
+    json_writer_flush(w);
+    return !w->failed && w->depth == 0;
+}
+
+// Buffer mode: returns the finished document as a malloc'd string the caller
+// frees, or NULL on failure. The writer is left empty.
+static inline char* json_writer_take(JsonWriter* w) {
+    char* result = NULL;
+    json_writer_putc(w, '\0');
+    if (!w->failed && w->depth == 0) {
+        result = w->buf;
+    } else {
+        free(w->buf);
+    }
+    json_writer_init(w);
+    return result;
+}
+
+#endif
@@ -0,0 +1,405 @@
+/*
+ * PRIORITY SOCIAL MEDIA - Load Test
+ * Keep-alive HTTP load generator for web_server.c: holds N connections open,
+ * keeps P pipelined requests in flight on each, and reports requests/sec
+ * and latency percentiles. With -t the connections are split across
+ * threads, each with its own epoll loop, so the client can load a
+ * multi-worker server without being the bottleneck.
+ *
+ * Build: make loadtest
+ * Run:   ./loadtest [-a address] [-p port] [-c connections] [-d seconds]
+ *                   [-P pipeline] [-t threads] [path]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+
+#define MAX_EVENTS 256
+#define MAX_PIPELINE 64
+#define READ_CHUNK 65536
+
+typedef struct Client {
+    int fd;
+    int connected;
+    char* in;
+    size_t in_len;
+    size_t in_capacity;
+    char* out;
+    size_t out_len;
+    size_t out_sent;
+    double sent_at[MAX_PIPELINE]; // Ring of send times for in-flight requests
+    int head;
+    int outstanding;
+} Client;
+
+typedef struct LoadStats {
+    unsigned int* latencies_us;
+    size_t count;
+    size_t capacity;
+    long errors;   // Non-2xx responses
+    long dropped;  // Requests lost to a closed or failed connection
+    long reconnects;
+} LoadStats;
+
+// One thread's share of the connections
+typedef struct LoadThread {
+    pthread_t thread;
+    int epoll_fd;
+    Client* clients;
+    int client_count;
+    LoadStats stats;
+    int failed;
+} LoadThread;
+
+static struct sockaddr_in target;
+static const char* request_text;
+static size_t request_len;
+static int pipeline = 1;
+static double stop_at;
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void record_latency(LoadStats* stats, double seconds) {
+    if (stats->count == stats->capacity) {
+        size_t capacity = stats->capacity ? stats->capacity * 2 : 1 << 16;
+        unsigned int* grown = realloc(stats->latencies_us, capacity * sizeof(unsigned int));
+        if (grown == NULL) {
+            return;
+        }
+        stats->latencies_us = grown;
+        stats->capacity = capacity;
+    }
+    stats->latencies_us[stats->count++] = (unsigned int)(seconds * 1e6);
+}
+
+static int client_connect(LoadThread* load, Client* client) {
+    client->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (client->fd < 0) {
+        perror("socket");
+        return 0;
+    }
+    int one = 1;
+    setsockopt(client->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(client->fd, (struct sockaddr*)&target, sizeof(target)) < 0 && errno != EINPROGRESS) {
+        perror("connect");
+        close(client->fd);
+        return 0;
+    }
+
+    client->connected = 0;
+    client->in_len = 0;
+    client->out_len = client->out_sent = 0;
+    client->head = client->outstanding = 0;
+
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = client;
+    if (epoll_ctl(load->epoll_fd, EPOLL_CTL_ADD, client->fd, &event) < 0) {
+        perror("epoll_ctl");
+        close(client->fd);
+        return 0;
+    }
+    return 1;
+}
+
+static int client_reconnect(LoadThread* load, Client* client) {
+    load->stats.dropped += client->outstanding;
+    load->stats.reconnects++;
+    close(client->fd);
+    return client_connect(load, client);
+}
+
+// Queues requests until the pipeline is full
+static void client_top_up(Client* client, double now) {
+    while (client->outstanding < pipeline) {
+        memcpy(client->out + client->out_len, request_text, request_len);
+        client->out_len += request_len;
+        client->sent_at[(client->head + client->outstanding) % MAX_PIPELINE] = now;
+        client->outstanding++;
+    }
+}
+
+// Consumes complete responses. Returns 0 when the server asked to close.
+static int client_read_responses(Client* client, LoadStats* stats, double now) {
+    size_t offset = 0;
+    int keep_alive = 1;
+    while (keep_alive && client->outstanding > 0) {
+        char* start = client->in + offset;
+        size_t available = client->in_len - offset;
+        char* end = memmem(start, available, "\r\n\r\n", 4);
+        if (end == NULL) {
+            break;
+        }
+        size_t header_len = (size_t)(end - start) + 4;
+        size_t content_length = 0;
+        int status = available > 12 ? atoi(start + 9) : 0;
+        for (char* line = memchr(start, '\n', header_len); line != NULL && line < end;
+             line = memchr(line + 1, '\n', (size_t)(end - line))) {
+            if (strncasecmp(line + 1, "Content-Length:", 15) == 0) {
+                content_length = (size_t)strtoul(line + 16, NULL, 10);
+            } else if (strncasecmp(line + 1, "Connection: close", 17) == 0) {
+                keep_alive = 0;
+            }
+        }
+        if (available < header_len + content_length) {
+            break;
+        }
+
+        record_latency(stats, now - client->sent_at[client->head]);
+        if (status < 200 || status > 299) {
+            stats->errors++;
+        }
+        client->head = (client->head + 1) % MAX_PIPELINE;
+        client->outstanding--;
+        offset += header_len + content_length;
+    }
+    memmove(client->in, client->in + offset, client->in_len - offset);
+    client->in_len -= offset;
+    return keep_alive;
+}
+
+// Reads and writes until the socket would block. Returns 0 on a dead connection.
+static int client_service(Client* client, LoadStats* stats) {
+    if (!client->connected) {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        getsockopt(client->fd, SOL_SOCKET, SO_ERROR, &error, &len);
+        if (error != 0) {
+            return 0;
+        }
+        client->connected = 1;
+    }
+
+    for (;;) {
+        double now = now_seconds();
+        if (client->out_sent == client->out_len) {
+            client->out_len = client->out_sent = 0;
+            client_top_up(client, now);
+        }
+        while (client->out_sent < client->out_len) {
+            ssize_t sent = send(client->fd, client->out + client->out_sent,
+                                client->out_len - client->out_sent, MSG_NOSIGNAL);
+            if (sent > 0) {
+                client->out_sent += (size_t)sent;
+            } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else if (!(sent < 0 && errno == EINTR)) {
+                return 0;
+            }
+        }
+
+        ssize_t received = recv(client->fd, client->in + client->in_len,
+                                client->in_capacity - client->in_len, 0);
+        if (received > 0) {
+            client->in_len += (size_t)received;
+            if (!client_read_responses(client, stats, now_seconds())) {
+                return 0;
+            }
+            if (client->in_len == client->in_capacity) {
+                printf("Response larger than %d bytes\n", READ_CHUNK);
+                return 0;
+            }
+        } else if (received == 0) {
+            return 0;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 1;
+        } else if (errno != EINTR) {
+            return 0;
+        }
+    }
+}
+
+static int compare_latency(const void* a, const void* b) {
+    unsigned int x = *(const unsigned int*)a, y = *(const unsigned int*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile_ms(const LoadStats* stats, double fraction) {
+    if (stats->count == 0) {
+        return 0;
+    }
+    size_t index = (size_t)(fraction * (stats->count - 1));
+    return stats->latencies_us[index] / 1000.0;
+}
+
+static void* load_thread_run(void* arg) {
+    LoadThread* load = arg;
+    struct epoll_event events[MAX_EVENTS];
+    while (now_seconds() < stop_at) {
+        int ready = epoll_wait(load->epoll_fd, events, MAX_EVENTS, 100);
+        if (ready < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            load->failed = 1;
+            break;
+        }
+        for (int i = 0; i < ready; i++) {
+            Client* client = events[i].data.ptr;
+            if (((events[i].events & EPOLLERR) || !client_service(client, &load->stats)) &&
+                !client_reconnect(load, client)) {
+                load->failed = 1;
+                return NULL;
+            }
+        }
+    }
+    return NULL;
+}
+
+static void usage(const char* program) {
+    printf("Usage: %s [-a address] [-p port] [-c connections] [-d seconds] [-P pipeline] [-t threads] [path]\n",
+           program);
+}
+
+int main(int argc, char** argv) {
+    const char* address = "127.0.0.1";
+    const char* port_str = getenv("PORT");
+    int port = port_str ? atoi(port_str) : 10000;
+    int connections = 64;
+    double duration = 10;
+    int threads = 1;
+    const char* path = "/";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "a:p:c:d:P:t:")) != -1) {
+        switch (opt) {
+            case 'a': address = optarg; break;
+            case 'p': port = atoi(optarg); break;
+            case 'c': connections = atoi(optarg); break;
+            case 'd': duration = atof(optarg); break;
+            case 'P': pipeline = atoi(optarg); break;
+            case 't': threads = atoi(optarg); break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (optind < argc) {
+        path = argv[optind];
+    }
+    if (connections <= 0 || duration <= 0 || pipeline <= 0 || pipeline > MAX_PIPELINE ||
+        threads <= 0 || threads > connections) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    memset(&target, 0, sizeof(target));
+    target.sin_family = AF_INET;
+    target.sin_port = htons(port);
+    if (inet_pton(AF_INET, address, &target.sin_addr) != 1) {
+        printf("Invalid address: %s\n", address);
+        return 1;
+    }
+
+    char request[512];
+    snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: %s:%d\r\n\r\n", path, address, port);
+    request_text = request;
+    request_len = strlen(request);
+    signal(SIGPIPE, SIG_IGN);
+
+    Client* clients = calloc((size_t)connections, sizeof(Client));
+    LoadThread* loads = calloc((size_t)threads, sizeof(LoadThread));
+    if (clients == NULL || loads == NULL) {
+        printf("Memory allocation failed!\n");
+        return 1;
+    }
+    for (int t = 0; t < threads; t++) {
+        LoadThread* load = &loads[t];
+        int first = (int)((long)connections * t / threads);
+        load->clients = &clients[first];
+        load->client_count = (int)((long)connections * (t + 1) / threads) - first;
+        load->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (load->epoll_fd < 0) {
+            perror("epoll_create1");
+            return 1;
+        }
+        for (int i = 0; i < load->client_count; i++) {
+            Client* client = &load->clients[i];
+            client->in_capacity = READ_CHUNK;
+            client->in = malloc(READ_CHUNK);
+            client->out = malloc(request_len * MAX_PIPELINE);
+            if (client->in == NULL || client->out == NULL) {
+                printf("Memory allocation failed!\n");
+                return 1;
+            }
+            if (!client_connect(load, client)) {
+                return 1;
+            }
+        }
+    }
+
+    printf("Running %.0fs test @ http://%s:%d%s (%d connections, pipeline %d, %d thread%s)\n",
+           duration, address, port, path, connections, pipeline, threads, threads == 1 ? "" : "s");
+    fflush(stdout);
+
+    double start = now_seconds();
+    stop_at = start + duration;
+    for (int t = 0; t < threads; t++) {
+        if (pthread_create(&loads[t].thread, NULL, load_thread_run, &loads[t]) != 0) {
+            printf("Could not start thread %d\n", t);
+            return 1;
+        }
+    }
+
+    // Merge every thread's results
+    LoadStats stats;
+    memset(&stats, 0, sizeof(stats));
+    int failed = 0;
+    for (int t = 0; t < threads; t++) {
+        LoadStats* part = &loads[t].stats;
+        pthread_join(loads[t].thread, NULL);
+        failed |= loads[t].failed;
+        unsigned int* grown = realloc(stats.latencies_us, (stats.count + part->count + 1) * sizeof(unsigned int));
+        if (grown == NULL) {
+            printf("Memory allocation failed!\n");
+            return 1;
+        }
+        stats.latencies_us = grown;
+        memcpy(stats.latencies_us + stats.count, part->latencies_us, part->count * sizeof(unsigned int));
+        stats.count += part->count;
+        stats.errors += part->errors;
+        stats.dropped += part->dropped;
+        stats.reconnects += part->reconnects;
+        free(part->latencies_us);
+    }
+    double elapsed = now_seconds() - start;
+
+    qsort(stats.latencies_us, stats.count, sizeof(unsigned int), compare_latency);
+    double total_ms = 0;
+    for (size_t i = 0; i < stats.count; i++) {
+        total_ms += stats.latencies_us[i] / 1000.0;
+    }
+
+    printf("Requests:     %10zu in %.2fs (%ld non-2xx, %ld dropped, %ld reconnects)\n",
+           stats.count, elapsed, stats.errors, stats.dropped, stats.reconnects);
+    printf("Throughput:   %10.0f requests/sec\n", stats.count / elapsed);
+    printf("Latency:      avg %.3f ms, p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+           stats.count ? total_ms / stats.count : 0, percentile_ms(&stats, 0.50),
+           percentile_ms(&stats, 0.99), percentile_ms(&stats, 1.0));
+
+    for (int i = 0; i < connections; i++) {
+        close(clients[i].fd);
+        free(clients[i].in);
+        free(clients[i].out);
+    }
+    for (int t = 0; t < threads; t++) {
+        close(loads[t].epoll_fd);
+    }
+    free(loads);
+    free(clients);
+    free(stats.latencies_us);
+    return stats.count > 0 && !failed ? 0 : 1;
+}
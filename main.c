@@ -2,7 +2,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
-#include <json-c/json.h>
+#include "user_index.h"
+#include "feed_rank.h"
+#include "json_writer.h"
+#include "slab.h"
 
 // Data Structures
 typedef struct User {
@@ -58,119 +61,242 @@ typedef struct {
 // Global app state
 AppState app_state = {NULL, NULL, NULL, NULL, NULL, "glassmorphic", "feed"};
 
-// Hash Map for efficient user lookup
-#define HASH_SIZE 1000
-User* user_hash_map[HASH_SIZE];
+// Every Follow node; unfollowed nodes are reused by the next follow
+static SlabAllocator follow_slab;
 
-// Hash function
-unsigned int hash(int id) {
-    return id % HASH_SIZE;
+// Hash index for efficient user lookup (shared with priority.c, see user_index.h)
+static const char* user_name(void* ctx, const void* record) {
+    (void)ctx;
+    return ((const User*)record)->username;
 }
 
-// Add user to hash map
+UserIndex user_index = {NULL, 0, NULL, 0, user_name, NULL, NULL};
+
+// Add user to the index (the users list itself is linked by the caller)
 void add_user_to_hash(User* user) {
-    unsigned int index = hash(user->id);
-    user->next = user_hash_map[index];
-    user_hash_map[index] = user;
+    if (!user_index_insert(&user_index, user->id, user)) {
+        printf("Warning: could not index user %d\n", user->id);
+    }
 }
 
 // Find user by ID (O(1) average case)
 User* find_user_by_id(int id) {
-    unsigned int index = hash(id);
-    User* current = user_hash_map[index];
-    while (current != NULL) {
-        if (current->id == id) {
-            return current;
+    return (User*)user_index_find_id(&user_index, id);
+}
+
+// Find user by username (O(1) average case)
+User* find_user_by_username(const char* username) {
+    return (User*)user_index_find_name(&user_index, username);
+}
+
+// Priority feed for the current viewer (see feed_rank.h). Posts from users
+// the viewer follows, and close-friends-only posts, rank first; the global
+// post list keeps its order.
+FeedRank viewer_feed = {0, {{NULL, 0, 0}, {NULL, 0, 0}}};
+
+static FeedRankEntry rank_entry(Post* post) {
+    FeedRankEntry entry;
+    entry.timestamp = (long long)post->timestamp;
+    entry.post_id = post->id;
+    entry.author_id = post->author_id;
+    entry.flags = post->is_close_friends_only ? FEED_RANK_PINNED : 0;
+    entry.record = post;
+    return entry;
+}
+
+static int compare_ids(const void* a, const void* b) {
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// Builds the viewer's ranking once: O(follows + posts log posts)
+void rank_posts_for_viewer() {
+    feed_rank_free(&viewer_feed);
+    if (app_state.current_user == NULL) return;
+    feed_rank_init(&viewer_feed, app_state.current_user->id);
+    
+    // Sorted ids the viewer follows, so each post needs one binary search
+    int followed_count = 0;
+    for (Follow* follow = app_state.follows; follow != NULL; follow = follow->next) {
+        if (follow->follower_id == viewer_feed.viewer_id) followed_count++;
+    }
+    int* followed = malloc((followed_count > 0 ? followed_count : 1) * sizeof(int));
+    if (followed == NULL) {
+        printf("Error: Could not rank posts\n");
+        return;
+    }
+    followed_count = 0;
+    for (Follow* follow = app_state.follows; follow != NULL; follow = follow->next) {
+        if (follow->follower_id == viewer_feed.viewer_id) followed[followed_count++] = follow->following_id;
+    }
+    qsort(followed, followed_count, sizeof(int), compare_ids);
+    
+    for (Post* post = app_state.posts; post != NULL; post = post->next) {
+        FeedRankEntry entry = rank_entry(post);
+        int is_followed = bsearch(&post->author_id, followed, followed_count,
+                                  sizeof(int), compare_ids) != NULL;
+        FeedRankLane lane = (is_followed || post->is_close_friends_only) ?
+                            FEED_RANK_PRIORITY : FEED_RANK_REGULAR;
+        if (!feed_rank_add(&viewer_feed, &entry, lane)) {
+            printf("Error: Could not rank posts\n");
+            break;
         }
-        current = current->next;
     }
-    return NULL;
+    free(followed);
 }
 
-// Priority Feed Algorithm - Move-to-Front heuristic
-void prioritize_posts() {
-    if (app_state.posts == NULL || app_state.current_user == NULL) return;
+static int viewer_follows(int author_id) {
+    for (Follow* follow = app_state.follows; follow != NULL; follow = follow->next) {
+        if (follow->follower_id == viewer_feed.viewer_id && follow->following_id == author_id) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Links a new post and slots it into the viewer's ranking
+void add_post(Post* post) {
+    post->next = app_state.posts;
+    app_state.posts = post;
     
-    Post* prev = NULL;
-    Post* current = app_state.posts;
-    Post* priority_posts = NULL;
+    if (app_state.current_user != NULL && viewer_feed.viewer_id == app_state.current_user->id) {
+        FeedRankEntry entry = rank_entry(post);
+        FeedRankLane lane = (post->is_close_friends_only || viewer_follows(post->author_id)) ?
+                            FEED_RANK_PRIORITY : FEED_RANK_REGULAR;
+        feed_rank_add(&viewer_feed, &entry, lane);
+    }
+}
+
+int follow_user(int follower_id, int following_id) {
+    Follow* follow = slab_alloc(&follow_slab);
+    if (follow == NULL) return 0;
+    follow->follower_id = follower_id;
+    follow->following_id = following_id;
+    follow->next = app_state.follows;
+    app_state.follows = follow;
     
-    // Extract close friends posts and move to front
-    while (current != NULL) {
-        Post* next = current->next;
-        
-        // Check if post is from close friend
-        int is_close_friend = 0;
-        Follow* follow = app_state.follows;
-        while (follow != NULL) {
-            if (follow->follower_id == app_state.current_user->id && 
-                follow->following_id == current->author_id) {
-                is_close_friend = 1;
-                break;
-            }
-            follow = follow->next;
-        }
-        
-        if (is_close_friend || current->is_close_friends_only) {
-            // Remove from current position
+    if (follower_id == viewer_feed.viewer_id) {
+        feed_rank_set_author(&viewer_feed, following_id, 1);
+    }
+    return 1;
+}
+
+int unfollow_user(int follower_id, int following_id) {
+    Follow* prev = NULL;
+    for (Follow* follow = app_state.follows; follow != NULL; prev = follow, follow = follow->next) {
+        if (follow->follower_id == follower_id && follow->following_id == following_id) {
             if (prev != NULL) {
-                prev->next = next;
+                prev->next = follow->next;
             } else {
-                app_state.posts = next;
+                app_state.follows = follow->next;
             }
+            slab_free(&follow_slab, follow);
             
-            // Add to priority list
-            current->next = priority_posts;
-            priority_posts = current;
-            current->priority_weight = 10; // High priority
-        } else {
-            current->priority_weight = 1; // Normal priority
-            prev = current;
+            if (follower_id == viewer_feed.viewer_id) {
+                feed_rank_set_author(&viewer_feed, following_id, 0);
+            }
+            return 1;
         }
-        
-        current = next;
     }
+    return 0;
+}
+
+static void write_post_json(JsonWriter* w, const Post* post, FeedRankLane lane) {
+    json_writer_begin_object(w);
+    json_writer_key(w, "id"); json_writer_int(w, post->id);
+    json_writer_key(w, "authorId"); json_writer_int(w, post->author_id);
+    json_writer_key(w, "authorName"); json_writer_string(w, post->author_name);
+    json_writer_key(w, "content"); json_writer_string(w, post->content);
+    json_writer_key(w, "timestamp"); json_writer_int64(w, (long long)post->timestamp * 1000); // JS expects milliseconds
+    json_writer_key(w, "isCloseFriendsOnly"); json_writer_bool(w, post->is_close_friends_only);
+    json_writer_key(w, "mediaType"); json_writer_string(w, post->media_type);
+    json_writer_key(w, "mediaPath"); json_writer_string(w, post->media_path);
+    json_writer_key(w, "mediaDescription"); json_writer_string(w, post->media_description);
+    json_writer_key(w, "priorityWeight"); json_writer_int(w, lane == FEED_RANK_PRIORITY ? 10 : 1);
+    json_writer_end_object(w);
+}
+
+// Whole ranked feed as a JSON array; with an fd writer it streams out in chunks
+int write_posts_json(JsonWriter* w) {
+    json_writer_begin_array(w);
     
-    // Reattach priority posts to front
-    if (priority_posts != NULL) {
-        Post* last_priority = priority_posts;
-        while (last_priority->next != NULL) {
-            last_priority = last_priority->next;
-        }
-        last_priority->next = app_state.posts;
-        app_state.posts = priority_posts;
+    FeedRankLane lane;
+    const FeedRankEntry* entry;
+    for (size_t i = 0; (entry = feed_rank_at(&viewer_feed, i, &lane)) != NULL; i++) {
+        write_post_json(w, (const Post*)entry->record, lane);
     }
+    
+    json_writer_end_array(w);
+    return !w->failed;
 }
 
 // Create JSON for frontend injection
 char* create_posts_json() {
-    json_object* posts_array = json_object_new_array();
+    JsonWriter w;
+    json_writer_init(&w);
+    write_posts_json(&w);
+    return json_writer_take(&w);
+}
+
+// Feed paging over the viewer's ranking; a cursor names the last post of the
+// previous page as "lane:timestamp:id"
+#define FEED_PAGE_SIZE 20
+#define FEED_PAGE_MAX 64
+
+// One page of posts after cursor (NULL or "" for the first page). The start
+// is found by binary search, so a page costs O(log posts + limit).
+int write_feed_page_json(JsonWriter* w, const char* cursor_text, int limit) {
+    if (limit <= 0) limit = FEED_PAGE_SIZE;
+    if (limit > FEED_PAGE_MAX) limit = FEED_PAGE_MAX;
     
-    Post* current = app_state.posts;
-    while (current != NULL) {
-        json_object* post_obj = json_object_new_object();
-        
-        json_object_object_add(post_obj, "id", json_object_new_int(current->id));
-        json_object_object_add(post_obj, "authorId", json_object_new_int(current->author_id));
-        json_object_object_add(post_obj, "authorName", json_object_new_string(current->author_name));
-        json_object_object_add(post_obj, "content", json_object_new_string(current->content));
-        json_object_object_add(post_obj, "timestamp", json_object_new_int64(current->timestamp * 1000)); // JS expects milliseconds
-        json_object_object_add(post_obj, "isCloseFriendsOnly", json_object_new_boolean(current->is_close_friends_only));
-        json_object_object_add(post_obj, "mediaType", json_object_new_string(current->media_type));
-        json_object_object_add(post_obj, "mediaPath", json_object_new_string(current->media_path));
-        json_object_object_add(post_obj, "mediaDescription", json_object_new_string(current->media_description));
-        json_object_object_add(post_obj, "priorityWeight", json_object_new_int(current->priority_weight));
-        
-        json_object_array_add(posts_array, post_obj);
-        current = current->next;
+    size_t start = 0;
+    int lane_value;
+    FeedRankEntry key;
+    memset(&key, 0, sizeof(key));
+    if (cursor_text != NULL && cursor_text[0] != '\0' &&
+        sscanf(cursor_text, "%d:%lld:%d", &lane_value, &key.timestamp, &key.post_id) == 3 &&
+        lane_value >= 0 && lane_value < FEED_RANK_LANES) {
+        start = feed_rank_position_after(&viewer_feed, (FeedRankLane)lane_value, &key);
     }
     
-    const char* json_string = json_object_to_json_string(posts_array);
-    char* result = malloc(strlen(json_string) + 1);
-    strcpy(result, json_string);
+    json_writer_begin_object(w);
+    json_writer_key(w, "posts");
+    json_writer_begin_array(w);
+    FeedRankLane lane = FEED_RANK_PRIORITY;
+    const FeedRankEntry* entry = NULL;
+    const FeedRankEntry* last = NULL;
+    FeedRankLane last_lane = FEED_RANK_PRIORITY;
+    int count = 0;
+    while (count < limit && (entry = feed_rank_at(&viewer_feed, start + count, &lane)) != NULL) {
+        write_post_json(w, (const Post*)entry->record, lane);
+        last = entry;
+        last_lane = lane;
+        count++;
+    }
+    json_writer_end_array(w);
     
-    json_object_put(posts_array); // Free JSON object
-    return result;
+    int has_more = feed_rank_at(&viewer_feed, start + count, NULL) != NULL;
+    json_writer_key(w, "hasMore");
+    json_writer_bool(w, has_more);
+    json_writer_key(w, "nextCursor");
+    if (has_more && last != NULL) {
+        char next_cursor[64];
+        snprintf(next_cursor, sizeof(next_cursor), "%d:%lld:%d",
+                 (int)last_lane, last->timestamp, last->post_id);
+        json_writer_string(w, next_cursor);
+    } else {
+        json_writer_null(w);
+    }
+    json_writer_end_object(w);
+    return !w->failed;
+}
+
+char* create_feed_page_json(const char* cursor_text, int limit) {
+    JsonWriter w;
+    json_writer_init(&w);
+    write_feed_page_json(&w, cursor_text, limit);
+    return json_writer_take(&w);
 }
 
 // Initialize sample data
@@ -194,6 +320,7 @@ void initialize_data() {
     bob->is_online = 1;
     bob->next = alice;
     add_user_to_hash(bob);
+    app_state.users = bob;
     
     // Create sample posts
     Post* post1 = malloc(sizeof(Post));
@@ -211,7 +338,7 @@ void initialize_data() {
     app_state.posts = post1;
     
     // Create sample follow relationship
-    Follow* follow1 = malloc(sizeof(Follow));
+    Follow* follow1 = slab_alloc(&follow_slab);
     follow1->follower_id = 2;
     follow1->following_id = 1;
     follow1->next = NULL;
@@ -289,6 +416,7 @@ void load_state_from_file() {
 // Cleanup memory
 void cleanup() {
     // Free users
+    user_index_free(&user_index);
     User* user = app_state.users;
     while (user != NULL) {
         User* next = user->next;
@@ -304,13 +432,11 @@ void cleanup() {
         post = next;
     }
     
-    // Free follows
-    Follow* follow = app_state.follows;
-    while (follow != NULL) {
-        Follow* next = follow->next;
-        free(follow);
-        follow = next;
-    }
+    // Free follows, all blocks at once
+    app_state.follows = NULL;
+    slab_release(&follow_slab);
+    
+    feed_rank_free(&viewer_feed);
     
     // Free messages
     Message* message = app_state.messages;
@@ -324,11 +450,7 @@ void cleanup() {
 // Main function
 int main() {
     printf("🚀 Priority Social Media - C Backend Starting...\n");
-    
-    // Initialize hash map
-    for (int i = 0; i < HASH_SIZE; i++) {
-        user_hash_map[i] = NULL;
-    }
+    slab_init(&follow_slab, sizeof(Follow));
     
     // Load or initialize data
     load_state_from_file();
@@ -336,11 +458,11 @@ int main() {
     // Set current user for demo
     app_state.current_user = find_user_by_id(1);
     
-    // Apply priority algorithm
-    prioritize_posts();
+    // Rank the feed for this viewer
+    rank_posts_for_viewer();
     
-    // Generate JSON for frontend
-    char* posts_json = create_posts_json();
+    // Generate JSON for frontend (first feed page; pass nextCursor for more)
+    char* posts_json = create_feed_page_json(NULL, FEED_PAGE_SIZE);
     printf("Posts JSON for frontend injection:\n%s\n", posts_json);
     free(posts_json);
     
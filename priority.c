@@ -0,0 +1,5495 @@
+/*
+ * PRIORITY SOCIAL MEDIA - Engine Library (libpriority)
+ * Data functions over a PriorityContext: no printing and no globals
+ *
+ * See priority.h for the context and error conventions. The modules below
+ * keep the layout of the original single-file program.
+ */
+
+#define _XOPEN_SOURCE 700 // PTHREAD_MUTEX_RECURSIVE, fdatasync, clock_gettime
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS, MAP_NORESERVE
+#include "priority.h"
+#include "dat_codec.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stddef.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+// =============================================================================
+// SOURCE FILE: context.c
+// Context Module - Engine state handed to every call
+// =============================================================================
+
+// The user index keeps a pointer back to ctx, so a context must not be
+// copied or moved once initialized
+void priority_init(PriorityContext* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+    epoch_init(&ctx->epoch);
+    
+    // Recursive so a locked call can make other locked calls
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&ctx->write_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    
+    user_index_init(&ctx->user_index, user_record_name, ctx);
+    ctx->user_index.epoch = &ctx->epoch;
+    ctx->follow_graph.epoch = &ctx->epoch;
+    ctx->close_friends.epoch = &ctx->epoch;
+    slab_init(&ctx->message_slab, sizeof(Message));
+    slab_init(&ctx->notification_slab, sizeof(Notification));
+    ctx->next_user_id = 1;
+    ctx->next_post_id = 1;
+    ctx->next_message_id = 1;
+    ctx->next_notif_id = 1;
+    ctx->wal.fd = -1;
+    ctx->error = "";
+}
+
+void priority_write_begin(PriorityContext* ctx) {
+    pthread_mutex_lock(&ctx->write_lock);
+}
+
+void priority_write_end(PriorityContext* ctx) {
+    pthread_mutex_unlock(&ctx->write_lock);
+}
+
+// Claims a reader slot for the calling thread; -1 when all are taken
+int priority_reader_register(PriorityContext* ctx) {
+    return epoch_reader_register(&ctx->epoch);
+}
+
+void priority_reader_unregister(PriorityContext* ctx, int reader) {
+    epoch_reader_unregister(&ctx->epoch, reader);
+}
+
+// Pointers read between begin and end stay valid until end
+void priority_read_begin(PriorityContext* ctx, int reader) {
+    epoch_read_begin(&ctx->epoch, reader);
+}
+
+void priority_read_end(PriorityContext* ctx, int reader) {
+    epoch_read_end(&ctx->epoch, reader);
+}
+
+// Records why a call failed; returns 0 so callers can return it directly
+static int priority_fail(PriorityContext* ctx, const char* message) {
+    ctx->error = message;
+    return 0;
+}
+
+// =============================================================================
+// SOURCE FILE: arena.c
+// String Arena Module - Shared storage for variable-length text
+// =============================================================================
+
+#define ARENA_INITIAL_CAPACITY 4096
+
+// Makes room for extra more bytes after used. Copied rather than realloc'd:
+// readers may still hold the old buffer.
+static int arena_reserve(PriorityContext* ctx, size_t extra) {
+    StringArena* arena = &ctx->text_arena;
+    if (arena->used + extra <= arena->capacity) {
+        return 1;
+    }
+    
+    size_t new_capacity = arena->capacity ? arena->capacity : ARENA_INITIAL_CAPACITY;
+    size_t needed = (arena->used ? arena->used : 1) + extra;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    if (new_capacity > UINT32_MAX) {
+        new_capacity = UINT32_MAX;
+        if (needed > new_capacity) {
+            return priority_fail(ctx, "String arena is full!");
+        }
+    }
+    
+    char* new_data = (char*)malloc(new_capacity);
+    if (new_data == NULL) {
+        return priority_fail(ctx, "Memory allocation failed!");
+    }
+    char* old_data = arena->data;
+    if (old_data == NULL) {
+        new_data[0] = '\0'; // Offset 0 is the shared empty string
+        arena->used = 1;
+    } else {
+        memcpy(new_data, old_data, arena->used);
+    }
+    EPOCH_PUBLISH(&arena->data, new_data);
+    arena->capacity = new_capacity;
+    if (arena->borrowed) {
+        arena->borrowed = 0; // The snapshot heap stays mapped until cleanup
+    } else {
+        epoch_retire(&ctx->epoch, old_data);
+    }
+    return 1;
+}
+
+StrRef arena_intern(PriorityContext* ctx, const char* text) {
+    if (text == NULL || text[0] == '\0') {
+        return 0; // Empty strings share offset 0
+    }
+    
+    StringArena* arena = &ctx->text_arena;
+    size_t len = strlen(text) + 1;
+    if (arena->used + len > arena->capacity) {
+        // text may point into the arena itself, so remember where it was
+        int inside = arena->data != NULL && text >= arena->data &&
+                     text < arena->data + arena->used;
+        size_t source_offset = inside ? (size_t)(text - arena->data) : 0;
+        if (!arena_reserve(ctx, len)) {
+            return 0;
+        }
+        if (inside) {
+            text = arena->data + source_offset;
+        }
+    }
+    
+    StrRef ref = (StrRef)arena->used;
+    memcpy(arena->data + arena->used, text, len);
+    arena->used += len;
+    return ref;
+}
+
+// The returned pointer stays valid until the next arena_intern call, or
+// until priority_read_end for a reader
+const char* arena_str(const PriorityContext* ctx, StrRef ref) {
+    const char* data = EPOCH_LOAD(&ctx->text_arena.data);
+    if (data == NULL) {
+        return "";
+    }
+    return data + ref;
+}
+
+// =============================================================================
+// SOURCE FILE: wal.c
+// Write-Ahead Log Module - Binary mutation records with group commit
+// =============================================================================
+
+// Record layout (little-endian):
+//   u32 payload length | u32 crc32 of the rest | u64 lsn | u8 type | payload
+// Payload integers are 4 bytes, times 8 bytes, and strings a u32 length
+// followed by the bytes and a NUL, so replay can use them in place.
+// Records are encoded into wal.buf and written once the group ends: after
+// WAL_GROUP_RECORDS records, WAL_GROUP_MS milliseconds, or a wal_sync call.
+// One write and one fdatasync then cover the whole group.
+
+#define WAL_HEADER_SIZE 17
+#define WAL_MAX_RECORD (1 << 20) // Larger lengths mean a torn or corrupt log
+
+typedef enum {
+    WAL_USER = 1,
+    WAL_POST = 2,
+    WAL_MESSAGE = 3,
+    WAL_FOLLOW = 4,
+    WAL_UNFOLLOW = 5,
+    WAL_CLOSE_FRIEND_ADD = 6,
+    WAL_CLOSE_FRIEND_REMOVE = 7,
+    WAL_NOTIFICATION = 8,
+    WAL_NOTIFICATION_READ = 9,
+    WAL_MESSAGE_READ = 10,
+    WAL_NOTIFY = 11 // A templated notification, or its latest state after merges
+} WalRecordType;
+
+static uint32_t wal_crc_table[256];
+static pthread_once_t wal_crc_once = PTHREAD_ONCE_INIT; // Contexts on other threads share the table
+
+static void wal_crc_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        wal_crc_table[i] = c;
+    }
+}
+
+static uint32_t wal_crc32(const unsigned char* data, size_t len) {
+    pthread_once(&wal_crc_once, wal_crc_init);
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; i++) {
+        crc = wal_crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static long long wal_now_ms() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static void wal_store_u32(unsigned char* dst, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        dst[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static void wal_store_u64(unsigned char* dst, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        dst[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static int wal_reserve(WriteAheadLog* wal, size_t extra) {
+    if (wal->len + extra <= wal->capacity) {
+        return 1;
+    }
+    size_t capacity = wal->capacity ? wal->capacity : WAL_BUFFER_SIZE;
+    while (capacity < wal->len + extra) {
+        capacity *= 2;
+    }
+    char* buf = (char*)realloc(wal->buf, capacity);
+    if (buf == NULL) {
+        wal->failed = 1;
+        return 0;
+    }
+    wal->buf = buf;
+    wal->capacity = capacity;
+    return 1;
+}
+
+// Writes out everything buffered so far, without syncing
+static int wal_write_buffer(WriteAheadLog* wal) {
+    size_t done = 0;
+    while (done < wal->len) {
+        ssize_t written = write(wal->fd, wal->buf + done, wal->len - done);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            wal->failed = 1;
+            return 0;
+        }
+        done += (size_t)written;
+    }
+    wal->len = 0;
+    return 1;
+}
+
+// Ends the current group: one write and one fdatasync for all its records
+int wal_sync(PriorityContext* ctx) {
+    WriteAheadLog* wal = &ctx->wal;
+    if (wal->fd < 0 || wal->unsynced == 0) {
+        return !wal->failed;
+    }
+    if (wal->failed || !wal_write_buffer(wal)) {
+        return priority_fail(ctx, "Write-ahead log write failed!");
+    }
+    if (fdatasync(wal->fd) < 0) {
+        wal->failed = 1;
+        return priority_fail(ctx, "Write-ahead log sync failed!");
+    }
+    wal->unsynced = 0;
+    wal->sync_count++;
+    return 1;
+}
+
+// Starts a record; returns its offset in the buffer, or -1 when not logging
+static long wal_begin(PriorityContext* ctx, WalRecordType type) {
+    WriteAheadLog* wal = &ctx->wal;
+    if (wal->fd < 0 || wal->failed || !wal_reserve(wal, WAL_HEADER_SIZE)) {
+        return -1;
+    }
+    long start = (long)wal->len;
+    wal->buf[start + WAL_HEADER_SIZE - 1] = (char)type;
+    wal->len += WAL_HEADER_SIZE;
+    return start;
+}
+
+static void wal_put_u32(PriorityContext* ctx, uint32_t value) {
+    if (wal_reserve(&ctx->wal, 4)) {
+        wal_store_u32((unsigned char*)ctx->wal.buf + ctx->wal.len, value);
+        ctx->wal.len += 4;
+    }
+}
+
+static void wal_put_int(PriorityContext* ctx, int value) {
+    wal_put_u32(ctx, (uint32_t)value);
+}
+
+static void wal_put_time(PriorityContext* ctx, time_t value) {
+    if (wal_reserve(&ctx->wal, 8)) {
+        wal_store_u64((unsigned char*)ctx->wal.buf + ctx->wal.len, (uint64_t)(int64_t)value);
+        ctx->wal.len += 8;
+    }
+}
+
+static void wal_put_str(PriorityContext* ctx, const char* text) {
+    size_t len = strlen(text);
+    wal_put_u32(ctx, (uint32_t)len);
+    if (wal_reserve(&ctx->wal, len + 1)) {
+        memcpy(ctx->wal.buf + ctx->wal.len, text, len + 1);
+        ctx->wal.len += len + 1;
+    }
+}
+
+// Seals the record started at start and ends the group if it is due
+static void wal_end(PriorityContext* ctx, long start) {
+    WriteAheadLog* wal = &ctx->wal;
+    if (start < 0 || wal->failed) {
+        return;
+    }
+    unsigned char* header = (unsigned char*)wal->buf + start;
+    size_t payload = wal->len - (size_t)start - WAL_HEADER_SIZE;
+    wal_store_u32(header, (uint32_t)payload);
+    wal_store_u64(header + 8, wal->next_lsn++);
+    wal_store_u32(header + 4, wal_crc32(header + 8, payload + 9));
+    
+    if (wal->unsynced++ == 0) {
+        wal->group_start_ms = wal_now_ms();
+    }
+    wal->since_snapshot++;
+    if (wal->unsynced >= WAL_GROUP_RECORDS || wal->len >= WAL_BUFFER_SIZE ||
+        wal_now_ms() - wal->group_start_ms >= WAL_GROUP_MS) {
+        wal_sync(ctx);
+    }
+}
+
+static void wal_log_user(PriorityContext* ctx, const User* user) {
+    long start = wal_begin(ctx, WAL_USER);
+    if (start < 0) return;
+    wal_put_int(ctx, user->user_id);
+    wal_put_time(ctx, user->created_at);
+    wal_put_str(ctx, arena_str(ctx, user->username));
+    wal_put_str(ctx, arena_str(ctx, user->password));
+    wal_end(ctx, start);
+}
+
+static void wal_log_post(PriorityContext* ctx, const Post* post) {
+    long start = wal_begin(ctx, WAL_POST);
+    if (start < 0) return;
+    wal_put_int(ctx, post->post_id);
+    wal_put_int(ctx, post->author_id);
+    wal_put_time(ctx, post->created_at);
+    wal_put_int(ctx, post->priority);
+    wal_put_int(ctx, post->media_type);
+    wal_put_str(ctx, arena_str(ctx, post->content));
+    wal_put_str(ctx, arena_str(ctx, post->media_path));
+    wal_put_str(ctx, arena_str(ctx, post->media_description));
+    wal_end(ctx, start);
+}
+
+static void wal_log_message(PriorityContext* ctx, const Message* message) {
+    long start = wal_begin(ctx, WAL_MESSAGE);
+    if (start < 0) return;
+    wal_put_int(ctx, message->message_id);
+    wal_put_int(ctx, message->sender_id);
+    wal_put_int(ctx, message->receiver_id);
+    wal_put_time(ctx, message->timestamp);
+    wal_put_int(ctx, message->priority);
+    wal_put_str(ctx, arena_str(ctx, message->content));
+    wal_end(ctx, start);
+}
+
+// Follows, unfollows and close-friend changes
+static void wal_log_edge(PriorityContext* ctx, WalRecordType type, int from_id, int to_id) {
+    long start = wal_begin(ctx, type);
+    if (start < 0) return;
+    wal_put_int(ctx, from_id);
+    wal_put_int(ctx, to_id);
+    wal_end(ctx, start);
+}
+
+static void wal_log_notification(PriorityContext* ctx, const Notification* notif) {
+    long start = wal_begin(ctx, notif->type == NOTIFY_TEXT ? WAL_NOTIFICATION : WAL_NOTIFY);
+    if (start < 0) return;
+    wal_put_int(ctx, notif->notif_id);
+    wal_put_int(ctx, notif->user_id);
+    wal_put_time(ctx, notif->timestamp);
+    wal_put_int(ctx, notif->priority);
+    if (notif->type == NOTIFY_TEXT) {
+        wal_put_str(ctx, arena_str(ctx, notif->content));
+    } else {
+        wal_put_int(ctx, notif->type);
+        wal_put_int(ctx, notif->actor_id);
+        wal_put_int(ctx, notif->object_id);
+        wal_put_int(ctx, notif->others);
+        wal_put_int(ctx, notif->span);
+    }
+    wal_end(ctx, start);
+}
+
+static void wal_log_notification_read(PriorityContext* ctx, int notif_id) {
+    long start = wal_begin(ctx, WAL_NOTIFICATION_READ);
+    if (start < 0) return;
+    wal_put_int(ctx, notif_id);
+    wal_end(ctx, start);
+}
+
+static void wal_log_message_read(PriorityContext* ctx, const Message* message) {
+    long start = wal_begin(ctx, WAL_MESSAGE_READ);
+    if (start < 0) return;
+    wal_put_int(ctx, message->message_id);
+    wal_put_int(ctx, message->receiver_id);
+    wal_end(ctx, start);
+}
+
+// =============================================================================
+// SOURCE FILE: scratch.c
+// Scratch Buffer Module - Per-request vectors drawn from a thread-local pool
+// =============================================================================
+
+// Each thread owns its pool, so display paths can run on worker threads
+// without locking. Buffers are kept between requests and reset on release.
+static THREAD_LOCAL ScratchVec scratch_pool[SCRATCH_POOL_SIZE];
+static THREAD_LOCAL size_t scratch_grows = 0;
+
+ScratchVec* scratch_acquire() {
+    for (int i = 0; i < SCRATCH_POOL_SIZE; i++) {
+        if (!scratch_pool[i].in_use) {
+            scratch_pool[i].in_use = 1;
+            scratch_pool[i].count = 0;
+            return &scratch_pool[i];
+        }
+    }
+    return NULL; // Pool exhausted
+}
+
+int scratch_push(ScratchVec* vec, void* item) {
+    if (vec->count == vec->capacity) {
+        size_t new_capacity = vec->capacity ? vec->capacity * 2 : 64;
+        void** new_items = (void**)realloc(vec->items, new_capacity * sizeof(void*));
+        if (new_items == NULL) {
+            return 0;
+        }
+        vec->items = new_items;
+        vec->capacity = new_capacity;
+        scratch_grows++;
+    }
+    vec->items[vec->count++] = item;
+    return 1;
+}
+
+// Uses the vector's storage as a raw buffer of at least the given size
+void* scratch_reserve(ScratchVec* vec, size_t bytes) {
+    size_t needed = (bytes + sizeof(void*) - 1) / sizeof(void*);
+    if (needed > vec->capacity) {
+        size_t new_capacity = vec->capacity ? vec->capacity : 64;
+        while (new_capacity < needed) {
+            new_capacity *= 2;
+        }
+        void** new_items = (void**)realloc(vec->items, new_capacity * sizeof(void*));
+        if (new_items == NULL) {
+            return NULL;
+        }
+        vec->items = new_items;
+        vec->capacity = new_capacity;
+        scratch_grows++;
+    }
+    vec->count = 0;
+    return vec->items;
+}
+
+void scratch_release(ScratchVec* vec) {
+    if (vec == NULL) {
+        return;
+    }
+    
+    // Trim buffers grown by an unusually large request so the pool stays bounded
+    if (vec->capacity > SCRATCH_RETAIN_LIMIT) {
+        void** trimmed = (void**)realloc(vec->items, SCRATCH_RETAIN_LIMIT * sizeof(void*));
+        if (trimmed != NULL) {
+            vec->items = trimmed;
+            vec->capacity = SCRATCH_RETAIN_LIMIT;
+        }
+    }
+    vec->count = 0;
+    vec->in_use = 0;
+}
+
+// Called by worker threads before they exit
+void scratch_pool_free() {
+    for (int i = 0; i < SCRATCH_POOL_SIZE; i++) {
+        free(scratch_pool[i].items);
+        scratch_pool[i].items = NULL;
+        scratch_pool[i].count = 0;
+        scratch_pool[i].capacity = 0;
+        scratch_pool[i].in_use = 0;
+    }
+}
+
+// Number of buffer reallocations on this thread (0 growth per request once warm)
+size_t scratch_grow_count() {
+    return scratch_grows;
+}
+
+// =============================================================================
+// SOURCE FILE: user.c
+// User Authentication Module - Uses Linked List with a Hash Index
+// =============================================================================
+
+const char* user_record_name(void* ctx, const void* record) {
+    return arena_str((const PriorityContext*)ctx, ((const User*)record)->username);
+}
+
+// Returns the new user's id, or 0 on failure
+static int register_user_locked(PriorityContext* ctx, const char* username, const char* password) {
+    // Check if username already exists
+    if (find_user_by_username(ctx, username) != NULL) {
+        return priority_fail(ctx, "Username already exists!");
+    }
+    
+    // Create new user
+    User* new_user = (User*)malloc(sizeof(User));
+    if (new_user == NULL) {
+        return priority_fail(ctx, "Memory allocation failed!");
+    }
+    
+    new_user->user_id = ctx->next_user_id++;
+    new_user->username = arena_intern(ctx, username);
+    new_user->password = arena_intern(ctx, password);
+    new_user->created_at = time(NULL);
+    if (!user_index_insert(&ctx->user_index, new_user->user_id, new_user)) {
+        free(new_user);
+        return priority_fail(ctx, "Memory allocation failed!");
+    }
+    new_user->next = ctx->users_head;
+    EPOCH_PUBLISH(&ctx->users_head, new_user);
+    wal_log_user(ctx, new_user);
+    return new_user->user_id;
+}
+
+int register_user(PriorityContext* ctx, const char* username, const char* password) {
+    priority_write_begin(ctx);
+    int result = register_user_locked(ctx, username, password);
+    priority_write_end(ctx);
+    return result;
+}
+
+User* login_user(PriorityContext* ctx, const char* username, const char* password) {
+    User* user = find_user_by_username(ctx, username);
+    if (user != NULL && strcmp(arena_str(ctx, user->password), password) == 0) {
+        ctx->current_user = user;
+        return user;
+    }
+    priority_fail(ctx, "Invalid username or password.");
+    return NULL; // Login failed
+}
+
+void logout_user(PriorityContext* ctx) {
+    ctx->current_user = NULL;
+}
+
+User* find_user_by_id(const PriorityContext* ctx, int user_id) {
+    return (User*)user_index_find_id(&ctx->user_index, user_id);
+}
+
+User* find_user_by_username(const PriorityContext* ctx, const char* username) {
+    return (User*)user_index_find_name(&ctx->user_index, username);
+}
+
+// =============================================================================
+// SOURCE FILE: media.c
+// Media Management Module - Handles Audio, Image, and Video Files
+// =============================================================================
+
+int validate_media_file(const char* file_path, MediaType expected_type) {
+    FILE* file = fopen(file_path, "rb");
+    if (file == NULL) {
+        return 0; // File doesn't exist
+    }
+    fclose(file);
+    
+    // Get file extension
+    const char* extension = strrchr(file_path, '.');
+    if (extension == NULL) {
+        return 0; // No extension
+    }
+    
+    // Convert to lowercase for comparison
+    char ext_lower[10];
+    int i = 0;
+    while (extension[i] && i < 9) {
+        ext_lower[i] = tolower(extension[i]);
+        i++;
+    }
+    ext_lower[i] = '\0';
+    
+    // Validate based on media type
+    switch (expected_type) {
+        case MEDIA_IMAGE:
+            return (strcmp(ext_lower, ".jpg") == 0 || 
+                    strcmp(ext_lower, ".jpeg") == 0 || 
+                    strcmp(ext_lower, ".png") == 0 || 
+                    strcmp(ext_lower, ".gif") == 0 || 
+                    strcmp(ext_lower, ".bmp") == 0);
+        
+        case MEDIA_VIDEO:
+            return (strcmp(ext_lower, ".mp4") == 0 || 
+                    strcmp(ext_lower, ".avi") == 0 || 
+                    strcmp(ext_lower, ".mov") == 0 || 
+                    strcmp(ext_lower, ".mkv") == 0 || 
+                    strcmp(ext_lower, ".wmv") == 0);
+        
+        case MEDIA_AUDIO:
+            return (strcmp(ext_lower, ".mp3") == 0 || 
+                    strcmp(ext_lower, ".wav") == 0 || 
+                    strcmp(ext_lower, ".flac") == 0 || 
+                    strcmp(ext_lower, ".aac") == 0 || 
+                    strcmp(ext_lower, ".ogg") == 0);
+        
+        default:
+            return 0;
+    }
+}
+
+// Returns 1 once the whole file is copied
+int copy_media_file(const char* source_path, const char* dest_path) {
+    FILE* source = fopen(source_path, "rb");
+    FILE* dest = fopen(dest_path, "wb");
+    
+    if (source == NULL || dest == NULL) {
+        if (source) fclose(source);
+        if (dest) fclose(dest);
+        return 0;
+    }
+    
+    char buffer[1024];
+    size_t bytes;
+    
+    int ok = 1;
+    
+    while ((bytes = fread(buffer, 1, sizeof(buffer), source)) > 0) {
+        if (fwrite(buffer, 1, bytes, dest) != bytes) {
+            ok = 0;
+            break;
+        }
+    }
+    
+    fclose(source);
+    if (fclose(dest) != 0) {
+        ok = 0;
+    }
+    return ok;
+}
+
+char* get_media_type_string(MediaType type) {
+    switch (type) {
+        case MEDIA_IMAGE: return "images";
+        case MEDIA_VIDEO: return "videos";
+        case MEDIA_AUDIO: return "audio";
+        default: return "unknown";
+    }
+}
+
+void create_media_directories() {
+    // Create main media directory
+    #ifdef _WIN32
+        system("if not exist media mkdir media");
+        system("if not exist media\\images mkdir media\\images");
+        system("if not exist media\\videos mkdir media\\videos");
+        system("if not exist media\\audio mkdir media\\audio");
+    #else
+        system("mkdir -p media/images");
+        system("mkdir -p media/videos");
+        system("mkdir -p media/audio");
+    #endif
+}
+
+// =============================================================================
+// SOURCE FILE: post_store.c
+// Post Store Module - Append-only chunks with id and per-author indexes
+// =============================================================================
+
+// Posts are appended in post id order, which is also created_at order, so
+// the chunks form one sorted sequence. by_id maps ids to positions in that
+// sequence, and each author keeps an ascending list of their post ids that
+// range queries binary search instead of walking every post.
+// After snapshot_load the leading chunks, by_id and the author lists point
+// into the mapping; they are copied before they would be reallocated.
+
+static int compare_post_ids(const void* a, const void* b) {
+    int x = ((const Post*)a)->post_id;
+    int y = ((const Post*)b)->post_id;
+    return (x > y) - (x < y);
+}
+
+// Grows a possibly borrowed array: borrowed storage is copied, never realloc'd
+static void* grow_array(void* items, int borrowed, size_t old_bytes, size_t new_bytes) {
+    if (!borrowed) {
+        return realloc(items, new_bytes);
+    }
+    void* copy = malloc(new_bytes);
+    if (copy != NULL && old_bytes > 0) {
+        memcpy(copy, items, old_bytes);
+    }
+    return copy;
+}
+
+static int post_store_index_id(PostStore* store, const Post* post, size_t position) {
+    if (post->post_id >= store->id_capacity) {
+        int new_capacity = store->id_capacity ? store->id_capacity : 1024;
+        while (new_capacity <= post->post_id) {
+            new_capacity *= 2;
+        }
+        uint32_t* grown = (uint32_t*)grow_array(store->by_id, store->by_id_borrowed,
+                                                store->id_capacity * sizeof(uint32_t),
+                                                new_capacity * sizeof(uint32_t));
+        if (grown == NULL) {
+            return 0;
+        }
+        memset(grown + store->id_capacity, 0, (new_capacity - store->id_capacity) * sizeof(uint32_t));
+        store->by_id = grown;
+        store->by_id_borrowed = 0;
+        store->id_capacity = new_capacity;
+    }
+    store->by_id[post->post_id] = (uint32_t)(position + 1);
+    return 1;
+}
+
+static int post_store_index_author(PostStore* store, const Post* post) {
+    int author_id = post->author_id;
+    if (author_id >= store->author_capacity) {
+        int new_capacity = store->author_capacity ? store->author_capacity : 1024;
+        while (new_capacity <= author_id) {
+            new_capacity *= 2;
+        }
+        AuthorPosts* grown = (AuthorPosts*)realloc(store->authors, new_capacity * sizeof(AuthorPosts));
+        if (grown == NULL) {
+            return 0;
+        }
+        memset(grown + store->author_capacity, 0,
+               (new_capacity - store->author_capacity) * sizeof(AuthorPosts));
+        store->authors = grown;
+        store->author_capacity = new_capacity;
+    }
+    
+    AuthorPosts* list = &store->authors[author_id];
+    if (list->count >= list->capacity) {
+        int new_capacity = list->count ? list->count * 2 : 8;
+        int* grown = (int*)grow_array(list->post_ids, list->capacity == 0,
+                                      list->count * sizeof(int), new_capacity * sizeof(int));
+        if (grown == NULL) {
+            return 0;
+        }
+        list->post_ids = grown;
+        list->capacity = new_capacity;
+    }
+    list->post_ids[list->count++] = post->post_id;
+    return 1;
+}
+
+// Copies post into the store and indexes it. Ids must be positive and larger
+// than any stored id. Returns the stored record, or NULL on failure.
+Post* post_store_append(PostStore* store, const Post* post) {
+    if (post->post_id <= 0 || post->author_id <= 0 || post->author_id > MAX_USERS) {
+        return NULL;
+    }
+    if (store->post_count > 0 &&
+        post->post_id <= post_store_at(store, store->post_count - 1)->post_id) {
+        return NULL;
+    }
+    
+    PostChunk* chunk = store->chunk_count ? store->chunks[store->chunk_count - 1] : NULL;
+    if (chunk == NULL || chunk->count == POST_CHUNK_SIZE) {
+        if (store->chunk_count == store->chunk_capacity) {
+            int new_capacity = store->chunk_capacity ? store->chunk_capacity * 2 : 16;
+            PostChunk** grown = (PostChunk**)realloc(store->chunks, new_capacity * sizeof(PostChunk*));
+            if (grown == NULL) {
+                return NULL;
+            }
+            store->chunks = grown;
+            store->chunk_capacity = new_capacity;
+        }
+        chunk = (PostChunk*)malloc(sizeof(PostChunk));
+        if (chunk == NULL) {
+            return NULL;
+        }
+        chunk->count = 0;
+        store->chunks[store->chunk_count++] = chunk;
+    }
+    
+    Post* stored = &chunk->posts[chunk->count];
+    *stored = *post;
+    if (!post_store_index_id(store, stored, store->post_count) || !post_store_index_author(store, stored)) {
+        if (post->post_id < store->id_capacity) {
+            store->by_id[post->post_id] = 0;
+        }
+        return NULL;
+    }
+    chunk->count++;
+    store->post_count++;
+    return stored;
+}
+
+Post* post_store_find(const PostStore* store, int post_id) {
+    if (post_id <= 0 || post_id >= store->id_capacity || store->by_id[post_id] == 0) {
+        return NULL;
+    }
+    return post_store_at(store, store->by_id[post_id] - 1);
+}
+
+// index-th post in id order, 0 <= index < post_count
+Post* post_store_at(const PostStore* store, size_t index) {
+    return &store->chunks[index / POST_CHUNK_SIZE]->posts[index % POST_CHUNK_SIZE];
+}
+
+// Ascending post ids; the pointer is valid until the author posts again
+const int* post_store_by_author(const PostStore* store, int author_id, int* count) {
+    if (author_id <= 0 || author_id >= store->author_capacity) {
+        *count = 0;
+        return NULL;
+    }
+    *count = store->authors[author_id].count;
+    return store->authors[author_id].post_ids;
+}
+
+// Newest n posts by an author, newest first. O(n).
+int post_store_latest(const PostStore* store, int author_id, int n, Post** out) {
+    int count;
+    const int* post_ids = post_store_by_author(store, author_id, &count);
+    int written = 0;
+    for (int i = count - 1; i >= 0 && written < n; i--) {
+        out[written++] = post_store_find(store, post_ids[i]);
+    }
+    return written;
+}
+
+// Posts by an author created at or after since, newest first, at most max.
+// O(log posts + max): the start is found by binary search on created_at.
+int post_store_since(const PostStore* store, int author_id, time_t since, Post** out, int max) {
+    int count;
+    const int* post_ids = post_store_by_author(store, author_id, &count);
+    int low = 0, high = count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (post_store_find(store, post_ids[mid])->created_at < since) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    
+    int written = 0;
+    for (int i = count - 1; i >= low && written < max; i--) {
+        out[written++] = post_store_find(store, post_ids[i]);
+    }
+    return written;
+}
+
+void post_store_free(PostStore* store) {
+    for (int i = store->mapped_chunks; i < store->chunk_count; i++) {
+        free(store->chunks[i]);
+    }
+    for (int id = 0; id < store->author_capacity; id++) {
+        if (store->authors[id].capacity > 0) {
+            free(store->authors[id].post_ids);
+        }
+    }
+    free(store->chunks);
+    if (!store->by_id_borrowed) {
+        free(store->by_id);
+    }
+    free(store->authors);
+    memset(store, 0, sizeof(*store));
+}
+
+// =============================================================================
+// SOURCE FILE: fanout.c
+// Fan-out Module - Background delivery of new posts to followers
+// =============================================================================
+
+// create_post queues a job on the worker picked by the author id, so one
+// author's posts fan out in order. A worker reads the followers and their
+// close-friend flags in a read section, then inserts notifications and
+// timeline entries FANOUT_BATCH followers at a time, each batch under the
+// write lock, so posters wait for at most one batch however many followers
+// the author has. A poster holds the write lock itself, so it never waits
+// for queue space: when no workers run, or its author's queue is full, it
+// does its own post's fan-out inline and leaves the queued ones to the
+// worker. That post can then reach followers before older ones still
+// queued; timelines keep posts in id order and skip ids they already hold,
+// whatever order they are delivered in.
+
+#define FANOUT_STAT_ADD(field, n) __atomic_add_fetch(&(field), (n), __ATOMIC_RELAXED)
+
+static void fanout_stat_max(int* field, int value) {
+    int seen = __atomic_load_n(field, __ATOMIC_RELAXED);
+    while (value > seen && !__atomic_compare_exchange_n(field, &seen, value, 0,
+                                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static void fanout_stat_max_ll(long long* field, long long value) {
+    long long seen = __atomic_load_n(field, __ATOMIC_RELAXED);
+    while (value > seen && !__atomic_compare_exchange_n(field, &seen, value, 0,
+                                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// Notifies every follower of the job's post and pushes it into their home
+// timelines. Followers who count the author as a close friend are resolved
+// in a single batched pass and get priority 1. reader is a worker's reader
+// slot, or -1 to read the graph under the write lock instead.
+static void fanout_run(PriorityContext* ctx, const FanoutJob* job, int reader, int from_worker) {
+    if (reader < 0) {
+        priority_write_begin(ctx);
+    } else {
+        priority_read_begin(ctx, reader);
+    }
+    size_t count = (size_t)follow_graph_follower_count(&ctx->follow_graph, job->author_id);
+    ScratchVec* id_buffer = scratch_acquire();
+    ScratchVec* bitmap_buffer = scratch_acquire();
+    int* ids = id_buffer ? (int*)scratch_reserve(id_buffer, (count ? count : 1) * sizeof(int)) : NULL;
+    unsigned char* bitmap = bitmap_buffer ?
+        (unsigned char*)scratch_reserve(bitmap_buffer, (count + 7) / 8 + 1) : NULL;
+    size_t n = 0;
+    if (ids != NULL && bitmap != NULL) {
+        EdgeIter followers;
+        int follower_id;
+        follow_graph_followers(&ctx->follow_graph, job->author_id, &followers);
+        while (n < count && edge_iter_next(&followers, &follower_id)) {
+            ids[n++] = follower_id;
+        }
+        close_friends_priority_bitmap(&ctx->close_friends, job->author_id, ids, n, bitmap);
+    }
+    if (reader < 0) {
+        priority_write_end(ctx);
+    } else {
+        priority_read_end(ctx, reader);
+    }
+    
+    if (ids == NULL || bitmap == NULL) {
+        // No scratch space: fall back to per-follower lookups in one hold
+        EdgeIter followers;
+        int follower_id;
+        priority_write_begin(ctx);
+        follow_graph_followers(&ctx->follow_graph, job->author_id, &followers);
+        while (edge_iter_next(&followers, &follower_id)) {
+            int priority = is_close_friend(ctx, follower_id, job->author_id) ? 1 : 0;
+            notify_user(ctx, follower_id, job->type, job->author_id, job->post_id, priority);
+            if (job->push) {
+                timeline_deliver(&ctx->timelines, follower_id, job->post_id, priority);
+            }
+            n++;
+        }
+        priority_write_end(ctx);
+    } else {
+        for (size_t start = 0; start < n; start += FANOUT_BATCH) {
+            size_t end = n - start > FANOUT_BATCH ? start + FANOUT_BATCH : n;
+            priority_write_begin(ctx);
+            for (size_t i = start; i < end; i++) {
+                int priority = BITMAP_TEST(bitmap, i);
+                notify_user(ctx, ids[i], job->type, job->author_id, job->post_id, priority);
+                if (job->push) {
+                    timeline_deliver(&ctx->timelines, ids[i], job->post_id, priority);
+                }
+            }
+            priority_write_end(ctx);
+            if (from_worker) {
+                FANOUT_STAT_ADD(ctx->fanout.stats.batches, 1);
+            }
+        }
+    }
+    if (from_worker) {
+        FANOUT_STAT_ADD(ctx->fanout.stats.notifications, n);
+    }
+    
+    scratch_release(id_buffer);
+    scratch_release(bitmap_buffer);
+}
+
+static void* fanout_worker(void* arg) {
+    FanoutQueue* queue = (FanoutQueue*)arg;
+    PriorityContext* ctx = queue->ctx;
+    FanoutJob job;
+    int reader = priority_reader_register(ctx); // -1: read under the write lock
+    
+    pthread_mutex_lock(&queue->lock);
+    for (;;) {
+        while (queue->count == 0 && !__atomic_load_n(&ctx->fanout.stopping, __ATOMIC_RELAXED)) {
+            pthread_cond_wait(&queue->ready, &queue->lock);
+        }
+        if (queue->count == 0) {
+            break; // Stopping, and nothing left to deliver
+        }
+        job = queue->jobs[queue->head];
+        queue->head = (queue->head + 1) % FANOUT_QUEUE_CAPACITY;
+        queue->count--;
+        queue->busy = 1;
+        pthread_mutex_unlock(&queue->lock);
+        
+        FANOUT_STAT_ADD(ctx->fanout.stats.depth, -1);
+        fanout_stat_max_ll(&ctx->fanout.stats.max_lag_ms, wal_now_ms() - job.queued_ms);
+        fanout_run(ctx, &job, reader, 1);
+        FANOUT_STAT_ADD(ctx->fanout.stats.jobs_done, 1);
+        
+        pthread_mutex_lock(&queue->lock);
+        queue->busy = 0;
+        if (queue->count == 0) {
+            pthread_cond_broadcast(&queue->idle);
+        }
+    }
+    pthread_mutex_unlock(&queue->lock);
+    
+    if (reader >= 0) {
+        priority_reader_unregister(ctx, reader);
+    }
+    scratch_pool_free(); // This thread's buffers
+    return NULL;
+}
+
+// Hands a job to its worker; 0 if the caller has to run it
+static int fanout_submit(PriorityContext* ctx, FanoutJob* job) {
+    FanoutPipeline* pipeline = &ctx->fanout;
+    if (pipeline->threads == 0) {
+        FANOUT_STAT_ADD(pipeline->stats.jobs_inline, 1);
+        return 0;
+    }
+    FanoutQueue* queue = &pipeline->queues[(unsigned)job->author_id % (unsigned)pipeline->threads];
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count == FANOUT_QUEUE_CAPACITY) {
+        // Only this post runs here; the backlog stays with the worker
+        pthread_mutex_unlock(&queue->lock);
+        FANOUT_STAT_ADD(pipeline->stats.queue_full, 1);
+        FANOUT_STAT_ADD(pipeline->stats.jobs_inline, 1);
+        return 0;
+    }
+    job->queued_ms = wal_now_ms();
+    queue->jobs[(queue->head + queue->count) % FANOUT_QUEUE_CAPACITY] = *job;
+    queue->count++;
+    pthread_cond_signal(&queue->ready);
+    pthread_mutex_unlock(&queue->lock);
+    
+    fanout_stat_max(&pipeline->stats.depth_high_water, FANOUT_STAT_ADD(pipeline->stats.depth, 1));
+    FANOUT_STAT_ADD(pipeline->stats.jobs_queued, 1);
+    return 1;
+}
+
+// Starts threads workers (at most FANOUT_MAX_THREADS); 0 on failure, with
+// fan-out left inline
+int fanout_start(PriorityContext* ctx, int threads) {
+    FanoutPipeline* pipeline = &ctx->fanout;
+    if (pipeline->threads > 0) {
+        return priority_fail(ctx, "Fan-out workers are already running!");
+    }
+    if (threads < 1 || threads > FANOUT_MAX_THREADS) {
+        return priority_fail(ctx, "Invalid number of fan-out workers!");
+    }
+    pipeline->queues = (FanoutQueue*)calloc(threads, sizeof(FanoutQueue));
+    if (pipeline->queues == NULL) {
+        return priority_fail(ctx, "Memory allocation failed!");
+    }
+    pipeline->stopping = 0;
+    int started = 0;
+    for (; started < threads; started++) {
+        FanoutQueue* queue = &pipeline->queues[started];
+        queue->ctx = ctx;
+        queue->jobs = (FanoutJob*)malloc(FANOUT_QUEUE_CAPACITY * sizeof(FanoutJob));
+        if (queue->jobs == NULL) {
+            break;
+        }
+        pthread_mutex_init(&queue->lock, NULL);
+        pthread_cond_init(&queue->ready, NULL);
+        pthread_cond_init(&queue->idle, NULL);
+        if (pthread_create(&queue->thread, NULL, fanout_worker, queue) != 0) {
+            pthread_mutex_destroy(&queue->lock);
+            pthread_cond_destroy(&queue->ready);
+            pthread_cond_destroy(&queue->idle);
+            free(queue->jobs);
+            break;
+        }
+    }
+    pipeline->threads = started;
+    if (started < threads) {
+        fanout_stop(ctx);
+        return priority_fail(ctx, "Could not start the fan-out workers!");
+    }
+    return 1;
+}
+
+// Waits until every queued post has been delivered
+void fanout_flush(PriorityContext* ctx) {
+    FanoutPipeline* pipeline = &ctx->fanout;
+    for (int i = 0; i < pipeline->threads; i++) {
+        FanoutQueue* queue = &pipeline->queues[i];
+        pthread_mutex_lock(&queue->lock);
+        while (queue->count > 0 || queue->busy) {
+            pthread_cond_wait(&queue->idle, &queue->lock);
+        }
+        pthread_mutex_unlock(&queue->lock);
+    }
+}
+
+// Delivers what is queued, then stops the workers; fan-out is inline again
+void fanout_stop(PriorityContext* ctx) {
+    FanoutPipeline* pipeline = &ctx->fanout;
+    if (pipeline->queues == NULL) {
+        return;
+    }
+    __atomic_store_n(&pipeline->stopping, 1, __ATOMIC_RELAXED);
+    for (int i = 0; i < pipeline->threads; i++) {
+        FanoutQueue* queue = &pipeline->queues[i];
+        pthread_mutex_lock(&queue->lock); // A worker checks stopping under its lock
+        pthread_cond_signal(&queue->ready);
+        pthread_mutex_unlock(&queue->lock);
+    }
+    for (int i = 0; i < pipeline->threads; i++) {
+        FanoutQueue* queue = &pipeline->queues[i];
+        pthread_join(queue->thread, NULL);
+        pthread_mutex_destroy(&queue->lock);
+        pthread_cond_destroy(&queue->ready);
+        pthread_cond_destroy(&queue->idle);
+        free(queue->jobs);
+    }
+    free(pipeline->queues);
+    pipeline->queues = NULL;
+    pipeline->threads = 0;
+    pipeline->stopping = 0;
+}
+
+void fanout_stats(PriorityContext* ctx, FanoutStats* stats) {
+    const FanoutStats* live = &ctx->fanout.stats;
+    stats->jobs_queued = __atomic_load_n(&live->jobs_queued, __ATOMIC_RELAXED);
+    stats->jobs_inline = __atomic_load_n(&live->jobs_inline, __ATOMIC_RELAXED);
+    stats->queue_full = __atomic_load_n(&live->queue_full, __ATOMIC_RELAXED);
+    stats->jobs_done = __atomic_load_n(&live->jobs_done, __ATOMIC_RELAXED);
+    stats->notifications = __atomic_load_n(&live->notifications, __ATOMIC_RELAXED);
+    stats->batches = __atomic_load_n(&live->batches, __ATOMIC_RELAXED);
+    stats->depth = __atomic_load_n(&live->depth, __ATOMIC_RELAXED);
+    stats->depth_high_water = __atomic_load_n(&live->depth_high_water, __ATOMIC_RELAXED);
+    stats->max_lag_ms = __atomic_load_n(&live->max_lag_ms, __ATOMIC_RELAXED);
+}
+
+// =============================================================================
+// SOURCE FILE: post.c (UPDATED)
+// Post and Feed Module - Now with Multimedia Support
+// =============================================================================
+
+// Records the post in the author's timeline state and fans it out to the
+// followers, in the background once fanout_start has run. Timeline
+// delivery is skipped for authors whose posts are pulled at read time.
+static void fan_out_post(PriorityContext* ctx, User* author, const Post* post, NotificationType type) {
+    FanoutJob job;
+    job.author_id = author->user_id;
+    job.post_id = post->post_id;
+    job.push = timeline_record_post(ctx, post);
+    job.type = type;
+    if (follow_graph_follower_count(&ctx->follow_graph, author->user_id) == 0) {
+        return;
+    }
+    if (!fanout_submit(ctx, &job)) {
+        fanout_run(ctx, &job, -1, 0);
+    }
+}
+
+// Returns the new post's id, or 0 on failure
+int create_post(PriorityContext* ctx, const char* content) {
+    if (ctx->current_user == NULL) {
+        return priority_fail(ctx, "Please login first!");
+    }
+    
+    Post new_post;
+    new_post.post_id = ctx->next_post_id;
+    new_post.author_id = ctx->current_user->user_id;
+    new_post.author_name = ctx->current_user->username;
+    new_post.content = arena_intern(ctx, content);
+    new_post.created_at = time(NULL);
+    new_post.priority = 0; // Default priority
+    new_post.media_type = MEDIA_NONE; // No media for text posts
+    new_post.media_path = 0;
+    new_post.media_description = 0;
+    
+    Post* stored = post_store_append(&ctx->post_store, &new_post);
+    if (stored == NULL) {
+        return priority_fail(ctx, "Memory allocation failed!");
+    }
+    ctx->next_post_id++;
+    wal_log_post(ctx, stored);
+    
+    // Notify followers
+    fan_out_post(ctx, ctx->current_user, stored, NOTIFY_POST);
+    return stored->post_id;
+}
+
+int create_media_post(PriorityContext* ctx, const char* content, MediaType media_type,
+                      const char* media_path, const char* media_description) {
+    if (ctx->current_user == NULL) {
+        return priority_fail(ctx, "Please login first!");
+    }
+    
+    // Validate media file
+    if (!validate_media_file(media_path, media_type)) {
+        return priority_fail(ctx, "Invalid media file or file doesn't exist!");
+    }
+    
+    // Create media directories if they don't exist
+    create_media_directories();
+    
+    // Generate unique filename for media
+    char dest_path[MAX_FILENAME];
+    const char* extension = strrchr(media_path, '.');
+    if (extension == NULL) extension = "";
+    
+    sprintf(dest_path, "media/%s/user_%d_post_%d%s", 
+            get_media_type_string(media_type), 
+            ctx->current_user->user_id, 
+            ctx->next_post_id, 
+            extension);
+    
+    // Copy media file to our media directory
+    if (!copy_media_file(media_path, dest_path)) {
+        return priority_fail(ctx, "Could not copy media file!");
+    }
+    
+    // Create post
+    Post new_post;
+    new_post.post_id = ctx->next_post_id;
+    new_post.author_id = ctx->current_user->user_id;
+    new_post.author_name = ctx->current_user->username;
+    new_post.content = arena_intern(ctx, content);
+    new_post.created_at = time(NULL);
+    new_post.priority = 0;
+    new_post.media_type = media_type;
+    new_post.media_path = arena_intern(ctx, dest_path);
+    new_post.media_description = arena_intern(ctx, media_description);
+    
+    Post* stored = post_store_append(&ctx->post_store, &new_post);
+    if (stored == NULL) {
+        return priority_fail(ctx, "Memory allocation failed!");
+    }
+    ctx->next_post_id++;
+    wal_log_post(ctx, stored);
+    
+    // Notify followers
+    fan_out_post(ctx, ctx->current_user, stored, NOTIFY_MEDIA_POST);
+    return stored->post_id;
+}
+
+int get_user_priority(const PriorityContext* ctx, int user_id) {
+    if (ctx->current_user == NULL) return 0;
+    return is_close_friend(ctx, ctx->current_user->user_id, user_id) ? 1 : 0;
+}
+
+// =============================================================================
+// SOURCE FILE: follow_graph.c
+// Follow Graph Module - CSR Adjacency Rows with Delta Buffers
+// =============================================================================
+
+// Every user has a sorted out-row (who they follow) and in-row (who follows
+// them). Rows start as slices of one CSR pool built in bulk; inserts and
+// deletes go to a small sorted delta buffer per row. A row whose delta fills
+// up is merged into a private array, and the whole graph is rebuilt into a
+// fresh CSR pool once enough changes have accumulated.
+//
+// Readers take no locks. Published rows are immutable: an edit copies the
+// row's delta (at most FOLLOW_ROW_DELTA_MAX ids) into a new version, swaps
+// the row pointer and retires the old version to the graph's epoch domain.
+
+#define FOLLOW_ROW_DELTA_MAX 64 // Delta entries a row holds before it is merged
+#define FOLLOW_REBUILD_MIN 4096 // Changes always tolerated before a CSR rebuild
+
+static int find_sorted(const int* values, int count, int value) {
+    int low = 0, high = count - 1;
+    while (low <= high) {
+        int mid = low + (high - low) / 2;
+        if (values[mid] == value) {
+            return mid;
+        }
+        if (values[mid] < value) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return -1;
+}
+
+// Copies a sorted array into dst with value inserted in order
+static int copy_with(int* dst, const int* src, int count, int value) {
+    int i = 0, n = 0;
+    while (i < count && src[i] < value) {
+        dst[n++] = src[i++];
+    }
+    dst[n++] = value;
+    while (i < count) {
+        dst[n++] = src[i++];
+    }
+    return n;
+}
+
+// Empty deltas have NULL arrays, which memcpy may not be given
+static void copy_ints(int* dst, const int* src, int count) {
+    if (count > 0) {
+        memcpy(dst, src, count * sizeof(int));
+    }
+}
+
+// Copies an array into dst without the entry at pos
+static int copy_without(int* dst, const int* src, int count, int pos) {
+    memcpy(dst, src, pos * sizeof(int));
+    memcpy(dst + pos, src + pos + 1, (count - pos - 1) * sizeof(int));
+    return count - 1;
+}
+
+static int compare_ints(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+static EdgeTable* edge_table_new(int capacity) {
+    EdgeTable* table = (EdgeTable*)calloc(1, sizeof(EdgeTable) + capacity * sizeof(EdgeRow*));
+    if (table != NULL) {
+        table->capacity = capacity;
+    }
+    return table;
+}
+
+// Grows the row table to cover user_id by publishing a larger copy
+static int adjacency_reserve(Adjacency* adj, int user_id, EpochDomain* epoch) {
+    EdgeTable* old = adj->table;
+    int old_capacity = old ? old->capacity : 0;
+    if (user_id < old_capacity) {
+        return 1;
+    }
+    
+    int new_capacity = old_capacity ? old_capacity : 64;
+    while (new_capacity <= user_id) {
+        new_capacity *= 2;
+    }
+    EdgeTable* table = edge_table_new(new_capacity);
+    if (table == NULL) {
+        return 0;
+    }
+    if (old != NULL) {
+        memcpy(table->rows, old->rows, old_capacity * sizeof(EdgeRow*));
+    }
+    EPOCH_PUBLISH(&adj->table, table);
+    epoch_retire(epoch, old);
+    return 1;
+}
+
+static const EdgeRow* adjacency_row(const Adjacency* adj, int user_id) {
+    const EdgeTable* table = EPOCH_LOAD(&adj->table);
+    if (table == NULL || user_id <= 0 || user_id >= table->capacity) {
+        return NULL;
+    }
+    return EPOCH_LOAD(&table->rows[user_id]);
+}
+
+// One past the largest user id that can have a row
+static int adjacency_capacity(const Adjacency* adj) {
+    const EdgeTable* table = EPOCH_LOAD(&adj->table);
+    return table ? table->capacity : 0;
+}
+
+// Frees everything at once; no reader may be using the adjacency
+static void adjacency_free(Adjacency* adj) {
+    EdgeTable* table = adj->table;
+    for (int i = 0; table != NULL && i < table->capacity; i++) {
+        EdgeRow* row = table->rows[i];
+        if (row == NULL) {
+            continue;
+        }
+        if (row->owned) {
+            free((void*)row->base);
+        }
+        if (!row->pooled) {
+            free(row);
+        }
+    }
+    free(table);
+    free(adj->pool);
+    free(adj->row_block);
+    adj->table = NULL;
+    adj->pool = NULL;
+    adj->row_block = NULL;
+}
+
+static void adjacency_free_retired(void* block) {
+    adjacency_free((Adjacency*)block);
+    free(block);
+}
+
+// Publishes a freshly built adjacency and retires the one it replaces
+static void adjacency_replace(Adjacency* adj, const Adjacency* built, EpochDomain* epoch) {
+    Adjacency old = *adj;
+    adj->pool = built->pool;
+    adj->row_block = built->row_block;
+    EPOCH_PUBLISH(&adj->table, built->table);
+    
+    Adjacency* retired = epoch ? (Adjacency*)malloc(sizeof(Adjacency)) : NULL;
+    if (retired == NULL) {
+        if (epoch != NULL) {
+            epoch_synchronize(epoch); // No room to defer the free
+        }
+        adjacency_free(&old);
+        return;
+    }
+    *retired = old;
+    epoch_retire_with(epoch, retired, adjacency_free_retired);
+}
+
+static int row_contains(const EdgeRow* row, int id) {
+    if (find_sorted(row->delta.added, row->delta.added_count, id) >= 0) {
+        return 1;
+    }
+    if (find_sorted(row->delta.removed, row->delta.removed_count, id) >= 0) {
+        return 0;
+    }
+    return find_sorted(row->base, row->base_count, id) >= 0;
+}
+
+// Folds a row's delta into a private sorted array; NULL when out of memory
+static EdgeRow* row_merged(const EdgeRow* row) {
+    EdgeRow* merged = (EdgeRow*)malloc(sizeof(EdgeRow));
+    int* base = (int*)malloc((row->degree > 0 ? row->degree : 1) * sizeof(int));
+    if (merged == NULL || base == NULL) {
+        free(merged);
+        free(base);
+        return NULL;
+    }
+    
+    EdgeIter iter = {row, 0, 0, 0};
+    int id, count = 0;
+    while (edge_iter_next(&iter, &id)) {
+        base[count++] = id;
+    }
+    memset(merged, 0, sizeof(EdgeRow));
+    merged->base = base;
+    merged->base_count = count;
+    merged->owned = 1;
+    merged->degree = count;
+    return merged;
+}
+
+// Builds the next version of a row (NULL for an empty one) with id added or
+// removed. Returns NULL when out of memory. Once the delta outgrows
+// FOLLOW_ROW_DELTA_MAX the new version is merged instead; if that fails
+// the row just keeps a longer delta.
+static EdgeRow* row_change(const EdgeRow* row, int id, int add) {
+    static const EdgeRow empty_row;
+    if (row == NULL) {
+        row = &empty_row;
+    }
+    const EdgeDelta* delta = &row->delta;
+    EdgeRow* next = (EdgeRow*)malloc(sizeof(EdgeRow) +
+                                     (delta->added_count + delta->removed_count + 1) * sizeof(int));
+    if (next == NULL) {
+        return NULL;
+    }
+    *next = *row;
+    next->pooled = 0;
+    
+    int* added = (int*)(next + 1);
+    int* removed;
+    if (add) {
+        // Re-adding a deleted base edge just cancels the deletion
+        int pos = find_sorted(delta->removed, delta->removed_count, id);
+        if (pos >= 0) {
+            copy_ints(added, delta->added, delta->added_count);
+            removed = added + delta->added_count;
+            next->delta.removed_count = copy_without(removed, delta->removed, delta->removed_count, pos);
+        } else {
+            next->delta.added_count = copy_with(added, delta->added, delta->added_count, id);
+            removed = added + next->delta.added_count;
+            copy_ints(removed, delta->removed, delta->removed_count);
+        }
+        next->degree++;
+    } else {
+        // Deleting a recent insert just drops it from the delta
+        int pos = find_sorted(delta->added, delta->added_count, id);
+        if (pos >= 0) {
+            next->delta.added_count = copy_without(added, delta->added, delta->added_count, pos);
+            removed = added + next->delta.added_count;
+            copy_ints(removed, delta->removed, delta->removed_count);
+        } else {
+            copy_ints(added, delta->added, delta->added_count);
+            removed = added + delta->added_count;
+            next->delta.removed_count = copy_with(removed, delta->removed, delta->removed_count, id);
+        }
+        next->degree--;
+    }
+    next->delta.added = added;
+    next->delta.removed = removed;
+    
+    if (next->delta.added_count + next->delta.removed_count > FOLLOW_ROW_DELTA_MAX) {
+        EdgeRow* merged = row_merged(next);
+        if (merged != NULL) {
+            free(next); // Shares its base with row, which stays live
+            return merged;
+        }
+    }
+    return next;
+}
+
+// Frees a row version that was never published, keeping what it shares with old
+static void row_discard(EdgeRow* row, const EdgeRow* old) {
+    if (row == NULL) {
+        return;
+    }
+    if (row->owned && (old == NULL || row->base != old->base)) {
+        free((void*)row->base);
+    }
+    free(row);
+}
+
+// Retires a row version that next has replaced
+static void row_retire(EdgeRow* row, const EdgeRow* next, EpochDomain* epoch) {
+    if (row == NULL) {
+        return;
+    }
+    if (row->owned && row->base != next->base) {
+        epoch_retire(epoch, (void*)row->base);
+    }
+    if (!row->pooled) {
+        epoch_retire(epoch, row);
+    }
+}
+
+// Adds or removes the edge from -> to in forward and its mirror in reverse.
+// Both new rows are built before either is published, so a failure leaves
+// the adjacency untouched.
+static int adjacency_pair_change(Adjacency* forward, Adjacency* reverse, int from, int to,
+                                 int add, EpochDomain* epoch) {
+    if (!adjacency_reserve(forward, from, epoch) || !adjacency_reserve(reverse, to, epoch)) {
+        return 0;
+    }
+    
+    EdgeRow* old_forward = forward->table->rows[from];
+    EdgeRow* old_reverse = reverse->table->rows[to];
+    EdgeRow* new_forward = row_change(old_forward, to, add);
+    EdgeRow* new_reverse = row_change(old_reverse, from, add);
+    if (new_forward == NULL || new_reverse == NULL) {
+        row_discard(new_forward, old_forward);
+        row_discard(new_reverse, old_reverse);
+        return 0;
+    }
+    
+    EPOCH_PUBLISH(&forward->table->rows[from], new_forward);
+    EPOCH_PUBLISH(&reverse->table->rows[to], new_reverse);
+    row_retire(old_forward, new_forward, epoch);
+    row_retire(old_reverse, new_reverse, epoch);
+    return 1;
+}
+
+int edge_iter_next(EdgeIter* iter, int* id) {
+    const EdgeRow* row = iter->row;
+    if (row == NULL) {
+        return 0;
+    }
+    
+    // Skip base ids that have been deleted
+    while (iter->base_pos < row->base_count) {
+        int candidate = row->base[iter->base_pos];
+        while (iter->removed_pos < row->delta.removed_count &&
+               row->delta.removed[iter->removed_pos] < candidate) {
+            iter->removed_pos++;
+        }
+        if (iter->removed_pos < row->delta.removed_count &&
+            row->delta.removed[iter->removed_pos] == candidate) {
+            iter->base_pos++;
+            continue;
+        }
+        break;
+    }
+    
+    int has_base = iter->base_pos < row->base_count;
+    int has_added = iter->added_pos < row->delta.added_count;
+    if (!has_base && !has_added) {
+        return 0;
+    }
+    if (has_base && (!has_added || row->base[iter->base_pos] < row->delta.added[iter->added_pos])) {
+        *id = row->base[iter->base_pos++];
+    } else {
+        *id = row->delta.added[iter->added_pos++];
+    }
+    return 1;
+}
+
+// Builds one direction of the graph in CSR form from an edge list
+static int adjacency_build(Adjacency* adj, const Follow* edges, size_t count,
+                           int max_id, int outgoing) {
+    int capacity = 64;
+    while (capacity <= max_id) {
+        capacity *= 2;
+    }
+    Adjacency built;
+    built.table = edge_table_new(capacity);
+    built.pool = (int*)malloc((count > 0 ? count : 1) * sizeof(int));
+    built.row_block = (EdgeRow*)calloc(capacity, sizeof(EdgeRow));
+    if (built.table == NULL || built.pool == NULL || built.row_block == NULL) {
+        adjacency_free(&built);
+        return 0;
+    }
+    
+    // Count, slice the pool, then fill each row (counting sort by row)
+    EdgeRow* rows = built.row_block;
+    for (size_t i = 0; i < count; i++) {
+        const Follow* edge = &edges[i];
+        if (edge->follower_id > 0 && edge->following_id > 0 &&
+            edge->follower_id != edge->following_id) {
+            rows[outgoing ? edge->follower_id : edge->following_id].base_count++;
+        }
+    }
+    size_t offset = 0;
+    for (int id = 0; id < capacity; id++) {
+        rows[id].base = built.pool + offset;
+        offset += rows[id].base_count;
+        rows[id].base_count = 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const Follow* edge = &edges[i];
+        if (edge->follower_id > 0 && edge->following_id > 0 &&
+            edge->follower_id != edge->following_id) {
+            EdgeRow* row = &rows[outgoing ? edge->follower_id : edge->following_id];
+            ((int*)row->base)[row->base_count++] = outgoing ? edge->following_id : edge->follower_id;
+        }
+    }
+    
+    // Sort and drop duplicate edges within each row
+    for (int id = 0; id < capacity; id++) {
+        EdgeRow* row = &rows[id];
+        int* base = (int*)row->base;
+        if (row->base_count > 1) {
+            qsort(base, row->base_count, sizeof(int), compare_ints);
+            int unique = 1;
+            for (int i = 1; i < row->base_count; i++) {
+                if (base[i] != base[unique - 1]) {
+                    base[unique++] = base[i];
+                }
+            }
+            row->base_count = unique;
+        }
+        row->degree = row->base_count;
+        row->pooled = 1;
+        if (row->degree > 0) {
+            built.table->rows[id] = row;
+        }
+    }
+    
+    *adj = built;
+    return 1;
+}
+
+// Points an empty adjacency at CSR rows stored elsewhere (a mapped
+// snapshot): row id holds ids[offsets[id]] up to ids[offsets[id + 1]]. The
+// ids are never freed; changed rows are copied as usual.
+static int adjacency_attach(Adjacency* adj, const uint64_t* offsets, const int* ids, int capacity) {
+    if (capacity <= 0) {
+        return 1;
+    }
+    Adjacency built = {NULL, NULL, NULL};
+    built.table = edge_table_new(capacity);
+    built.row_block = (EdgeRow*)calloc(capacity, sizeof(EdgeRow));
+    if (built.table == NULL || built.row_block == NULL) {
+        adjacency_free(&built);
+        return 0;
+    }
+    for (int id = 0; id < capacity; id++) {
+        EdgeRow* row = &built.row_block[id];
+        row->base = ids + offsets[id];
+        row->base_count = (int)(offsets[id + 1] - offsets[id]);
+        row->degree = row->base_count;
+        row->pooled = 1;
+        if (row->degree > 0) {
+            built.table->rows[id] = row;
+        }
+    }
+    *adj = built;
+    return 1;
+}
+
+static int edges_max_id(const Follow* edges, size_t count) {
+    int max_id = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (edges[i].follower_id > max_id) max_id = edges[i].follower_id;
+        if (edges[i].following_id > max_id) max_id = edges[i].following_id;
+    }
+    return max_id;
+}
+
+// Edges held by a freshly built adjacency
+static size_t adjacency_built_degree(const Adjacency* built) {
+    size_t total = 0;
+    for (int id = 0; id < built->table->capacity; id++) {
+        total += built->row_block[id].degree;
+    }
+    return total;
+}
+
+// Publishes both directions of a freshly built graph
+static void follow_graph_install(FollowGraph* graph, const Adjacency* out, const Adjacency* in) {
+    adjacency_replace(&graph->out, out, graph->epoch);
+    adjacency_replace(&graph->in, in, graph->epoch);
+    graph->edge_count = adjacency_built_degree(out);
+    graph->changes = 0;
+}
+
+// Replaces the whole graph with the given edges (used by load_data and rebuilds)
+int follow_graph_build(FollowGraph* graph, const Follow* edges, size_t count) {
+    int max_id = edges_max_id(edges, count);
+    Adjacency out, in;
+    if (!adjacency_build(&out, edges, count, max_id, 1)) {
+        return 0;
+    }
+    if (!adjacency_build(&in, edges, count, max_id, 0)) {
+        adjacency_free(&out);
+        return 0;
+    }
+    follow_graph_install(graph, &out, &in);
+    return 1;
+}
+
+// Moves every row back into a fresh CSR pool
+static void follow_graph_rebuild(FollowGraph* graph) {
+    Follow* edges = (Follow*)malloc((graph->edge_count > 0 ? graph->edge_count : 1) * sizeof(Follow));
+    if (edges == NULL) {
+        return; // Keep serving from the delta buffers
+    }
+    
+    size_t count = 0;
+    for (int id = 1; id < adjacency_capacity(&graph->out); id++) {
+        EdgeIter iter = {adjacency_row(&graph->out, id), 0, 0, 0};
+        int following_id;
+        while (edge_iter_next(&iter, &following_id)) {
+            edges[count].follower_id = id;
+            edges[count].following_id = following_id;
+            count++;
+        }
+    }
+    
+    follow_graph_build(graph, edges, count);
+    free(edges);
+}
+
+static void follow_graph_after_change(FollowGraph* graph) {
+    graph->changes++;
+    if (graph->changes > graph->edge_count / 4 + FOLLOW_REBUILD_MIN) {
+        follow_graph_rebuild(graph);
+    }
+}
+
+int follow_graph_add(FollowGraph* graph, int follower_id, int following_id) {
+    if (follower_id <= 0 || following_id <= 0 || follower_id == following_id ||
+        follow_graph_has(graph, follower_id, following_id)) {
+        return 0;
+    }
+    if (!adjacency_pair_change(&graph->out, &graph->in, follower_id, following_id, 1, graph->epoch)) {
+        return 0;
+    }
+    
+    graph->edge_count++;
+    follow_graph_after_change(graph);
+    return 1;
+}
+
+int follow_graph_remove(FollowGraph* graph, int follower_id, int following_id) {
+    if (!follow_graph_has(graph, follower_id, following_id)) {
+        return 0;
+    }
+    if (!adjacency_pair_change(&graph->out, &graph->in, follower_id, following_id, 0, graph->epoch)) {
+        return 0;
+    }
+    
+    graph->edge_count--;
+    follow_graph_after_change(graph);
+    return 1;
+}
+
+// O(log degree)
+int follow_graph_has(const FollowGraph* graph, int follower_id, int following_id) {
+    const EdgeRow* row = adjacency_row(&graph->out, follower_id);
+    return row != NULL && row_contains(row, following_id);
+}
+
+// O(1)
+int follow_graph_following_count(const FollowGraph* graph, int user_id) {
+    const EdgeRow* row = adjacency_row(&graph->out, user_id);
+    return row ? row->degree : 0;
+}
+
+// O(1)
+int follow_graph_follower_count(const FollowGraph* graph, int user_id) {
+    const EdgeRow* row = adjacency_row(&graph->in, user_id);
+    return row ? row->degree : 0;
+}
+
+void follow_graph_following(const FollowGraph* graph, int user_id, EdgeIter* iter) {
+    iter->row = adjacency_row(&graph->out, user_id);
+    iter->base_pos = iter->added_pos = iter->removed_pos = 0;
+}
+
+void follow_graph_followers(const FollowGraph* graph, int user_id, EdgeIter* iter) {
+    iter->row = adjacency_row(&graph->in, user_id);
+    iter->base_pos = iter->added_pos = iter->removed_pos = 0;
+}
+
+// Frees the graph at once; no reader may be using it
+void follow_graph_free(FollowGraph* graph) {
+    adjacency_free(&graph->out);
+    adjacency_free(&graph->in);
+    graph->edge_count = 0;
+    graph->changes = 0;
+}
+
+// =============================================================================
+// SOURCE FILE: follow.c
+// Follow/Unfollow Module - Uses Graph (Adjacency List, see follow_graph.c)
+// =============================================================================
+
+static int follow_user_locked(PriorityContext* ctx, int user_id) {
+    if (ctx->current_user == NULL) {
+        return priority_fail(ctx, "Please login first!");
+    }
+    
+    if (user_id == ctx->current_user->user_id) {
+        return priority_fail(ctx, "You cannot follow yourself!");
+    }
+    
+    if (find_user_by_id(ctx, user_id) == NULL) {
+        return priority_fail(ctx, "User not found!");
+    }
+    
+    // Check if already following
+    if (is_following(ctx, ctx->current_user->user_id, user_id)) {
+        return priority_fail(ctx, "You are already following this user!");
+    }
+    
+    if (!follow_graph_add(&ctx->follow_graph, ctx->current_user->user_id, user_id)) {
+        return priority_fail(ctx, "Memory allocation failed!");
+    }
+    wal_log_edge(ctx, WAL_FOLLOW, ctx->current_user->user_id, user_id);
+    timeline_invalidate(&ctx->timelines, ctx->current_user->user_id); // Backfill on next read
+    
+    // Notify the followed user
+    notify_user(ctx, user_id, NOTIFY_FOLLOW, ctx->current_user->user_id, 0, 0);
+    return 1;
+}
+
+int follow_user(PriorityContext* ctx, int user_id) {
+    priority_write_begin(ctx);
+    int result = follow_user_locked(ctx, user_id);
+    priority_write_end(ctx);
+    return result;
+}
+
+static int unfollow_user_locked(PriorityContext* ctx, int user_id) {
+    if (ctx->current_user == NULL) {
+        return priority_fail(ctx, "Please login first!");
+    }
+    
+    if (!is_following(ctx, ctx->current_user->user_id, user_id)) {
+        return priority_fail(ctx, "You are not following this user!");
+    }
+    
+    if (!follow_graph_remove(&ctx->follow_graph, ctx->current_user->user_id, user_id)) {
+        return priority_fail(ctx, "Memory allocation failed!");
+    }
+    wal_log_edge(ctx, WAL_UNFOLLOW, ctx->current_user->user_id, user_id);
+    timeline_invalidate(&ctx->timelines, ctx->current_user->user_id);
+    return 1;
+}
+
+int unfollow_user(PriorityContext* ctx, int user_id) {
+    priority_write_begin(ctx);
+    int result = unfollow_user_locked(ctx, user_id);
+    priority_write_end(ctx);
+    return result;
+}
+
+int is_following(const PriorityContext* ctx, int follower_id, int following_id) {
+    return follow_graph_has(&ctx->follow_graph, follower_id, following_id);
+}
+
+// =============================================================================
+// SOURCE FILE: message.c
+// Messaging Module - Uses Queue (FIFO) with Priority Queue for Close Friends
+// =============================================================================
+
+// Returns the new message's id, or 0 on failure
+int send_message(PriorityContext* ctx, int receiver_id, const char* content) {
+    if (ctx->current_user == NULL) {
+        return priority_fail(ctx, "Please login first!");
+    }
+    
+    if (find_user_by_id(ctx, receiver_id) == NULL) {
+        return priority_fail(ctx, "Receiver not found!");
+    }
+    
+    if (receiver_id == ctx->current_user->user_id) {
+        return priority_fail(ctx, "You cannot send a message to yourself!");
+    }
+    
+    Message* new_message = (Message*)slab_alloc(&ctx->message_slab);
+    if (new_message == NULL) {
+        return priority_fail(ctx, "Memory allocation failed!");
+    }
+    
+    new_message->message_id = ctx->next_message_id++;
+    new_message->sender_id = ctx->current_user->user_id;
+    new_message->receiver_id = receiver_id;
+    new_message->sender_name = ctx->current_user->username;
+    new_message->content = arena_intern(ctx, content);
+    new_message->timestamp = time(NULL);
+    new_message->priority = is_close_friend(ctx, receiver_id, ctx->current_user->user_id) ? 1 : 0;
+    new_message->is_read = 0;
+    if (!inbox_enqueue(&ctx->inboxes, new_message)) {
+        slab_free(&ctx->message_slab, new_message);
+        return priority_fail(ctx, "Memory allocation failed!");
+    }
+    if (!conversation_store_add(&ctx->conversations, new_message)) {
+        inbox_remove(&ctx->inboxes, receiver_id, new_message->message_id);
+        slab_free(&ctx->message_slab, new_message);
+        return priority_fail(ctx, "Memory allocation failed!");
+    }
+    new_message->next = ctx->messages_head;
+    ctx->messages_head = new_message;
+    wal_log_message(ctx, new_message);
+    
+    // Notify receiver
+    notify_user(ctx, receiver_id, NOTIFY_MESSAGE, new_message->sender_id, new_message->message_id,
+                new_message->priority);
+    return new_message->message_id;
+}
+
+// =============================================================================
+// SOURCE FILE: conversation.c
+// Conversation Module - Per-pair message arrays with recent lists per user
+// =============================================================================
+
+// Messages are appended to their pair's array as they are sent, so a
+// conversation is always in order and a page is a binary search plus a copy.
+// Each user's conversations form a doubly linked list that a new message
+// moves to the front in O(1).
+
+static int compare_message_ids(const void* a, const void* b) {
+    int id_a = (*(Message* const*)a)->message_id;
+    int id_b = (*(Message* const*)b)->message_id;
+    return (id_a > id_b) - (id_a < id_b);
+}
+
+// Every message on the list in id (send) order; NULL if out of memory
+static Message** messages_by_id(Message* messages_head, size_t* count) {
+    *count = 0;
+    for (Message* message = messages_head; message != NULL; message = message->next) {
+        (*count)++;
+    }
+    Message** sorted = (Message**)malloc((*count ? *count : 1) * sizeof(Message*));
+    if (sorted == NULL) {
+        return NULL;
+    }
+    size_t i = 0;
+    for (Message* message = messages_head; message != NULL; message = message->next) {
+        sorted[i++] = message;
+    }
+    qsort(sorted, *count, sizeof(Message*), compare_message_ids);
+    return sorted;
+}
+
+static uint32_t conversation_hash(int user_a, int user_b) {
+    uint64_t key = ((uint64_t)(uint32_t)user_a << 32) | (uint32_t)user_b;
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (uint32_t)key;
+}
+
+// Slot holding the pair, or the empty slot where it would go
+static int conversation_slot(const ConversationStore* store, int user_a, int user_b) {
+    int mask = store->slot_capacity - 1;
+    int slot = (int)(conversation_hash(user_a, user_b) & (uint32_t)mask);
+    while (store->slots[slot] != 0) {
+        const Conversation* conv = &store->conversations[store->slots[slot] - 1];
+        if (conv->user_a == user_a && conv->user_b == user_b) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static int conversation_rehash(ConversationStore* store, int new_capacity) {
+    int* slots = (int*)calloc(new_capacity, sizeof(int));
+    if (slots == NULL) {
+        return 0;
+    }
+    free(store->slots);
+    store->slots = slots;
+    store->slot_capacity = new_capacity;
+    for (int i = 0; i < store->count; i++) {
+        const Conversation* conv = &store->conversations[i];
+        slots[conversation_slot(store, conv->user_a, conv->user_b)] = i + 1;
+    }
+    return 1;
+}
+
+static int conversation_reserve_user(ConversationStore* store, int user_id) {
+    if (user_id < store->user_capacity) {
+        return 1;
+    }
+    int new_capacity = store->user_capacity ? store->user_capacity : 1024;
+    while (new_capacity <= user_id) {
+        new_capacity *= 2;
+    }
+    int* grown = (int*)realloc(store->recent, new_capacity * sizeof(int));
+    if (grown == NULL) {
+        return 0;
+    }
+    memset(grown + store->user_capacity, 0, (new_capacity - store->user_capacity) * sizeof(int));
+    store->recent = grown;
+    store->user_capacity = new_capacity;
+    return 1;
+}
+
+// Index of the pair's conversation, created if missing; -1 if out of memory
+static int conversation_open(ConversationStore* store, int user_a, int user_b) {
+    if ((store->count + 1) * 2 > store->slot_capacity &&
+        !conversation_rehash(store, store->slot_capacity ? store->slot_capacity * 2 : 1024)) {
+        return -1;
+    }
+    int slot = conversation_slot(store, user_a, user_b);
+    if (store->slots[slot] != 0) {
+        return store->slots[slot] - 1;
+    }
+    if (!conversation_reserve_user(store, user_a) || !conversation_reserve_user(store, user_b)) {
+        return -1;
+    }
+    if (store->count == store->capacity) {
+        int new_capacity = store->capacity ? store->capacity * 2 : 256;
+        Conversation* grown = (Conversation*)realloc(store->conversations, new_capacity * sizeof(Conversation));
+        if (grown == NULL) {
+            return -1;
+        }
+        store->conversations = grown;
+        store->capacity = new_capacity;
+    }
+    Conversation* conv = &store->conversations[store->count];
+    memset(conv, 0, sizeof(*conv));
+    conv->user_a = user_a;
+    conv->user_b = user_b;
+    store->slots[slot] = ++store->count;
+    return store->count - 1;
+}
+
+// Which of the conversation's recent-list links belong to user_id
+static int conversation_side(const Conversation* conv, int user_id) {
+    return user_id == conv->user_a ? 0 : 1;
+}
+
+// Moves a conversation to the front of both users' recent lists
+static void conversation_touch(ConversationStore* store, int index) {
+    Conversation* conv = &store->conversations[index];
+    int sides = conv->user_a == conv->user_b ? 1 : 2;
+    for (int side = 0; side < sides; side++) {
+        int user_id = side ? conv->user_b : conv->user_a;
+        int head = store->recent[user_id];
+        if (head == index + 1) {
+            continue;
+        }
+        if (conv->prev[side] != 0) {
+            Conversation* prev = &store->conversations[conv->prev[side] - 1];
+            prev->next[conversation_side(prev, user_id)] = conv->next[side];
+        }
+        if (conv->next[side] != 0) {
+            Conversation* next = &store->conversations[conv->next[side] - 1];
+            next->prev[conversation_side(next, user_id)] = conv->prev[side];
+        }
+        if (head != 0) {
+            Conversation* first = &store->conversations[head - 1];
+            first->prev[conversation_side(first, user_id)] = index + 1;
+        }
+        conv->prev[side] = 0;
+        conv->next[side] = head;
+        store->recent[user_id] = index + 1;
+    }
+}
+
+// Files a message under its pair; 0 if out of memory
+int conversation_store_add(ConversationStore* store, Message* message) {
+    int user_a = message->sender_id < message->receiver_id ? message->sender_id : message->receiver_id;
+    int user_b = message->sender_id < message->receiver_id ? message->receiver_id : message->sender_id;
+    if (user_a <= 0 || user_b > MAX_USERS) {
+        return 1; // No such users; the message stays only in messages_head
+    }
+    int index = conversation_open(store, user_a, user_b);
+    if (index < 0) {
+        return 0;
+    }
+    
+    Conversation* conv = &store->conversations[index];
+    if (conv->count == conv->capacity) {
+        int new_capacity = conv->capacity ? conv->capacity * 2 : 4;
+        Message** grown = (Message**)realloc(conv->messages, new_capacity * sizeof(Message*));
+        if (grown == NULL) {
+            return 0;
+        }
+        conv->messages = grown;
+        conv->capacity = new_capacity;
+    }
+    // Messages arrive in id order; an older one is slotted into place
+    int pos = conv->count;
+    while (pos > 0 && conv->messages[pos - 1]->message_id > message->message_id) {
+        pos--;
+    }
+    memmove(conv->messages + pos + 1, conv->messages + pos, (conv->count - pos) * sizeof(Message*));
+    conv->messages[pos] = message;
+    conv->count++;
+    if (pos == conv->count - 1) {
+        conversation_touch(store, index);
+    }
+    return 1;
+}
+
+// Replaces the store with every message on the list (used by load_data)
+int conversation_store_build(ConversationStore* store, Message* messages_head) {
+    conversation_store_free(store);
+    
+    // In id order, so every append lands at the end and the recent lists
+    // end up ordered by each conversation's newest message
+    size_t count = 0;
+    Message** sorted = messages_by_id(messages_head, &count);
+    if (sorted == NULL) {
+        return 0;
+    }
+    int ok = 1;
+    for (size_t i = 0; ok && i < count; i++) {
+        ok = conversation_store_add(store, sorted[i]);
+    }
+    free(sorted);
+    return ok;
+}
+
+const Conversation* conversation_find(const PriorityContext* ctx, int user_id, int other_id) {
+    const ConversationStore* store = &ctx->conversations;
+    if (store->slot_capacity == 0) {
+        return NULL;
+    }
+    int user_a = user_id < other_id ? user_id : other_id;
+    int user_b = user_id < other_id ? other_id : user_id;
+    int slot = conversation_slot(store, user_a, user_b);
+    return store->slots[slot] ? &store->conversations[store->slots[slot] - 1] : NULL;
+}
+
+// The newest limit messages of the conversation that come before
+// before_id (0 = the newest message), oldest first; returns the count
+int conversation_page(const PriorityContext* ctx, int user_id, int other_id, int before_id, int limit,
+                      ConversationPage* page) {
+    page->count = 0;
+    page->has_more = 0;
+    page->next_before_id = 0;
+    if (limit <= 0) {
+        limit = CONVERSATION_PAGE_SIZE;
+    }
+    if (limit > CONVERSATION_PAGE_MAX) {
+        limit = CONVERSATION_PAGE_MAX;
+    }
+    const Conversation* conv = conversation_find(ctx, user_id, other_id);
+    if (conv == NULL) {
+        return 0;
+    }
+    
+    // First message at or after before_id
+    int end = conv->count;
+    if (before_id > 0) {
+        int low = 0;
+        while (low < end) {
+            int mid = low + (end - low) / 2;
+            if (conv->messages[mid]->message_id < before_id) {
+                low = mid + 1;
+            } else {
+                end = mid;
+            }
+        }
+    }
+    int start = end > limit ? end - limit : 0;
+    memcpy(page->messages, conv->messages + start, (end - start) * sizeof(Message*));
+    page->count = end - start;
+    page->has_more = start > 0;
+    page->next_before_id = page->count > 0 ? conv->messages[start]->message_id : 0;
+    return page->count;
+}
+
+// Up to max of the user's conversations, most recently active first
+int conversation_recent(const PriorityContext* ctx, int user_id, const Conversation** out, int max) {
+    const ConversationStore* store = &ctx->conversations;
+    if (user_id <= 0 || user_id >= store->user_capacity) {
+        return 0;
+    }
+    int count = 0;
+    for (int index = store->recent[user_id]; index != 0 && count < max;) {
+        const Conversation* conv = &store->conversations[index - 1];
+        out[count++] = conv;
+        index = conv->next[conversation_side(conv, user_id)];
+    }
+    return count;
+}
+
+void conversation_store_free(ConversationStore* store) {
+    for (int i = 0; i < store->count; i++) {
+        free(store->conversations[i].messages);
+    }
+    free(store->conversations);
+    free(store->slots);
+    free(store->recent);
+    memset(store, 0, sizeof(*store));
+}
+
+// =============================================================================
+// SOURCE FILE: inbox.c
+// Inbox Module - Two-lane FIFO queues of unread messages per receiver
+// =============================================================================
+
+// Every receiver has a priority lane (close friends) and a regular lane,
+// each a growable ring. Sending appends to the tail of one lane; reading
+// takes the head of the priority lane, or of the regular lane once the
+// priority lane is empty, and marks the message read. The unread counts are
+// the lane lengths.
+
+static int message_queue_push(MessageQueue* queue, Message* message) {
+    if (queue->count == queue->capacity) {
+        int new_capacity = queue->capacity ? queue->capacity * 2 : 8;
+        Message** grown = (Message**)malloc(new_capacity * sizeof(Message*));
+        if (grown == NULL) {
+            return 0;
+        }
+        // Unwrap into oldest-first order while growing
+        for (int i = 0; i < queue->count; i++) {
+            grown[i] = queue->ring[(queue->head + i) & (queue->capacity - 1)];
+        }
+        free(queue->ring);
+        queue->ring = grown;
+        queue->head = 0;
+        queue->capacity = new_capacity;
+    }
+    queue->ring[(queue->head + queue->count) & (queue->capacity - 1)] = message;
+    queue->count++;
+    return 1;
+}
+
+static Message* message_queue_pop(MessageQueue* queue) {
+    if (queue->count == 0) {
+        return NULL;
+    }
+    Message* message = queue->ring[queue->head];
+    queue->head = (queue->head + 1) & (queue->capacity - 1);
+    queue->count--;
+    return message;
+}
+
+// Takes a message out of the middle of the queue; NULL if it is not queued
+static Message* message_queue_remove(MessageQueue* queue, int message_id) {
+    int mask = queue->capacity - 1;
+    for (int i = 0; i < queue->count; i++) {
+        Message* message = queue->ring[(queue->head + i) & mask];
+        if (message->message_id != message_id) {
+            continue;
+        }
+        for (int j = i; j > 0; j--) {
+            queue->ring[(queue->head + j) & mask] = queue->ring[(queue->head + j - 1) & mask];
+        }
+        queue->head = (queue->head + 1) & mask;
+        queue->count--;
+        return message;
+    }
+    return NULL;
+}
+
+static int inbox_reserve(InboxStore* store, int user_id) {
+    if (user_id <= 0 || user_id > MAX_USERS) {
+        return 0;
+    }
+    if (user_id < store->capacity) {
+        return 1;
+    }
+    int new_capacity = store->capacity ? store->capacity : 1024;
+    while (new_capacity <= user_id) {
+        new_capacity *= 2;
+    }
+    MessageQueue* grown = (MessageQueue*)realloc(store->queues,
+                                                 (size_t)new_capacity * INBOX_LANES * sizeof(MessageQueue));
+    if (grown == NULL) {
+        return 0;
+    }
+    memset(grown + (size_t)store->capacity * INBOX_LANES, 0,
+           (size_t)(new_capacity - store->capacity) * INBOX_LANES * sizeof(MessageQueue));
+    store->queues = grown;
+    store->capacity = new_capacity;
+    return 1;
+}
+
+static MessageQueue* inbox_lane(const InboxStore* store, int user_id, InboxLane lane) {
+    if (user_id <= 0 || user_id >= store->capacity) {
+        return NULL;
+    }
+    return &store->queues[(size_t)user_id * INBOX_LANES + lane];
+}
+
+// Queues an unread message for its receiver; 0 if out of memory
+int inbox_enqueue(InboxStore* store, Message* message) {
+    if (message->is_read || message->receiver_id <= 0 || message->receiver_id > MAX_USERS) {
+        return 1; // Nothing to deliver
+    }
+    if (!inbox_reserve(store, message->receiver_id)) {
+        return 0;
+    }
+    InboxLane lane = message->priority ? INBOX_PRIORITY : INBOX_REGULAR;
+    return message_queue_push(inbox_lane(store, message->receiver_id, lane), message);
+}
+
+// Replaces the store with every unread message on the list (used by load_data)
+int inbox_store_build(InboxStore* store, Message* messages_head) {
+    inbox_store_free(store);
+    size_t count = 0;
+    Message** sorted = messages_by_id(messages_head, &count);
+    if (sorted == NULL) {
+        return 0;
+    }
+    int ok = 1;
+    for (size_t i = 0; ok && i < count; i++) {
+        ok = inbox_enqueue(store, sorted[i]);
+    }
+    free(sorted);
+    return ok;
+}
+
+// Takes a queued message out of the inbox without reading it, for log
+// replay and for undoing a send; NULL if it was not queued
+Message* inbox_remove(InboxStore* store, int receiver_id, int message_id) {
+    for (int lane = 0; lane < INBOX_LANES; lane++) {
+        MessageQueue* queue = inbox_lane(store, receiver_id, (InboxLane)lane);
+        Message* message = queue ? message_queue_remove(queue, message_id) : NULL;
+        if (message != NULL) {
+            return message;
+        }
+    }
+    return NULL;
+}
+
+// Takes the user's next unread message, close friends first, and marks it
+// read; NULL when the inbox is empty
+Message* inbox_next(PriorityContext* ctx, int user_id) {
+    for (int lane = 0; lane < INBOX_LANES; lane++) {
+        MessageQueue* queue = inbox_lane(&ctx->inboxes, user_id, (InboxLane)lane);
+        Message* message = queue ? message_queue_pop(queue) : NULL;
+        if (message != NULL) {
+            message->is_read = 1;
+            wal_log_message_read(ctx, message);
+            return message;
+        }
+    }
+    return NULL;
+}
+
+// Up to max unread messages in delivery order, for workers that hand out
+// messages in batches; returns the count
+int inbox_drain(PriorityContext* ctx, int user_id, Message** out, int max) {
+    int count = 0;
+    while (count < max && (out[count] = inbox_next(ctx, user_id)) != NULL) {
+        count++;
+    }
+    return count;
+}
+
+// Unread messages in total; either lane count may be NULL
+int inbox_unread(const PriorityContext* ctx, int user_id, int* priority_unread, int* regular_unread) {
+    const MessageQueue* priority = inbox_lane(&ctx->inboxes, user_id, INBOX_PRIORITY);
+    const MessageQueue* regular = inbox_lane(&ctx->inboxes, user_id, INBOX_REGULAR);
+    int priority_count = priority ? priority->count : 0;
+    int regular_count = regular ? regular->count : 0;
+    if (priority_unread != NULL) {
+        *priority_unread = priority_count;
+    }
+    if (regular_unread != NULL) {
+        *regular_unread = regular_count;
+    }
+    return priority_count + regular_count;
+}
+
+void inbox_store_free(InboxStore* store) {
+    for (size_t i = 0; i < (size_t)store->capacity * INBOX_LANES; i++) {
+        free(store->queues[i].ring);
+    }
+    free(store->queues);
+    memset(store, 0, sizeof(*store));
+}
+
+// =============================================================================
+// SOURCE FILE: close_friends.c
+// Close Friends Module - Uses Sorted Adjacency Rows (see follow_graph.c)
+// =============================================================================
+
+static void close_friends_install(CloseFriendIndex* index, const Adjacency* friends,
+                                  const Adjacency* friend_of) {
+    adjacency_replace(&index->friends, friends, index->epoch);
+    adjacency_replace(&index->friend_of, friend_of, index->epoch);
+    index->pair_count = adjacency_built_degree(friends);
+}
+
+int close_friends_build(CloseFriendIndex* index, const Follow* pairs, size_t count) {
+    int max_id = edges_max_id(pairs, count);
+    Adjacency friends, friend_of;
+    if (!adjacency_build(&friends, pairs, count, max_id, 1)) {
+        return 0;
+    }
+    if (!adjacency_build(&friend_of, pairs, count, max_id, 0)) {
+        adjacency_free(&friends);
+        return 0;
+    }
+    close_friends_install(index, &friends, &friend_of);
+    return 1;
+}
+
+// Frees the index at once; no reader may be using it
+void close_friends_free(CloseFriendIndex* index) {
+    adjacency_free(&index->friends);
+    adjacency_free(&index->friend_of);
+    index->pair_count = 0;
+}
+
+static int close_friends_insert(CloseFriendIndex* index, int user_id, int friend_id) {
+    if (!adjacency_pair_change(&index->friends, &index->friend_of, user_id, friend_id, 1, index->epoch)) {
+        return 0;
+    }
+    index->pair_count++;
+    return 1;
+}
+
+static int close_friends_delete(CloseFriendIndex* index, int user_id, int friend_id) {
+    if (!adjacency_pair_change(&index->friends, &index->friend_of, user_id, friend_id, 0, index->epoch)) {
+        return 0;
+    }
+    index->pair_count--;
+    return 1;
+}
+
+// Sets bit i of bitmap when follower_ids[i] has author_id as a close friend.
+// Followers come from the follow graph in ascending order, so the whole batch
+// is answered by one merge against the author's reverse row; ids that arrive
+// out of order fall back to a binary search.
+void close_friends_priority_bitmap(const CloseFriendIndex* index, int author_id,
+                                   const int* follower_ids, size_t count,
+                                   unsigned char* bitmap) {
+    memset(bitmap, 0, (count + 7) / 8);
+    const EdgeRow* fans = adjacency_row(&index->friend_of, author_id);
+    if (fans == NULL || fans->degree == 0) {
+        return;
+    }
+    
+    EdgeIter iter = {fans, 0, 0, 0};
+    int fan = 0;
+    int has_fan = edge_iter_next(&iter, &fan);
+    int previous = 0;
+    for (size_t i = 0; i < count; i++) {
+        int id = follower_ids[i];
+        int match;
+        if (id < previous) {
+            match = row_contains(fans, id);
+        } else {
+            previous = id;
+            while (has_fan && fan < id) {
+                has_fan = edge_iter_next(&iter, &fan);
+            }
+            match = has_fan && fan == id;
+        }
+        if (match) {
+            bitmap[i / 8] |= (unsigned char)(1u << (i % 8));
+        }
+    }
+}
+
+static int add_close_friend_locked(PriorityContext* ctx, int friend_id) {
+    if (ctx->current_user == NULL) {
+        return priority_fail(ctx, "Please login first!");
+    }
+    
+    if (friend_id == ctx->current_user->user_id) {
+        return priority_fail(ctx, "You cannot add yourself as a close friend!");
+    }
+    
+    if (find_user_by_id(ctx, friend_id) == NULL) {
+        return priority_fail(ctx, "User not found!");
+    }
+    
+    // Check if already a close friend
+    if (is_close_friend(ctx, ctx->current_user->user_id, friend_id)) {
+        return priority_fail(ctx, "User is already in your close friends list!");
+    }
+    
+    // Must be following the user to add as close friend
+    if (!is_following(ctx, ctx->current_user->user_id, friend_id)) {
+        return priority_fail(ctx, "You must follow this user first to add them as a close friend!");
+    }
+    
+    if (!close_friends_insert(&ctx->close_friends, ctx->current_user->user_id, friend_id)) {
+        return priority_fail(ctx, "Memory allocation failed!");
+    }
+    wal_log_edge(ctx, WAL_CLOSE_FRIEND_ADD, ctx->current_user->user_id, friend_id);
+    timeline_invalidate(&ctx->timelines, ctx->current_user->user_id); // Posts change lanes
+    return 1;
+}
+
+int add_close_friend(PriorityContext* ctx, int friend_id) {
+    priority_write_begin(ctx);
+    int result = add_close_friend_locked(ctx, friend_id);
+    priority_write_end(ctx);
+    return result;
+}
+
+static int remove_close_friend_locked(PriorityContext* ctx, int friend_id) {
+    if (ctx->current_user == NULL) {
+        return priority_fail(ctx, "Please login first!");
+    }
+    
+    if (!is_close_friend(ctx, ctx->current_user->user_id, friend_id)) {
+        return priority_fail(ctx, "User is not in your close friends list!");
+    }
+    
+    if (!close_friends_delete(&ctx->close_friends, ctx->current_user->user_id, friend_id)) {
+        return priority_fail(ctx, "Memory allocation failed!");
+    }
+    wal_log_edge(ctx, WAL_CLOSE_FRIEND_REMOVE, ctx->current_user->user_id, friend_id);
+    timeline_invalidate(&ctx->timelines, ctx->current_user->user_id);
+    return 1;
+}
+
+int remove_close_friend(PriorityContext* ctx, int friend_id) {
+    priority_write_begin(ctx);
+    int result = remove_close_friend_locked(ctx, friend_id);
+    priority_write_end(ctx);
+    return result;
+}
+
+// O(log friends)
+int is_close_friend(const PriorityContext* ctx, int user_id, int friend_id) {
+    const EdgeRow* row = adjacency_row(&ctx->close_friends.friends, user_id);
+    return row != NULL && row_contains(row, friend_id);
+}
+
+// Iterates user_id's close friends in ascending id order
+void close_friends_list(const CloseFriendIndex* index, int user_id, EdgeIter* iter) {
+    iter->row = adjacency_row(&index->friends, user_id);
+    iter->base_pos = iter->added_pos = iter->removed_pos = 0;
+}
+
+// =============================================================================
+// SOURCE FILE: timeline.c
+// Home Timeline Module - Fan-out-on-write with pull for very popular authors
+// =============================================================================
+
+// New posts are pushed into each follower's bounded priority or regular lane,
+// so reading a feed costs O(page size). Authors with more than
+// TIMELINE_FANOUT_LIMIT followers skip the push; readers merge their newest
+// posts in from the author's post list when they read.
+// A reader's timeline is only materialised once they read it; following,
+// unfollowing or changing close friends marks it for a rebuild.
+
+// i = 0 is the newest entry
+static int* post_ring_slot(PostRing* ring, int i) {
+    return &ring->ids[(ring->head - 1 - i + ring->capacity) % ring->capacity];
+}
+
+// Adds post_id in id order, so the ring stays newest first when background
+// fan-out delivers posts out of order; an id already held is skipped (a
+// rebuild may have collected a post whose delivery was still queued)
+static int post_ring_push(PostRing* ring, int post_id) {
+    int newer = 0; // Entries newer than post_id
+    while (newer < ring->count && *post_ring_slot(ring, newer) > post_id) {
+        newer++;
+    }
+    if (newer < ring->count && *post_ring_slot(ring, newer) == post_id) {
+        return 1;
+    }
+    if (newer == ring->count && ring->count == TIMELINE_LANE_CAPACITY) {
+        return 1; // Older than everything a full ring keeps
+    }
+    
+    if (ring->count == ring->capacity && ring->capacity < TIMELINE_LANE_CAPACITY) {
+        int new_capacity = ring->capacity ? ring->capacity * 2 : 8;
+        if (new_capacity > TIMELINE_LANE_CAPACITY) {
+            new_capacity = TIMELINE_LANE_CAPACITY;
+        }
+        int* grown = (int*)malloc(new_capacity * sizeof(int));
+        if (grown == NULL) {
+            return 0;
+        }
+        // Unwrap into oldest-first order while growing
+        for (int i = 0; i < ring->count; i++) {
+            grown[i] = ring->ids[(ring->head - ring->count + i + ring->capacity) % ring->capacity];
+        }
+        free(ring->ids);
+        ring->ids = grown;
+        ring->head = ring->count;
+        ring->capacity = new_capacity;
+    }
+    
+    ring->ids[ring->head] = post_id;
+    ring->head = (ring->head + 1) % ring->capacity;
+    if (ring->count < ring->capacity) {
+        ring->count++;
+    }
+    for (int i = 0; i < newer; i++) { // Sink below the newer entries
+        int* slot = post_ring_slot(ring, i);
+        int* below = post_ring_slot(ring, i + 1);
+        int swap = *slot;
+        *slot = *below;
+        *below = swap;
+    }
+    return 1;
+}
+
+static int post_ring_get(const PostRing* ring, int i) {
+    return ring->ids[(ring->head - 1 - i + ring->capacity) % ring->capacity];
+}
+
+static void post_ring_free(PostRing* ring) {
+    free(ring->ids);
+    ring->ids = NULL;
+    ring->capacity = 0;
+    ring->head = 0;
+    ring->count = 0;
+}
+
+static int timeline_reserve(TimelineStore* store, int user_id) {
+    if (user_id <= 0 || user_id > MAX_USERS) {
+        return 0;
+    }
+    if (user_id < store->capacity) {
+        return 1;
+    }
+    
+    int new_capacity = store->capacity ? store->capacity : 1024;
+    while (new_capacity <= user_id) {
+        new_capacity *= 2;
+    }
+    Timeline* grown_timelines = (Timeline*)realloc(store->timelines, new_capacity * sizeof(Timeline));
+    if (grown_timelines == NULL) {
+        return 0;
+    }
+    store->timelines = grown_timelines;
+    int* grown_pull = (int*)realloc(store->pull_since, new_capacity * sizeof(int));
+    if (grown_pull == NULL) {
+        return 0;
+    }
+    store->pull_since = grown_pull;
+    memset(store->timelines + store->capacity, 0, (new_capacity - store->capacity) * sizeof(Timeline));
+    memset(store->pull_since + store->capacity, 0, (new_capacity - store->capacity) * sizeof(int));
+    store->capacity = new_capacity;
+    return 1;
+}
+
+// Switches an author to being pulled from post_id on; 0 if out of memory
+static int timeline_pull_author(TimelineStore* store, int author_id, int post_id) {
+    if (store->pulled_count == store->pulled_capacity) {
+        int new_capacity = store->pulled_capacity ? store->pulled_capacity * 2 : 16;
+        int* grown = (int*)realloc(store->pulled_authors, new_capacity * sizeof(int));
+        if (grown == NULL) {
+            return 0;
+        }
+        store->pulled_authors = grown;
+        store->pulled_capacity = new_capacity;
+    }
+    store->pulled_authors[store->pulled_count++] = author_id;
+    store->pull_since[author_id] = post_id;
+    return 1;
+}
+
+// Puts a post in its author's own timeline. Returns 1 when the caller should
+// push it to followers, 0 when readers will pull it instead.
+int timeline_record_post(PriorityContext* ctx, const Post* post) {
+    TimelineStore* store = &ctx->timelines;
+    if (!timeline_reserve(store, post->author_id)) {
+        return 0;
+    }
+    timeline_deliver(store, post->author_id, post->post_id, 1); // Own posts rank first
+    
+    if (follow_graph_follower_count(&ctx->follow_graph, post->author_id) <= TIMELINE_FANOUT_LIMIT) {
+        return store->pull_since[post->author_id] == 0; // Once pulled, an author stays pulled
+    }
+    if (store->pull_since[post->author_id] == 0 &&
+        !timeline_pull_author(store, post->author_id, post->post_id)) {
+        return 1; // Fall back to pushing
+    }
+    return 0;
+}
+
+// Starts the store over for a freshly loaded post store: the same outcome as
+// recording every post in order, at the cost of one step per author
+void timeline_record_authors(PriorityContext* ctx) {
+    TimelineStore* store = &ctx->timelines;
+    timeline_store_free(store);
+    for (int author_id = 1; author_id < ctx->post_store.author_capacity; author_id++) {
+        const AuthorPosts* list = &ctx->post_store.authors[author_id];
+        if (list->count == 0 || !timeline_reserve(store, author_id)) {
+            continue;
+        }
+        if (follow_graph_follower_count(&ctx->follow_graph, author_id) > TIMELINE_FANOUT_LIMIT) {
+            timeline_pull_author(store, author_id, list->post_ids[0]);
+        }
+    }
+}
+
+void timeline_deliver(TimelineStore* store, int reader_id, int post_id, int priority) {
+    // Readers who have not built a timeline pick the post up on their first read
+    if (reader_id <= 0 || reader_id >= store->capacity || !store->timelines[reader_id].built) {
+        return;
+    }
+    
+    Timeline* timeline = &store->timelines[reader_id];
+    if (!post_ring_push(&timeline->lanes[priority ? TIMELINE_PRIORITY : TIMELINE_REGULAR], post_id)) {
+        timeline->built = 0; // Rebuild on the next read rather than drop the post
+    }
+}
+
+void timeline_invalidate(TimelineStore* store, int reader_id) {
+    if (reader_id > 0 && reader_id < store->capacity) {
+        store->timelines[reader_id].built = 0;
+    }
+}
+
+typedef struct TimelineEntry {
+    int post_id;
+    int lane;
+} TimelineEntry;
+
+static int compare_timeline_entries(const void* a, const void* b) {
+    int x = ((const TimelineEntry*)a)->post_id;
+    int y = ((const TimelineEntry*)b)->post_id;
+    return (x > y) - (x < y);
+}
+
+// An author's newest posts that reach the reader by push: all of their own,
+// and for followed authors those made before the author switched to pull
+static int timeline_collect(const PriorityContext* ctx, int reader_id, int author_id,
+                            TimelineEntry* entries, int count) {
+    const TimelineStore* store = &ctx->timelines;
+    int total;
+    const int* post_ids = post_store_by_author(&ctx->post_store, author_id, &total);
+    int pull_since = author_id < store->capacity ? store->pull_since[author_id] : 0;
+    int lane = (author_id == reader_id || is_close_friend(ctx, reader_id, author_id)) ?
+               TIMELINE_PRIORITY : TIMELINE_REGULAR;
+    
+    int end = total;
+    if (author_id != reader_id && pull_since != 0) {
+        while (end > 0 && post_ids[end - 1] >= pull_since) {
+            end--;
+        }
+    }
+    int begin = end > TIMELINE_LANE_CAPACITY ? end - TIMELINE_LANE_CAPACITY : 0;
+    for (int i = begin; i < end; i++) {
+        entries[count].post_id = post_ids[i];
+        entries[count].lane = lane;
+        count++;
+    }
+    return count;
+}
+
+static int timeline_rebuild(PriorityContext* ctx, int reader_id) {
+    TimelineStore* store = &ctx->timelines;
+    if (!timeline_reserve(store, reader_id)) {
+        return 0;
+    }
+    
+    Timeline* timeline = &store->timelines[reader_id];
+    for (int lane = 0; lane < TIMELINE_LANES; lane++) {
+        timeline->lanes[lane].head = 0;
+        timeline->lanes[lane].count = 0;
+    }
+    
+    EdgeIter iter;
+    int author_id;
+    int authors = 1;
+    follow_graph_following(&ctx->follow_graph, reader_id, &iter);
+    while (edge_iter_next(&iter, &author_id)) {
+        authors++;
+    }
+    
+    ScratchVec* buffer = scratch_acquire();
+    size_t bound = (size_t)authors * TIMELINE_LANE_CAPACITY;
+    TimelineEntry* entries = buffer ?
+        (TimelineEntry*)scratch_reserve(buffer, bound * sizeof(TimelineEntry)) : NULL;
+    if (entries == NULL) {
+        scratch_release(buffer);
+        return 0;
+    }
+    
+    int count = timeline_collect(ctx, reader_id, reader_id, entries, 0);
+    follow_graph_following(&ctx->follow_graph, reader_id, &iter);
+    while (edge_iter_next(&iter, &author_id)) {
+        count = timeline_collect(ctx, reader_id, author_id, entries, count);
+    }
+    
+    // Replay oldest first so each ring ends up holding the newest posts
+    qsort(entries, count, sizeof(TimelineEntry), compare_timeline_entries);
+    int ok = 1;
+    for (int i = 0; i < count && ok; i++) {
+        ok = post_ring_push(&timeline->lanes[entries[i].lane], entries[i].post_id);
+    }
+    scratch_release(buffer);
+    
+    timeline->built = ok;
+    return ok;
+}
+
+// Merges a newest-first run into the newest-first page, keeping at most max
+static int timeline_merge(int* page, int count, const int* run, int run_count, int max) {
+    int merged[TIMELINE_LANE_CAPACITY];
+    int i = 0, j = 0, n = 0;
+    while (n < max && (i < count || j < run_count)) {
+        if (j >= run_count || (i < count && page[i] > run[j])) {
+            merged[n++] = page[i++];
+        } else {
+            merged[n++] = run[j++];
+        }
+    }
+    memcpy(page, merged, n * sizeof(int));
+    return n;
+}
+
+// Fills post_ids with up to max of the reader's newest posts in one lane,
+// newest first, and returns how many were written. Fewer than
+// TIMELINE_LANE_CAPACITY results means the lane holds nothing older.
+int timeline_page(PriorityContext* ctx, int reader_id, TimelineLane lane, int* post_ids, int max) {
+    TimelineStore* store = &ctx->timelines;
+    if (max > TIMELINE_LANE_CAPACITY) {
+        max = TIMELINE_LANE_CAPACITY;
+    }
+    if (!timeline_reserve(store, reader_id) ||
+        (!store->timelines[reader_id].built && !timeline_rebuild(ctx, reader_id))) {
+        return 0;
+    }
+    
+    const PostRing* ring = &store->timelines[reader_id].lanes[lane];
+    int count = 0;
+    while (count < max && count < ring->count) {
+        post_ids[count] = post_ring_get(ring, count);
+        count++;
+    }
+    
+    // Pull from followed authors who are above the fan-out limit
+    for (int p = 0; p < store->pulled_count; p++) {
+        int author_id = store->pulled_authors[p];
+        if (author_id == reader_id || !follow_graph_has(&ctx->follow_graph, reader_id, author_id)) {
+            continue;
+        }
+        TimelineLane author_lane = is_close_friend(ctx, reader_id, author_id) ?
+                                   TIMELINE_PRIORITY : TIMELINE_REGULAR;
+        if (author_lane != lane) {
+            continue;
+        }
+        
+        int total;
+        const int* author_ids = post_store_by_author(&ctx->post_store, author_id, &total);
+        int run[TIMELINE_LANE_CAPACITY];
+        int run_count = 0;
+        while (run_count < max && run_count < total &&
+               author_ids[total - 1 - run_count] >= store->pull_since[author_id]) {
+            run[run_count] = author_ids[total - 1 - run_count];
+            run_count++;
+        }
+        count = timeline_merge(post_ids, count, run, run_count, max);
+    }
+    return count;
+}
+
+void timeline_store_free(TimelineStore* store) {
+    for (int id = 0; id < store->capacity; id++) {
+        for (int lane = 0; lane < TIMELINE_LANES; lane++) {
+            post_ring_free(&store->timelines[id].lanes[lane]);
+        }
+    }
+    free(store->timelines);
+    free(store->pull_since);
+    free(store->pulled_authors);
+    memset(store, 0, sizeof(*store));
+}
+
+// =============================================================================
+// SOURCE FILE: feed.c
+// Feed Query Module - Cursor-paged feed with k-way merge of author post lists
+// =============================================================================
+
+// Pages are ordered by (priority, post id) descending; post ids increase with
+// created_at, so within a lane this is newest first. Pages that fall inside
+// the reader's home timeline are copied straight out of it. Deeper pages use
+// a max-heap holding one cursor per followed author, so a page costs
+// O(limit log authors) after the heap is built.
+
+typedef struct FeedSource {
+    int post_id;
+    const int* post_ids; // The author's ascending post list
+    int pos; // Index of post_id in post_ids
+} FeedSource;
+
+static void feed_heap_sift_down(FeedSource* heap, int count, int i) {
+    while (1) {
+        int largest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < count && heap[left].post_id > heap[largest].post_id) largest = left;
+        if (right < count && heap[right].post_id > heap[largest].post_id) largest = right;
+        if (largest == i) {
+            return;
+        }
+        FeedSource swap = heap[i];
+        heap[i] = heap[largest];
+        heap[largest] = swap;
+        i = largest;
+    }
+}
+
+// Adds the author's newest post below before_id to the heap
+static int feed_add_source(const PriorityContext* ctx, FeedSource* heap, int count,
+                           int author_id, int before_id) {
+    int total;
+    const int* post_ids = post_store_by_author(&ctx->post_store, author_id, &total);
+    int low = 0, high = total;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (post_ids[mid] < before_id) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low > 0) {
+        heap[count].post_ids = post_ids;
+        heap[count].pos = low - 1;
+        heap[count].post_id = post_ids[low - 1];
+        count++;
+    }
+    return count;
+}
+
+static int feed_lane_merge(const PriorityContext* ctx, int reader_id, TimelineLane lane,
+                           int before_id, int* post_ids, int want) {
+    EdgeIter iter;
+    int author_id;
+    int authors = 1;
+    follow_graph_following(&ctx->follow_graph, reader_id, &iter);
+    while (edge_iter_next(&iter, &author_id)) {
+        authors++;
+    }
+    
+    ScratchVec* buffer = scratch_acquire();
+    FeedSource* heap = buffer ?
+        (FeedSource*)scratch_reserve(buffer, (size_t)authors * sizeof(FeedSource)) : NULL;
+    if (heap == NULL) {
+        scratch_release(buffer);
+        return 0;
+    }
+    
+    int count = 0;
+    if (lane == TIMELINE_PRIORITY) {
+        count = feed_add_source(ctx, heap, count, reader_id, before_id); // Own posts rank first
+    }
+    follow_graph_following(&ctx->follow_graph, reader_id, &iter);
+    while (edge_iter_next(&iter, &author_id)) {
+        TimelineLane author_lane = is_close_friend(ctx, reader_id, author_id) ?
+                                   TIMELINE_PRIORITY : TIMELINE_REGULAR;
+        if (author_lane == lane) {
+            count = feed_add_source(ctx, heap, count, author_id, before_id);
+        }
+    }
+    for (int i = count / 2 - 1; i >= 0; i--) {
+        feed_heap_sift_down(heap, count, i);
+    }
+    
+    int n = 0;
+    while (n < want && count > 0) {
+        post_ids[n++] = heap[0].post_id;
+        if (heap[0].pos > 0) {
+            heap[0].pos--;
+            heap[0].post_id = heap[0].post_ids[heap[0].pos];
+        } else {
+            heap[0] = heap[--count];
+        }
+        feed_heap_sift_down(heap, count, 0);
+    }
+    
+    scratch_release(buffer);
+    return n;
+}
+
+// Next posts of one lane below before_id, newest first
+static int feed_lane_fetch(PriorityContext* ctx, int reader_id, TimelineLane lane,
+                           int before_id, int* post_ids, int want) {
+    int recent[TIMELINE_LANE_CAPACITY];
+    int recent_count = timeline_page(ctx, reader_id, lane, recent, TIMELINE_LANE_CAPACITY);
+    
+    int n = 0;
+    for (int i = 0; i < recent_count && n < want; i++) {
+        if (recent[i] < before_id) {
+            post_ids[n++] = recent[i];
+        }
+    }
+    if (n == want || recent_count < TIMELINE_LANE_CAPACITY) {
+        return n; // The timeline covered the whole range
+    }
+    return feed_lane_merge(ctx, reader_id, lane, before_id, post_ids, want);
+}
+
+// Fills page with up to limit posts after cursor. Returns the item count.
+int feed_query(PriorityContext* ctx, int reader_id, FeedCursor cursor, int limit, FeedPage* page) {
+    page->count = 0;
+    page->has_more = 0;
+    page->next = cursor;
+    if (limit <= 0) {
+        limit = FEED_PAGE_SIZE;
+    }
+    if (limit > FEED_PAGE_MAX) {
+        limit = FEED_PAGE_MAX;
+    }
+    
+    int lane = cursor.lane;
+    int before_id = cursor.before_id > 0 ? cursor.before_id : INT_MAX;
+    while (lane < TIMELINE_LANES && !page->has_more) {
+        // Fetch one extra post to learn whether another page exists
+        int post_ids[FEED_PAGE_MAX + 1];
+        int want = limit + 1 - page->count;
+        int found = feed_lane_fetch(ctx, reader_id, (TimelineLane)lane, before_id, post_ids, want);
+        for (int i = 0; i < found; i++) {
+            Post* post = post_store_find(&ctx->post_store, post_ids[i]);
+            if (page->count == limit) {
+                page->has_more = 1;
+                break;
+            }
+            if (post == NULL) {
+                continue;
+            }
+            page->items[page->count].post = post;
+            page->items[page->count].priority = lane == TIMELINE_PRIORITY;
+            page->count++;
+            page->next.lane = lane;
+            page->next.before_id = post_ids[i];
+        }
+        lane++;
+        before_id = INT_MAX;
+    }
+    return page->count;
+}
+
+// Cursors travel to frontends as "lane:before_id"
+void feed_cursor_format(FeedCursor cursor, char* buffer, size_t size) {
+    snprintf(buffer, size, "%d:%d", cursor.lane, cursor.before_id);
+}
+
+// An empty or missing cursor starts from the newest post
+int feed_cursor_parse(const char* text, FeedCursor* cursor) {
+    cursor->lane = TIMELINE_PRIORITY;
+    cursor->before_id = 0;
+    if (text == NULL || text[0] == '\0') {
+        return 1;
+    }
+    
+    int lane, before_id;
+    char extra;
+    if (sscanf(text, "%d:%d%c", &lane, &before_id, &extra) != 2 ||
+        lane < 0 || lane >= TIMELINE_LANES || before_id < 0) {
+        return 0;
+    }
+    cursor->lane = lane;
+    cursor->before_id = before_id;
+    return 1;
+}
+
+// =============================================================================
+// SOURCE FILE: notification.c
+// Notification Module - Per-user priority lanes with an id index
+// =============================================================================
+
+// Each user's notifications sit in two lanes by priority, oldest first. Ids
+// only grow, so appending keeps a lane in time order and reading it
+// backwards gives the newest first. A hash from id to notification makes
+// mark-read O(1), and every box keeps its own unread counts. Once a box
+// grows past NOTIFICATION_RETENTION, its oldest read notifications are
+// evicted until NOTIFICATION_EVICT_TO are left.
+//
+// Events are stored as (type, actor, object) and only turned into text by
+// notification_render. An event that repeats the newest unread notification
+// of its lane within NOTIFICATION_COALESCE_SECONDS of that notification's
+// first event is merged into it instead of adding another ("alice and 12
+// others started following you").
+
+// Nodes rebuilt by snapshot_load share one block and are freed with it
+static int node_in_block(const void* block, size_t count, size_t size, const void* node) {
+    return block != NULL && (const char*)node >= (const char*)block &&
+           (const char*)node < (const char*)block + count * size;
+}
+
+static void notification_release(PriorityContext* ctx, Notification* notif) {
+    const SnapshotMap* snapshot = &ctx->snapshot;
+    if (!node_in_block(snapshot->notifications, snapshot->notification_count, sizeof(Notification), notif)) {
+        slab_free(&ctx->notification_slab, notif);
+    }
+}
+
+static int notification_lane_of(const Notification* notif) {
+    return notif->priority ? 1 : 0;
+}
+
+static uint32_t notification_hash(int notif_id) {
+    uint32_t key = (uint32_t)notif_id;
+    key ^= key >> 16;
+    key *= 0x7feb352dU;
+    key ^= key >> 15;
+    key *= 0x846ca68bU;
+    key ^= key >> 16;
+    return key;
+}
+
+// The slot holding notif_id, or the empty slot where it would go
+static int notification_slot(const NotificationStore* store, int notif_id) {
+    int mask = store->slot_capacity - 1;
+    int slot = (int)(notification_hash(notif_id) & (uint32_t)mask);
+    while (store->slots[slot] != NULL && store->slots[slot]->notif_id != notif_id) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// Keeps the id table at most half full once extra more ids are added
+static int notification_slots_reserve(NotificationStore* store, size_t extra) {
+    size_t needed = ((size_t)store->count + extra) * 2;
+    if (needed <= (size_t)store->slot_capacity) {
+        return 1;
+    }
+    int old_capacity = store->slot_capacity;
+    size_t new_capacity = old_capacity ? (size_t)old_capacity * 2 : 1024;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    if (new_capacity > INT_MAX) {
+        return 0;
+    }
+    Notification** old = store->slots;
+    Notification** grown = (Notification**)calloc(new_capacity, sizeof(Notification*));
+    if (grown == NULL) {
+        return 0;
+    }
+    store->slots = grown;
+    store->slot_capacity = (int)new_capacity;
+    for (int i = 0; i < old_capacity; i++) {
+        if (old[i] != NULL) {
+            store->slots[notification_slot(store, old[i]->notif_id)] = old[i];
+        }
+    }
+    free(old);
+    return 1;
+}
+
+// Removes an id, moving later entries of its probe run back into the hole
+static void notification_unindex(NotificationStore* store, int notif_id) {
+    int mask = store->slot_capacity - 1;
+    int hole = notification_slot(store, notif_id);
+    if (store->slots[hole] == NULL) {
+        return;
+    }
+    for (int slot = (hole + 1) & mask; store->slots[slot] != NULL; slot = (slot + 1) & mask) {
+        int home = (int)(notification_hash(store->slots[slot]->notif_id) & (uint32_t)mask);
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            store->slots[hole] = store->slots[slot];
+            hole = slot;
+        }
+    }
+    store->slots[hole] = NULL;
+    store->count--;
+}
+
+static int notification_reserve_user(NotificationStore* store, int user_id) {
+    if (user_id < store->capacity) {
+        return 1;
+    }
+    int new_capacity = store->capacity ? store->capacity : 1024;
+    while (new_capacity <= user_id) {
+        new_capacity *= 2;
+    }
+    NotificationBox* grown = (NotificationBox*)realloc(store->boxes, new_capacity * sizeof(NotificationBox));
+    if (grown == NULL) {
+        return 0;
+    }
+    memset(grown + store->capacity, 0, (new_capacity - store->capacity) * sizeof(NotificationBox));
+    store->boxes = grown;
+    store->capacity = new_capacity;
+    return 1;
+}
+
+// Takes ownership of notif and adds it to the id index only. Returns 1 once
+// indexed, 0 if out of memory (notif is left to the caller), and -1 when
+// notif was refused and freed: a duplicate id or a user id out of range.
+static int notification_store_index(PriorityContext* ctx, Notification* notif) {
+    NotificationStore* store = &ctx->notifications;
+    if (notif->user_id <= 0 || notif->user_id > MAX_USERS) {
+        notification_release(ctx, notif);
+        return -1;
+    }
+    if (!notification_slots_reserve(store, 1) || !notification_reserve_user(store, notif->user_id)) {
+        return 0;
+    }
+    int slot = notification_slot(store, notif->notif_id);
+    if (store->slots[slot] != NULL) {
+        notification_release(ctx, notif);
+        return -1;
+    }
+    store->slots[slot] = notif;
+    store->count++;
+    if (notif->notif_id > store->last_id) {
+        store->last_id = notif->notif_id;
+    }
+    return 1;
+}
+
+// Puts an indexed notification in its lane; 0 if out of memory
+static int notification_file(NotificationStore* store, Notification* notif) {
+    NotificationBox* box = &store->boxes[notif->user_id];
+    NotificationLane* lane = &box->lanes[notification_lane_of(notif)];
+    if (lane->count == lane->capacity) {
+        int new_capacity = lane->capacity ? lane->capacity * 2 : 8;
+        Notification** grown = (Notification**)realloc(lane->items, new_capacity * sizeof(Notification*));
+        if (grown == NULL) {
+            return 0;
+        }
+        lane->items = grown;
+        lane->capacity = new_capacity;
+    }
+    // Notifications arrive in id order; an older one is slotted into place
+    int pos = lane->count;
+    while (pos > 0 && lane->items[pos - 1]->notif_id > notif->notif_id) {
+        pos--;
+    }
+    memmove(lane->items + pos + 1, lane->items + pos, (lane->count - pos) * sizeof(Notification*));
+    lane->items[pos] = notif;
+    lane->count++;
+    box->unread[notification_lane_of(notif)] += !notif->is_read;
+    return 1;
+}
+
+// Evicts the box's oldest read notifications, across both lanes, once it
+// has grown past its limit. The limit then moves up with the unread ones
+// left behind, so a box full of unread notifications is not rescanned on
+// every insert.
+static void notification_evict(PriorityContext* ctx, NotificationBox* box) {
+    int total = box->lanes[0].count + box->lanes[1].count;
+    if (total <= (box->evict_at ? box->evict_at : NOTIFICATION_RETENTION)) {
+        return;
+    }
+    int excess = total - NOTIFICATION_EVICT_TO;
+    int next[2] = {0, 0};
+    while (excess > 0) {
+        int more[2] = {next[0] < box->lanes[0].count, next[1] < box->lanes[1].count};
+        if (!more[0] && !more[1]) {
+            break;
+        }
+        int lane = !more[0] || (more[1] && box->lanes[1].items[next[1]]->notif_id <
+                                           box->lanes[0].items[next[0]]->notif_id);
+        Notification** item = &box->lanes[lane].items[next[lane]++];
+        if ((*item)->is_read) {
+            notification_unindex(&ctx->notifications, (*item)->notif_id);
+            notification_release(ctx, *item);
+            *item = NULL;
+            ctx->notifications.evicted++;
+            excess--;
+        }
+    }
+    
+    total = 0;
+    for (int lane = 0; lane < 2; lane++) {
+        NotificationLane* l = &box->lanes[lane];
+        int kept = 0;
+        for (int i = 0; i < l->count; i++) {
+            if (l->items[i] != NULL) {
+                l->items[kept++] = l->items[i];
+            }
+        }
+        l->count = kept;
+        total += kept;
+    }
+    int evict_at = total + (NOTIFICATION_RETENTION - NOTIFICATION_EVICT_TO);
+    box->evict_at = evict_at > NOTIFICATION_RETENTION ? evict_at : NOTIFICATION_RETENTION;
+}
+
+// Takes ownership of notif and files it under its user, without applying
+// the retention limit (the loaders leave that to notification_store_build).
+// Returns 0 if out of memory, -1 when notif was refused (see
+// notification_store_index).
+static int notification_store_place(PriorityContext* ctx, Notification* notif) {
+    NotificationStore* store = &ctx->notifications;
+    int indexed = notification_store_index(ctx, notif);
+    if (indexed <= 0) {
+        return indexed;
+    }
+    if (!notification_file(store, notif)) {
+        notification_unindex(store, notif->notif_id);
+        return 0;
+    }
+    return 1;
+}
+
+// notification_store_place, then the retention limit for the user's box
+static int notification_store_add(PriorityContext* ctx, Notification* notif) {
+    int added = notification_store_place(ctx, notif);
+    if (added > 0) {
+        notification_evict(ctx, &ctx->notifications.boxes[notif->user_id]);
+    }
+    return added;
+}
+
+static int compare_notification_ids(const void* a, const void* b) {
+    int id_a = (*(Notification* const*)a)->notif_id;
+    int id_b = (*(Notification* const*)b)->notif_id;
+    return (id_a > id_b) - (id_a < id_b);
+}
+
+// Every notification held, in id order; NULL if out of memory
+static Notification** notifications_by_id(const NotificationStore* store, size_t* count) {
+    Notification** sorted = (Notification**)malloc((store->count ? store->count : 1) * sizeof(Notification*));
+    *count = 0;
+    if (sorted == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < store->slot_capacity; i++) {
+        if (store->slots[i] != NULL) {
+            sorted[(*count)++] = store->slots[i];
+        }
+    }
+    qsort(sorted, *count, sizeof(Notification*), compare_notification_ids);
+    return sorted;
+}
+
+// Applies the retention limit to every box (used by load_data once the
+// loaders have placed everything)
+int notification_store_build(PriorityContext* ctx) {
+    NotificationStore* store = &ctx->notifications;
+    for (int id = 0; id < store->capacity; id++) {
+        notification_evict(ctx, &store->boxes[id]);
+    }
+    
+    // Never hand out an id below a stored one, even without counters.dat
+    if (ctx->next_notif_id <= store->last_id) {
+        ctx->next_notif_id = store->last_id + 1;
+    }
+    return 1;
+}
+
+void notification_store_free(NotificationStore* store) {
+    for (int id = 0; id < store->capacity; id++) {
+        free(store->boxes[id].lanes[0].items);
+        free(store->boxes[id].lanes[1].items);
+    }
+    free(store->boxes);
+    free(store->slots);
+    memset(store, 0, sizeof(*store));
+}
+
+Notification* notification_find(const PriorityContext* ctx, int notif_id) {
+    const NotificationStore* store = &ctx->notifications;
+    if (store->slot_capacity == 0) {
+        return NULL;
+    }
+    return store->slots[notification_slot(store, notif_id)];
+}
+
+// NULL when the user never had a notification
+const NotificationBox* notification_box(const PriorityContext* ctx, int user_id) {
+    if (user_id <= 0 || user_id >= ctx->notifications.capacity) {
+        return NULL;
+    }
+    return &ctx->notifications.boxes[user_id];
+}
+
+// Unread notifications in total; either lane count may be NULL
+int notification_unread(const PriorityContext* ctx, int user_id, int* priority_unread, int* regular_unread) {
+    const NotificationBox* box = notification_box(ctx, user_id);
+    int priority_count = box ? box->unread[1] : 0;
+    int regular_count = box ? box->unread[0] : 0;
+    if (priority_unread != NULL) {
+        *priority_unread = priority_count;
+    }
+    if (regular_unread != NULL) {
+        *regular_unread = regular_count;
+    }
+    return priority_count + regular_count;
+}
+
+// Returns 1 if the notification was unread
+static int notification_mark_read(NotificationStore* store, Notification* notif) {
+    if (notif->is_read) {
+        return 0;
+    }
+    notif->is_read = 1;
+    store->boxes[notif->user_id].unread[notification_lane_of(notif)]--;
+    return 1;
+}
+
+// The unread notification an event for user_id should be merged into, if any
+static Notification* notification_coalesce_target(const PriorityContext* ctx, int user_id, NotificationType type,
+                                                  int actor_id, int priority, time_t now) {
+    const NotificationBox* box = notification_box(ctx, user_id);
+    const NotificationLane* lane = box ? &box->lanes[priority] : NULL;
+    if (lane == NULL || lane->count == 0) {
+        return NULL;
+    }
+    Notification* newest = lane->items[lane->count - 1];
+    time_t first = newest->timestamp - newest->span; // The window does not slide with merges
+    if (newest->is_read || newest->type != type || now - first >= NOTIFICATION_COALESCE_SECONDS) {
+        return NULL;
+    }
+    // Follows name their actors; other events only merge per actor
+    return type == NOTIFY_FOLLOW || newest->actor_id == actor_id ? newest : NULL;
+}
+
+// Gives a new notification the next id and files it
+static int notification_insert(PriorityContext* ctx, Notification* new_notif) {
+    new_notif->notif_id = ctx->next_notif_id++;
+    new_notif->timestamp = time(NULL);
+    new_notif->is_read = 0;
+    int added = notification_store_add(ctx, new_notif);
+    if (added == 0) {
+        slab_free(&ctx->notification_slab, new_notif);
+        return priority_fail(ctx, "Memory allocation failed!");
+    }
+    if (added < 0) {
+        return priority_fail(ctx, "Notification id already in use!");
+    }
+    wal_log_notification(ctx, new_notif);
+    return 1;
+}
+
+// A free-text notification
+int add_notification(PriorityContext* ctx, int user_id, const char* content, int priority) {
+    if (user_id <= 0 || user_id > MAX_USERS) {
+        return priority_fail(ctx, "User not found!");
+    }
+    Notification* new_notif = (Notification*)slab_alloc(&ctx->notification_slab);
+    if (new_notif == NULL) {
+        return priority_fail(ctx, "Memory allocation failed!");
+    }
+    memset(new_notif, 0, sizeof(*new_notif));
+    new_notif->user_id = user_id;
+    new_notif->type = NOTIFY_TEXT;
+    new_notif->content = arena_intern(ctx, content);
+    new_notif->priority = priority ? 1 : 0;
+    return notification_insert(ctx, new_notif);
+}
+
+// Tells user_id that actor_id did something to object_id (a post or
+// message id, 0 for follows)
+int notify_user(PriorityContext* ctx, int user_id, NotificationType type, int actor_id, int object_id, int priority) {
+    if (user_id <= 0 || user_id > MAX_USERS) {
+        return priority_fail(ctx, "User not found!");
+    }
+    if (type <= NOTIFY_TEXT || type >= NOTIFY_TYPE_COUNT) {
+        return priority_fail(ctx, "Invalid notification type!");
+    }
+    priority = priority ? 1 : 0;
+    time_t now = time(NULL);
+    Notification* merged = notification_coalesce_target(ctx, user_id, type, actor_id, priority, now);
+    if (merged != NULL) {
+        if (type == NOTIFY_FOLLOW && merged->actor_id == actor_id) {
+            return 1; // Followed again after unfollowing; already counted
+        }
+        merged->others++;
+        if (object_id >= merged->object_id) { // A late fan-out job can bring an older post
+            merged->actor_id = actor_id;
+            merged->object_id = object_id;
+        }
+        time_t first = merged->timestamp - merged->span;
+        merged->timestamp = now;
+        merged->span = (int)(now - first);
+        ctx->notifications.coalesced++;
+        wal_log_notification(ctx, merged);
+        return 1;
+    }
+    
+    Notification* new_notif = (Notification*)slab_alloc(&ctx->notification_slab);
+    if (new_notif == NULL) {
+        return priority_fail(ctx, "Memory allocation failed!");
+    }
+    memset(new_notif, 0, sizeof(*new_notif));
+    new_notif->user_id = user_id;
+    new_notif->type = (unsigned char)type;
+    new_notif->actor_id = actor_id;
+    new_notif->object_id = object_id;
+    new_notif->priority = (unsigned char)priority;
+    return notification_insert(ctx, new_notif);
+}
+
+// The text shown for a notification: NOTIFY_TEXT notifications point into
+// the arena, the others are written into buf
+const char* notification_render(const PriorityContext* ctx, const Notification* notif, char* buf, size_t size) {
+    if (notif->type == NOTIFY_TEXT) {
+        return arena_str(ctx, notif->content);
+    }
+    const User* actor = find_user_by_id(ctx, notif->actor_id);
+    const char* name = actor ? arena_str(ctx, actor->username) : "Someone";
+    int others = notif->others;
+    switch (notif->type) {
+        case NOTIFY_FOLLOW:
+            if (others == 0) {
+                snprintf(buf, size, "%s started following you", name);
+            } else {
+                snprintf(buf, size, "%s and %d other%s started following you", name, others, others == 1 ? "" : "s");
+            }
+            break;
+        case NOTIFY_POST:
+        case NOTIFY_MEDIA_POST: {
+            const char* kind = notif->type == NOTIFY_POST ? "" : "media ";
+            if (others == 0) {
+                snprintf(buf, size, "%s created a new %spost", name, kind);
+            } else {
+                snprintf(buf, size, "%s created %d new %sposts", name, others + 1, kind);
+            }
+            break;
+        }
+        case NOTIFY_MESSAGE:
+            if (others == 0) {
+                snprintf(buf, size, "New message from %s", name);
+            } else {
+                snprintf(buf, size, "%d new messages from %s", others + 1, name);
+            }
+            break;
+        default:
+            snprintf(buf, size, "Notification from %s", name);
+            break;
+    }
+    return buf;
+}
+
+int mark_notification_read(PriorityContext* ctx, int notif_id) {
+    if (ctx->current_user == NULL) {
+        return priority_fail(ctx, "Please login first!");
+    }
+    
+    Notification* notif = notification_find(ctx, notif_id);
+    if (notif == NULL || notif->user_id != ctx->current_user->user_id) {
+        return priority_fail(ctx, "Notification not found or doesn't belong to you!");
+    }
+    if (notification_mark_read(&ctx->notifications, notif)) {
+        wal_log_notification_read(ctx, notif_id);
+    }
+    return 1;
+}
+
+// =============================================================================
+// SOURCE FILE: file_handler.c
+// File Handling Module - Persistent Data Storage
+// =============================================================================
+
+// Each file is written under a temporary name, synced and renamed over the
+// old one, so a crash never leaves a half-written snapshot. The directory is
+// synced too, so the rename itself survives a crash before the log is emptied.
+static FILE* snapshot_create(const char* name, char* temp_path, size_t size) {
+    snprintf(temp_path, size, "%s.tmp", name);
+    return fopen(temp_path, "w");
+}
+
+// Syncs the directory that holds name
+static int snapshot_sync_dir(const char* name) {
+    char dir[256] = ".";
+    const char* slash = strrchr(name, '/');
+    if (slash != NULL) {
+        size_t len = slash == name ? 1 : (size_t)(slash - name);
+        if (len >= sizeof(dir)) {
+            return 0;
+        }
+        memcpy(dir, name, len);
+        dir[len] = '\0';
+    }
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        return 0;
+    }
+    int ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+static int snapshot_commit(FILE* file, const char* temp_path, const char* name) {
+    int ok = !ferror(file) && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(temp_path, name) != 0) {
+        remove(temp_path);
+        return 0;
+    }
+    return snapshot_sync_dir(name);
+}
+
+// Rewrites every .dat file; returns 0 if any of them could not be written.
+// counters.dat goes last and records the log position the snapshot covers.
+int save_data(const PriorityContext* ctx) {
+    FILE *file;
+    char temp_path[64];
+    int ok = 1;
+    
+    // Save users
+    file = snapshot_create("users.dat", temp_path, sizeof(temp_path));
+    if (file == NULL) {
+        ok = 0;
+    } else {
+        dat_write_header(file);
+        User* temp = ctx->users_head;
+        while (temp != NULL) {
+            dat_write_int(file, temp->user_id);
+            dat_write_sep(file);
+            dat_write_str(file, arena_str(ctx, temp->username));
+            dat_write_sep(file);
+            dat_write_str(file, arena_str(ctx, temp->password));
+            dat_write_sep(file);
+            dat_write_int(file, temp->created_at);
+            dat_write_end(file);
+            temp = temp->next;
+        }
+        ok = snapshot_commit(file, temp_path, "users.dat") && ok;
+    }
+    
+    // Save posts
+    file = snapshot_create("posts.dat", temp_path, sizeof(temp_path));
+    if (file == NULL) {
+        ok = 0;
+    } else {
+        dat_write_header(file);
+        for (size_t i = 0; i < ctx->post_store.post_count; i++) {
+            Post* temp = post_store_at(&ctx->post_store, i);
+            dat_write_int(file, temp->post_id);
+            dat_write_sep(file);
+            dat_write_int(file, temp->author_id);
+            dat_write_sep(file);
+            dat_write_str(file, arena_str(ctx, temp->author_name));
+            dat_write_sep(file);
+            dat_write_str(file, arena_str(ctx, temp->content));
+            dat_write_sep(file);
+            dat_write_int(file, temp->created_at);
+            dat_write_sep(file);
+            dat_write_int(file, temp->priority);
+            dat_write_sep(file);
+            dat_write_int(file, temp->media_type);
+            dat_write_sep(file);
+            dat_write_str(file, arena_str(ctx, temp->media_path));
+            dat_write_sep(file);
+            dat_write_str(file, arena_str(ctx, temp->media_description));
+            dat_write_end(file);
+        }
+        ok = snapshot_commit(file, temp_path, "posts.dat") && ok;
+    }
+    
+    // Save messages
+    file = snapshot_create("messages.dat", temp_path, sizeof(temp_path));
+    if (file == NULL) {
+        ok = 0;
+    } else {
+        dat_write_header(file);
+        Message* temp = ctx->messages_head;
+        while (temp != NULL) {
+            dat_write_int(file, temp->message_id);
+            dat_write_sep(file);
+            dat_write_int(file, temp->sender_id);
+            dat_write_sep(file);
+            dat_write_int(file, temp->receiver_id);
+            dat_write_sep(file);
+            dat_write_str(file, arena_str(ctx, temp->sender_name));
+            dat_write_sep(file);
+            dat_write_str(file, arena_str(ctx, temp->content));
+            dat_write_sep(file);
+            dat_write_int(file, temp->timestamp);
+            dat_write_sep(file);
+            dat_write_int(file, temp->priority);
+            dat_write_sep(file);
+            dat_write_int(file, temp->is_read);
+            dat_write_end(file);
+            temp = temp->next;
+        }
+        ok = snapshot_commit(file, temp_path, "messages.dat") && ok;
+    }
+    
+    // Save follows
+    file = snapshot_create("follows.dat", temp_path, sizeof(temp_path));
+    if (file == NULL) {
+        ok = 0;
+    } else {
+        for (int user_id = 1; user_id < adjacency_capacity(&ctx->follow_graph.out); user_id++) {
+            EdgeIter followings;
+            int following_id;
+            follow_graph_following(&ctx->follow_graph, user_id, &followings);
+            while (edge_iter_next(&followings, &following_id)) {
+                fprintf(file, "%d|%d\n", user_id, following_id);
+            }
+        }
+        ok = snapshot_commit(file, temp_path, "follows.dat") && ok;
+    }
+    
+    // Save close friends
+    file = snapshot_create("close_friends.dat", temp_path, sizeof(temp_path));
+    if (file == NULL) {
+        ok = 0;
+    } else {
+        for (int user_id = 1; user_id < adjacency_capacity(&ctx->close_friends.friends); user_id++) {
+            EdgeIter iter;
+            int friend_id;
+            close_friends_list(&ctx->close_friends, user_id, &iter);
+            while (edge_iter_next(&iter, &friend_id)) {
+                fprintf(file, "%d|%d\n", user_id, friend_id);
+            }
+        }
+        ok = snapshot_commit(file, temp_path, "close_friends.dat") && ok;
+    }
+    
+    // Save notifications
+    file = snapshot_create("notifications.dat", temp_path, sizeof(temp_path));
+    if (file == NULL) {
+        ok = 0;
+    } else {
+        dat_write_header(file);
+        size_t count = 0;
+        Notification** sorted = notifications_by_id(&ctx->notifications, &count);
+        ok = sorted != NULL && ok;
+        char text[MAX_MESSAGE_CONTENT];
+        while (count > 0) { // Newest first
+            Notification* temp = sorted[--count];
+            dat_write_int(file, temp->notif_id);
+            dat_write_sep(file);
+            dat_write_int(file, temp->user_id);
+            dat_write_sep(file);
+            // Rendered for readers of the file; the fields after it rebuild it
+            dat_write_str(file, notification_render(ctx, temp, text, sizeof(text)));
+            dat_write_sep(file);
+            dat_write_int(file, temp->timestamp);
+            dat_write_sep(file);
+            dat_write_int(file, temp->priority);
+            dat_write_sep(file);
+            dat_write_int(file, temp->is_read);
+            if (temp->type != NOTIFY_TEXT) {
+                dat_write_sep(file);
+                dat_write_int(file, temp->type);
+                dat_write_sep(file);
+                dat_write_int(file, temp->actor_id);
+                dat_write_sep(file);
+                dat_write_int(file, temp->object_id);
+                dat_write_sep(file);
+                dat_write_int(file, temp->others);
+                dat_write_sep(file);
+                dat_write_int(file, temp->span);
+            }
+            dat_write_end(file);
+        }
+        free(sorted);
+        ok = snapshot_commit(file, temp_path, "notifications.dat") && ok;
+    }
+    
+    // Save ID counters
+    file = snapshot_create("counters.dat", temp_path, sizeof(temp_path));
+    if (file == NULL) {
+        ok = 0;
+    } else {
+        fprintf(file, "%d|%d|%d|%d|%llu\n", 
+                ctx->next_user_id, ctx->next_post_id, ctx->next_message_id, ctx->next_notif_id,
+                (unsigned long long)(ctx->wal.next_lsn ? ctx->wal.next_lsn - 1 : ctx->wal.snapshot_lsn));
+        ok = snapshot_commit(file, temp_path, "counters.dat") && ok;
+    }
+    return ok;
+}
+
+// Parses the .dat files written by save_data, escaped or not, on a pool of
+// threads. Each file is cut into chunks of about LOAD_CHUNK_BYTES on record
+// boundaries; every chunk is parsed into its own record array and string
+// buffers. The buffers are copied into the arena in one step, then the user
+// index, both directions of the follow graph and of the close friends
+// index, and the post sort are built side by side. Only linking records into
+// the engine runs on one thread.
+
+typedef enum {
+    LOAD_USERS = 0,
+    LOAD_POSTS,
+    LOAD_MESSAGES,
+    LOAD_FOLLOWS,
+    LOAD_CLOSE_FRIENDS,
+    LOAD_NOTIFICATIONS,
+    LOAD_KINDS
+} LoadKind;
+
+static const char* const load_files[LOAD_KINDS] = {
+    "users.dat", "posts.dat", "messages.dat", "follows.dat", "close_friends.dat", "notifications.dat"
+};
+
+static const size_t load_record_sizes[LOAD_KINDS] = {
+    sizeof(User), sizeof(Post), sizeof(Message), sizeof(Follow), sizeof(Follow), sizeof(Notification)
+};
+
+// Strings parsed by one chunk; offset 0 is the empty string
+typedef struct LoadText {
+    char* data;
+    size_t used;
+    size_t capacity;
+} LoadText;
+
+typedef struct LoadChunk {
+    LoadKind kind;
+    long start;
+    size_t length;
+    int escaped;
+    char* records; // count records of load_record_sizes[kind] bytes
+    size_t count;
+    size_t capacity;
+    LoadText text; // Strings bound for the arena
+    LoadText names; // Author and sender names, used only for unknown users
+    size_t text_base; // Arena offset that text offset 1 moves to
+    size_t names_base; // Offset that names offset 1 moves to in the merged names
+    int failed; // Out of memory or a read error
+} LoadChunk;
+
+static StrRef load_text_add(LoadChunk* chunk, LoadText* text, const char* value) {
+    size_t len = strlen(value) + 1;
+    if (len == 1) {
+        return 0;
+    }
+    if (text->used + len > text->capacity) {
+        size_t capacity = text->capacity ? text->capacity : 4096;
+        while (capacity < text->used + len + 1) {
+            capacity *= 2;
+        }
+        char* grown = (char*)realloc(text->data, capacity);
+        if (grown == NULL || capacity > UINT32_MAX) {
+            free(grown == text->data ? NULL : grown);
+            chunk->failed = 1;
+            return 0;
+        }
+        if (text->data == NULL) {
+            grown[0] = '\0';
+            text->used = 1;
+        }
+        text->data = grown;
+        text->capacity = capacity;
+    }
+    StrRef ref = (StrRef)text->used;
+    memcpy(text->data + text->used, value, len);
+    text->used += len;
+    return ref;
+}
+
+// A zeroed slot for the next record, or NULL when memory ran out
+static void* load_record_add(LoadChunk* chunk) {
+    size_t size = load_record_sizes[chunk->kind];
+    if (chunk->count == chunk->capacity) {
+        size_t capacity = chunk->capacity ? chunk->capacity * 2 : 1024;
+        char* grown = (char*)realloc(chunk->records, capacity * size);
+        if (grown == NULL) {
+            chunk->failed = 1;
+            return NULL;
+        }
+        chunk->records = grown;
+        chunk->capacity = capacity;
+    }
+    void* record = chunk->records + chunk->count++ * size;
+    memset(record, 0, size);
+    return record;
+}
+
+static void load_parse_user(LoadChunk* chunk, const DatReader* reader) {
+    int user_id;
+    long long created_at;
+    if (!dat_field_int(reader, 0, &user_id) || !dat_field_long(reader, 3, &created_at) ||
+        dat_field_str(reader, 1)[0] == '\0') {
+        return;
+    }
+    User* user = (User*)load_record_add(chunk);
+    if (user == NULL) {
+        return;
+    }
+    user->user_id = user_id;
+    user->username = load_text_add(chunk, &chunk->text, dat_field_str(reader, 1));
+    user->password = load_text_add(chunk, &chunk->text, dat_field_str(reader, 2));
+    user->created_at = (time_t)created_at;
+}
+
+static void load_parse_post(LoadChunk* chunk, const DatReader* reader) {
+    Post parsed;
+    long long created_at;
+    int media_type_int = MEDIA_NONE;
+    if (!dat_field_int(reader, 0, &parsed.post_id) || !dat_field_int(reader, 1, &parsed.author_id) ||
+        !dat_field_long(reader, 4, &created_at) || !dat_field_int(reader, 5, &parsed.priority)) {
+        return;
+    }
+    Post* post = (Post*)load_record_add(chunk);
+    if (post == NULL) {
+        return;
+    }
+    post->post_id = parsed.post_id;
+    post->author_id = parsed.author_id;
+    post->priority = parsed.priority;
+    post->created_at = (time_t)created_at;
+    
+    // Handle backward compatibility - older posts without media fields
+    dat_field_int(reader, 6, &media_type_int);
+    if (media_type_int >= 0 && media_type_int <= 3) {
+        post->media_type = (MediaType)media_type_int;
+        post->media_path = load_text_add(chunk, &chunk->text, dat_field_str(reader, 7));
+        post->media_description = load_text_add(chunk, &chunk->text, dat_field_str(reader, 8));
+    } else {
+        post->media_type = MEDIA_NONE;
+    }
+    post->author_name = load_text_add(chunk, &chunk->names, dat_field_str(reader, 2));
+    post->content = load_text_add(chunk, &chunk->text, dat_field_str(reader, 3));
+}
+
+static void load_parse_message(LoadChunk* chunk, const DatReader* reader) {
+    Message parsed;
+    long long timestamp;
+    if (!dat_field_int(reader, 0, &parsed.message_id) || !dat_field_int(reader, 1, &parsed.sender_id) ||
+        !dat_field_int(reader, 2, &parsed.receiver_id) || !dat_field_long(reader, 5, &timestamp) ||
+        !dat_field_int(reader, 6, &parsed.priority)) {
+        return;
+    }
+    Message* message = (Message*)load_record_add(chunk);
+    if (message == NULL) {
+        return;
+    }
+    *message = parsed;
+    message->timestamp = (time_t)timestamp;
+    message->sender_name = load_text_add(chunk, &chunk->names, dat_field_str(reader, 3));
+    message->content = load_text_add(chunk, &chunk->text, dat_field_str(reader, 4));
+    if (!dat_field_int(reader, 7, &message->is_read)) {
+        message->is_read = 0; // Saved before messages had read state
+    }
+    message->next = NULL;
+}
+
+// Follows and close friends: "id|id"
+static void load_parse_pair(LoadChunk* chunk, const DatReader* reader) {
+    Follow pair;
+    if (!dat_field_int(reader, 0, &pair.follower_id) || !dat_field_int(reader, 1, &pair.following_id)) {
+        return;
+    }
+    Follow* stored = (Follow*)load_record_add(chunk);
+    if (stored != NULL) {
+        *stored = pair;
+    }
+}
+
+// Templated notifications carry type, actor, object and merge count after
+// the rendered text; older files only have the text
+static void load_parse_notification(LoadChunk* chunk, const DatReader* reader) {
+    Notification parsed;
+    long long timestamp;
+    int priority, is_read, type = NOTIFY_TEXT;
+    memset(&parsed, 0, sizeof(parsed));
+    if (!dat_field_int(reader, 0, &parsed.notif_id) || !dat_field_int(reader, 1, &parsed.user_id) ||
+        !dat_field_long(reader, 3, &timestamp) || !dat_field_int(reader, 4, &priority) ||
+        !dat_field_int(reader, 5, &is_read)) {
+        return;
+    }
+    if (reader->field_count > 6 &&
+        (!dat_field_int(reader, 6, &type) || type <= NOTIFY_TEXT || type >= NOTIFY_TYPE_COUNT ||
+         !dat_field_int(reader, 7, &parsed.actor_id) || !dat_field_int(reader, 8, &parsed.object_id) ||
+         !dat_field_int(reader, 9, &parsed.others) ||
+         (reader->field_count > 10 && !dat_field_int(reader, 10, &parsed.span)))) {
+        return;
+    }
+    Notification* notif = (Notification*)load_record_add(chunk);
+    if (notif == NULL) {
+        return;
+    }
+    *notif = parsed;
+    notif->type = (unsigned char)type;
+    notif->priority = priority ? 1 : 0;
+    notif->is_read = is_read ? 1 : 0;
+    notif->timestamp = (time_t)timestamp;
+    if (type == NOTIFY_TEXT) {
+        notif->content = load_text_add(chunk, &chunk->text, dat_field_str(reader, 2));
+    }
+}
+
+// Pool job: parse one chunk. Each job opens the file for itself.
+static void load_parse_chunk(void* jobs, size_t i) {
+    LoadChunk* chunk = &((LoadChunk*)jobs)[i];
+    FILE* file = fopen(load_files[chunk->kind], "r");
+    if (file == NULL || fseek(file, chunk->start, SEEK_SET) != 0) {
+        chunk->failed = 1;
+        if (file != NULL) {
+            fclose(file);
+        }
+        return;
+    }
+    
+    DatReader reader;
+    dat_reader_open_range(&reader, file, chunk->escaped, chunk->length);
+    while (!chunk->failed && dat_reader_next(&reader)) {
+        switch (chunk->kind) {
+            case LOAD_USERS: load_parse_user(chunk, &reader); break;
+            case LOAD_POSTS: load_parse_post(chunk, &reader); break;
+            case LOAD_MESSAGES: load_parse_message(chunk, &reader); break;
+            case LOAD_NOTIFICATIONS: load_parse_notification(chunk, &reader); break;
+            default: load_parse_pair(chunk, &reader); break;
+        }
+    }
+    if (reader.failed) {
+        chunk->failed = 1;
+    }
+    dat_reader_free(&reader);
+    fclose(file);
+}
+
+static StrRef load_rebase(StrRef ref, size_t base) {
+    return ref ? (StrRef)(ref - 1 + base) : 0;
+}
+
+typedef struct LoadMerge {
+    PriorityContext* ctx;
+    LoadChunk* chunks;
+    char* names; // Every chunk's names, side by side
+} LoadMerge;
+
+// Pool job: copy one chunk's strings to their reserved place and point its
+// records there
+static void load_merge_chunk(void* jobs, size_t i) {
+    LoadMerge* merge = (LoadMerge*)jobs;
+    LoadChunk* chunk = &merge->chunks[i];
+    if (chunk->text.used > 1) {
+        memcpy(merge->ctx->text_arena.data + chunk->text_base, chunk->text.data + 1, chunk->text.used - 1);
+    }
+    if (chunk->names.used > 1) {
+        memcpy(merge->names + chunk->names_base, chunk->names.data + 1, chunk->names.used - 1);
+    }
+    size_t text = chunk->text_base, names = chunk->names_base;
+    for (size_t r = 0; r < chunk->count; r++) {
+        void* record = chunk->records + r * load_record_sizes[chunk->kind];
+        if (chunk->kind == LOAD_USERS) {
+            User* user = (User*)record;
+            user->username = load_rebase(user->username, text);
+            user->password = load_rebase(user->password, text);
+        } else if (chunk->kind == LOAD_POSTS) {
+            Post* post = (Post*)record;
+            post->author_name = load_rebase(post->author_name, names);
+            post->content = load_rebase(post->content, text);
+            post->media_path = load_rebase(post->media_path, text);
+            post->media_description = load_rebase(post->media_description, text);
+        } else if (chunk->kind == LOAD_MESSAGES) {
+            Message* message = (Message*)record;
+            message->sender_name = load_rebase(message->sender_name, names);
+            message->content = load_rebase(message->content, text);
+        } else if (chunk->kind == LOAD_NOTIFICATIONS) {
+            Notification* notif = (Notification*)record;
+            if (notif->type == NOTIFY_TEXT) {
+                notif->content = load_rebase(notif->content, text);
+            }
+        }
+    }
+}
+
+typedef enum {
+    BUILD_USERS = 0,
+    BUILD_FOLLOWING,
+    BUILD_FOLLOWERS,
+    BUILD_FRIENDS,
+    BUILD_FRIEND_OF,
+    BUILD_POSTS,
+    BUILD_TASKS
+} LoadBuildTask;
+
+typedef struct LoadBuild {
+    PriorityContext* ctx;
+    LoadChunk* chunks;
+    size_t chunk_count;
+    Follow* pairs[2]; // Follows, close friends; NULL when the file is missing
+    size_t pair_count[2];
+    int pair_max_id[2];
+    Adjacency built[4]; // Following, followers, friends, friend_of
+    Post* posts; // Every post, sorted by id
+    size_t post_count;
+    int ok[BUILD_TASKS];
+} LoadBuild;
+
+// Concatenates the records of one kind across chunks, in file order
+static void* load_gather(const LoadChunk* chunks, size_t chunk_count, LoadKind kind, size_t* count) {
+    size_t size = load_record_sizes[kind];
+    *count = 0;
+    for (size_t i = 0; i < chunk_count; i++) {
+        if (chunks[i].kind == kind) {
+            *count += chunks[i].count;
+        }
+    }
+    char* all = (char*)malloc((*count ? *count : 1) * size);
+    if (all == NULL) {
+        return NULL;
+    }
+    size_t at = 0;
+    for (size_t i = 0; i < chunk_count; i++) {
+        if (chunks[i].kind == kind && chunks[i].count > 0) {
+            memcpy(all + at * size, chunks[i].records, chunks[i].count * size);
+            at += chunks[i].count;
+        }
+    }
+    return all;
+}
+
+// Pool job: one of the independent index builds. Only BUILD_USERS touches
+// the context (and its epoch domain); the others work on private memory.
+static void load_build_task(void* jobs, size_t task) {
+    LoadBuild* build = (LoadBuild*)jobs;
+    PriorityContext* ctx = build->ctx;
+    if (task == BUILD_USERS) {
+        build->ok[task] = 1;
+        for (size_t i = 0; i < build->chunk_count; i++) {
+            const LoadChunk* chunk = &build->chunks[i];
+            for (size_t r = 0; chunk->kind == LOAD_USERS && r < chunk->count; r++) {
+                User* new_user = (User*)malloc(sizeof(User));
+                if (new_user == NULL) {
+                    build->ok[task] = 0;
+                    return;
+                }
+                *new_user = ((const User*)chunk->records)[r];
+                if (!user_index_insert(&ctx->user_index, new_user->user_id, new_user)) {
+                    free(new_user); // Duplicate id or username
+                    continue;
+                }
+                new_user->next = ctx->users_head;
+                ctx->users_head = new_user;
+            }
+        }
+    } else if (task == BUILD_POSTS) {
+        // Older files list posts newest first, so sort before appending
+        build->posts = (Post*)load_gather(build->chunks, build->chunk_count, LOAD_POSTS, &build->post_count);
+        if (build->posts != NULL) {
+            qsort(build->posts, build->post_count, sizeof(Post), compare_post_ids);
+        }
+        build->ok[task] = build->posts != NULL;
+    } else {
+        int which = task >= BUILD_FRIENDS; // 0: follows, 1: close friends
+        int outgoing = task == BUILD_FOLLOWING || task == BUILD_FRIENDS;
+        build->ok[task] = build->pairs[which] == NULL ||
+                          adjacency_build(&build->built[task - BUILD_FOLLOWING], build->pairs[which],
+                                          build->pair_count[which], build->pair_max_id[which], outgoing);
+    }
+}
+
+typedef struct LoadPool {
+    void (*run)(void* jobs, size_t i);
+    void* jobs;
+    size_t job_count;
+    size_t next; // Next job to hand out
+} LoadPool;
+
+static void* load_worker(void* arg) {
+    LoadPool* pool = (LoadPool*)arg;
+    size_t i;
+    while ((i = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED)) < pool->job_count) {
+        pool->run(pool->jobs, i);
+    }
+    return NULL;
+}
+
+// Runs every job on up to threads threads, the calling one included
+static void load_run(int threads, void (*run)(void*, size_t), void* jobs, size_t job_count) {
+    LoadPool pool = {run, jobs, job_count, 0};
+    pthread_t workers[LOAD_MAX_THREADS];
+    int started = 0;
+    for (int t = 1; t < threads && (size_t)t < job_count; t++) {
+        if (pthread_create(&workers[started], NULL, load_worker, &pool) == 0) {
+            started++;
+        }
+    }
+    load_worker(&pool);
+    for (int t = 0; t < started; t++) {
+        pthread_join(workers[t], NULL);
+    }
+}
+
+static int load_thread_count(const PriorityContext* ctx) {
+    long threads = ctx->load_threads > 0 ? ctx->load_threads : sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) {
+        return 1;
+    }
+    return threads > LOAD_MAX_THREADS ? LOAD_MAX_THREADS : (int)threads;
+}
+
+// Position just past the first '\n' at or after offset - 1
+static long load_record_end(FILE* file, long offset, long size) {
+    if (fseek(file, offset - 1, SEEK_SET) != 0) {
+        return size;
+    }
+    int c;
+    while ((c = getc(file)) != EOF && c != '\n') {
+    }
+    return c == EOF ? size : ftell(file);
+}
+
+// Cuts every file that exists into chunks; have[kind] says which exist
+static LoadChunk* load_plan(size_t* chunk_count, int* have, int* ok) {
+    LoadChunk* chunks = NULL;
+    size_t capacity = 0;
+    *chunk_count = 0;
+    for (int kind = 0; kind < LOAD_KINDS; kind++) {
+        FILE* file = fopen(load_files[kind], "r");
+        have[kind] = file != NULL;
+        if (file == NULL) {
+            continue;
+        }
+        DatReader probe;
+        dat_reader_open(&probe, file); // Reads the header line, if any
+        int escaped = probe.escaped, failed = probe.failed;
+        long start = escaped ? (long)probe.bytes : 0;
+        dat_reader_free(&probe);
+        long size = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+        if (size < 0 || failed) {
+            *ok = 0;
+            size = 0;
+        }
+        
+        while (start < size) {
+            long end = start + LOAD_CHUNK_BYTES < size ? load_record_end(file, start + LOAD_CHUNK_BYTES, size) : size;
+            if (*chunk_count == capacity) {
+                size_t new_capacity = capacity ? capacity * 2 : 16;
+                LoadChunk* grown = (LoadChunk*)realloc(chunks, new_capacity * sizeof(LoadChunk));
+                if (grown == NULL) {
+                    *ok = 0;
+                    break;
+                }
+                chunks = grown;
+                capacity = new_capacity;
+            }
+            LoadChunk* chunk = &chunks[(*chunk_count)++];
+            memset(chunk, 0, sizeof(*chunk));
+            chunk->kind = (LoadKind)kind;
+            chunk->start = start;
+            chunk->length = (size_t)(end - start);
+            chunk->escaped = escaped;
+            start = end;
+        }
+        fclose(file);
+    }
+    return chunks;
+}
+
+static void load_counters(PriorityContext* ctx) {
+    FILE* file = fopen("counters.dat", "r");
+    if (file == NULL) {
+        return;
+    }
+    DatReader reader;
+    dat_reader_open(&reader, file);
+    long long snapshot_lsn = 0; // Older files have no log position
+    if (!dat_reader_next(&reader) ||
+        !dat_field_int(&reader, 0, &ctx->next_user_id) || !dat_field_int(&reader, 1, &ctx->next_post_id) ||
+        !dat_field_int(&reader, 2, &ctx->next_message_id) || !dat_field_int(&reader, 3, &ctx->next_notif_id)) {
+        // If read fails, set defaults
+        ctx->next_user_id = 1;
+        ctx->next_post_id = 1;
+        ctx->next_message_id = 1;
+        ctx->next_notif_id = 1;
+    }
+    if (!dat_field_long(&reader, 4, &snapshot_lsn) || snapshot_lsn < 0) {
+        snapshot_lsn = 0;
+    }
+    ctx->wal.snapshot_lsn = (uint64_t)snapshot_lsn;
+    dat_reader_free(&reader);
+    fclose(file);
+}
+
+// Malformed records are skipped; returns 0 if memory ran out or a file
+// could not be read, so some records may be missing
+static int load_text_data(PriorityContext* ctx) {
+    int ok = 1;
+    int threads = load_thread_count(ctx);
+    load_counters(ctx);
+    
+    // Parse every chunk
+    int have[LOAD_KINDS];
+    size_t chunk_count = 0;
+    LoadChunk* chunks = load_plan(&chunk_count, have, &ok);
+    load_run(threads, load_parse_chunk, chunks, chunk_count);
+    
+    // Reserve the arena once, then move each chunk's strings in
+    size_t text_total = 0, names_total = 1;
+    for (size_t i = 0; i < chunk_count; i++) {
+        ok = ok && !chunks[i].failed;
+        text_total += chunks[i].text.used ? chunks[i].text.used - 1 : 0;
+        names_total += chunks[i].names.used ? chunks[i].names.used - 1 : 0;
+    }
+    LoadMerge merge = {ctx, chunks, (char*)malloc(names_total)};
+    size_t placed = chunk_count; // Chunks whose records are kept
+    if (merge.names == NULL || !arena_reserve(ctx, text_total)) {
+        ok = 0;
+        placed = 0; // Nowhere to put the strings; drop every record
+    } else {
+        size_t text_base = ctx->text_arena.used, names_base = 1;
+        for (size_t i = 0; i < chunk_count; i++) {
+            chunks[i].text_base = text_base;
+            chunks[i].names_base = names_base;
+            text_base += chunks[i].text.used ? chunks[i].text.used - 1 : 0;
+            names_base += chunks[i].names.used ? chunks[i].names.used - 1 : 0;
+        }
+        merge.names[0] = '\0';
+        load_run(threads, load_merge_chunk, &merge, chunk_count);
+        ctx->text_arena.used = text_base;
+    }
+    
+    // Independent index builds side by side
+    LoadBuild build;
+    memset(&build, 0, sizeof(build));
+    build.ctx = ctx;
+    build.chunks = chunks;
+    build.chunk_count = placed;
+    for (int which = 0; which < 2; which++) {
+        LoadKind kind = which ? LOAD_CLOSE_FRIENDS : LOAD_FOLLOWS;
+        if (have[kind]) {
+            build.pairs[which] = (Follow*)load_gather(chunks, placed, kind, &build.pair_count[which]);
+            ok = ok && build.pairs[which] != NULL;
+            build.pair_max_id[which] = edges_max_id(build.pairs[which], build.pairs[which] ? build.pair_count[which] : 0);
+        }
+    }
+    load_run(threads, load_build_task, &build, BUILD_TASKS);
+    for (int task = 0; task < BUILD_TASKS; task++) {
+        ok = ok && build.ok[task];
+    }
+    
+    // Publish the graph and close friends index built from files that exist
+    for (int which = 0; which < 2; which++) {
+        Adjacency* forward = &build.built[2 * which];
+        Adjacency* reverse = &build.built[2 * which + 1];
+        if (build.pairs[which] != NULL && build.ok[BUILD_FOLLOWING + 2 * which] &&
+            build.ok[BUILD_FOLLOWERS + 2 * which]) {
+            if (which == 0) {
+                follow_graph_install(&ctx->follow_graph, forward, reverse);
+            } else {
+                close_friends_install(&ctx->close_friends, forward, reverse);
+            }
+        } else {
+            adjacency_free(forward);
+            adjacency_free(reverse);
+        }
+        free(build.pairs[which]);
+    }
+    
+    // Posts: share the author's username instead of storing another copy
+    for (size_t i = 0; build.posts != NULL && i < build.post_count; i++) {
+        Post* post = &build.posts[i];
+        User* author = find_user_by_id(ctx, post->author_id);
+        post->author_name = author ? author->username : arena_intern(ctx, merge.names + post->author_name);
+        if (post->post_id > 0 && post_store_find(&ctx->post_store, post->post_id) == NULL &&
+            post_store_append(&ctx->post_store, post) == NULL) {
+            ok = 0;
+            break;
+        }
+    }
+    free(build.posts);
+    
+    // Never hand out an id below a stored one, even without counters.dat
+    if (ctx->post_store.post_count > 0) {
+        Post* newest = post_store_at(&ctx->post_store, ctx->post_store.post_count - 1);
+        if (ctx->next_post_id <= newest->post_id) {
+            ctx->next_post_id = newest->post_id + 1;
+        }
+    }
+    
+    // Messages are listed newest first, as loaded one by one
+    size_t notification_count = 0;
+    for (size_t i = 0; i < placed; i++) {
+        const LoadChunk* chunk = &chunks[i];
+        for (size_t r = 0; ok && chunk->kind == LOAD_MESSAGES && r < chunk->count; r++) {
+            Message* new_message = (Message*)slab_alloc(&ctx->message_slab);
+            if (new_message == NULL) {
+                ok = 0;
+                break;
+            }
+            *new_message = ((const Message*)chunk->records)[r];
+            User* sender = find_user_by_id(ctx, new_message->sender_id);
+            new_message->sender_name = sender ? sender->username
+                                              : arena_intern(ctx, merge.names + new_message->sender_name);
+            new_message->next = ctx->messages_head;
+            ctx->messages_head = new_message;
+        }
+        notification_count += chunk->kind == LOAD_NOTIFICATIONS ? chunk->count : 0;
+    }
+    
+    // notifications.dat is newest first, so walking it backwards appends
+    // every notification at the end of its lane
+    ok = ok && notification_slots_reserve(&ctx->notifications, notification_count);
+    for (size_t i = placed; ok && i-- > 0;) {
+        const LoadChunk* chunk = &chunks[i];
+        for (size_t r = chunk->kind == LOAD_NOTIFICATIONS ? chunk->count : 0; ok && r-- > 0;) {
+            Notification* new_notif = (Notification*)slab_alloc(&ctx->notification_slab);
+            if (new_notif == NULL) {
+                ok = 0;
+                break;
+            }
+            *new_notif = ((const Notification*)chunk->records)[r];
+            if (notification_store_place(ctx, new_notif) == 0) {
+                slab_free(&ctx->notification_slab, new_notif);
+                ok = 0;
+            }
+        }
+    }
+    
+    for (size_t i = 0; i < chunk_count; i++) {
+        free(chunks[i].records);
+        free(chunks[i].text.data);
+        free(chunks[i].names.data);
+    }
+    free(chunks);
+    free(merge.names);
+    
+    // Timelines are built on first read
+    timeline_record_authors(ctx);
+    return ok ? 1 : priority_fail(ctx, "Memory allocation failed!");
+}
+
+// Loads the binary snapshot when there is one, else the .dat files
+int load_data(PriorityContext* ctx) {
+    int ok = access(SNAPSHOT_PATH, F_OK) == 0 ? snapshot_load(ctx, SNAPSHOT_PATH) : load_text_data(ctx);
+    if (!conversation_store_build(&ctx->conversations, ctx->messages_head) ||
+        !inbox_store_build(&ctx->inboxes, ctx->messages_head) || !notification_store_build(ctx)) {
+        return priority_fail(ctx, "Memory allocation failed!");
+    }
+    return ok;
+}
+
+// Free every record and reset the engine to an empty state
+// No reader may be inside a read section
+void cleanup_data(PriorityContext* ctx) {
+    fanout_stop(ctx);
+    wal_close(ctx);
+    memset(&ctx->wal, 0, sizeof(ctx->wal));
+    ctx->wal.fd = -1;
+    epoch_free(&ctx->epoch); // Blocks retired by earlier writes
+    user_index_free(&ctx->user_index);
+    SnapshotMap* snapshot = &ctx->snapshot;
+    while (ctx->users_head != NULL) {
+        User* next = ctx->users_head->next;
+        if (!node_in_block(snapshot->users, snapshot->user_count, sizeof(User), ctx->users_head)) {
+            free(ctx->users_head);
+        }
+        ctx->users_head = next;
+    }
+    post_store_free(&ctx->post_store);
+    ctx->messages_head = NULL;
+    conversation_store_free(&ctx->conversations);
+    inbox_store_free(&ctx->inboxes);
+    slab_release(&ctx->message_slab);
+    follow_graph_free(&ctx->follow_graph);
+    close_friends_free(&ctx->close_friends);
+    timeline_store_free(&ctx->timelines);
+    notification_store_free(&ctx->notifications);
+    slab_release(&ctx->notification_slab);
+    
+    if (!ctx->text_arena.borrowed) {
+        free(ctx->text_arena.data);
+    }
+    memset(&ctx->text_arena, 0, sizeof(ctx->text_arena));
+    
+    // Everything that pointed into the mapping is gone
+    free(snapshot->users);
+    free(snapshot->messages);
+    free(snapshot->notifications);
+    if (snapshot->base != NULL) {
+        munmap(snapshot->base, snapshot->size);
+    }
+    memset(snapshot, 0, sizeof(*snapshot));
+    
+    ctx->current_user = NULL;
+    ctx->next_user_id = 1;
+    ctx->next_post_id = 1;
+    ctx->next_message_id = 1;
+    ctx->next_notif_id = 1;
+}
+
+// =============================================================================
+// SOURCE FILE: snapshot.c
+// Binary Snapshot Module - One file that is mapped instead of parsed
+// =============================================================================
+
+// Layout: a header with a section table, then the sections, each starting on
+// a 64-byte boundary. Post chunks, ids and rows are stored in the engine's
+// own layout, so snapshot_load points the engine at the mapping and only
+// the pages a request touches are ever read. The string heap goes last and
+// the mapping continues past it with anonymous memory, so new strings are
+// appended right after the old ones without copying the heap.
+// The format is native: the header records the byte order and the record
+// sizes, and a file written by a different build is refused.
+
+#define SNAPSHOT_MAGIC "PRIOSNAP"
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+#define SNAPSHOT_ALIGN 64
+
+typedef enum {
+    SNAP_USERS = 0,
+    SNAP_POSTS, // PostChunks as stored
+    SNAP_POST_INDEX, // PostStore.by_id
+    SNAP_AUTHOR_INDEX, // author_id -> offset into SNAP_AUTHOR_POSTS, one extra at the end
+    SNAP_AUTHOR_POSTS,
+    SNAP_MESSAGES,
+    SNAP_NOTIFICATIONS,
+    SNAP_FOLLOWING_INDEX, // Row offsets as in SNAP_AUTHOR_INDEX
+    SNAP_FOLLOWING_IDS,
+    SNAP_FOLLOWERS_INDEX,
+    SNAP_FOLLOWERS_IDS,
+    SNAP_FRIENDS_INDEX,
+    SNAP_FRIENDS_IDS,
+    SNAP_FRIEND_OF_INDEX,
+    SNAP_FRIEND_OF_IDS,
+    SNAP_STRINGS, // The arena; always last, ends at end of file
+    SNAP_SECTION_COUNT
+} SnapshotSectionId;
+
+typedef struct SnapshotSection {
+    uint64_t offset;
+    uint64_t count;
+    uint32_t record_size;
+    uint32_t reserved;
+} SnapshotSection;
+
+typedef struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t header_size;
+    uint32_t header_crc; // crc32 of the header with this field zeroed
+    uint64_t lsn; // Last log record the snapshot holds
+    int32_t next_ids[4]; // User, post, message, notification
+    uint64_t post_count;
+    SnapshotSection sections[SNAP_SECTION_COUNT];
+} SnapshotHeader;
+
+// Nodes are stored without their list pointers
+typedef struct SnapUser {
+    int32_t user_id;
+    StrRef username;
+    StrRef password;
+    uint32_t reserved;
+    int64_t created_at;
+} SnapUser;
+
+typedef struct SnapMessage {
+    int32_t message_id;
+    int32_t sender_id;
+    int32_t receiver_id;
+    StrRef sender_name;
+    StrRef content;
+    int32_t flags; // SNAP_MESSAGE_PRIORITY | SNAP_MESSAGE_READ
+    int64_t timestamp;
+} SnapMessage;
+
+#define SNAP_MESSAGE_PRIORITY 1
+#define SNAP_MESSAGE_READ 2 // Clear in snapshots written before the inbox
+
+typedef struct SnapNotification {
+    int32_t notif_id;
+    int32_t user_id;
+    StrRef content;
+    int32_t priority;
+    int32_t is_read;
+    uint32_t type; // NOTIFY_TEXT (0) in snapshots written before templates
+    int64_t timestamp;
+    int32_t actor_id; // Not in those snapshots, which end the record here
+    int32_t object_id;
+    int32_t others;
+    int32_t span; // 0 in snapshots written before merge windows were kept
+} SnapNotification;
+
+#define SNAP_NOTIFICATION_TEXT_SIZE offsetof(SnapNotification, actor_id)
+
+static const uint32_t snapshot_record_sizes[SNAP_SECTION_COUNT] = {
+    sizeof(SnapUser), sizeof(PostChunk), sizeof(uint32_t), sizeof(uint64_t), sizeof(int),
+    sizeof(SnapMessage), sizeof(SnapNotification),
+    sizeof(uint64_t), sizeof(int), sizeof(uint64_t), sizeof(int),
+    sizeof(uint64_t), sizeof(int), sizeof(uint64_t), sizeof(int),
+    1
+};
+
+typedef struct SnapshotWriter {
+    FILE* file;
+    uint64_t pos;
+} SnapshotWriter;
+
+static void snapshot_write(SnapshotWriter* w, const void* data, size_t len) {
+    if (len > 0 && fwrite(data, 1, len, w->file) != len) {
+        return; // ferror is checked when the file is committed
+    }
+    w->pos += len;
+}
+
+// Pads with zeros up to where the next section starts
+static void snapshot_seek(SnapshotWriter* w, uint64_t offset) {
+    static const char zeros[SNAPSHOT_ALIGN];
+    while (w->pos < offset) {
+        uint64_t gap = offset - w->pos;
+        snapshot_write(w, zeros, gap < sizeof(zeros) ? (size_t)gap : sizeof(zeros));
+    }
+}
+
+static size_t adjacency_edge_total(const Adjacency* adj) {
+    size_t total = 0;
+    for (int id = 0; id < adjacency_capacity(adj); id++) {
+        const EdgeRow* row = adjacency_row(adj, id);
+        total += row ? (size_t)row->degree : 0;
+    }
+    return total;
+}
+
+static void snapshot_write_row_index(SnapshotWriter* w, const Adjacency* adj) {
+    uint64_t offset = 0;
+    for (int id = 0; id < adjacency_capacity(adj); id++) {
+        const EdgeRow* row = adjacency_row(adj, id);
+        snapshot_write(w, &offset, sizeof(offset));
+        offset += row ? (uint64_t)row->degree : 0;
+    }
+    snapshot_write(w, &offset, sizeof(offset));
+}
+
+// Rows are written merged, so a loaded row has an empty delta
+static void snapshot_write_row_ids(SnapshotWriter* w, const Adjacency* adj) {
+    for (int id = 0; id < adjacency_capacity(adj); id++) {
+        EdgeIter iter = {adjacency_row(adj, id), 0, 0, 0};
+        int other;
+        while (edge_iter_next(&iter, &other)) {
+            snapshot_write(w, &other, sizeof(other));
+        }
+    }
+}
+
+// Writes the binary snapshot: a CRC-checked header with the next ids, the
+// log position covered and a table of sections, then each section as
+// fixed-size records at a SNAPSHOT_ALIGN boundary (users, post chunks and
+// indexes, messages, notifications, the four adjacency row indexes and ids),
+// and last the string heap every StrRef points into. It goes to path.tmp,
+// which snapshot_commit syncs and renames over path. Returns 0 if anything
+// could not be written.
+int snapshot_save(const PriorityContext* ctx, const char* path) {
+    const PostStore* store = &ctx->post_store;
+    const Adjacency* adjacencies[4] = {
+        &ctx->follow_graph.out, &ctx->follow_graph.in,
+        &ctx->close_friends.friends, &ctx->close_friends.friend_of
+    };
+    
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.header_size = sizeof(header);
+    header.lsn = ctx->wal.next_lsn ? ctx->wal.next_lsn - 1 : ctx->wal.snapshot_lsn;
+    header.next_ids[0] = ctx->next_user_id;
+    header.next_ids[1] = ctx->next_post_id;
+    header.next_ids[2] = ctx->next_message_id;
+    header.next_ids[3] = ctx->next_notif_id;
+    header.post_count = store->post_count;
+    
+    SnapshotSection* sections = header.sections;
+    for (User* user = ctx->users_head; user != NULL; user = user->next) {
+        sections[SNAP_USERS].count++;
+    }
+    sections[SNAP_POSTS].count = store->chunk_count;
+    sections[SNAP_POST_INDEX].count = store->id_capacity;
+    sections[SNAP_AUTHOR_INDEX].count = store->author_capacity + 1;
+    for (int id = 0; id < store->author_capacity; id++) {
+        sections[SNAP_AUTHOR_POSTS].count += store->authors[id].count;
+    }
+    for (Message* message = ctx->messages_head; message != NULL; message = message->next) {
+        sections[SNAP_MESSAGES].count++;
+    }
+    sections[SNAP_NOTIFICATIONS].count = ctx->notifications.count;
+    for (int i = 0; i < 4; i++) {
+        sections[SNAP_FOLLOWING_INDEX + 2 * i].count = adjacency_capacity(adjacencies[i]) + 1;
+        sections[SNAP_FOLLOWING_IDS + 2 * i].count = adjacency_edge_total(adjacencies[i]);
+    }
+    // Offset 0 must stay the empty string, even for an empty arena
+    const char* heap = ctx->text_arena.data ? ctx->text_arena.data : "";
+    sections[SNAP_STRINGS].count = ctx->text_arena.data ? ctx->text_arena.used : 1;
+    
+    uint64_t offset = sizeof(header);
+    for (int i = 0; i < SNAP_SECTION_COUNT; i++) {
+        offset = (offset + SNAPSHOT_ALIGN - 1) & ~(uint64_t)(SNAPSHOT_ALIGN - 1);
+        sections[i].offset = offset;
+        sections[i].record_size = snapshot_record_sizes[i];
+        offset += sections[i].count * sections[i].record_size;
+    }
+    header.header_crc = wal_crc32((const unsigned char*)&header, sizeof(header));
+    
+    char temp_path[PATH_MAX];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    SnapshotWriter w = {fopen(temp_path, "wb"), 0};
+    if (w.file == NULL) {
+        return 0;
+    }
+    snapshot_write(&w, &header, sizeof(header));
+    
+    snapshot_seek(&w, sections[SNAP_USERS].offset);
+    for (User* user = ctx->users_head; user != NULL; user = user->next) {
+        SnapUser record = {user->user_id, user->username, user->password, 0, user->created_at};
+        snapshot_write(&w, &record, sizeof(record));
+    }
+    
+    snapshot_seek(&w, sections[SNAP_POSTS].offset);
+    for (int i = 0; i < store->chunk_count; i++) {
+        snapshot_write(&w, store->chunks[i], sizeof(PostChunk));
+    }
+    snapshot_seek(&w, sections[SNAP_POST_INDEX].offset);
+    snapshot_write(&w, store->by_id, store->id_capacity * sizeof(uint32_t));
+    snapshot_seek(&w, sections[SNAP_AUTHOR_INDEX].offset);
+    uint64_t author_offset = 0;
+    for (int id = 0; id <= store->author_capacity; id++) {
+        snapshot_write(&w, &author_offset, sizeof(author_offset));
+        author_offset += id < store->author_capacity ? (uint64_t)store->authors[id].count : 0;
+    }
+    snapshot_seek(&w, sections[SNAP_AUTHOR_POSTS].offset);
+    for (int id = 0; id < store->author_capacity; id++) {
+        snapshot_write(&w, store->authors[id].post_ids, store->authors[id].count * sizeof(int));
+    }
+    
+    snapshot_seek(&w, sections[SNAP_MESSAGES].offset);
+    for (Message* m = ctx->messages_head; m != NULL; m = m->next) {
+        SnapMessage record = {m->message_id, m->sender_id, m->receiver_id, m->sender_name,
+                              m->content,
+                              (m->priority ? SNAP_MESSAGE_PRIORITY : 0) | (m->is_read ? SNAP_MESSAGE_READ : 0),
+                              m->timestamp};
+        snapshot_write(&w, &record, sizeof(record));
+    }
+    // Box by box, each lane oldest first, so loading appends every one to its lane
+    snapshot_seek(&w, sections[SNAP_NOTIFICATIONS].offset);
+    for (int id = 0; id < ctx->notifications.capacity; id++) {
+        for (int lane = 0; lane < 2; lane++) {
+            const NotificationLane* l = &ctx->notifications.boxes[id].lanes[lane];
+            for (int i = 0; i < l->count; i++) {
+                const Notification* n = l->items[i];
+                SnapNotification record = {n->notif_id, n->user_id, n->content, n->priority, n->is_read,
+                                           n->type, n->timestamp, n->actor_id, n->object_id, n->others, n->span};
+                snapshot_write(&w, &record, sizeof(record));
+            }
+        }
+    }
+    
+    for (int i = 0; i < 4; i++) {
+        snapshot_seek(&w, sections[SNAP_FOLLOWING_INDEX + 2 * i].offset);
+        snapshot_write_row_index(&w, adjacencies[i]);
+        snapshot_seek(&w, sections[SNAP_FOLLOWING_IDS + 2 * i].offset);
+        snapshot_write_row_ids(&w, adjacencies[i]);
+    }
+    
+    snapshot_seek(&w, sections[SNAP_STRINGS].offset);
+    snapshot_write(&w, heap, sections[SNAP_STRINGS].count);
+    
+    return w.pos == offset && snapshot_commit(w.file, temp_path, path);
+}
+
+// Checks the header against this build and the file it came from
+static int snapshot_check_header(SnapshotHeader* header, uint64_t file_size) {
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SNAPSHOT_VERSION || header->byte_order != SNAPSHOT_BYTE_ORDER ||
+        header->header_size != sizeof(*header) || header->post_count > UINT32_MAX) {
+        return 0;
+    }
+    uint32_t crc = header->header_crc;
+    header->header_crc = 0;
+    if (wal_crc32((const unsigned char*)header, sizeof(*header)) != crc) {
+        return 0;
+    }
+    header->header_crc = crc;
+    
+    for (int i = 0; i < SNAP_SECTION_COUNT; i++) {
+        const SnapshotSection* section = &header->sections[i];
+        int older_notifications = i == SNAP_NOTIFICATIONS && section->record_size == SNAP_NOTIFICATION_TEXT_SIZE;
+        if ((section->record_size != snapshot_record_sizes[i] && !older_notifications) ||
+            section->offset % SNAPSHOT_ALIGN != 0 ||
+            section->offset < sizeof(*header) || section->offset > file_size ||
+            section->count > (file_size - section->offset) / section->record_size) {
+            return 0;
+        }
+    }
+    
+    // Counts that become ints, and a heap that ends the file
+    const SnapshotSection* strings = &header->sections[SNAP_STRINGS];
+    if (header->sections[SNAP_POSTS].count > INT_MAX || header->sections[SNAP_POST_INDEX].count > INT_MAX ||
+        header->sections[SNAP_AUTHOR_INDEX].count < 1 || header->sections[SNAP_AUTHOR_INDEX].count > INT_MAX ||
+        strings->count < 1 || strings->count > UINT32_MAX || strings->offset + strings->count != file_size) {
+        return 0;
+    }
+    for (int i = SNAP_FOLLOWING_INDEX; i < SNAP_STRINGS; i += 2) {
+        if (header->sections[i].count < 1 || header->sections[i].count > INT_MAX) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Row offsets must start at 0, never go down and end at the id count
+static int snapshot_check_index(const uint64_t* offsets, uint64_t count, uint64_t id_count) {
+    if (offsets[0] != 0 || offsets[count - 1] != id_count) {
+        return 0;
+    }
+    for (uint64_t i = 1; i < count; i++) {
+        if (offsets[i] < offsets[i - 1] || offsets[i] - offsets[i - 1] > INT_MAX) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int snapshot_check_posts(const PostChunk* chunks, uint64_t chunk_count, uint64_t post_count,
+                                const uint32_t* by_id, uint64_t id_capacity) {
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < chunk_count; i++) {
+        // Every chunk but the last is full, as post_store_at expects
+        if (chunks[i].count < 0 || chunks[i].count > POST_CHUNK_SIZE ||
+            (i + 1 < chunk_count && chunks[i].count != POST_CHUNK_SIZE)) {
+            return 0;
+        }
+        total += chunks[i].count;
+    }
+    if (total != post_count) {
+        return 0;
+    }
+    for (uint64_t id = 0; id < id_capacity; id++) {
+        if (by_id[id] > post_count) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+#define SNAPSHOT_AT(base, header, id) ((void*)((base) + (header).sections[id].offset))
+
+// Loads the snapshot at path into an empty engine by mapping it. Strings
+// are checked for the rebuilt nodes only; post records are used unchecked,
+// so the file must have been written by snapshot_save.
+int snapshot_load(PriorityContext* ctx, const char* path) {
+    if (ctx->snapshot.base != NULL || ctx->users_head != NULL || ctx->post_store.post_count > 0 ||
+        ctx->messages_head != NULL || ctx->notifications.count > 0 || ctx->text_arena.data != NULL) {
+        return priority_fail(ctx, "A snapshot can only be loaded into an empty engine!");
+    }
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return priority_fail(ctx, "Could not open the snapshot!");
+    }
+    struct stat st;
+    SnapshotHeader header;
+    if (fstat(fd, &st) < 0 || (uint64_t)st.st_size < sizeof(header) ||
+        pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        !snapshot_check_header(&header, (uint64_t)st.st_size)) {
+        close(fd);
+        return priority_fail(ctx, "The snapshot is damaged or from another build!");
+    }
+    
+    // Reserve room for the heap to grow in place, then map the file over the
+    // start of it. Untouched headroom costs address space only.
+    size_t file_size = (size_t)st.st_size;
+    size_t heap_size = (size_t)header.sections[SNAP_STRINGS].count;
+    size_t headroom = heap_size / 4 > SNAPSHOT_ARENA_HEADROOM ? heap_size / 4 : SNAPSHOT_ARENA_HEADROOM;
+    char* base = (char*)mmap(NULL, file_size + headroom, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return priority_fail(ctx, "Could not map the snapshot!");
+    }
+    if (mmap(base, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, file_size + headroom);
+        close(fd);
+        return priority_fail(ctx, "Could not map the snapshot!");
+    }
+    close(fd);
+    SnapshotMap* snapshot = &ctx->snapshot;
+    snapshot->base = base;
+    snapshot->size = file_size + headroom;
+    
+    const SnapshotSection* sections = header.sections;
+    const uint64_t* author_index = (const uint64_t*)SNAPSHOT_AT(base, header, SNAP_AUTHOR_INDEX);
+    int valid = snapshot_check_posts((const PostChunk*)SNAPSHOT_AT(base, header, SNAP_POSTS),
+                                     sections[SNAP_POSTS].count, header.post_count,
+                                     (const uint32_t*)SNAPSHOT_AT(base, header, SNAP_POST_INDEX),
+                                     sections[SNAP_POST_INDEX].count) &&
+                snapshot_check_index(author_index, sections[SNAP_AUTHOR_INDEX].count,
+                                     sections[SNAP_AUTHOR_POSTS].count);
+    for (int i = SNAP_FOLLOWING_INDEX; valid && i < SNAP_STRINGS; i += 2) {
+        valid = snapshot_check_index((const uint64_t*)SNAPSHOT_AT(base, header, i),
+                                     sections[i].count, sections[i + 1].count);
+    }
+    if (!valid) {
+        cleanup_data(ctx);
+        return priority_fail(ctx, "The snapshot is damaged or from another build!");
+    }
+    
+    // The arena is the mapped heap plus the headroom after it
+    StringArena* arena = &ctx->text_arena;
+    size_t arena_room = snapshot->size - (size_t)sections[SNAP_STRINGS].offset;
+    arena->data = base + sections[SNAP_STRINGS].offset;
+    arena->used = heap_size;
+    arena->capacity = arena_room < UINT32_MAX ? arena_room : UINT32_MAX;
+    arena->borrowed = 1;
+    const char* error = NULL;
+    
+    // Users, messages and notifications become one block each, linked in
+    // their saved order
+    const SnapUser* users = (const SnapUser*)SNAPSHOT_AT(base, header, SNAP_USERS);
+    snapshot->user_count = (size_t)sections[SNAP_USERS].count;
+    snapshot->users = (User*)malloc((snapshot->user_count ? snapshot->user_count : 1) * sizeof(User));
+    for (size_t i = 0; snapshot->users != NULL && i < snapshot->user_count; i++) {
+        User* user = &snapshot->users[i];
+        if (users[i].username >= heap_size || users[i].password >= heap_size) {
+            error = "The snapshot is damaged or from another build!";
+            break;
+        }
+        user->user_id = users[i].user_id;
+        user->username = users[i].username;
+        user->password = users[i].password;
+        user->created_at = (time_t)users[i].created_at;
+        if (!user_index_insert(&ctx->user_index, user->user_id, user)) {
+            error = "The snapshot lists a user twice!";
+            break;
+        }
+        user->next = NULL;
+        if (i > 0) {
+            snapshot->users[i - 1].next = user;
+        } else {
+            ctx->users_head = user;
+        }
+    }
+    
+    const SnapMessage* messages = (const SnapMessage*)SNAPSHOT_AT(base, header, SNAP_MESSAGES);
+    snapshot->message_count = (size_t)sections[SNAP_MESSAGES].count;
+    snapshot->messages = (Message*)malloc((snapshot->message_count ? snapshot->message_count : 1) * sizeof(Message));
+    for (size_t i = 0; error == NULL && snapshot->messages != NULL && i < snapshot->message_count; i++) {
+        Message* message = &snapshot->messages[i];
+        if (messages[i].sender_name >= heap_size || messages[i].content >= heap_size) {
+            error = "The snapshot is damaged or from another build!";
+            break;
+        }
+        message->message_id = messages[i].message_id;
+        message->sender_id = messages[i].sender_id;
+        message->receiver_id = messages[i].receiver_id;
+        message->sender_name = messages[i].sender_name;
+        message->content = messages[i].content;
+        message->priority = (messages[i].flags & SNAP_MESSAGE_PRIORITY) != 0;
+        message->is_read = (messages[i].flags & SNAP_MESSAGE_READ) != 0;
+        message->timestamp = (time_t)messages[i].timestamp;
+        message->next = i + 1 < snapshot->message_count ? message + 1 : NULL;
+    }
+    if (snapshot->message_count > 0 && error == NULL) {
+        ctx->messages_head = snapshot->messages;
+    }
+    
+    // Records are read by their stored size, which may be the older, shorter one
+    const char* notifs = (const char*)SNAPSHOT_AT(base, header, SNAP_NOTIFICATIONS);
+    size_t notif_size = sections[SNAP_NOTIFICATIONS].record_size;
+    snapshot->notification_count = (size_t)sections[SNAP_NOTIFICATIONS].count;
+    snapshot->notifications = (Notification*)malloc(
+        (snapshot->notification_count ? snapshot->notification_count : 1) * sizeof(Notification));
+    if (!notification_slots_reserve(&ctx->notifications, snapshot->notification_count)) {
+        error = "Memory allocation failed!";
+    }
+    for (size_t i = 0; error == NULL && snapshot->notifications != NULL && i < snapshot->notification_count; i++) {
+        Notification* notif = &snapshot->notifications[i];
+        SnapNotification record;
+        memset(&record, 0, sizeof(record));
+        memcpy(&record, notifs + i * notif_size, notif_size);
+        if (record.content >= heap_size || record.type >= NOTIFY_TYPE_COUNT) {
+            error = "The snapshot is damaged or from another build!";
+            break;
+        }
+        notif->notif_id = record.notif_id;
+        notif->user_id = record.user_id;
+        notif->actor_id = record.actor_id;
+        notif->object_id = record.object_id;
+        notif->others = record.others;
+        notif->span = record.span;
+        notif->content = record.content;
+        notif->type = (unsigned char)record.type;
+        notif->priority = record.priority ? 1 : 0;
+        notif->is_read = record.is_read ? 1 : 0;
+        notif->timestamp = (time_t)record.timestamp;
+        if (notification_store_place(ctx, notif) == 0) {
+            error = "Memory allocation failed!";
+        }
+    }
+    
+    // Posts stay where they are; only the chunk and author tables are new
+    PostStore* store = &ctx->post_store;
+    int chunk_count = (int)sections[SNAP_POSTS].count;
+    int author_capacity = (int)sections[SNAP_AUTHOR_INDEX].count - 1;
+    store->chunks = (PostChunk**)malloc((chunk_count ? chunk_count : 1) * sizeof(PostChunk*));
+    store->authors = (AuthorPosts*)calloc(author_capacity ? author_capacity : 1, sizeof(AuthorPosts));
+    if (store->chunks != NULL && store->authors != NULL) {
+        PostChunk* chunks = (PostChunk*)SNAPSHOT_AT(base, header, SNAP_POSTS);
+        for (int i = 0; i < chunk_count; i++) {
+            store->chunks[i] = &chunks[i];
+        }
+        store->chunk_count = store->chunk_capacity = store->mapped_chunks = chunk_count;
+        store->post_count = (size_t)header.post_count;
+        store->by_id = (uint32_t*)SNAPSHOT_AT(base, header, SNAP_POST_INDEX);
+        store->id_capacity = (int)sections[SNAP_POST_INDEX].count;
+        store->by_id_borrowed = 1;
+        
+        int* author_posts = (int*)SNAPSHOT_AT(base, header, SNAP_AUTHOR_POSTS);
+        for (int id = 0; id < author_capacity; id++) {
+            AuthorPosts* list = &store->authors[id];
+            list->count = (int)(author_index[id + 1] - author_index[id]);
+            list->post_ids = list->count ? author_posts + author_index[id] : NULL;
+        }
+        store->author_capacity = author_capacity;
+    }
+    
+    // Rows are used in place, as if they came from a CSR build
+    Adjacency* adjacencies[4] = {
+        &ctx->follow_graph.out, &ctx->follow_graph.in,
+        &ctx->close_friends.friends, &ctx->close_friends.friend_of
+    };
+    int attached = 1;
+    for (int i = 0; i < 4; i++) {
+        int index_id = SNAP_FOLLOWING_INDEX + 2 * i;
+        attached = attached && adjacency_attach(adjacencies[i],
+                                                (const uint64_t*)SNAPSHOT_AT(base, header, index_id),
+                                                (const int*)SNAPSHOT_AT(base, header, index_id + 1),
+                                                (int)sections[index_id].count - 1);
+    }
+    ctx->follow_graph.edge_count = (size_t)sections[SNAP_FOLLOWING_IDS].count;
+    ctx->follow_graph.changes = 0;
+    ctx->close_friends.pair_count = (size_t)sections[SNAP_FRIENDS_IDS].count;
+    
+    if (error == NULL && (snapshot->users == NULL || snapshot->messages == NULL ||
+                          snapshot->notifications == NULL || store->chunks == NULL ||
+                          store->authors == NULL || !attached)) {
+        error = "Memory allocation failed!";
+    }
+    if (error != NULL) {
+        cleanup_data(ctx);
+        return priority_fail(ctx, error);
+    }
+    
+    ctx->next_user_id = header.next_ids[0];
+    ctx->next_post_id = header.next_ids[1];
+    ctx->next_message_id = header.next_ids[2];
+    ctx->next_notif_id = header.next_ids[3];
+    ctx->wal.snapshot_lsn = header.lsn;
+    timeline_record_authors(ctx);
+    return 1;
+}
+
+// =============================================================================
+// SOURCE FILE: wal_replay.c
+// Write-Ahead Log Module - Replay, snapshots and shutdown (see wal.c)
+// =============================================================================
+
+typedef struct WalReader {
+    const unsigned char* data;
+    size_t left;
+    int ok;
+} WalReader;
+
+static uint64_t wal_get_bytes(WalReader* r, int count) {
+    uint64_t value = 0;
+    if (r->left < (size_t)count) {
+        r->ok = 0;
+        return 0;
+    }
+    for (int i = 0; i < count; i++) {
+        value |= (uint64_t)r->data[i] << (8 * i);
+    }
+    r->data += count;
+    r->left -= (size_t)count;
+    return value;
+}
+
+static int wal_get_int(WalReader* r) {
+    return (int)(uint32_t)wal_get_bytes(r, 4);
+}
+
+static time_t wal_get_time(WalReader* r) {
+    return (time_t)(int64_t)wal_get_bytes(r, 8);
+}
+
+// Strings are stored NUL-terminated, so they are used in place
+static const char* wal_get_str(WalReader* r) {
+    size_t len = (size_t)wal_get_bytes(r, 4);
+    if (!r->ok || r->left < len + 1 || r->data[len] != '\0') {
+        r->ok = 0;
+        return "";
+    }
+    const char* text = (const char*)r->data;
+    r->data += len + 1;
+    r->left -= len + 1;
+    return text;
+}
+
+static void wal_bump(int* next_id, int id) {
+    if (*next_id <= id) {
+        *next_id = id + 1;
+    }
+}
+
+// Applies one record on top of the loaded snapshot. Every record is
+// idempotent (ids already present are skipped, edge changes are set
+// operations), so replaying a record the snapshot already holds is harmless.
+// Returns 0 if the record is malformed or memory ran out.
+static int wal_apply(PriorityContext* ctx, int type, WalReader* r, int* max_message_id, int* max_notif_id) {
+    switch (type) {
+        case WAL_USER: {
+            int user_id = wal_get_int(r);
+            time_t created_at = wal_get_time(r);
+            const char* username = wal_get_str(r);
+            const char* password = wal_get_str(r);
+            if (!r->ok || find_user_by_id(ctx, user_id) != NULL) {
+                return r->ok;
+            }
+            User* user = (User*)malloc(sizeof(User));
+            if (user == NULL) {
+                return 0;
+            }
+            user->user_id = user_id;
+            user->username = arena_intern(ctx, username);
+            user->password = arena_intern(ctx, password);
+            user->created_at = created_at;
+            if (!user_index_insert(&ctx->user_index, user_id, user)) {
+                free(user); // Duplicate username
+                return 1;
+            }
+            user->next = ctx->users_head;
+            EPOCH_PUBLISH(&ctx->users_head, user);
+            wal_bump(&ctx->next_user_id, user_id);
+            return 1;
+        }
+        case WAL_POST: {
+            Post post;
+            post.post_id = wal_get_int(r);
+            post.author_id = wal_get_int(r);
+            post.created_at = wal_get_time(r);
+            post.priority = wal_get_int(r);
+            int media_type = wal_get_int(r);
+            const char* content = wal_get_str(r);
+            const char* media_path = wal_get_str(r);
+            const char* media_description = wal_get_str(r);
+            if (!r->ok || post_store_find(&ctx->post_store, post.post_id) != NULL) {
+                return r->ok;
+            }
+            User* author = find_user_by_id(ctx, post.author_id);
+            post.author_name = author ? author->username : 0;
+            post.media_type = media_type >= MEDIA_NONE && media_type <= MEDIA_AUDIO ?
+                              (MediaType)media_type : MEDIA_NONE;
+            post.content = arena_intern(ctx, content);
+            post.media_path = arena_intern(ctx, media_path);
+            post.media_description = arena_intern(ctx, media_description);
+            Post* stored = post_store_append(&ctx->post_store, &post);
+            if (stored == NULL) {
+                return 0;
+            }
+            timeline_record_post(ctx, stored);
+            wal_bump(&ctx->next_post_id, post.post_id);
+            return 1;
+        }
+        case WAL_MESSAGE: {
+            int message_id = wal_get_int(r);
+            int sender_id = wal_get_int(r);
+            int receiver_id = wal_get_int(r);
+            time_t timestamp = wal_get_time(r);
+            int priority = wal_get_int(r);
+            const char* content = wal_get_str(r);
+            if (!r->ok || message_id <= *max_message_id) {
+                return r->ok;
+            }
+            Message* message = (Message*)slab_alloc(&ctx->message_slab);
+            if (message == NULL) {
+                return 0;
+            }
+            User* sender = find_user_by_id(ctx, sender_id);
+            message->message_id = message_id;
+            message->sender_id = sender_id;
+            message->receiver_id = receiver_id;
+            message->sender_name = sender ? sender->username : 0;
+            message->content = arena_intern(ctx, content);
+            message->timestamp = timestamp;
+            message->priority = priority;
+            message->is_read = 0;
+            if (!inbox_enqueue(&ctx->inboxes, message)) {
+                slab_free(&ctx->message_slab, message);
+                return 0;
+            }
+            if (!conversation_store_add(&ctx->conversations, message)) {
+                inbox_remove(&ctx->inboxes, receiver_id, message_id);
+                slab_free(&ctx->message_slab, message);
+                return 0;
+            }
+            message->next = ctx->messages_head;
+            ctx->messages_head = message;
+            *max_message_id = message_id;
+            wal_bump(&ctx->next_message_id, message_id);
+            return 1;
+        }
+        case WAL_FOLLOW:
+        case WAL_UNFOLLOW:
+        case WAL_CLOSE_FRIEND_ADD:
+        case WAL_CLOSE_FRIEND_REMOVE: {
+            int from_id = wal_get_int(r);
+            int to_id = wal_get_int(r);
+            if (!r->ok) {
+                return 0;
+            }
+            int ok = 1;
+            if (type == WAL_FOLLOW && !is_following(ctx, from_id, to_id)) {
+                ok = follow_graph_add(&ctx->follow_graph, from_id, to_id);
+            } else if (type == WAL_UNFOLLOW && is_following(ctx, from_id, to_id)) {
+                ok = follow_graph_remove(&ctx->follow_graph, from_id, to_id);
+            } else if (type == WAL_CLOSE_FRIEND_ADD && !is_close_friend(ctx, from_id, to_id)) {
+                ok = close_friends_insert(&ctx->close_friends, from_id, to_id);
+            } else if (type == WAL_CLOSE_FRIEND_REMOVE && is_close_friend(ctx, from_id, to_id)) {
+                ok = close_friends_delete(&ctx->close_friends, from_id, to_id);
+            }
+            timeline_invalidate(&ctx->timelines, from_id);
+            return ok;
+        }
+        case WAL_NOTIFICATION: {
+            int notif_id = wal_get_int(r);
+            int user_id = wal_get_int(r);
+            time_t timestamp = wal_get_time(r);
+            int priority = wal_get_int(r);
+            const char* content = wal_get_str(r);
+            if (!r->ok || notif_id <= *max_notif_id) {
+                return r->ok;
+            }
+            Notification* notif = (Notification*)slab_alloc(&ctx->notification_slab);
+            if (notif == NULL) {
+                return 0;
+            }
+            memset(notif, 0, sizeof(*notif));
+            notif->notif_id = notif_id;
+            notif->user_id = user_id;
+            notif->type = NOTIFY_TEXT;
+            notif->content = arena_intern(ctx, content);
+            notif->timestamp = timestamp;
+            notif->priority = priority ? 1 : 0;
+            if (notification_store_add(ctx, notif) == 0) {
+                slab_free(&ctx->notification_slab, notif);
+                return 0;
+            }
+            *max_notif_id = notif_id;
+            wal_bump(&ctx->next_notif_id, notif_id);
+            return 1;
+        }
+        case WAL_NOTIFY: {
+            int notif_id = wal_get_int(r);
+            int user_id = wal_get_int(r);
+            time_t timestamp = wal_get_time(r);
+            int priority = wal_get_int(r);
+            int type = wal_get_int(r);
+            int actor_id = wal_get_int(r);
+            int object_id = wal_get_int(r);
+            int others = wal_get_int(r);
+            int span = r->left >= 4 ? wal_get_int(r) : 0; // Not in older records
+            if (!r->ok || type <= NOTIFY_TEXT || type >= NOTIFY_TYPE_COUNT) {
+                return 0;
+            }
+            // A record for a held id is a merge: it carries the whole new state
+            Notification* notif = notification_find(ctx, notif_id);
+            if (notif != NULL) {
+                notif->actor_id = actor_id;
+                notif->object_id = object_id;
+                notif->others = others;
+                notif->span = span;
+                notif->timestamp = timestamp;
+                return 1;
+            }
+            if (notif_id <= *max_notif_id) {
+                return 1; // Evicted since
+            }
+            notif = (Notification*)slab_alloc(&ctx->notification_slab);
+            if (notif == NULL) {
+                return 0;
+            }
+            memset(notif, 0, sizeof(*notif));
+            notif->notif_id = notif_id;
+            notif->user_id = user_id;
+            notif->type = (unsigned char)type;
+            notif->actor_id = actor_id;
+            notif->object_id = object_id;
+            notif->others = others;
+            notif->span = span;
+            notif->timestamp = timestamp;
+            notif->priority = priority ? 1 : 0;
+            if (notification_store_add(ctx, notif) == 0) {
+                slab_free(&ctx->notification_slab, notif);
+                return 0;
+            }
+            *max_notif_id = notif_id;
+            wal_bump(&ctx->next_notif_id, notif_id);
+            return 1;
+        }
+        case WAL_NOTIFICATION_READ: {
+            int notif_id = wal_get_int(r);
+            Notification* notif = r->ok ? notification_find(ctx, notif_id) : NULL;
+            if (notif != NULL) {
+                notification_mark_read(&ctx->notifications, notif);
+            }
+            return r->ok;
+        }
+        case WAL_MESSAGE_READ: {
+            int message_id = wal_get_int(r);
+            int receiver_id = wal_get_int(r);
+            Message* message = r->ok ? inbox_remove(&ctx->inboxes, receiver_id, message_id) : NULL;
+            if (message != NULL) {
+                message->is_read = 1;
+            }
+            return r->ok;
+        }
+        default:
+            return 0;
+    }
+}
+
+static int read_whole_file(int fd, unsigned char** data, size_t* size) {
+    struct stat info;
+    *data = NULL;
+    *size = 0;
+    if (fstat(fd, &info) < 0) {
+        return 0;
+    }
+    if (info.st_size == 0) {
+        return 1;
+    }
+    *data = (unsigned char*)malloc((size_t)info.st_size);
+    if (*data == NULL) {
+        return 0;
+    }
+    while (*size < (size_t)info.st_size) {
+        ssize_t got = read(fd, *data + *size, (size_t)info.st_size - *size);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        *size += (size_t)got;
+    }
+    return 1;
+}
+
+// Replays the records after the snapshot and returns the length of the
+// intact prefix of the log; a torn or corrupt record ends the replay
+static size_t wal_replay(PriorityContext* ctx, const unsigned char* data, size_t size,
+                         size_t* record_count, int* ok) {
+    WriteAheadLog* wal = &ctx->wal;
+    int max_message_id = 0, max_notif_id = 0;
+    for (Message* m = ctx->messages_head; m != NULL; m = m->next) {
+        if (m->message_id > max_message_id) max_message_id = m->message_id;
+    }
+    max_notif_id = ctx->notifications.last_id;
+    
+    size_t offset = 0;
+    *record_count = 0;
+    while (size - offset >= WAL_HEADER_SIZE) {
+        WalReader header = {data + offset, WAL_HEADER_SIZE, 1};
+        size_t payload = (size_t)wal_get_bytes(&header, 4);
+        uint32_t crc = (uint32_t)wal_get_bytes(&header, 4);
+        uint64_t lsn = wal_get_bytes(&header, 8);
+        int type = data[offset + WAL_HEADER_SIZE - 1];
+        if (payload > WAL_MAX_RECORD || size - offset - WAL_HEADER_SIZE < payload ||
+            wal_crc32(data + offset + 8, payload + 9) != crc) {
+            break;
+        }
+        
+        if (lsn > wal->snapshot_lsn) {
+            WalReader reader = {data + offset + WAL_HEADER_SIZE, payload, 1};
+            if (!wal_apply(ctx, type, &reader, &max_message_id, &max_notif_id)) {
+                *ok = 0;
+            }
+        }
+        if (lsn >= wal->next_lsn) {
+            wal->next_lsn = lsn + 1;
+        }
+        offset += WAL_HEADER_SIZE + payload;
+        (*record_count)++;
+    }
+    return offset;
+}
+
+// Replays the log at path on top of what load_data loaded, then keeps it
+// open for appending. Returns 0 if the log could not be opened; a record
+// that could not be applied also returns 0 but leaves the log open.
+int wal_open(PriorityContext* ctx, const char* path) {
+    WriteAheadLog* wal = &ctx->wal;
+    if (wal->fd >= 0) {
+        return priority_fail(ctx, "Write-ahead log is already open!");
+    }
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return priority_fail(ctx, "Could not open the write-ahead log!");
+    }
+    
+    unsigned char* data;
+    size_t size, record_count = 0;
+    if (!read_whole_file(fd, &data, &size)) {
+        close(fd);
+        return priority_fail(ctx, "Could not read the write-ahead log!");
+    }
+    int ok = 1;
+    wal->next_lsn = wal->snapshot_lsn + 1;
+    size_t intact = wal_replay(ctx, data, size, &record_count, &ok);
+    free(data);
+    
+    // Drop a torn tail so new records follow the last intact one
+    if ((intact < size && ftruncate(fd, (off_t)intact) < 0) || lseek(fd, (off_t)intact, SEEK_SET) < 0) {
+        close(fd);
+        return priority_fail(ctx, "Could not repair the write-ahead log!");
+    }
+    wal->fd = fd;
+    wal->len = 0;
+    wal->unsynced = 0;
+    wal->failed = 0;
+    wal->since_snapshot = record_count;
+    if (wal->since_snapshot >= WAL_SNAPSHOT_RECORDS) {
+        wal_snapshot(ctx);
+    }
+    return ok ? 1 : priority_fail(ctx, "Memory ran out while replaying the write-ahead log!");
+}
+
+// Writes the binary snapshot and empties the log it now covers. Without an
+// open log this only writes the snapshot.
+int wal_snapshot(PriorityContext* ctx) {
+    WriteAheadLog* wal = &ctx->wal;
+    if (wal->fd >= 0 && !wal->failed) {
+        wal_sync(ctx);
+    }
+    if (!snapshot_save(ctx, SNAPSHOT_PATH)) {
+        return priority_fail(ctx, "Could not write the snapshot!");
+    }
+    if (wal->next_lsn > 0) {
+        wal->snapshot_lsn = wal->next_lsn - 1;
+    }
+    wal->since_snapshot = 0;
+    if (wal->fd < 0) {
+        return 1;
+    }
+    
+    // Buffered records are in the snapshot too, so a failed log starts over
+    wal->len = 0;
+    wal->unsynced = 0;
+    if (ftruncate(wal->fd, 0) < 0 || lseek(wal->fd, 0, SEEK_SET) < 0) {
+        wal->failed = 1;
+        return priority_fail(ctx, "Could not truncate the write-ahead log!");
+    }
+    wal->failed = 0;
+    return 1;
+}
+
+// Called when the caller goes idle: ends the current group, then rewrites the
+// snapshot once WAL_SNAPSHOT_RECORDS records have piled up (or to restart a
+// failed log). A failed snapshot waits WAL_SNAPSHOT_RETRY_MS before the next try.
+// Returns 1 when every change logged so far is on disk: a failed snapshot
+// of a healthy log still counts, as the log is kept until one succeeds.
+int wal_idle(PriorityContext* ctx) {
+    WriteAheadLog* wal = &ctx->wal;
+    int ok = wal_sync(ctx);
+    if (wal->fd < 0 || (!wal->failed && wal->since_snapshot < WAL_SNAPSHOT_RECORDS) ||
+        wal_now_ms() < wal->snapshot_retry_ms) {
+        return ok;
+    }
+    if (!wal_snapshot(ctx)) {
+        wal->snapshot_retry_ms = wal_now_ms() + WAL_SNAPSHOT_RETRY_MS;
+        return ok;
+    }
+    wal->snapshot_retry_ms = 0;
+    return 1;
+}
+
+void wal_close(PriorityContext* ctx) {
+    WriteAheadLog* wal = &ctx->wal;
+    if (wal->fd >= 0) {
+        wal_sync(ctx);
+        close(wal->fd);
+        wal->fd = -1;
+    }
+    free(wal->buf);
+    wal->buf = NULL;
+    wal->len = wal->capacity = 0;
+    wal->unsynced = 0;
+}
+
+// Makes every change durable: ends the log's current group, or writes a
+// full snapshot when there is no working log
+int sync_data(PriorityContext* ctx) {
+    if (ctx->wal.fd >= 0 && !ctx->wal.failed) {
+        return wal_sync(ctx);
+    }
+    return wal_snapshot(ctx);
+}
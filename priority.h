@@ -0,0 +1,695 @@
+/*
+ * PRIORITY SOCIAL MEDIA - Engine Library (libpriority)
+ * Users, posts, the follow graph, close friends, messages and notifications
+ *
+ * All engine state lives in a PriorityContext that every call receives
+ * explicitly; there are no global records. Contexts are independent, so
+ * separate threads may each drive their own context without locking.
+ *
+ * Threads sharing one context: the follow graph, close friends, the user
+ * index, the users list and the string arena may be read lock-free from
+ * any number of threads, each inside priority_read_begin/end on a reader
+ * slot from priority_reader_register (is_following, is_close_friend,
+ * find_user_by_*, follower counts and iterators, arena_str). Writers are
+ * serialized by ctx->write_lock: register_user, follow_user, unfollow_user,
+ * add_close_friend and remove_close_friend take it themselves, and a caller
+ * that sets current_user or calls anything else wraps the whole sequence
+ * in priority_write_begin/end. Posts, messages, timelines and notifications
+ * are only safe to read under the write lock.
+ *
+ * Fan-out: after fanout_start, create_post hands follower notifications and
+ * timeline delivery to background workers, which take the write lock in
+ * short batches. From then on every caller must hold the write lock around
+ * engine calls, and fanout_flush, fanout_stop and cleanup_data must be
+ * called without it.
+ *
+ * Persistence: load_data maps the binary snapshot (data.snap), or parses
+ * the .dat text files on load_threads threads when there is none; then
+ * wal_open replays the write-ahead log on top of it and keeps appending
+ * every mutation to it.
+ * Snapshots are written by wal_snapshot; save_data exports the .dat files
+ * (escaped pipe-delimited text, see dat_codec.h).
+ * Callers that go idle (an event loop iteration, a menu prompt) call
+ * wal_idle so the last group of records is not left waiting; it is also
+ * where the snapshot is rewritten once the log has grown, never inside a
+ * mutation. sync_data at exit makes everything durable with or without a log.
+ *
+ * The data functions (priority.c) never print. On failure they return 0
+ * and leave a message in ctx->error. The terminal views that print records
+ * with printf (display_*) live in priority_display.c.
+ *
+ * Build: make lib   (libpriority.a and libpriority.so)
+ */
+
+#ifndef PRIORITY_H
+#define PRIORITY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <limits.h>
+#include <pthread.h>
+#include "user_index.h"
+#include "slab.h"
+
+// Constants
+// Input limits. Records no longer embed buffers of these sizes: variable-length
+// text lives in the string arena, so these only bound user input and the
+// field widths used by load_data.
+#define MAX_USERNAME 50
+#define MAX_PASSWORD 50
+#define MAX_POST_CONTENT 5000
+#define MAX_MESSAGE_CONTENT 300
+#define MAX_FILENAME 1000
+#define MAX_MEDIA_DESCRIPTION 500
+#define MAX_USERS 1000000
+#define CACHE_LINE_SIZE 64
+#define SCRATCH_POOL_SIZE 8 // Scratch vectors a single thread may hold at once
+#define SCRATCH_RETAIN_LIMIT 65536 // Items a released vector may keep allocated
+#define TIMELINE_LANE_CAPACITY 64 // Newest posts kept per timeline lane
+#define TIMELINE_FANOUT_LIMIT 10000 // Authors with more followers are pulled at read time
+#define POST_CHUNK_SIZE 1024 // Posts per store chunk
+#define FEED_PAGE_SIZE 20 // Posts per feed page by default
+#define FEED_PAGE_MAX 64 // Largest page a caller may request
+#define CONVERSATION_PAGE_SIZE 50 // Messages per conversation page by default
+#define CONVERSATION_PAGE_MAX 200 // Largest conversation page a caller may request
+#define NOTIFICATION_RETENTION 512 // Notifications a user keeps before read ones are evicted
+#define NOTIFICATION_EVICT_TO 384 // Eviction stops once this few are left
+#define NOTIFICATION_COALESCE_SECONDS 86400 // Longest an unread notification keeps absorbing repeats, from its first event
+#define WAL_PATH "data.wal" // Write-ahead log next to the snapshot
+#define WAL_GROUP_RECORDS 256 // Most records that share one fsync
+#define WAL_GROUP_MS 10 // Longest a record waits for its group's fsync
+#define WAL_SNAPSHOT_RECORDS 100000 // Records logged before wal_idle rewrites the snapshot
+#define WAL_SNAPSHOT_RETRY_MS 30000 // Wait after a failed snapshot before wal_idle tries again
+#define WAL_BUFFER_SIZE 65536 // Buffered bytes written out before a group ends
+#define SNAPSHOT_PATH "data.snap" // Binary snapshot, preferred over the .dat files
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_ARENA_HEADROOM (64u << 20) // Least room mapped for new strings
+#define LOAD_MAX_THREADS 16 // Most threads that parse .dat files together
+#define LOAD_CHUNK_BYTES (8L << 20) // .dat bytes parsed by one job
+#define FANOUT_MAX_THREADS 8 // Most fan-out workers
+#define FANOUT_QUEUE_CAPACITY 256 // Pending posts per worker before posters run fan-out themselves
+#define FANOUT_BATCH 1024 // Followers handled per hold of the write lock
+
+// Thread-local storage qualifier
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define THREAD_LOCAL _Thread_local
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+// Compile-time check (C99 has no _Static_assert)
+#define STATIC_CHECK(name, cond) typedef char static_check_##name[(cond) ? 1 : -1]
+
+// Reference into the shared string arena (byte offset, 0 is the empty string)
+typedef uint32_t StrRef;
+
+// String arena: one growable buffer holding every variable-length text field
+typedef struct StringArena {
+    char* data;
+    size_t used;
+    size_t capacity;
+    int borrowed; // data is the string heap of a mapped snapshot
+} StringArena;
+
+// Scratch vector: growable array of record pointers borrowed for one request
+typedef struct ScratchVec {
+    void** items;
+    size_t count;
+    size_t capacity;
+    int in_use;
+} ScratchVec;
+
+// User structure
+typedef struct User {
+    int user_id;
+    StrRef username;
+    StrRef password;
+    time_t created_at;
+    struct User* next;
+} User;
+
+// Media types enumeration
+typedef enum {
+    MEDIA_NONE = 0,
+    MEDIA_IMAGE = 1,
+    MEDIA_VIDEO = 2,
+    MEDIA_AUDIO = 3
+} MediaType;
+
+// Post structure with multimedia support
+typedef struct Post {
+    int post_id;
+    int author_id;
+    time_t created_at;
+    StrRef author_name; // Shares the author's username in the arena
+    StrRef content;
+    StrRef media_path; // Path to media file
+    StrRef media_description; // Description of media content
+    int priority; // Higher for close friends
+    MediaType media_type; // Type of attached media
+} Post;
+
+// Message structure
+typedef struct Message {
+    int message_id;
+    int sender_id;
+    int receiver_id;
+    StrRef sender_name; // Shares the sender's username in the arena
+    StrRef content;
+    int priority; // 1 for close friends, 0 for regular
+    int is_read; // Taken out of the receiver's inbox
+    time_t timestamp;
+    struct Message* next;
+} Message;
+
+// Every message between two users in send order (ascending message id).
+// Each conversation is also on both users' recent lists, most recently
+// active first.
+typedef struct Conversation {
+    int user_a; // Lower user id
+    int user_b; // Higher user id
+    Message** messages;
+    int count;
+    int capacity;
+    int prev[2]; // Neighbours on user_a's and user_b's recent lists,
+    int next[2]; // as conversation index + 1 (0 = none)
+} Conversation;
+
+// Conversations keyed by unordered user pair
+typedef struct ConversationStore {
+    Conversation* conversations;
+    int count;
+    int capacity;
+    int* slots; // Hash of (user_a, user_b) -> conversation index + 1 (0 = empty)
+    int slot_capacity; // Power of two
+    int* recent; // user id -> most recently active conversation + 1 (0 = none)
+    int user_capacity;
+} ConversationStore;
+
+// Inbox lanes: close friends' messages are always delivered first
+typedef enum {
+    INBOX_PRIORITY = 0,
+    INBOX_REGULAR = 1,
+    INBOX_LANES = 2
+} InboxLane;
+
+// Unread messages of one lane in arrival order
+typedef struct MessageQueue {
+    Message** ring;
+    int capacity; // Power of two
+    int head; // Oldest unread message
+    int count;
+} MessageQueue;
+
+typedef struct InboxStore {
+    MessageQueue* queues; // Indexed by receiver id * INBOX_LANES + lane
+    int capacity; // Receivers
+} InboxStore;
+
+// One page of a conversation, oldest first
+typedef struct ConversationPage {
+    Message* messages[CONVERSATION_PAGE_MAX];
+    int count;
+    int has_more; // Older messages exist
+    int next_before_id; // Pass back as before_id for the older page
+} ConversationPage;
+
+// Follow relationship (one edge of the follow graph)
+typedef struct Follow {
+    int follower_id;
+    int following_id;
+} Follow;
+
+// Recent changes to one adjacency row, both kept sorted
+typedef struct EdgeDelta {
+    const int* added; // Ids inserted since the row was last merged
+    int added_count;
+    const int* removed; // Base ids deleted since the row was last merged
+    int removed_count;
+} EdgeDelta;
+
+// Adjacency row of one user: sorted base ids plus a delta buffer. A row is
+// never changed once published; every edit publishes a new version.
+typedef struct EdgeRow {
+    const int* base; // Slice of the CSR pool, or a private array when owned
+    int base_count;
+    int owned;
+    int pooled; // Lives in the row block of the last CSR build
+    int degree; // Live edge count (base - removed + added)
+    EdgeDelta delta; // Stored just past the row in the same allocation
+} EdgeRow;
+
+// Row pointers indexed by user id (NULL for no edges), replaced whole to grow
+typedef struct EdgeTable {
+    int capacity;
+    EdgeRow* rows[];
+} EdgeTable;
+
+// One direction of the follow graph
+typedef struct Adjacency {
+    EdgeTable* table; // Published to readers
+    int* pool; // CSR edge storage of the last build
+    EdgeRow* row_block; // Rows of the last build, one allocation
+} Adjacency;
+
+// Follow graph: out-edges (following) and in-edges (followers)
+typedef struct FollowGraph {
+    Adjacency out;
+    Adjacency in;
+    size_t edge_count;
+    size_t changes; // Edge inserts and deletes since the last CSR rebuild
+    EpochDomain* epoch; // Where replaced rows are retired, NULL to free at once
+} FollowGraph;
+
+// Iterator over one row in ascending id order
+typedef struct EdgeIter {
+    const EdgeRow* row;
+    int base_pos;
+    int added_pos;
+    int removed_pos;
+} EdgeIter;
+
+// Every post id an author has written, ascending
+typedef struct AuthorPosts {
+    int* post_ids;
+    int count;
+    int capacity; // 0 with post_ids set: borrowed from a mapped snapshot
+} AuthorPosts;
+
+// Posts live in fixed-size chunks that are never moved or freed until
+// cleanup, so Post pointers stay valid
+typedef struct PostChunk {
+    Post posts[POST_CHUNK_SIZE];
+    int count;
+} PostChunk;
+
+// Append-only post store ordered by post id (and so by created_at)
+typedef struct PostStore {
+    PostChunk** chunks;
+    int chunk_count;
+    int chunk_capacity;
+    size_t post_count;
+    uint32_t* by_id; // post_id -> position in id order + 1 (0 = none)
+    int id_capacity;
+    int by_id_borrowed; // by_id lives in a mapped snapshot
+    int mapped_chunks; // Leading chunks that live in a mapped snapshot
+    AuthorPosts* authors; // author_id -> ascending post ids
+    int author_capacity;
+} PostStore;
+
+// Close friends index: sorted rows in both directions
+typedef struct CloseFriendIndex {
+    Adjacency friends; // user -> their close friends
+    Adjacency friend_of; // friend -> users who list them
+    size_t pair_count;
+    EpochDomain* epoch; // As in FollowGraph
+} CloseFriendIndex;
+
+// Test bit i of a bitmap filled by close_friends_priority_bitmap
+#define BITMAP_TEST(bits, i) (((bits)[(i) / 8] >> ((i) % 8)) & 1)
+
+// Home timeline lanes
+typedef enum {
+    TIMELINE_PRIORITY = 0,
+    TIMELINE_REGULAR = 1,
+    TIMELINE_LANES = 2
+} TimelineLane;
+
+// Bounded ring of post ids; the oldest id is overwritten once full
+typedef struct PostRing {
+    int* ids;
+    int capacity; // Grows on demand up to TIMELINE_LANE_CAPACITY
+    int head; // Next write slot
+    int count;
+} PostRing;
+
+// Posts delivered to one reader, filled when followed authors post
+typedef struct Timeline {
+    PostRing lanes[TIMELINE_LANES];
+    int built; // 0 until first read and after the reader's follows change
+} Timeline;
+
+
+typedef struct TimelineStore {
+    Timeline* timelines; // Indexed by user id
+    int* pull_since; // Per author: first post id served by pulling (0 = pushed)
+    int capacity;
+    int* pulled_authors; // Authors whose new posts are merged in at read time
+    int pulled_count;
+    int pulled_capacity;
+} TimelineStore;
+
+// Position in a paged feed: priority lane first, then regular, newest first
+typedef struct FeedCursor {
+    int lane; // TimelineLane being read
+    int before_id; // Next page starts below this post id (0 = newest)
+} FeedCursor;
+
+typedef struct FeedItem {
+    Post* post;
+    int priority;
+} FeedItem;
+
+typedef struct FeedPage {
+    FeedItem items[FEED_PAGE_MAX];
+    int count;
+    int has_more;
+    FeedCursor next; // Pass back to get the following page
+} FeedPage;
+
+// What a notification is about. Everything but NOTIFY_TEXT is stored as
+// ids and rendered by notification_render when it is shown.
+typedef enum {
+    NOTIFY_TEXT = 0, // Free text, kept in the string arena
+    NOTIFY_FOLLOW = 1, // actor started following the user
+    NOTIFY_POST = 2, // actor created post object_id
+    NOTIFY_MEDIA_POST = 3,
+    NOTIFY_MESSAGE = 4, // actor sent message object_id
+    NOTIFY_TYPE_COUNT
+} NotificationType;
+
+// Notification structure. A repeat of an unread notification's event is
+// merged into it: actor_id, object_id and timestamp then name the newest
+// event, and others counts the earlier ones. A follow by the newest actor
+// again is not counted twice.
+typedef struct Notification {
+    int notif_id;
+    int user_id;
+    int actor_id;
+    int object_id;
+    int others;
+    int span; // Seconds from the first merged event to timestamp
+    StrRef content; // NOTIFY_TEXT only
+    unsigned char type; // NotificationType
+    unsigned char priority;
+    unsigned char is_read;
+    time_t timestamp;
+} Notification;
+
+// A lane of one user's notifications, oldest first
+typedef struct NotificationLane {
+    Notification** items;
+    int count;
+    int capacity;
+} NotificationLane;
+
+// One user's notifications. Newest first within each lane is the display
+// order, close friends' lane before the other.
+typedef struct NotificationBox {
+    NotificationLane lanes[2]; // Indexed by priority (1 = close friends)
+    int unread[2]; // Unread notifications in each lane
+    int evict_at; // Notification count that starts the next eviction pass
+} NotificationBox;
+
+// Every notification, by user and by id. Past NOTIFICATION_RETENTION a
+// user's oldest read notifications are evicted; unread ones always stay.
+typedef struct NotificationStore {
+    NotificationBox* boxes; // Indexed by user id
+    int capacity;
+    Notification** slots; // Hash of notif_id, linear probing (NULL = empty)
+    int slot_capacity; // Power of two
+    int count; // Notifications held
+    int last_id; // Highest id ever held
+    size_t evicted;
+    size_t coalesced; // Events merged into an earlier notification
+} NotificationStore;
+
+// Write-ahead log: every mutation is appended as a binary record, and
+// records are fsync'd in groups. The snapshot (data.snap, or the .dat files
+// before one exists) holds the log up to snapshot_lsn.
+typedef struct WriteAheadLog {
+    int fd; // -1 while no log is open
+    char* buf; // Encoded records not yet written to fd
+    size_t len;
+    size_t capacity;
+    uint64_t next_lsn; // Sequence number of the next record
+    uint64_t snapshot_lsn; // Last record already in the snapshot
+    size_t unsynced; // Records appended since the last fsync
+    long long group_start_ms; // When the oldest unsynced record was appended
+    size_t since_snapshot; // Records appended since the last snapshot
+    long long snapshot_retry_ms; // No snapshot from wal_idle before this time
+    size_t sync_count;
+    int failed; // A write or fsync failed; later records are dropped
+} WriteAheadLog;
+
+// A mapped binary snapshot. Post chunks, the post and author indexes, the
+// follow and close-friend rows and the string heap are used in place;
+// MAP_PRIVATE copies only the pages a write touches. User, message and
+// notification nodes are rebuilt into one block each.
+typedef struct SnapshotMap {
+    char* base; // NULL when nothing is mapped
+    size_t size; // Mapped bytes, including the string heap's headroom
+    User* users;
+    size_t user_count;
+    Message* messages;
+    size_t message_count;
+    Notification* notifications;
+    size_t notification_count;
+} SnapshotMap;
+
+// Every record must fit in a single cache line
+STATIC_CHECK(user_fits_cache_line, sizeof(User) <= CACHE_LINE_SIZE);
+STATIC_CHECK(post_fits_cache_line, sizeof(Post) <= CACHE_LINE_SIZE);
+STATIC_CHECK(message_fits_cache_line, sizeof(Message) <= CACHE_LINE_SIZE);
+STATIC_CHECK(notification_fits_cache_line, sizeof(Notification) <= CACHE_LINE_SIZE);
+
+// One post waiting for fan-out
+typedef struct FanoutJob {
+    int author_id;
+    int post_id;
+    int push; // Also deliver to followers' home timelines
+    NotificationType type;
+    long long queued_ms; // When the job was queued
+} FanoutJob;
+
+// Bounded ring of jobs for one worker. Any thread may push (posters are
+// already serialized by the write lock); only the worker pops.
+typedef struct FanoutQueue {
+    FanoutJob* jobs; // FANOUT_QUEUE_CAPACITY slots
+    int head; // Oldest job
+    int count;
+    int busy; // The worker is running a job it popped
+    pthread_mutex_t lock;
+    pthread_cond_t ready; // A job was pushed, or the pipeline is stopping
+    pthread_cond_t idle; // The queue drained
+    pthread_t thread;
+    struct PriorityContext* ctx;
+} FanoutQueue;
+
+// Pipeline counters, updated atomically; read them with fanout_stats
+typedef struct FanoutStats {
+    size_t jobs_queued; // Handed to a worker
+    size_t jobs_inline; // Run by the poster: no workers, or the queue was full
+    size_t queue_full; // Of jobs_inline, those turned away by a full queue
+    size_t jobs_done; // Finished by workers
+    size_t notifications; // Delivered by workers
+    size_t batches; // Write-lock holds taken by workers
+    int depth; // Jobs queued right now
+    int depth_high_water;
+    long long max_lag_ms; // Longest a job waited before a worker took it
+} FanoutStats;
+
+typedef struct FanoutPipeline {
+    FanoutQueue* queues; // One per worker; a post goes to queue author_id % threads
+    int threads; // 0 while fan-out runs inline
+    int stopping;
+    FanoutStats stats;
+} FanoutPipeline;
+
+// Every piece of engine state. Initialize with priority_init and release
+// with cleanup_data; a zeroed context is not valid (ids start at 1).
+typedef struct PriorityContext {
+    EpochDomain epoch; // Lock-free readers of the graph, the index and the arena
+    pthread_mutex_t write_lock; // Recursive; held by every call that changes them
+    StringArena text_arena;
+    User* users_head;
+    UserIndex user_index;
+    PostStore post_store;
+    Message* messages_head;
+    SlabAllocator message_slab; // Messages not rebuilt by snapshot_load
+    ConversationStore conversations; // The same messages by user pair
+    InboxStore inboxes; // Unread messages by receiver
+    FollowGraph follow_graph;
+    CloseFriendIndex close_friends;
+    TimelineStore timelines;
+    NotificationStore notifications;
+    SlabAllocator notification_slab; // Notifications not rebuilt by snapshot_load
+    User* current_user; // Acting user for posting, following and messaging
+    int next_user_id;
+    int next_post_id;
+    int next_message_id;
+    int next_notif_id;
+    WriteAheadLog wal;
+    SnapshotMap snapshot;
+    int load_threads; // Threads that parse .dat files; 0 means one per core
+    FanoutPipeline fanout;
+    const char* error; // Why the last failed call failed
+} PriorityContext;
+
+// Function prototypes for all modules
+// Context module
+void priority_init(PriorityContext* ctx);
+void priority_write_begin(PriorityContext* ctx);
+void priority_write_end(PriorityContext* ctx);
+int priority_reader_register(PriorityContext* ctx);
+void priority_reader_unregister(PriorityContext* ctx, int reader);
+void priority_read_begin(PriorityContext* ctx, int reader);
+void priority_read_end(PriorityContext* ctx, int reader);
+
+// String arena module
+StrRef arena_intern(PriorityContext* ctx, const char* text);
+const char* arena_str(const PriorityContext* ctx, StrRef ref);
+
+// Scratch buffer module
+ScratchVec* scratch_acquire();
+int scratch_push(ScratchVec* vec, void* item);
+void* scratch_reserve(ScratchVec* vec, size_t bytes);
+void scratch_release(ScratchVec* vec);
+void scratch_pool_free();
+size_t scratch_grow_count();
+
+// User module
+int register_user(PriorityContext* ctx, const char* username, const char* password);
+User* login_user(PriorityContext* ctx, const char* username, const char* password);
+void logout_user(PriorityContext* ctx);
+User* find_user_by_id(const PriorityContext* ctx, int user_id);
+User* find_user_by_username(const PriorityContext* ctx, const char* username);
+const char* user_record_name(void* ctx, const void* record);
+
+// Post module
+int create_post(PriorityContext* ctx, const char* content);
+int create_media_post(PriorityContext* ctx, const char* content, MediaType media_type,
+                      const char* media_path, const char* media_description);
+int get_user_priority(const PriorityContext* ctx, int user_id);
+
+// Post store module
+Post* post_store_append(PostStore* store, const Post* post);
+Post* post_store_find(const PostStore* store, int post_id);
+Post* post_store_at(const PostStore* store, size_t index);
+const int* post_store_by_author(const PostStore* store, int author_id, int* count);
+int post_store_latest(const PostStore* store, int author_id, int n, Post** out);
+int post_store_since(const PostStore* store, int author_id, time_t since, Post** out, int max);
+void post_store_free(PostStore* store);
+
+// Media module
+int validate_media_file(const char* file_path, MediaType expected_type);
+int copy_media_file(const char* source_path, const char* dest_path);
+char* get_media_type_string(MediaType type);
+void create_media_directories();
+
+// Follow graph module
+int follow_graph_add(FollowGraph* graph, int follower_id, int following_id);
+int follow_graph_remove(FollowGraph* graph, int follower_id, int following_id);
+int follow_graph_has(const FollowGraph* graph, int follower_id, int following_id);
+int follow_graph_following_count(const FollowGraph* graph, int user_id);
+int follow_graph_follower_count(const FollowGraph* graph, int user_id);
+void follow_graph_following(const FollowGraph* graph, int user_id, EdgeIter* iter);
+void follow_graph_followers(const FollowGraph* graph, int user_id, EdgeIter* iter);
+int edge_iter_next(EdgeIter* iter, int* id);
+int follow_graph_build(FollowGraph* graph, const Follow* edges, size_t count);
+void follow_graph_free(FollowGraph* graph);
+
+// Follow module
+int follow_user(PriorityContext* ctx, int user_id);
+int unfollow_user(PriorityContext* ctx, int user_id);
+int is_following(const PriorityContext* ctx, int follower_id, int following_id);
+
+// Message module
+int send_message(PriorityContext* ctx, int receiver_id, const char* content);
+
+// Conversation module
+int conversation_store_add(ConversationStore* store, Message* message);
+int conversation_store_build(ConversationStore* store, Message* messages_head);
+const Conversation* conversation_find(const PriorityContext* ctx, int user_id, int other_id);
+int conversation_page(const PriorityContext* ctx, int user_id, int other_id, int before_id, int limit,
+                      ConversationPage* page);
+int conversation_recent(const PriorityContext* ctx, int user_id, const Conversation** out, int max);
+void conversation_store_free(ConversationStore* store);
+
+// Inbox module
+int inbox_enqueue(InboxStore* store, Message* message);
+Message* inbox_remove(InboxStore* store, int receiver_id, int message_id);
+int inbox_store_build(InboxStore* store, Message* messages_head);
+Message* inbox_next(PriorityContext* ctx, int user_id);
+int inbox_drain(PriorityContext* ctx, int user_id, Message** out, int max);
+int inbox_unread(const PriorityContext* ctx, int user_id, int* priority_unread, int* regular_unread);
+void inbox_store_free(InboxStore* store);
+
+// Close friends module
+int add_close_friend(PriorityContext* ctx, int friend_id);
+int remove_close_friend(PriorityContext* ctx, int friend_id);
+int is_close_friend(const PriorityContext* ctx, int user_id, int friend_id);
+void close_friends_list(const CloseFriendIndex* index, int user_id, EdgeIter* iter);
+void close_friends_priority_bitmap(const CloseFriendIndex* index, int author_id,
+                                   const int* follower_ids, size_t count,
+                                   unsigned char* bitmap);
+int close_friends_build(CloseFriendIndex* index, const Follow* pairs, size_t count);
+void close_friends_free(CloseFriendIndex* index);
+
+// Fan-out module
+int fanout_start(PriorityContext* ctx, int threads);
+void fanout_flush(PriorityContext* ctx);
+void fanout_stop(PriorityContext* ctx);
+void fanout_stats(PriorityContext* ctx, FanoutStats* stats);
+
+// Timeline module
+int timeline_record_post(PriorityContext* ctx, const Post* post);
+void timeline_record_authors(PriorityContext* ctx);
+void timeline_deliver(TimelineStore* store, int reader_id, int post_id, int priority);
+void timeline_invalidate(TimelineStore* store, int reader_id);
+int timeline_page(PriorityContext* ctx, int reader_id, TimelineLane lane, int* post_ids, int max);
+void timeline_store_free(TimelineStore* store);
+
+// Feed query module
+int feed_query(PriorityContext* ctx, int reader_id, FeedCursor cursor, int limit, FeedPage* page);
+void feed_cursor_format(FeedCursor cursor, char* buffer, size_t size);
+int feed_cursor_parse(const char* text, FeedCursor* cursor);
+
+// Notification module
+int add_notification(PriorityContext* ctx, int user_id, const char* content, int priority);
+int notify_user(PriorityContext* ctx, int user_id, NotificationType type, int actor_id, int object_id, int priority);
+const char* notification_render(const PriorityContext* ctx, const Notification* notif, char* buf, size_t size);
+int mark_notification_read(PriorityContext* ctx, int notif_id);
+Notification* notification_find(const PriorityContext* ctx, int notif_id);
+const NotificationBox* notification_box(const PriorityContext* ctx, int user_id);
+int notification_unread(const PriorityContext* ctx, int user_id, int* priority_unread, int* regular_unread);
+int notification_store_build(PriorityContext* ctx);
+void notification_store_free(NotificationStore* store);
+
+// File handling
+int save_data(const PriorityContext* ctx);
+int load_data(PriorityContext* ctx);
+int sync_data(PriorityContext* ctx);
+void cleanup_data(PriorityContext* ctx);
+
+// Binary snapshot
+int snapshot_save(const PriorityContext* ctx, const char* path);
+int snapshot_load(PriorityContext* ctx, const char* path);
+
+// Write-ahead log
+int wal_open(PriorityContext* ctx, const char* path);
+int wal_sync(PriorityContext* ctx);
+int wal_snapshot(PriorityContext* ctx);
+int wal_idle(PriorityContext* ctx);
+void wal_close(PriorityContext* ctx);
+
+// Terminal views (priority_display.c)
+void display_user_profile(const PriorityContext* ctx, int user_id);
+void display_media_info(const PriorityContext* ctx, const Post* post);
+void display_feed(PriorityContext* ctx);
+int display_feed_page(PriorityContext* ctx, FeedCursor* cursor);
+void display_user_posts(const PriorityContext* ctx, int user_id);
+void display_followers(const PriorityContext* ctx, int user_id);
+void display_following(const PriorityContext* ctx, int user_id);
+void display_messages(const PriorityContext* ctx, int user_id);
+void display_conversation(const PriorityContext* ctx, int other_user_id);
+void display_close_friends(const PriorityContext* ctx);
+void display_notifications(const PriorityContext* ctx);
+
+#endif
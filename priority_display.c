@@ -0,0 +1,386 @@
+/*
+ * PRIORITY SOCIAL MEDIA - Terminal Views
+ * printf-based display_* functions over a PriorityContext
+ *
+ * Kept apart from the data functions in priority.c so programs that only
+ * need the engine (the web server, the GTK frontends) never pull these in.
+ */
+
+#include "priority.h"
+
+// =============================================================================
+// User Views - Profiles
+// =============================================================================
+
+void display_user_profile(const PriorityContext* ctx, int user_id) {
+    User* user = find_user_by_id(ctx, user_id);
+    if (user == NULL) {
+        printf("User not found!\n");
+        return;
+    }
+    
+    printf("\n=== USER PROFILE ===\n");
+    printf("User ID: %d\n", user->user_id);
+    printf("Username: %s\n", arena_str(ctx, user->username));
+    printf("Member since: %s", ctime(&user->created_at));
+    
+    // Count followers and following
+    int followers = follow_graph_follower_count(&ctx->follow_graph, user_id);
+    int following = follow_graph_following_count(&ctx->follow_graph, user_id);
+    
+    printf("Followers: %d\n", followers);
+    printf("Following: %d\n", following);
+    printf("==================\n");
+}
+
+// =============================================================================
+// Media Views - Attachment details
+// =============================================================================
+
+void display_media_info(const PriorityContext* ctx, const Post* post) {
+    if (post->media_type == MEDIA_NONE) {
+        return; // No media attached
+    }
+    
+    printf("📎 Media: %s", get_media_type_string(post->media_type));
+    if (post->media_description != 0) {
+        printf(" - %s", arena_str(ctx, post->media_description));
+    }
+    printf("\n");
+    printf("   File: %s\n", arena_str(ctx, post->media_path));
+    
+    // Display media type specific icons
+    switch (post->media_type) {
+        case MEDIA_IMAGE:
+            printf("   🖼️  Image file\n");
+            break;
+        case MEDIA_VIDEO:
+            printf("   🎥 Video file\n");
+            break;
+        case MEDIA_AUDIO:
+            printf("   🎵 Audio file\n");
+            break;
+        default:
+            break;
+    }
+}
+
+// =============================================================================
+// Post Views - Feed pages and author posts
+// =============================================================================
+
+void display_feed(PriorityContext* ctx) {
+    FeedCursor cursor = {TIMELINE_PRIORITY, 0};
+    display_feed_page(ctx, &cursor);
+}
+
+// Prints one page of the feed and advances cursor. Returns 1 if more follow.
+int display_feed_page(PriorityContext* ctx, FeedCursor* cursor) {
+    if (ctx->current_user == NULL) {
+        printf("Please login first!\n");
+        return 0;
+    }
+    
+    int first_page = cursor->lane == TIMELINE_PRIORITY && cursor->before_id == 0;
+    printf("\n=== YOUR FEED ===\n");
+    
+    FeedPage page;
+    feed_query(ctx, ctx->current_user->user_id, *cursor, FEED_PAGE_SIZE, &page);
+    
+    int lane = -1;
+    for (int i = 0; i < page.count; i++) {
+        Post* post = page.items[i].post;
+        int item_lane = page.items[i].priority ? TIMELINE_PRIORITY : TIMELINE_REGULAR;
+        if (item_lane != lane) {
+            // Display priority posts first, then regular posts
+            lane = item_lane;
+            printf(lane == TIMELINE_PRIORITY ? "--- PRIORITY POSTS (Close Friends) ---\n" :
+                                               "\n--- REGULAR POSTS ---\n");
+        }
+        printf("\n[POST ID: %d] @%s\n", post->post_id, arena_str(ctx, post->author_name));
+        printf("%s\n", arena_str(ctx, post->content));
+        display_media_info(ctx, post);
+        printf("Posted on: %s", ctime(&post->created_at));
+        if (page.items[i].priority) {
+            printf("--- ⭐ PRIORITY ---\n");
+        }
+    }
+    
+    if (page.count == 0 && first_page) {
+        printf("No posts to display. Follow some users to see their posts!\n");
+    }
+    
+    printf("===============\n");
+    *cursor = page.next;
+    return page.has_more;
+}
+
+void display_user_posts(const PriorityContext* ctx, int user_id) {
+    User* user = find_user_by_id(ctx, user_id);
+    if (user == NULL) {
+        printf("User not found!\n");
+        return;
+    }
+    
+    printf("\n=== POSTS BY @%s ===\n", arena_str(ctx, user->username));
+    
+    // Newest first, straight from the author's index
+    int count;
+    const int* post_ids = post_store_by_author(&ctx->post_store, user_id, &count);
+    for (int i = count - 1; i >= 0; i--) {
+        Post* temp = post_store_find(&ctx->post_store, post_ids[i]);
+        printf("\n[POST ID: %d]\n", temp->post_id);
+        printf("%s\n", arena_str(ctx, temp->content));
+        display_media_info(ctx, temp);
+        printf("Posted on: %s", ctime(&temp->created_at));
+    }
+    
+    if (count == 0) {
+        printf("No posts found for this user.\n");
+    }
+    
+    printf("====================\n");
+}
+
+// =============================================================================
+// Follow Views - Followers and following lists
+// =============================================================================
+
+void display_followers(const PriorityContext* ctx, int user_id) {
+    User* user = find_user_by_id(ctx, user_id);
+    if (user == NULL) {
+        printf("User not found!\n");
+        return;
+    }
+    
+    printf("\n=== FOLLOWERS OF @%s ===\n", arena_str(ctx, user->username));
+    
+    EdgeIter followers;
+    int follower_id;
+    int count = 0;
+    follow_graph_followers(&ctx->follow_graph, user_id, &followers);
+    while (edge_iter_next(&followers, &follower_id)) {
+        User* follower = find_user_by_id(ctx, follower_id);
+        if (follower != NULL) {
+            printf("%d. @%s (ID: %d)\n", ++count, arena_str(ctx, follower->username), follower->user_id);
+        }
+    }
+    
+    if (count == 0) {
+        printf("No followers found.\n");
+    }
+    
+    printf("========================\n");
+}
+
+void display_following(const PriorityContext* ctx, int user_id) {
+    User* user = find_user_by_id(ctx, user_id);
+    if (user == NULL) {
+        printf("User not found!\n");
+        return;
+    }
+    
+    printf("\n=== @%s IS FOLLOWING ===\n", arena_str(ctx, user->username));
+    
+    EdgeIter followings;
+    int following_id;
+    int count = 0;
+    follow_graph_following(&ctx->follow_graph, user_id, &followings);
+    while (edge_iter_next(&followings, &following_id)) {
+        User* following = find_user_by_id(ctx, following_id);
+        if (following != NULL) {
+            char status[20] = "";
+            if (is_close_friend(ctx, user_id, following->user_id)) {
+                strcpy(status, " ⭐ CLOSE FRIEND");
+            }
+            printf("%d. @%s (ID: %d)%s\n", ++count, arena_str(ctx, following->username), 
+                   following->user_id, status);
+        }
+    }
+    
+    if (count == 0) {
+        printf("Not following anyone.\n");
+    }
+    
+    printf("========================\n");
+}
+
+// =============================================================================
+// Message Views - Inbox and conversations
+// =============================================================================
+
+void display_messages(const PriorityContext* ctx, int user_id) {
+    if (ctx->current_user == NULL) {
+        printf("Please login first!\n");
+        return;
+    }
+    
+    printf("\n=== YOUR MESSAGES ===\n");
+    
+    // Separate priority and regular messages
+    ScratchVec* priority_messages = scratch_acquire();
+    ScratchVec* regular_messages = scratch_acquire();
+    if (priority_messages == NULL || regular_messages == NULL) {
+        scratch_release(priority_messages);
+        scratch_release(regular_messages);
+        return;
+    }
+    
+    Message* temp = ctx->messages_head;
+    while (temp != NULL) {
+        if (temp->receiver_id == user_id || temp->sender_id == user_id) {
+            if (temp->priority == 1) {
+                scratch_push(priority_messages, temp);
+            } else {
+                scratch_push(regular_messages, temp);
+            }
+        }
+        temp = temp->next;
+    }
+    
+    // Display priority messages first
+    printf("--- PRIORITY MESSAGES (Close Friends) ---\n");
+    for (size_t i = 0; i < priority_messages->count; i++) {
+        Message* msg = (Message*)priority_messages->items[i];
+        char direction = (msg->sender_id == user_id) ? '→' : '←';
+        User* other_user = (msg->sender_id == user_id) ? 
+                          find_user_by_id(ctx, msg->receiver_id) : 
+                          find_user_by_id(ctx, msg->sender_id);
+        
+        printf("\n%c @%s [MSG ID: %d] ⭐\n", direction, 
+               other_user ? arena_str(ctx, other_user->username) : "Unknown", msg->message_id);
+        printf("%s\n", arena_str(ctx, msg->content));
+        printf("Time: %s", ctime(&msg->timestamp));
+    }
+    
+    printf("\n--- REGULAR MESSAGES ---\n");
+    for (size_t i = 0; i < regular_messages->count; i++) {
+        Message* msg = (Message*)regular_messages->items[i];
+        char direction = (msg->sender_id == user_id) ? '→' : '←';
+        User* other_user = (msg->sender_id == user_id) ? 
+                          find_user_by_id(ctx, msg->receiver_id) : 
+                          find_user_by_id(ctx, msg->sender_id);
+        
+        printf("\n%c @%s [MSG ID: %d]\n", direction, 
+               other_user ? arena_str(ctx, other_user->username) : "Unknown", msg->message_id);
+        printf("%s\n", arena_str(ctx, msg->content));
+        printf("Time: %s", ctime(&msg->timestamp));
+    }
+    
+    if (priority_messages->count == 0 && regular_messages->count == 0) {
+        printf("No messages found.\n");
+    }
+    
+    printf("====================\n");
+    scratch_release(priority_messages);
+    scratch_release(regular_messages);
+}
+
+void display_conversation(const PriorityContext* ctx, int other_user_id) {
+    if (ctx->current_user == NULL) {
+        printf("Please login first!\n");
+        return;
+    }
+    
+    User* other_user = find_user_by_id(ctx, other_user_id);
+    if (other_user == NULL) {
+        printf("User not found!\n");
+        return;
+    }
+    
+    printf("\n=== CONVERSATION WITH @%s ===\n", arena_str(ctx, other_user->username));
+    
+    // Already in chronological order
+    const Conversation* conversation = conversation_find(ctx, ctx->current_user->user_id, other_user_id);
+    int count = conversation ? conversation->count : 0;
+    for (int i = 0; i < count; i++) {
+        Message* msg = conversation->messages[i];
+        const char* sender_name = (msg->sender_id == ctx->current_user->user_id) ? 
+                           "You" : arena_str(ctx, other_user->username);
+        char priority_indicator = msg->priority ? '⭐' : ' ';
+        
+        printf("\n%s%c: %s\n", sender_name, priority_indicator, arena_str(ctx, msg->content));
+        printf("   %s", ctime(&msg->timestamp));
+    }
+    
+    if (count == 0) {
+        printf("No conversation found.\n");
+    }
+    
+    printf("===============================\n");
+}
+
+// =============================================================================
+// Close Friends Views
+// =============================================================================
+
+void display_close_friends(const PriorityContext* ctx) {
+    if (ctx->current_user == NULL) {
+        printf("Please login first!\n");
+        return;
+    }
+    
+    printf("\n=== YOUR CLOSE FRIENDS ===\n");
+    
+    EdgeIter iter;
+    int friend_id;
+    int count = 0;
+    close_friends_list(&ctx->close_friends, ctx->current_user->user_id, &iter);
+    while (edge_iter_next(&iter, &friend_id)) {
+        User* friend_user = find_user_by_id(ctx, friend_id);
+        if (friend_user != NULL) {
+            printf("%d. ⭐ @%s (ID: %d)\n", ++count, 
+                   arena_str(ctx, friend_user->username), friend_user->user_id);
+        }
+    }
+    
+    if (count == 0) {
+        printf("No close friends added yet.\n");
+        printf("Follow users and add them to your close friends for priority content!\n");
+    }
+    
+    printf("=========================\n");
+}
+
+// =============================================================================
+// Notification Views
+// =============================================================================
+
+void display_notifications(const PriorityContext* ctx) {
+    if (ctx->current_user == NULL) {
+        printf("Please login first!\n");
+        return;
+    }
+    
+    printf("\n=== YOUR NOTIFICATIONS ===\n");
+    
+    // Priority lane first, newest first in each
+    const NotificationBox* box = notification_box(ctx, ctx->current_user->user_id);
+    const NotificationLane* priority_notifs = box ? &box->lanes[1] : NULL;
+    const NotificationLane* regular_notifs = box ? &box->lanes[0] : NULL;
+    int priority_count = priority_notifs ? priority_notifs->count : 0;
+    int regular_count = regular_notifs ? regular_notifs->count : 0;
+    char text[MAX_MESSAGE_CONTENT];
+    
+    printf("--- PRIORITY NOTIFICATIONS ---\n");
+    for (int i = priority_count - 1; i >= 0; i--) {
+        Notification* notif = priority_notifs->items[i];
+        char status = notif->is_read ? ' ' : '●';
+        printf("\n%c [ID: %d] ⭐ %s\n", status, notif->notif_id, notification_render(ctx, notif, text, sizeof(text)));
+        printf("   Time: %s", ctime(&notif->timestamp));
+    }
+    
+    printf("\n--- REGULAR NOTIFICATIONS ---\n");
+    for (int i = regular_count - 1; i >= 0; i--) {
+        Notification* notif = regular_notifs->items[i];
+        char status = notif->is_read ? ' ' : '●';
+        printf("\n%c [ID: %d] %s\n", status, notif->notif_id, notification_render(ctx, notif, text, sizeof(text)));
+        printf("   Time: %s", ctime(&notif->timestamp));
+    }
+    
+    if (priority_count == 0 && regular_count == 0) {
+        printf("No notifications found.\n");
+    }
+    
+    printf("=========================\n");
+}
@@ -0,0 +1,147 @@
+/*
+ * PRIORITY SOCIAL MEDIA - SHA-256 and HMAC-SHA256
+ * FIPS 180-4 hash and RFC 2104 MAC over byte buffers
+ *
+ * Used by the web server to sign login tokens, so that every worker
+ * process can check a token without a shared session table. Only whole
+ * buffers are hashed; HMAC keys longer than a block are hashed first, as
+ * the RFC requires.
+ */
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define SHA256_BLOCK_BYTES 64
+#define SHA256_DIGEST_BYTES 32
+
+typedef struct Sha256 {
+    uint32_t state[8];
+    unsigned char block[SHA256_BLOCK_BYTES];
+    size_t block_len;
+    uint64_t total; // Bytes hashed so far
+} Sha256;
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t sha256_rotr(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+static inline void sha256_compress(Sha256* sha, const unsigned char* block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)block[i * 4] << 24 | (uint32_t)block[i * 4 + 1] << 16 |
+               (uint32_t)block[i * 4 + 2] << 8 | (uint32_t)block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = sha256_rotr(w[i - 15], 7) ^ sha256_rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = sha256_rotr(w[i - 2], 17) ^ sha256_rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = sha->state[0], b = sha->state[1], c = sha->state[2], d = sha->state[3];
+    uint32_t e = sha->state[4], f = sha->state[5], g = sha->state[6], h = sha->state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (sha256_rotr(e, 6) ^ sha256_rotr(e, 11) ^ sha256_rotr(e, 25)) +
+                      ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+        uint32_t t2 = (sha256_rotr(a, 2) ^ sha256_rotr(a, 13) ^ sha256_rotr(a, 22)) +
+                      ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    sha->state[0] += a; sha->state[1] += b; sha->state[2] += c; sha->state[3] += d;
+    sha->state[4] += e; sha->state[5] += f; sha->state[6] += g; sha->state[7] += h;
+}
+
+static inline void sha256_init(Sha256* sha) {
+    static const uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(sha->state, initial, sizeof(initial));
+    sha->block_len = 0;
+    sha->total = 0;
+}
+
+static inline void sha256_update(Sha256* sha, const void* data, size_t len) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    sha->total += len;
+    while (len > 0) {
+        size_t take = SHA256_BLOCK_BYTES - sha->block_len;
+        if (take > len) {
+            take = len;
+        }
+        memcpy(sha->block + sha->block_len, bytes, take);
+        sha->block_len += take;
+        bytes += take;
+        len -= take;
+        if (sha->block_len == SHA256_BLOCK_BYTES) {
+            sha256_compress(sha, sha->block);
+            sha->block_len = 0;
+        }
+    }
+}
+
+static inline void sha256_final(Sha256* sha, unsigned char digest[SHA256_DIGEST_BYTES]) {
+    uint64_t bits = sha->total * 8;
+    unsigned char pad = 0x80;
+    sha256_update(sha, &pad, 1);
+    pad = 0;
+    while (sha->block_len != SHA256_BLOCK_BYTES - 8) {
+        sha256_update(sha, &pad, 1);
+    }
+    unsigned char length[8];
+    for (int i = 0; i < 8; i++) {
+        length[i] = (unsigned char)(bits >> (56 - 8 * i));
+    }
+    sha256_update(sha, length, sizeof(length));
+    for (int i = 0; i < 8; i++) {
+        digest[i * 4] = (unsigned char)(sha->state[i] >> 24);
+        digest[i * 4 + 1] = (unsigned char)(sha->state[i] >> 16);
+        digest[i * 4 + 2] = (unsigned char)(sha->state[i] >> 8);
+        digest[i * 4 + 3] = (unsigned char)sha->state[i];
+    }
+}
+
+static inline void hmac_sha256(const void* key, size_t key_len, const void* data, size_t data_len,
+                               unsigned char mac[SHA256_DIGEST_BYTES]) {
+    unsigned char block[SHA256_BLOCK_BYTES];
+    memset(block, 0, sizeof(block));
+    Sha256 sha;
+    if (key_len > SHA256_BLOCK_BYTES) {
+        sha256_init(&sha);
+        sha256_update(&sha, key, key_len);
+        sha256_final(&sha, block);
+    } else {
+        memcpy(block, key, key_len);
+    }
+
+    unsigned char pad[SHA256_BLOCK_BYTES];
+    unsigned char inner[SHA256_DIGEST_BYTES];
+    for (int i = 0; i < SHA256_BLOCK_BYTES; i++) {
+        pad[i] = block[i] ^ 0x36;
+    }
+    sha256_init(&sha);
+    sha256_update(&sha, pad, sizeof(pad));
+    sha256_update(&sha, data, data_len);
+    sha256_final(&sha, inner);
+    for (int i = 0; i < SHA256_BLOCK_BYTES; i++) {
+        pad[i] = block[i] ^ 0x5c;
+    }
+    sha256_init(&sha);
+    sha256_update(&sha, pad, sizeof(pad));
+    sha256_update(&sha, inner, sizeof(inner));
+    sha256_final(&sha, mac);
+}
+
+#endif
@@ -0,0 +1,119 @@
+/*
+ * PRIORITY SOCIAL MEDIA - Slab Allocator
+ * Fixed-size records carved from large blocks, with a free list
+ *
+ * Used by libpriority for messages and notifications, which are created by
+ * the million. Items come from blocks of SLAB_BLOCK_BYTES, so a record costs
+ * its own size instead of its size plus malloc's header and rounding, and
+ * records created together sit next to each other. Records can be freed one
+ * at a time with slab_free, as notification retention does when it evicts
+ * read notifications: the item goes on a free list and is handed out again
+ * before the newest block is used further, so blocks are reused but never
+ * returned to malloc. slab_release returns every block at once. The
+ * counters are plain fields for stats pages and benchmarks.
+ * Not thread-safe: callers serialize allocation and release.
+ */
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SLAB_BLOCK_BYTES 65536 // Bytes requested from malloc at a time
+#define SLAB_ALIGN 8 // Item alignment; enough for pointers, time_t and long long
+
+// Header of every block; items follow it
+typedef struct SlabBlock {
+    struct SlabBlock* next;
+} SlabBlock;
+
+#define SLAB_HEADER_BYTES ((sizeof(SlabBlock) + SLAB_ALIGN - 1) / SLAB_ALIGN * SLAB_ALIGN)
+
+typedef struct SlabAllocator {
+    size_t item_size; // Record size rounded up to SLAB_ALIGN
+    size_t block_items; // Items that fit in one block
+    SlabBlock* blocks; // Newest first
+    void* free_list; // Freed items, linked through their first bytes
+    char* fresh; // Next never-used item in the newest block
+    size_t fresh_left; // Never-used items left in the newest block
+
+    size_t live; // Items handed out and not yet freed
+    size_t peak; // Highest live count since the last release
+    size_t alloc_count; // slab_alloc calls that succeeded
+    size_t free_count; // slab_free calls
+    size_t block_count;
+} SlabAllocator;
+
+static inline void slab_init(SlabAllocator* slab, size_t item_size) {
+    memset(slab, 0, sizeof(*slab));
+    if (item_size < sizeof(void*)) {
+        item_size = sizeof(void*); // Room for the free-list link
+    }
+    slab->item_size = (item_size + SLAB_ALIGN - 1) / SLAB_ALIGN * SLAB_ALIGN;
+    slab->block_items = (SLAB_BLOCK_BYTES - SLAB_HEADER_BYTES) / slab->item_size;
+    if (slab->block_items == 0) {
+        slab->block_items = 1;
+    }
+}
+
+// Bytes held from malloc, used or not
+static inline size_t slab_reserved_bytes(const SlabAllocator* slab) {
+    return slab->block_count * (SLAB_HEADER_BYTES + slab->block_items * slab->item_size);
+}
+
+// An uninitialized item, or NULL when memory ran out
+static inline void* slab_alloc(SlabAllocator* slab) {
+    void* item = slab->free_list;
+    if (item != NULL) {
+        memcpy(&slab->free_list, item, sizeof(void*));
+    } else {
+        if (slab->fresh_left == 0) {
+            SlabBlock* block = (SlabBlock*)malloc(SLAB_HEADER_BYTES + slab->block_items * slab->item_size);
+            if (block == NULL) {
+                return NULL;
+            }
+            block->next = slab->blocks;
+            slab->blocks = block;
+            slab->block_count++;
+            slab->fresh = (char*)block + SLAB_HEADER_BYTES;
+            slab->fresh_left = slab->block_items;
+        }
+        item = slab->fresh;
+        slab->fresh += slab->item_size;
+        slab->fresh_left--;
+    }
+    slab->alloc_count++;
+    if (++slab->live > slab->peak) {
+        slab->peak = slab->live;
+    }
+    return item;
+}
+
+// item must have come from this slab
+static inline void slab_free(SlabAllocator* slab, void* item) {
+    if (item == NULL) {
+        return;
+    }
+    memcpy(item, &slab->free_list, sizeof(void*));
+    slab->free_list = item;
+    slab->free_count++;
+    slab->live--;
+}
+
+// Frees every item at once; the slab stays ready for new items
+static inline void slab_release(SlabAllocator* slab) {
+    while (slab->blocks != NULL) {
+        SlabBlock* next = slab->blocks->next;
+        free(slab->blocks);
+        slab->blocks = next;
+    }
+    slab->free_list = NULL;
+    slab->fresh = NULL;
+    slab->fresh_left = 0;
+    slab->live = 0;
+    slab->peak = 0;
+    slab->block_count = 0;
+}
+
+#endif
@@ -0,0 +1,190 @@
+/*
+ * PRIORITY SOCIAL MEDIA - User Index
+ * Resizable open-addressing hash index: user id -> record, username -> record
+ *
+ * Shared by the engine library (priority.c) and the WebView backend
+ * (main.c). Records are opaque; the index never links through them, so the
+ * caller's own user list stays intact. The username table stores only the
+ * hash and the record and reads the name back through a caller-supplied
+ * accessor, so names can live in an arena that moves when it grows. The
+ * accessor receives name_ctx, so each engine context resolves names in its
+ * own arena.
+ *
+ * Lookups are safe alongside one inserting writer when the index has an
+ * epoch domain (epoch.h): a slot's key is written before its record is
+ * published, and a table that grows is replaced whole, with the old one
+ * retired to the domain. Without a domain, old tables are freed at once.
+ */
+
+#ifndef USER_INDEX_H
+#define USER_INDEX_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "epoch.h"
+
+#define USER_INDEX_INITIAL_CAPACITY 64 // Slots per table, always a power of two
+#define USER_INDEX_MAX_LOAD_PERCENT 70 // Tables double once they are this full
+
+typedef const char* (*UserNameFn)(void* ctx, const void* record);
+
+// One linear-probing table in a single allocation; an empty slot has record NULL
+typedef struct UserIndexTable {
+    size_t capacity;
+    uint32_t* keys; // User ids, or cached username hashes
+    void** records;
+} UserIndexTable;
+
+typedef struct UserIndex {
+    UserIndexTable* ids;   // id -> record
+    size_t id_count;
+    UserIndexTable* names; // username -> record (hash cached per slot to skip most string compares)
+    size_t name_count;
+
+    UserNameFn name_of;
+    void* name_ctx; // Passed to name_of
+    EpochDomain* epoch; // Where replaced tables are retired, NULL to free them at once
+} UserIndex;
+
+static inline uint32_t user_index_hash_id(int id) {
+    // Fibonacci hashing spreads sequential ids across the table
+    return (uint32_t)id * 2654435769u;
+}
+
+static inline uint32_t user_index_hash_name(const char* name) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    while (*name) {
+        hash ^= (unsigned char)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static inline void user_index_init(UserIndex* index, UserNameFn name_of, void* name_ctx) {
+    memset(index, 0, sizeof(*index));
+    index->name_of = name_of;
+    index->name_ctx = name_ctx;
+}
+
+// Frees both tables at once; no reader may be using the index
+static inline void user_index_free(UserIndex* index) {
+    UserNameFn name_of = index->name_of;
+    void* name_ctx = index->name_ctx;
+    EpochDomain* epoch = index->epoch;
+    free(index->ids);
+    free(index->names);
+    user_index_init(index, name_of, name_ctx);
+    index->epoch = epoch;
+}
+
+static inline UserIndexTable* user_index_table_new(size_t capacity) {
+    UserIndexTable* table = (UserIndexTable*)calloc(1, sizeof(UserIndexTable) +
+                                                    capacity * (sizeof(void*) + sizeof(uint32_t)));
+    if (table == NULL) {
+        return NULL;
+    }
+    table->capacity = capacity;
+    table->records = (void**)(table + 1);
+    table->keys = (uint32_t*)(table->records + capacity);
+    return table;
+}
+
+// Fills the first free slot of the key's probe run; the record goes in last
+static inline void user_index_place(UserIndexTable* table, uint32_t hash, uint32_t key, void* record) {
+    size_t mask = table->capacity - 1;
+    size_t slot = hash & mask;
+    while (table->records[slot] != NULL) {
+        slot = (slot + 1) & mask;
+    }
+    table->keys[slot] = key;
+    EPOCH_PUBLISH(&table->records[slot], record);
+}
+
+// Doubles a table into a fresh copy, then swaps it in for readers
+static inline int user_index_grow(UserIndex* index, UserIndexTable** slot, int by_id) {
+    UserIndexTable* old = *slot;
+    UserIndexTable* table = user_index_table_new(old ? old->capacity * 2 : USER_INDEX_INITIAL_CAPACITY);
+    if (table == NULL) {
+        return 0;
+    }
+
+    for (size_t i = 0; old != NULL && i < old->capacity; i++) {
+        if (old->records[i] != NULL) {
+            uint32_t key = old->keys[i];
+            user_index_place(table, by_id ? user_index_hash_id((int)key) : key, key, old->records[i]);
+        }
+    }
+    EPOCH_PUBLISH(slot, table);
+    epoch_retire(index->epoch, old);
+    return 1;
+}
+
+static inline void* user_index_find_id(const UserIndex* index, int id) {
+    const UserIndexTable* table = EPOCH_LOAD(&index->ids);
+    if (table == NULL) {
+        return NULL;
+    }
+
+    size_t mask = table->capacity - 1;
+    size_t slot = user_index_hash_id(id) & mask;
+    void* record;
+    while ((record = EPOCH_LOAD(&table->records[slot])) != NULL) {
+        if (table->keys[slot] == (uint32_t)id) {
+            return record;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return NULL;
+}
+
+static inline void* user_index_find_name(const UserIndex* index, const char* name) {
+    const UserIndexTable* table = EPOCH_LOAD(&index->names);
+    if (table == NULL || name == NULL) {
+        return NULL;
+    }
+
+    uint32_t hash = user_index_hash_name(name);
+    size_t mask = table->capacity - 1;
+    size_t slot = hash & mask;
+    void* record;
+    while ((record = EPOCH_LOAD(&table->records[slot])) != NULL) {
+        if (table->keys[slot] == hash &&
+            strcmp(index->name_of(index->name_ctx, record), name) == 0) {
+            return record;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return NULL;
+}
+
+// Adds a record under its id and username. Returns 0 when the id or the
+// name is already present or memory runs out.
+static inline int user_index_insert(UserIndex* index, int id, void* record) {
+    if (record == NULL) {
+        return 0;
+    }
+    const char* name = index->name_of(index->name_ctx, record);
+    if (user_index_find_id(index, id) != NULL || user_index_find_name(index, name) != NULL) {
+        return 0;
+    }
+
+    if ((index->ids == NULL || (index->id_count + 1) * 100 > index->ids->capacity * USER_INDEX_MAX_LOAD_PERCENT) &&
+        !user_index_grow(index, &index->ids, 1)) {
+        return 0;
+    }
+    if ((index->names == NULL || (index->name_count + 1) * 100 > index->names->capacity * USER_INDEX_MAX_LOAD_PERCENT) &&
+        !user_index_grow(index, &index->names, 0)) {
+        return 0;
+    }
+
+    user_index_place(index->ids, user_index_hash_id(id), (uint32_t)id, record);
+    index->id_count++;
+    uint32_t hash = user_index_hash_name(name);
+    user_index_place(index->names, hash, hash, record);
+    index->name_count++;
+    return 1;
+}
+
+#endif
@@ -1,17 +1,64 @@
+/*
+ * PRIORITY SOCIAL MEDIA - Web Server
+ * Event-driven HTTP/1.1 server: each worker process runs one edge-triggered
+ * epoll loop over non-blocking sockets, with keep-alive and pipelined
+ * requests, on its own SO_REUSEPORT listening socket. /api/ serves a JSON
+ * REST API backed by libpriority (data in the working directory).
+ *
+ * Environment: PORT (default 10000), BACKLOG (listen queue, default 1024)
+ *              WORKERS (processes, default 1), PIN_CPUS=1 pins worker i to
+ *              core i.
+ *              Worker 0 appends every change to data.wal and fsyncs once
+ *              per event loop batch; responses to API requests that may
+ *              change data are held until that fsync. SIGTERM drains
+ *              in-flight requests, then syncs the log.
+ *              Login tokens are signed with a key drawn before the
+ *              workers fork, so every worker accepts them. Each worker
+ *              still holds its own copy of the engine, loaded at startup:
+ *              workers other than 0 are read-only and do not see later
+ *              changes, and answer 503 to requests that change data, since
+ *              only worker 0 persists. Use WORKERS > 1 only for read
+ *              traffic that can be stale.
+ *              FANOUT_THREADS (default 2, 0 = inline) threads per worker
+ *              deliver new posts to followers after the response is sent.
+ * Load test:   make loadtest && ./loadtest -c 64 -d 10
+ */
+
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/wait.h>
+#include <sys/random.h>
+#include <sys/mman.h>
+#include <sched.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "priority.h"
+#include "json_writer.h"
+#include "sha256.h"
 
-#define BUFFER_SIZE 1024
+#define DEFAULT_PORT 10000
+#define DEFAULT_BACKLOG 1024
+#define READ_CHUNK 16384
+#define MAX_EVENTS 256
+#define MAX_HEADER_SIZE 8192 // Request line plus headers
+#define MAX_BODY_SIZE (1 << 20)
+#define MAX_PENDING_OUTPUT (1 << 20) // Stop answering pipelined requests until the client reads
+#define IDLE_TIMEOUT_SECONDS 30
+#define DRAIN_TIMEOUT_SECONDS 10 // Longest a stopping worker waits for in-flight requests
+#define MAX_WORKERS 256
 
-const char* html_response = 
-"HTTP/1.1 200 OK\r\n"
-"Content-Type: text/html\r\n"
-"Connection: close\r\n"
-"\r\n"
+const char* html_page =
 "<!DOCTYPE html>\n"
 "<html>\n"
 "<head>\n"
@@ -41,30 +88,1434 @@ const char* html_response =
 "    </div>\n"
 "</body>\n"
 "</html>";
+typedef struct Buffer {
+    char* data;
+    size_t len;
+    size_t capacity;
+} Buffer;
 
-int main() {
-    int server_fd, new_socket;
-    struct sockaddr_in address;
-    int opt = 1;
-    int addrlen = sizeof(address);
-    char buffer[BUFFER_SIZE] = {0};
+typedef struct HttpRequest {
+    const char* method;
+    size_t method_len;
+    const char* path; // Without the query string
+    size_t path_len;
+    const char* query; // After '?', possibly empty
+    size_t query_len;
+    const char* authorization;
+    size_t authorization_len;
+    int keep_alive;
+    const char* body;
+    size_t body_len;
+} HttpRequest;
+
+typedef struct Connection {
+    int fd;
+    Buffer in;
+    size_t in_start; // First byte of in not yet parsed
+    Buffer out;
+    size_t out_sent; // Bytes of out already written
+    int closing;     // Close once out is flushed
+    int awaiting_sync; // Out is held until the log group of its changes is synced
+    size_t held_from; // Where the held output starts in out
+    time_t last_active;
+} Connection;
+
+// Open connections indexed by fd
+static Connection** connections = NULL;
+static int connection_capacity = 0;
+static int connection_count = 0;
+
+// Fds of connections with awaiting_sync set, released after the next wal_idle
+// (-1 once the connection closes)
+static int* held_fds = NULL;
+static int held_count = 0;
+static int held_capacity = 0;
+
+// 1 once SIGTERM arrives, 2 after the listening socket is closed
+static volatile sig_atomic_t draining = 0;
+
+static int buffer_reserve(Buffer* buffer, size_t extra) {
+    if (buffer->len + extra <= buffer->capacity) {
+        return 1;
+    }
+    size_t capacity = buffer->capacity ? buffer->capacity : READ_CHUNK;
+    while (capacity < buffer->len + extra) {
+        capacity *= 2;
+    }
+    char* data = realloc(buffer->data, capacity);
+    if (data == NULL) {
+        return 0;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return 1;
+}
+
+static int buffer_append(Buffer* buffer, const char* data, size_t len) {
+    if (!buffer_reserve(buffer, len)) {
+        return 0;
+    }
+    memcpy(buffer->data + buffer->len, data, len);
+    buffer->len += len;
+    return 1;
+}
+
+// =============================================================================
+// Request parsing
+// =============================================================================
+
+static int header_is(const char* name, size_t len, const char* expected) {
+    return strlen(expected) == len && strncasecmp(name, expected, len) == 0;
+}
+
+// Whether a comma-separated header value lists token
+static int header_has_token(const char* value, size_t len, const char* token) {
+    size_t token_len = strlen(token);
+    size_t i = 0;
+    while (i < len) {
+        while (i < len && (value[i] == ' ' || value[i] == '\t' || value[i] == ',')) i++;
+        size_t start = i;
+        while (i < len && value[i] != ',') i++;
+        size_t end = i;
+        while (end > start && (value[end - 1] == ' ' || value[end - 1] == '\t')) end--;
+        if (end - start == token_len && strncasecmp(value + start, token, token_len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Parses one request from the front of data. Returns the bytes it spans,
+// 0 when it is still incomplete, or a negative HTTP status when malformed.
+static long parse_request(const char* data, size_t len, HttpRequest* req) {
+    if (len == 0) {
+        return 0;
+    }
+    size_t window = len < MAX_HEADER_SIZE ? len : MAX_HEADER_SIZE;
+    const char* end = memmem(data, window, "\r\n\r\n", 4);
+    if (end == NULL) {
+        return len >= MAX_HEADER_SIZE ? -431 : 0;
+    }
+    size_t header_len = (size_t)(end - data) + 4;
+
+    // Request line: METHOD SP target SP HTTP/1.x
+    const char* line_end = memchr(data, '\r', header_len);
+    const char* sp1 = memchr(data, ' ', (size_t)(line_end - data));
+    const char* sp2 = sp1 ? memchr(sp1 + 1, ' ', (size_t)(line_end - sp1 - 1)) : NULL;
+    if (line_end[1] != '\n' || sp1 == NULL || sp2 == NULL || sp1 == data || sp2 == sp1 + 1 ||
+        line_end - sp2 - 1 != 8 || strncmp(sp2 + 1, "HTTP/1.", 7) != 0 ||
+        (sp2[8] != '0' && sp2[8] != '1')) {
+        return -400;
+    }
+    memset(req, 0, sizeof(*req));
+    req->method = data;
+    req->method_len = (size_t)(sp1 - data);
+    req->path = sp1 + 1;
+    const char* query = memchr(req->path, '?', (size_t)(sp2 - req->path));
+    req->path_len = (size_t)((query ? query : sp2) - req->path);
+    req->query = query ? query + 1 : sp2;
+    req->query_len = (size_t)(sp2 - req->query);
+    req->keep_alive = sp2[8] == '1'; // HTTP/1.1 defaults to keep-alive, 1.0 to close
+
+    size_t content_length = 0;
+    const char* headers_end = end + 2;
+    for (const char* line = line_end + 2; line < headers_end;) {
+        const char* eol = memchr(line, '\r', (size_t)(headers_end - line));
+        const char* colon = memchr(line, ':', (size_t)(eol - line));
+        if (eol[1] != '\n' || colon == NULL || colon == line) {
+            return -400;
+        }
+        const char* value = colon + 1;
+        const char* value_end = eol;
+        while (value < value_end && (*value == ' ' || *value == '\t')) value++;
+        while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t')) value_end--;
+        size_t name_len = (size_t)(colon - line);
+        size_t value_len = (size_t)(value_end - value);
+
+        if (header_is(line, name_len, "Content-Length")) {
+            if (value_len == 0) {
+                return -400;
+            }
+            content_length = 0;
+            for (const char* digit = value; digit < value_end; digit++) {
+                if (*digit < '0' || *digit > '9') {
+                    return -400;
+                }
+                content_length = content_length * 10 + (size_t)(*digit - '0');
+                if (content_length > MAX_BODY_SIZE) {
+                    return -413;
+                }
+            }
+        } else if (header_is(line, name_len, "Transfer-Encoding")) {
+            return -501; // Chunked request bodies are not supported
+        } else if (header_is(line, name_len, "Authorization")) {
+            req->authorization = value;
+            req->authorization_len = value_len;
+        } else if (header_is(line, name_len, "Connection")) {
+            if (header_has_token(value, value_len, "close")) {
+                req->keep_alive = 0;
+            } else if (header_has_token(value, value_len, "keep-alive")) {
+                req->keep_alive = 1;
+            }
+        }
+        line = eol + 2;
+    }
+
+    if (len - header_len < content_length) {
+        return 0;
+    }
+    req->body = data + header_len;
+    req->body_len = content_length;
+    return (long)(header_len + content_length);
+}
+
+// =============================================================================
+// Responses
+// =============================================================================
+
+static const char* status_reason(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 201: return "Created";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 409: return "Conflict";
+        case 413: return "Payload Too Large";
+        case 431: return "Request Header Fields Too Large";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        default: return "Internal Server Error";
+    }
+}
+
+static void send_response(Connection* c, int status, const char* content_type,
+                          const char* body, size_t body_len, int keep_alive, int head_only) {
+    if (draining) {
+        keep_alive = 0; // Tell the client to reconnect elsewhere
+    }
+    char header[256];
+    int header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.1 %d %s\r\n"
+                              "Content-Type: %s\r\n"
+                              "Content-Length: %zu\r\n"
+                              "Connection: %s\r\n"
+                              "\r\n",
+                              status, status_reason(status), content_type, body_len,
+                              keep_alive ? "keep-alive" : "close");
+    if (!buffer_append(&c->out, header, (size_t)header_len) ||
+        (!head_only && !buffer_append(&c->out, body, body_len))) {
+        printf("Memory allocation failed!\n");
+        keep_alive = 0;
+    }
+    if (!keep_alive) {
+        c->closing = 1;
+    }
+}
+
+static void send_error(Connection* c, int status) {
+    char body[64];
+    int body_len = snprintf(body, sizeof(body), "%d %s\n", status, status_reason(status));
+    send_response(c, status, "text/plain", body, (size_t)body_len, 0, 0);
+}
+
+// =============================================================================
+// REST API over libpriority
+// =============================================================================
+
+#define API_TOKEN_PAYLOAD_BYTES 16 // User id, logout count and expiry
+#define API_TOKEN_MAC_BYTES 16 // HMAC-SHA256, truncated
+#define API_TOKEN_LENGTH ((API_TOKEN_PAYLOAD_BYTES + API_TOKEN_MAC_BYTES) * 2) // Hex digits
+#define API_TOKEN_SECONDS (7 * 24 * 3600) // How long a login stays valid
+#define API_LIST_DEFAULT 50
+#define API_LIST_MAX 200
+
+static PriorityContext engine; // This worker's copy of the social data
+static int worker_index = 0; // Only worker 0 logs changes, so only it accepts writes
+
+// Tokens are signed rather than stored, so any worker can check one. The
+// key and the logout counts are set up by main before the workers fork; the
+// counts live in shared memory so a logout reaches every worker.
+static unsigned char token_key[SHA256_DIGEST_BYTES];
+static uint32_t* logout_counts = NULL; // Indexed by user id
+
+// Every API response body is built here; the buffer is reused across requests
+static JsonWriter api_json;
+
+// --- Request bodies: flat JSON objects such as {"username":"a","password":"b"}
+
+static const char* json_skip_ws(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+    return p;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static size_t utf8_encode(unsigned int code, char* out) {
+    if (code < 0x80) {
+        out[0] = (char)code;
+        return 1;
+    }
+    if (code < 0x800) {
+        out[0] = (char)(0xC0 | (code >> 6));
+        out[1] = (char)(0x80 | (code & 0x3F));
+        return 2;
+    }
+    if (code < 0x10000) {
+        out[0] = (char)(0xE0 | (code >> 12));
+        out[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (code & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (code >> 18));
+    out[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (code & 0x3F));
+    return 4;
+}
+
+static int json_read_hex4(const char* p, const char* end, unsigned int* code) {
+    if (end - p < 4) {
+        return 0;
+    }
+    *code = 0;
+    for (int i = 0; i < 4; i++) {
+        int digit = hex_value(p[i]);
+        if (digit < 0) {
+            return 0;
+        }
+        *code = *code * 16 + (unsigned int)digit;
+    }
+    return 1;
+}
+
+// Decodes the string starting after its opening quote into out (NULL just
+// skips it). Returns the position after the closing quote, or NULL when the
+// string is malformed or does not fit.
+static const char* json_read_string(const char* p, const char* end, char* out, size_t size) {
+    size_t len = 0;
+    while (p < end && *p != '"') {
+        char bytes[4];
+        size_t count = 1;
+        if ((unsigned char)*p < 0x20) {
+            return NULL;
+        }
+        if (*p != '\\') {
+            bytes[0] = *p++;
+        } else {
+            if (++p >= end) {
+                return NULL;
+            }
+            char escape = *p++;
+            switch (escape) {
+                case '"': case '\\': case '/': bytes[0] = escape; break;
+                case 'b': bytes[0] = '\b'; break;
+                case 'f': bytes[0] = '\f'; break;
+                case 'n': bytes[0] = '\n'; break;
+                case 'r': bytes[0] = '\r'; break;
+                case 't': bytes[0] = '\t'; break;
+                case 'u': {
+                    unsigned int code, low;
+                    if (!json_read_hex4(p, end, &code)) {
+                        return NULL;
+                    }
+                    p += 4;
+                    if (code >= 0xD800 && code < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u' &&
+                        json_read_hex4(p + 2, end, &low) && low >= 0xDC00 && low < 0xE000) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        p += 6;
+                    } else if (code >= 0xD800 && code < 0xE000) {
+                        code = 0xFFFD; // Unpaired surrogate
+                    }
+                    if (code == 0) {
+                        return NULL; // Would truncate the C string
+                    }
+                    count = utf8_encode(code, bytes);
+                    break;
+                }
+                default:
+                    return NULL;
+            }
+        }
+        if (out != NULL) {
+            if (len + count >= size) {
+                return NULL;
+            }
+            memcpy(out + len, bytes, count);
+        }
+        len += count;
+    }
+    if (p >= end) {
+        return NULL;
+    }
+    if (out != NULL) {
+        out[len] = '\0';
+    }
+    return p + 1;
+}
+
+// Returns the position after any JSON value, or NULL when malformed
+static const char* json_skip_value(const char* p, const char* end) {
+    if (p >= end) {
+        return NULL;
+    }
+    if (*p == '"') {
+        return json_read_string(p + 1, end, NULL, 0);
+    }
+    if (*p == '{' || *p == '[') {
+        int depth = 0;
+        while (p < end) {
+            if (*p == '"') {
+                p = json_read_string(p + 1, end, NULL, 0);
+                if (p == NULL) {
+                    return NULL;
+                }
+                continue;
+            }
+            if (*p == '{' || *p == '[') depth++;
+            if (*p == '}' || *p == ']') depth--;
+            p++;
+            if (depth == 0) {
+                return p;
+            }
+        }
+        return NULL;
+    }
+    const char* start = p;
+    while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\t' &&
+           *p != '\r' && *p != '\n') {
+        p++;
+    }
+    return p > start ? p : NULL;
+}
+
+// Finds a key of the top-level body object and returns its value's position
+static const char* body_field(const HttpRequest* req, const char* key) {
+    const char* end = req->body + req->body_len;
+    const char* p = json_skip_ws(req->body, end);
+    if (p >= end || *p != '{') {
+        return NULL;
+    }
+    p = json_skip_ws(p + 1, end);
+    while (p < end && *p == '"') {
+        char name[64];
+        const char* after = json_read_string(p + 1, end, name, sizeof(name));
+        int match = after != NULL && strcmp(name, key) == 0;
+        if (after == NULL) {
+            after = json_read_string(p + 1, end, NULL, 0); // Long key: never one of ours
+            if (after == NULL) {
+                return NULL;
+            }
+        }
+        p = json_skip_ws(after, end);
+        if (p >= end || *p != ':') {
+            return NULL;
+        }
+        p = json_skip_ws(p + 1, end);
+        if (match) {
+            return p;
+        }
+        p = json_skip_value(p, end);
+        if (p == NULL) {
+            return NULL;
+        }
+        p = json_skip_ws(p, end);
+        if (p < end && *p == ',') {
+            p = json_skip_ws(p + 1, end);
+        }
+    }
+    return NULL;
+}
+
+// Copies a non-empty string field into out. Returns 0 if missing or too long.
+static int body_string(const HttpRequest* req, const char* key, char* out, size_t size) {
+    const char* value = body_field(req, key);
+    return value != NULL && *value == '"' &&
+           json_read_string(value + 1, req->body + req->body_len, out, size) != NULL && out[0] != '\0';
+}
+
+static int body_int(const HttpRequest* req, const char* key, int* out) {
+    const char* value = body_field(req, key);
+    const char* end = req->body + req->body_len;
+    if (value == NULL) {
+        return 0;
+    }
+    int negative = value < end && *value == '-';
+    const char* digit = value + negative;
+    long long parsed = 0;
+    if (digit >= end || *digit < '0' || *digit > '9') {
+        return 0;
+    }
+    while (digit < end && *digit >= '0' && *digit <= '9') {
+        parsed = parsed * 10 + (*digit++ - '0');
+        if (parsed > INT_MAX) {
+            return 0;
+        }
+    }
+    *out = (int)(negative ? -parsed : parsed);
+    return 1;
+}
+
+// Percent-decoded value of one query-string parameter
+static int query_param(const HttpRequest* req, const char* key, char* out, size_t size) {
+    size_t key_len = strlen(key);
+    const char* p = req->query;
+    const char* end = req->query + req->query_len;
+    while (p < end) {
+        const char* amp = memchr(p, '&', (size_t)(end - p));
+        const char* item_end = amp ? amp : end;
+        const char* eq = memchr(p, '=', (size_t)(item_end - p));
+        if (eq != NULL && (size_t)(eq - p) == key_len && memcmp(p, key, key_len) == 0) {
+            size_t len = 0;
+            for (const char* v = eq + 1; v < item_end; v++) {
+                char c = *v;
+                if (c == '+') {
+                    c = ' ';
+                } else if (c == '%' && item_end - v > 2 && hex_value(v[1]) >= 0 && hex_value(v[2]) >= 0) {
+                    c = (char)(hex_value(v[1]) * 16 + hex_value(v[2]));
+                    v += 2;
+                }
+                if (len + 1 >= size) {
+                    return 0;
+                }
+                out[len++] = c;
+            }
+            out[len] = '\0';
+            return 1;
+        }
+        p = item_end + 1;
+    }
+    return 0;
+}
+
+static int query_limit(const HttpRequest* req, int fallback, int max) {
+    char text[16];
+    int limit = query_param(req, "limit", text, sizeof(text)) ? atoi(text) : fallback;
+    if (limit <= 0) limit = fallback;
+    return limit > max ? max : limit;
+}
+
+// --- Sessions: signed bearer tokens
+
+static void token_store_u32(unsigned char* p, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static uint32_t token_load_u32(const unsigned char* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Draws the signing key and maps the shared logout counts; 0 on failure
+static int session_init(void) {
+    if (getrandom(token_key, sizeof(token_key), 0) != (ssize_t)sizeof(token_key)) {
+        return 0;
+    }
+    void* counts = mmap(NULL, (MAX_USERS + 1) * sizeof(uint32_t), PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (counts == MAP_FAILED) {
+        return 0;
+    }
+    logout_counts = counts;
+    return 1;
+}
+
+// Payload: user id, the user's logout count when issued, expiry (low and
+// high words), then its MAC
+static const char* session_create(int user_id) {
+    static const char hex[] = "0123456789abcdef";
+    static char token[API_TOKEN_LENGTH + 1];
+    unsigned char bytes[API_TOKEN_PAYLOAD_BYTES + SHA256_DIGEST_BYTES];
+    uint64_t expires = (uint64_t)time(NULL) + API_TOKEN_SECONDS;
+    token_store_u32(bytes, (uint32_t)user_id);
+    token_store_u32(bytes + 4, __atomic_load_n(&logout_counts[user_id], __ATOMIC_RELAXED));
+    token_store_u32(bytes + 8, (uint32_t)expires);
+    token_store_u32(bytes + 12, (uint32_t)(expires >> 32));
+    hmac_sha256(token_key, sizeof(token_key), bytes, API_TOKEN_PAYLOAD_BYTES, bytes + API_TOKEN_PAYLOAD_BYTES);
+    for (int i = 0; i < API_TOKEN_LENGTH / 2; i++) {
+        token[i * 2] = hex[bytes[i] >> 4];
+        token[i * 2 + 1] = hex[bytes[i] & 15];
+    }
+    token[API_TOKEN_LENGTH] = '\0';
+    return token;
+}
+
+// The user behind "Authorization: Bearer <token>", or NULL when the token
+// is malformed, forged, expired or older than the user's last logout
+static User* session_user(const HttpRequest* req) {
+    const char* prefix = "Bearer ";
+    if (req->authorization_len != strlen(prefix) + API_TOKEN_LENGTH ||
+        strncasecmp(req->authorization, prefix, strlen(prefix)) != 0) {
+        return NULL;
+    }
+    const char* text = req->authorization + strlen(prefix);
+    unsigned char bytes[API_TOKEN_LENGTH / 2];
+    for (int i = 0; i < API_TOKEN_LENGTH / 2; i++) {
+        int high = hex_value(text[i * 2]), low = hex_value(text[i * 2 + 1]);
+        if (high < 0 || low < 0) {
+            return NULL;
+        }
+        bytes[i] = (unsigned char)(high * 16 + low);
+    }
+    unsigned char mac[SHA256_DIGEST_BYTES];
+    hmac_sha256(token_key, sizeof(token_key), bytes, API_TOKEN_PAYLOAD_BYTES, mac);
+    unsigned char diff = 0; // Compared in full, so timing does not reveal a prefix
+    for (int i = 0; i < API_TOKEN_MAC_BYTES; i++) {
+        diff |= mac[i] ^ bytes[API_TOKEN_PAYLOAD_BYTES + i];
+    }
+    uint32_t user_id = token_load_u32(bytes);
+    uint64_t expires = token_load_u32(bytes + 8) | (uint64_t)token_load_u32(bytes + 12) << 32;
+    if (diff != 0 || user_id == 0 || user_id > MAX_USERS || expires < (uint64_t)time(NULL) ||
+        token_load_u32(bytes + 4) != __atomic_load_n(&logout_counts[user_id], __ATOMIC_RELAXED)) {
+        return NULL;
+    }
+    return find_user_by_id(&engine, (int)user_id);
+}
+
+// --- Handlers: each writes its body into api_json and returns the status
+
+static int api_error(int status, const char* message) {
+    json_writer_begin_object(&api_json);
+    json_writer_key(&api_json, "error");
+    json_writer_string(&api_json, message);
+    json_writer_end_object(&api_json);
+    return status;
+}
+
+static int api_ok(void) {
+    json_writer_begin_object(&api_json);
+    json_writer_key(&api_json, "ok");
+    json_writer_bool(&api_json, 1);
+    json_writer_end_object(&api_json);
+    return 200;
+}
+
+static int api_register(const HttpRequest* req, User* user) {
+    (void)user;
+    char username[MAX_USERNAME], password[MAX_PASSWORD];
+    if (!body_string(req, "username", username, sizeof(username)) ||
+        !body_string(req, "password", password, sizeof(password))) {
+        return api_error(400, "username and password are required (max 49 characters)");
+    }
+    int user_id = register_user(&engine, username, password);
+    if (!user_id) {
+        return find_user_by_username(&engine, username) ? api_error(409, "Username already exists")
+                                                        : api_error(500, engine.error);
+    }
+    json_writer_begin_object(&api_json);
+    json_writer_key(&api_json, "userId");
+    json_writer_int(&api_json, user_id);
+    json_writer_end_object(&api_json);
+    return 201;
+}
+
+static int api_login(const HttpRequest* req, User* user) {
+    (void)user;
+    char username[MAX_USERNAME], password[MAX_PASSWORD];
+    if (!body_string(req, "username", username, sizeof(username)) ||
+        !body_string(req, "password", password, sizeof(password))) {
+        return api_error(400, "username and password are required");
+    }
+    User* found = login_user(&engine, username, password);
+    engine.current_user = NULL; // Sessions, not the engine's single current user, track logins
+    if (found == NULL) {
+        return api_error(401, "Invalid username or password");
+    }
+    const char* token = session_create(found->user_id);
+    json_writer_begin_object(&api_json);
+    json_writer_key(&api_json, "token");
+    json_writer_string(&api_json, token);
+    json_writer_key(&api_json, "userId");
+    json_writer_int(&api_json, found->user_id);
+    json_writer_end_object(&api_json);
+    return 200;
+}
+
+// Ends every session of the user, on every worker
+static int api_logout(const HttpRequest* req, User* user) {
+    (void)req;
+    __atomic_add_fetch(&logout_counts[user->user_id], 1, __ATOMIC_RELAXED);
+    return api_ok();
+}
+
+static int api_profile(const HttpRequest* req, User* user) {
+    (void)user;
+    const char* id_text = req->path + strlen("/api/users/");
+    char* end;
+    long user_id = strtol(id_text, &end, 10);
+    User* profile = end == req->path + req->path_len && end > id_text ? find_user_by_id(&engine, (int)user_id) : NULL;
+    if (profile == NULL) {
+        return api_error(404, "User not found");
+    }
+    json_writer_begin_object(&api_json);
+    json_writer_key(&api_json, "userId"); json_writer_int(&api_json, profile->user_id);
+    json_writer_key(&api_json, "username"); json_writer_string(&api_json, arena_str(&engine, profile->username));
+    json_writer_key(&api_json, "createdAt"); json_writer_int64(&api_json, (long long)profile->created_at);
+    json_writer_key(&api_json, "followers");
+    json_writer_int(&api_json, follow_graph_follower_count(&engine.follow_graph, profile->user_id));
+    json_writer_key(&api_json, "following");
+    json_writer_int(&api_json, follow_graph_following_count(&engine.follow_graph, profile->user_id));
+    json_writer_end_object(&api_json);
+    return 200;
+}
+
+static int api_follow_change(const HttpRequest* req, User* user, int follow) {
+    int target;
+    if (!body_int(req, "userId", &target)) {
+        return api_error(400, "userId is required");
+    }
+    if (find_user_by_id(&engine, target) == NULL) {
+        return api_error(404, "User not found");
+    }
+    if (target == user->user_id) {
+        return api_error(400, "You cannot follow yourself");
+    }
+    if (is_following(&engine, user->user_id, target) == follow) {
+        return api_error(409, follow ? "Already following" : "Not following");
+    }
+    int done = follow ? follow_user(&engine, target) : unfollow_user(&engine, target);
+    return done ? api_ok() : api_error(500, engine.error);
+}
+
+static int api_follow(const HttpRequest* req, User* user) {
+    return api_follow_change(req, user, 1);
+}
+
+static int api_unfollow(const HttpRequest* req, User* user) {
+    return api_follow_change(req, user, 0);
+}
+
+static int api_create_post(const HttpRequest* req, User* user) {
+    (void)user;
+    char content[MAX_POST_CONTENT];
+    if (!body_string(req, "content", content, sizeof(content))) {
+        return api_error(400, "content is required (max 4999 bytes)");
+    }
+    int post_id = create_post(&engine, content);
+    if (!post_id) {
+        return api_error(500, engine.error);
+    }
+    json_writer_begin_object(&api_json);
+    json_writer_key(&api_json, "postId");
+    json_writer_int(&api_json, post_id);
+    json_writer_end_object(&api_json);
+    return 201;
+}
+
+static int api_feed(const HttpRequest* req, User* user) {
+    char cursor_text[32] = "";
+    FeedCursor cursor;
+    query_param(req, "cursor", cursor_text, sizeof(cursor_text));
+    if (!feed_cursor_parse(cursor_text, &cursor)) {
+        return api_error(400, "Invalid cursor");
+    }
+
+    FeedPage page;
+    feed_query(&engine, user->user_id, cursor, query_limit(req, FEED_PAGE_SIZE, FEED_PAGE_MAX), &page);
+
+    json_writer_begin_object(&api_json);
+    json_writer_key(&api_json, "posts");
+    json_writer_begin_array(&api_json);
+    for (int i = 0; i < page.count; i++) {
+        const Post* post = page.items[i].post;
+        json_writer_begin_object(&api_json);
+        json_writer_key(&api_json, "postId"); json_writer_int(&api_json, post->post_id);
+        json_writer_key(&api_json, "authorId"); json_writer_int(&api_json, post->author_id);
+        json_writer_key(&api_json, "authorName"); json_writer_string(&api_json, arena_str(&engine, post->author_name));
+        json_writer_key(&api_json, "content"); json_writer_string(&api_json, arena_str(&engine, post->content));
+        json_writer_key(&api_json, "createdAt"); json_writer_int64(&api_json, (long long)post->created_at);
+        json_writer_key(&api_json, "mediaType");
+        json_writer_string(&api_json, post->media_type == MEDIA_NONE ? "text" : get_media_type_string(post->media_type));
+        json_writer_key(&api_json, "priority"); json_writer_bool(&api_json, page.items[i].priority);
+        json_writer_end_object(&api_json);
+    }
+    json_writer_end_array(&api_json);
+    json_writer_key(&api_json, "hasMore");
+    json_writer_bool(&api_json, page.has_more);
+    json_writer_key(&api_json, "nextCursor");
+    if (page.has_more) {
+        feed_cursor_format(page.next, cursor_text, sizeof(cursor_text));
+        json_writer_string(&api_json, cursor_text);
+    } else {
+        json_writer_null(&api_json);
+    }
+    json_writer_end_object(&api_json);
+    return 200;
+}
+
+static void json_message(const Message* msg) {
+    json_writer_begin_object(&api_json);
+    json_writer_key(&api_json, "messageId"); json_writer_int(&api_json, msg->message_id);
+    json_writer_key(&api_json, "senderId"); json_writer_int(&api_json, msg->sender_id);
+    json_writer_key(&api_json, "receiverId"); json_writer_int(&api_json, msg->receiver_id);
+    json_writer_key(&api_json, "senderName"); json_writer_string(&api_json, arena_str(&engine, msg->sender_name));
+    json_writer_key(&api_json, "content"); json_writer_string(&api_json, arena_str(&engine, msg->content));
+    json_writer_key(&api_json, "timestamp"); json_writer_int64(&api_json, (long long)msg->timestamp);
+    json_writer_key(&api_json, "priority"); json_writer_bool(&api_json, msg->priority);
+    json_writer_key(&api_json, "read"); json_writer_bool(&api_json, msg->is_read);
+    json_writer_end_object(&api_json);
+}
+
+static int api_messages(const HttpRequest* req, User* user) {
+    int limit = query_limit(req, API_LIST_DEFAULT, API_LIST_MAX);
+    int count = 0;
+    json_writer_begin_object(&api_json);
+    json_writer_key(&api_json, "messages");
+    json_writer_begin_array(&api_json);
+    // Priority (close friends) first, then regular; newest first in each
+    for (int priority = 1; priority >= 0; priority--) {
+        for (const Message* msg = engine.messages_head; msg != NULL && count < limit; msg = msg->next) {
+            if (msg->priority != priority || (msg->sender_id != user->user_id && msg->receiver_id != user->user_id)) {
+                continue;
+            }
+            json_message(msg);
+            count++;
+        }
+    }
+    json_writer_end_array(&api_json);
+    json_writer_end_object(&api_json);
+    return 200;
+}
+
+// The user's conversations, most recently active first
+static int api_conversations(const HttpRequest* req, User* user) {
+    const Conversation* recent[API_LIST_MAX];
+    int count = conversation_recent(&engine, user->user_id, recent, query_limit(req, API_LIST_DEFAULT, API_LIST_MAX));
+    json_writer_begin_object(&api_json);
+    json_writer_key(&api_json, "conversations");
+    json_writer_begin_array(&api_json);
+    for (int i = 0; i < count; i++) {
+        const Conversation* conv = recent[i];
+        int other_id = conv->user_a == user->user_id ? conv->user_b : conv->user_a;
+        User* other = find_user_by_id(&engine, other_id);
+        json_writer_begin_object(&api_json);
+        json_writer_key(&api_json, "userId"); json_writer_int(&api_json, other_id);
+        json_writer_key(&api_json, "username");
+        json_writer_string(&api_json, other ? arena_str(&engine, other->username) : NULL);
+        json_writer_key(&api_json, "messageCount"); json_writer_int(&api_json, conv->count);
+        json_writer_key(&api_json, "lastMessage"); json_message(conv->messages[conv->count - 1]);
+        json_writer_end_object(&api_json);
+    }
+    json_writer_end_array(&api_json);
+    json_writer_end_object(&api_json);
+    return 200;
+}
+
+// One page of a conversation, oldest first; ?before= pages back in time
+static int api_conversation(const HttpRequest* req, User* user) {
+    const char* id_text = req->path + strlen("/api/conversations/");
+    char* end;
+    long other_id = strtol(id_text, &end, 10);
+    if (end != req->path + req->path_len || end == id_text || find_user_by_id(&engine, (int)other_id) == NULL) {
+        return api_error(404, "User not found");
+    }
+    char before_text[16];
+    int before_id = query_param(req, "before", before_text, sizeof(before_text)) ? atoi(before_text) : 0;
     
-    // Get port from environment variable or use default
-    char* port_str = getenv("PORT");
-    int port = port_str ? atoi(port_str) : 10000;
+    ConversationPage page;
+    conversation_page(&engine, user->user_id, (int)other_id, before_id,
+                      query_limit(req, CONVERSATION_PAGE_SIZE, CONVERSATION_PAGE_MAX), &page);
+    json_writer_begin_object(&api_json);
+    json_writer_key(&api_json, "messages");
+    json_writer_begin_array(&api_json);
+    for (int i = 0; i < page.count; i++) {
+        json_message(page.messages[i]);
+    }
+    json_writer_end_array(&api_json);
+    json_writer_key(&api_json, "hasMore");
+    json_writer_bool(&api_json, page.has_more);
+    json_writer_key(&api_json, "nextBefore");
+    if (page.has_more) {
+        json_writer_int(&api_json, page.next_before_id);
+    } else {
+        json_writer_null(&api_json);
+    }
+    json_writer_end_object(&api_json);
+    return 200;
+}
 
-    printf("Starting Priority Social Media Web Server on port %d\n", port);
+static int api_send_message(const HttpRequest* req, User* user) {
+    int receiver_id;
+    char content[MAX_MESSAGE_CONTENT];
+    if (!body_int(req, "to", &receiver_id) || !body_string(req, "content", content, sizeof(content))) {
+        return api_error(400, "to and content are required (max 299 bytes)");
+    }
+    if (find_user_by_id(&engine, receiver_id) == NULL) {
+        return api_error(404, "Receiver not found");
+    }
+    if (receiver_id == user->user_id) {
+        return api_error(400, "You cannot send a message to yourself");
+    }
+    int message_id = send_message(&engine, receiver_id, content);
+    if (!message_id) {
+        return api_error(500, engine.error);
+    }
+    json_writer_begin_object(&api_json);
+    json_writer_key(&api_json, "messageId");
+    json_writer_int(&api_json, message_id);
+    json_writer_end_object(&api_json);
+    return 201;
+}
+
+static void json_inbox_counts(int user_id) {
+    int priority_unread, regular_unread;
+    int unread = inbox_unread(&engine, user_id, &priority_unread, &regular_unread);
+    json_writer_key(&api_json, "unread"); json_writer_int(&api_json, unread);
+    json_writer_key(&api_json, "priorityUnread"); json_writer_int(&api_json, priority_unread);
+    json_writer_key(&api_json, "regularUnread"); json_writer_int(&api_json, regular_unread);
+}
+
+static int api_inbox(const HttpRequest* req, User* user) {
+    (void)req;
+    json_writer_begin_object(&api_json);
+    json_inbox_counts(user->user_id);
+    json_writer_end_object(&api_json);
+    return 200;
+}
+
+// Hands out and marks read up to "max" unread messages, close friends first
+static int api_inbox_drain(const HttpRequest* req, User* user) {
+    int max = API_LIST_DEFAULT;
+    if (body_int(req, "max", &max) && (max < 1 || max > API_LIST_MAX)) {
+        return api_error(400, "max must be between 1 and 200");
+    }
+    Message* drained[API_LIST_MAX];
+    int count = inbox_drain(&engine, user->user_id, drained, max);
+    json_writer_begin_object(&api_json);
+    json_writer_key(&api_json, "messages");
+    json_writer_begin_array(&api_json);
+    for (int i = 0; i < count; i++) {
+        json_message(drained[i]);
+    }
+    json_writer_end_array(&api_json);
+    json_inbox_counts(user->user_id);
+    json_writer_end_object(&api_json);
+    return 200;
+}
+
+static int api_notifications(const HttpRequest* req, User* user) {
+    int limit = query_limit(req, API_LIST_DEFAULT, API_LIST_MAX);
+    int count = 0;
+    char text[MAX_MESSAGE_CONTENT];
+    const NotificationBox* box = notification_box(&engine, user->user_id);
+    json_writer_begin_object(&api_json);
+    json_writer_key(&api_json, "notifications");
+    json_writer_begin_array(&api_json);
+    // Priority (close friends) first, then regular; newest first in each
+    for (int priority = 1; box != NULL && priority >= 0; priority--) {
+        const NotificationLane* lane = &box->lanes[priority];
+        for (int i = lane->count - 1; i >= 0 && count < limit; i--, count++) {
+            const Notification* notif = lane->items[i];
+            json_writer_begin_object(&api_json);
+            json_writer_key(&api_json, "notificationId"); json_writer_int(&api_json, notif->notif_id);
+            json_writer_key(&api_json, "content");
+            json_writer_string(&api_json, notification_render(&engine, notif, text, sizeof(text)));
+            json_writer_key(&api_json, "actorId"); json_writer_int(&api_json, notif->actor_id);
+            json_writer_key(&api_json, "objectId"); json_writer_int(&api_json, notif->object_id);
+            json_writer_key(&api_json, "others"); json_writer_int(&api_json, notif->others);
+            json_writer_key(&api_json, "timestamp"); json_writer_int64(&api_json, (long long)notif->timestamp);
+            json_writer_key(&api_json, "priority"); json_writer_bool(&api_json, notif->priority);
+            json_writer_key(&api_json, "read"); json_writer_bool(&api_json, notif->is_read);
+            json_writer_end_object(&api_json);
+        }
+    }
+    json_writer_end_array(&api_json);
+    json_writer_key(&api_json, "unread");
+    json_writer_int(&api_json, notification_unread(&engine, user->user_id, NULL, NULL));
+    json_writer_end_object(&api_json);
+    return 200;
+}
+
+static int api_mark_read(const HttpRequest* req, User* user) {
+    int notif_id;
+    if (!body_int(req, "notificationId", &notif_id)) {
+        return api_error(400, "notificationId is required");
+    }
+    const Notification* notif = notification_find(&engine, notif_id);
+    if (notif == NULL || notif->user_id != user->user_id) {
+        return api_error(404, "Notification not found");
+    }
+    mark_notification_read(&engine, notif_id);
+    return api_ok();
+}
+
+static void stats_slab(const char* key, const SlabAllocator* slab) {
+    json_writer_key(&api_json, key);
+    json_writer_begin_object(&api_json);
+    json_writer_key(&api_json, "live"); json_writer_int64(&api_json, (long long)slab->live);
+    json_writer_key(&api_json, "peak"); json_writer_int64(&api_json, (long long)slab->peak);
+    json_writer_key(&api_json, "allocs"); json_writer_int64(&api_json, (long long)slab->alloc_count);
+    json_writer_key(&api_json, "frees"); json_writer_int64(&api_json, (long long)slab->free_count);
+    json_writer_key(&api_json, "blocks"); json_writer_int64(&api_json, (long long)slab->block_count);
+    json_writer_key(&api_json, "reservedBytes");
+    json_writer_int64(&api_json, (long long)slab_reserved_bytes(slab));
+    json_writer_end_object(&api_json);
+}
+
+static void stats_fanout(void) {
+    FanoutStats stats;
+    fanout_stats(&engine, &stats);
+    json_writer_key(&api_json, "fanout");
+    json_writer_begin_object(&api_json);
+    json_writer_key(&api_json, "threads");
+    json_writer_int(&api_json, engine.fanout.threads);
+    json_writer_key(&api_json, "jobsQueued");
+    json_writer_int64(&api_json, (long long)stats.jobs_queued);
+    json_writer_key(&api_json, "jobsInline");
+    json_writer_int64(&api_json, (long long)stats.jobs_inline);
+    json_writer_key(&api_json, "queueFull");
+    json_writer_int64(&api_json, (long long)stats.queue_full);
+    json_writer_key(&api_json, "jobsDone");
+    json_writer_int64(&api_json, (long long)stats.jobs_done);
+    json_writer_key(&api_json, "notifications");
+    json_writer_int64(&api_json, (long long)stats.notifications);
+    json_writer_key(&api_json, "batches");
+    json_writer_int64(&api_json, (long long)stats.batches);
+    json_writer_key(&api_json, "depth");
+    json_writer_int(&api_json, stats.depth);
+    json_writer_key(&api_json, "depthHighWater");
+    json_writer_int(&api_json, stats.depth_high_water);
+    json_writer_key(&api_json, "maxLagMs");
+    json_writer_int64(&api_json, stats.max_lag_ms);
+    json_writer_end_object(&api_json);
+}
+
+// Allocation counters of the engine's record stores
+static int api_stats(const HttpRequest* req, User* user) {
+    (void)req;
+    (void)user;
+    json_writer_begin_object(&api_json);
+    json_writer_key(&api_json, "posts");
+    json_writer_int64(&api_json, (long long)engine.post_store.post_count);
+    json_writer_key(&api_json, "follows");
+    json_writer_int64(&api_json, (long long)engine.follow_graph.edge_count);
+    json_writer_key(&api_json, "stringArenaBytes");
+    json_writer_int64(&api_json, (long long)engine.text_arena.used);
+    stats_slab("messages", &engine.message_slab);
+    stats_slab("notifications", &engine.notification_slab);
+    json_writer_key(&api_json, "notificationsEvicted");
+    json_writer_int64(&api_json, (long long)engine.notifications.evicted);
+    json_writer_key(&api_json, "notificationsCoalesced");
+    json_writer_int64(&api_json, (long long)engine.notifications.coalesced);
+    stats_fanout();
+    json_writer_end_object(&api_json);
+    return 200;
+}
+
+typedef struct ApiRoute {
+    const char* method;
+    const char* path;
+    int prefix;     // path is a prefix, e.g. /api/users/{id}
+    int needs_auth;
+    int writes;     // Changes the social data, which only worker 0 logs
+    int (*handler)(const HttpRequest* req, User* user);
+} ApiRoute;
+
+static const ApiRoute api_routes[] = {
+    {"POST", "/api/register", 0, 0, 1, api_register},
+    {"POST", "/api/login", 0, 0, 0, api_login},
+    {"POST", "/api/logout", 0, 1, 0, api_logout},
+    {"GET", "/api/users/", 1, 0, 0, api_profile},
+    {"POST", "/api/follow", 0, 1, 1, api_follow},
+    {"POST", "/api/unfollow", 0, 1, 1, api_unfollow},
+    {"POST", "/api/posts", 0, 1, 1, api_create_post},
+    {"GET", "/api/feed", 0, 1, 0, api_feed},
+    {"GET", "/api/messages", 0, 1, 0, api_messages},
+    {"POST", "/api/messages", 0, 1, 1, api_send_message},
+    {"GET", "/api/conversations", 0, 1, 0, api_conversations},
+    {"GET", "/api/conversations/", 1, 1, 0, api_conversation},
+    {"GET", "/api/inbox", 0, 1, 0, api_inbox},
+    {"POST", "/api/inbox/drain", 0, 1, 1, api_inbox_drain},
+    {"GET", "/api/notifications", 0, 1, 0, api_notifications},
+    {"POST", "/api/notifications/read", 0, 1, 1, api_mark_read},
+    {"GET", "/api/stats", 0, 0, 0, api_stats},
+};
+
+// Runs one API request; the body is left in api_json
+static int api_dispatch(const HttpRequest* req) {
+    int path_found = 0;
+    for (size_t i = 0; i < sizeof(api_routes) / sizeof(api_routes[0]); i++) {
+        const ApiRoute* route = &api_routes[i];
+        size_t route_len = strlen(route->path);
+        int matches = route->prefix ? req->path_len > route_len && strncmp(req->path, route->path, route_len) == 0
+                                    : req->path_len == route_len && strncmp(req->path, route->path, route_len) == 0;
+        if (!matches) {
+            continue;
+        }
+        path_found = 1;
+        if (!header_is(req->method, req->method_len, route->method)) {
+            continue;
+        }
+        if (route->writes && worker_index != 0) {
+            return api_error(503, "Changes are only accepted by worker 0; retry on a new connection");
+        }
+
+        // Fan-out threads write to the engine too
+        priority_write_begin(&engine);
+        User* user = session_user(req);
+        int status;
+        if (route->needs_auth && user == NULL) {
+            status = api_error(401, "Login required");
+        } else {
+            engine.current_user = user; // Engine calls act as the session's user
+            status = route->handler(req, user);
+            engine.current_user = NULL;
+        }
+        priority_write_end(&engine);
+        return status;
+    }
+    return path_found ? api_error(405, "Method not allowed") : api_error(404, "Not found");
+}
+
+// Replaces the output held since held_from with a 503: the change was made
+// but could not be synced to the log. The requests answered after it are
+// dropped along with their responses, so the connection closes.
+static void refuse_held_output(Connection* c) {
+    c->out.len = c->held_from;
+    c->awaiting_sync = 0;
+    api_error(503, "The change could not be saved to disk");
+    send_response(c, 503, "application/json", api_json.buf, api_json.len, 0, 0);
+    json_writer_reset(&api_json);
+}
+
+// Holds c's output from held_from on until the event loop has synced the
+// log, so a client never sees success for a change a crash could still lose
+static void hold_until_synced(Connection* c, size_t held_from) {
+    if (c->awaiting_sync) {
+        return;
+    }
+    c->awaiting_sync = 1;
+    c->held_from = held_from;
+    if (held_count == held_capacity) {
+        int capacity = held_capacity ? held_capacity * 2 : 64;
+        int* grown = realloc(held_fds, (size_t)capacity * sizeof(int));
+        if (grown == NULL) {
+            refuse_held_output(c); // Cannot wait for the sync, so cannot vouch for it
+            return;
+        }
+        held_fds = grown;
+        held_capacity = capacity;
+    }
+    held_fds[held_count++] = c->fd;
+}
+
+static void handle_request(Connection* c, const HttpRequest* req) {
+    if (req->path_len >= 5 && strncmp(req->path, "/api/", 5) == 0) {
+        size_t response_start = c->out.len;
+        int status = api_dispatch(req);
+        if (api_json.failed) {
+            json_writer_reset(&api_json);
+            status = api_error(500, "Response too large");
+        }
+        send_response(c, status, "application/json", api_json.buf, api_json.len, req->keep_alive, 0);
+        json_writer_reset(&api_json);
+        if (!header_is(req->method, req->method_len, "GET")) {
+            hold_until_synced(c, response_start);
+        }
+        return;
+    }
+
+    int head_only = header_is(req->method, req->method_len, "HEAD");
+    if (!head_only && !header_is(req->method, req->method_len, "GET")) {
+        const char* body = "405 Method Not Allowed\n";
+        send_response(c, 405, "text/plain", body, strlen(body), req->keep_alive, 0);
+        return;
+    }
+
+    if (header_is(req->path, req->path_len, "/") || header_is(req->path, req->path_len, "/index.html")) {
+        send_response(c, 200, "text/html; charset=utf-8", html_page, strlen(html_page),
+                      req->keep_alive, head_only);
+    } else if (header_is(req->path, req->path_len, "/health")) {
+        send_response(c, 200, "text/plain", "OK\n", 3, req->keep_alive, head_only);
+    } else {
+        const char* body = "404 Not Found\n";
+        send_response(c, 404, "text/plain", body, strlen(body), req->keep_alive, head_only);
+    }
+}
+
+// =============================================================================
+// Connections
+// =============================================================================
+
+static Connection* connection_open(int fd) {
+    if (fd >= connection_capacity) {
+        int capacity = connection_capacity ? connection_capacity : 1024;
+        while (capacity <= fd) {
+            capacity *= 2;
+        }
+        Connection** grown = realloc(connections, (size_t)capacity * sizeof(Connection*));
+        if (grown == NULL) {
+            return NULL;
+        }
+        memset(grown + connection_capacity, 0, (size_t)(capacity - connection_capacity) * sizeof(Connection*));
+        connections = grown;
+        connection_capacity = capacity;
+    }
+    Connection* c = calloc(1, sizeof(Connection));
+    if (c == NULL) {
+        return NULL;
+    }
+    c->fd = fd;
+    c->last_active = time(NULL);
+    connections[fd] = c;
+    connection_count++;
+    return c;
+}
+
+// Closing the fd also drops it from the epoll set
+static void connection_close(Connection* c) {
+    for (int i = 0; c->awaiting_sync && i < held_count; i++) {
+        if (held_fds[i] == c->fd) {
+            held_fds[i] = -1; // The fd may be reused before the release
+        }
+    }
+    connections[c->fd] = NULL;
+    connection_count--;
+    close(c->fd);
+    free(c->in.data);
+    free(c->out.data);
+    free(c);
+}
+
+// Writes pending output. Returns 1 when all of it went out, 0 when the
+// socket is full or the output is held, -1 on error.
+static int flush_output(Connection* c) {
+    if (c->awaiting_sync) {
+        return 0;
+    }
+    while (c->out_sent < c->out.len) {
+        ssize_t sent = send(c->fd, c->out.data + c->out_sent, c->out.len - c->out_sent, MSG_NOSIGNAL);
+        if (sent > 0) {
+            c->out_sent += (size_t)sent;
+            c->last_active = time(NULL);
+        } else if (sent < 0 && errno == EINTR) {
+            continue;
+        } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        } else {
+            return -1;
+        }
+    }
+    c->out.len = c->out_sent = 0;
+    return 1;
+}
+
+// Answers every complete request buffered so far, in arrival order
+static void answer_requests(Connection* c) {
+    while (!c->closing && c->out.len - c->out_sent < MAX_PENDING_OUTPUT) {
+        HttpRequest req;
+        long used = parse_request(c->in.data + c->in_start, c->in.len - c->in_start, &req);
+        if (used == 0) {
+            break;
+        }
+        if (used < 0) {
+            send_error(c, (int)-used);
+            break;
+        }
+        handle_request(c, &req);
+        c->in_start += (size_t)used;
+    }
+
+    // Keep only the partial request, at the front of the buffer
+    if (c->in_start > 0) {
+        memmove(c->in.data, c->in.data + c->in_start, c->in.len - c->in_start);
+        c->in.len -= c->in_start;
+        c->in_start = 0;
+    }
+}
+
+// Runs a connection until its socket would block, as edge-triggered epoll
+// requires. Returns 0 once the connection should be closed.
+static int service_connection(Connection* c) {
+    for (;;) {
+        answer_requests(c);
+        int flushed = flush_output(c);
+        if (flushed < 0 || (flushed == 1 && c->closing)) {
+            return 0;
+        }
+        if (c->closing || c->out.len - c->out_sent >= MAX_PENDING_OUTPUT) {
+            return 1; // Resumes on EPOLLOUT
+        }
+
+        if (!buffer_reserve(&c->in, READ_CHUNK)) {
+            printf("Memory allocation failed!\n");
+            return 0;
+        }
+        ssize_t received = recv(c->fd, c->in.data + c->in.len, c->in.capacity - c->in.len, 0);
+        if (received > 0) {
+            c->in.len += (size_t)received;
+            c->last_active = time(NULL);
+        } else if (received == 0) {
+            c->closing = 1; // Peer finished sending; deliver what is owed, then close
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 1;
+        } else if (errno != EINTR) {
+            return 0;
+        }
+    }
+}
+
+static void accept_connections(int epoll_fd, int server_fd) {
+    for (;;) {
+        int fd = accept4(server_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("accept");
+            }
+            return;
+        }
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
 
-    if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
+        Connection* c = connection_open(fd);
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.ptr = c;
+        if (c == NULL) {
+            printf("Memory allocation failed!\n");
+            close(fd);
+        } else if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            perror("epoll_ctl");
+            connection_close(c);
+        }
+    }
+}
+
+// Sends the output held for the group just synced, or a 503 in its place
+// when the sync failed. Requests answered while doing so are held again and
+// wait for the next group.
+static void release_held_connections(int synced) {
+    int count = held_count;
+    for (int i = 0; i < count; i++) {
+        if (held_fds[i] < 0) {
+            continue; // Closed while held
+        }
+        Connection* c = connections[held_fds[i]];
+        if (synced) {
+            c->awaiting_sync = 0;
+        } else {
+            refuse_held_output(c);
+        }
+        if (!service_connection(c)) {
+            connection_close(c);
+        }
+    }
+    held_count -= count;
+    memmove(held_fds, held_fds + count, (size_t)held_count * sizeof(int));
+}
+
+static void close_idle_connections(time_t now) {
+    for (int fd = 0; fd < connection_capacity; fd++) {
+        if (connections[fd] != NULL && now - connections[fd]->last_active > IDLE_TIMEOUT_SECONDS) {
+            connection_close(connections[fd]);
+        }
+    }
+}
+
+// Stops accepting and lets in-flight requests finish: idle keep-alive
+// connections close now, busy ones after their current response
+static void begin_drain(int server_fd) {
+    draining = 2;
+    close(server_fd);
+    for (int fd = 0; fd < connection_capacity; fd++) {
+        Connection* c = connections[fd];
+        if (c != NULL && c->in.len == 0 && c->out.len == c->out_sent) {
+            connection_close(c);
+        }
+    }
+}
+
+static void run_event_loop(int server_fd) {
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        perror("epoll_create1");
+        exit(EXIT_FAILURE);
+    }
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLET;
+    event.data.ptr = NULL; // The listening socket
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_fd, &event) < 0) {
+        perror("epoll_ctl");
+        exit(EXIT_FAILURE);
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    time_t last_sweep = time(NULL);
+    time_t drain_deadline = 0;
+    while (draining != 2 || (connection_count > 0 && time(NULL) < drain_deadline)) {
+        if (draining == 1) {
+            // Take whatever the kernel already queued before closing the socket
+            accept_connections(epoll_fd, server_fd);
+            begin_drain(server_fd);
+            drain_deadline = time(NULL) + DRAIN_TIMEOUT_SECONDS;
+            continue;
+        }
+
+        int ready = epoll_wait(epoll_fd, events, MAX_EVENTS, held_count > 0 ? 0 : 1000);
+        if (ready < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 0; i < ready; i++) {
+            Connection* c = events[i].data.ptr;
+            if (c == NULL) {
+                if (!draining) {
+                    accept_connections(epoll_fd, server_fd);
+                }
+            } else if ((events[i].events & EPOLLERR) || !service_connection(c)) {
+                connection_close(c);
+            }
+        }
+
+        priority_write_begin(&engine);
+        int synced = wal_idle(&engine); // Group commit: one fsync for the whole batch
+        priority_write_end(&engine);
+        release_held_connections(synced);
+
+        time_t now = time(NULL);
+        if (now != last_sweep) {
+            close_idle_connections(now);
+            last_sweep = now;
+        }
+    }
+    close(epoll_fd);
+}
+
+static int env_int(const char* name, int fallback) {
+    const char* value = getenv(name);
+    int parsed = value ? atoi(value) : 0;
+    return parsed > 0 ? parsed : fallback;
+}
+
+static int create_listen_socket(int port, int backlog) {
+    int server_fd;
+    struct sockaddr_in address;
+    int opt = 1;
+
+    if ((server_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) {
         perror("socket failed");
         exit(EXIT_FAILURE);
     }
 
-    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt))) {
+    // Every worker binds its own socket; the kernel spreads connections across them
+    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) ||
+        setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt))) {
         perror("setsockopt");
         exit(EXIT_FAILURE);
     }
 
+    memset(&address, 0, sizeof(address));
     address.sin_family = AF_INET;
     address.sin_addr.s_addr = INADDR_ANY;
     address.sin_port = htons(port);
@@ -74,27 +1525,188 @@ int main() {
         exit(EXIT_FAILURE);
     }
 
-    if (listen(server_fd, 3) < 0) {
+    if (listen(server_fd, backlog) < 0) {
         perror("listen");
         exit(EXIT_FAILURE);
     }
+    return server_fd;
+}
 
-    printf("Server listening on port %d\n", port);
+// =============================================================================
+// Workers
+// =============================================================================
 
-    while(1) {
-        if ((new_socket = accept(server_fd, (struct sockaddr *)&address, (socklen_t*)&addrlen)) < 0) {
-            perror("accept");
-            exit(EXIT_FAILURE);
+static pid_t worker_pids[MAX_WORKERS];
+static int worker_total = 0;
+static volatile sig_atomic_t stopping = 0;
+
+static void worker_stop(int sig) {
+    (void)sig;
+    if (!draining) {
+        draining = 1;
+    }
+}
+
+// Supervisor: pass the stop signal on to every worker
+static void supervisor_stop(int sig) {
+    (void)sig;
+    stopping = 1;
+    for (int i = 0; i < worker_total; i++) {
+        if (worker_pids[i] > 0) {
+            kill(worker_pids[i], SIGTERM);
+        }
+    }
+}
+
+static void install_handler(int sig, void (*handler)(int)) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handler;
+    sigemptyset(&action.sa_mask);
+    sigaction(sig, &action, NULL); // No SA_RESTART: epoll_wait and waitpid return EINTR
+}
+
+// Cores this process may run on, which respects container CPU sets
+static int usable_cpus(void) {
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0 && CPU_COUNT(&set) > 0) {
+        return CPU_COUNT(&set);
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+}
+
+static void run_worker(int index, int port, int backlog, int pin) {
+    worker_index = index;
+    install_handler(SIGTERM, worker_stop);
+    install_handler(SIGINT, worker_stop);
+
+    if (pin) {
+        // The n-th allowed core, not simply core n
+        cpu_set_t allowed, set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+            int wanted = index % usable_cpus();
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if (CPU_ISSET(cpu, &allowed) && wanted-- == 0) {
+                    CPU_SET(cpu, &set);
+                    break;
+                }
+            }
+        }
+        if (CPU_COUNT(&set) == 0 || sched_setaffinity(0, sizeof(set), &set) < 0) {
+            perror("sched_setaffinity");
         }
+    }
+
+    int server_fd = create_listen_socket(port, backlog);
+    priority_init(&engine);
+    if (!load_data(&engine)) {
+        fprintf(stderr, "Worker %d: %s\n", index, engine.error);
+    }
+    if (index == 0 && !wal_open(&engine, WAL_PATH)) {
+        fprintf(stderr, "Worker %d: %s\n", index, engine.error);
+    }
+    const char* fanout_env = getenv("FANOUT_THREADS"); // env_int would turn 0 into the default
+    int fanout_threads = fanout_env ? atoi(fanout_env) : 2;
+    if (fanout_threads > FANOUT_MAX_THREADS) {
+        fanout_threads = FANOUT_MAX_THREADS;
+    }
+    if (fanout_threads > 0 && !fanout_start(&engine, fanout_threads)) {
+        fprintf(stderr, "Worker %d: %s\n", index, engine.error);
+    }
+
+    run_event_loop(server_fd);
+
+    fanout_stop(&engine); // Delivers what is still queued
+    if (index == 0) {
+        sync_data(&engine);
+        wal_close(&engine);
+    }
+}
 
-        read(new_socket, buffer, BUFFER_SIZE);
-        printf("Request received\n");
-        
-        send(new_socket, html_response, strlen(html_response), 0);
-        printf("Response sent\n");
-        
-        close(new_socket);
+// Only worker 0 replays the log, so before forking several, fold it into
+// the snapshot: every worker then starts from the same data.
+static void fold_log_into_snapshot(void) {
+    static PriorityContext startup;
+    priority_init(&startup);
+    if (!load_data(&startup) || !wal_open(&startup, WAL_PATH) || !wal_snapshot(&startup)) {
+        fprintf(stderr, "Startup: %s\n", startup.error);
     }
+    cleanup_data(&startup);
+}
 
+static pid_t spawn_worker(int index, int port, int backlog, int pin) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        run_worker(index, port, backlog, pin);
+        _exit(EXIT_SUCCESS);
+    }
+    if (pid < 0) {
+        perror("fork");
+    }
+    return pid;
+}
+
+int main() {
+    // Get port from environment variable or use default
+    int port = env_int("PORT", DEFAULT_PORT);
+    int backlog = env_int("BACKLOG", DEFAULT_BACKLOG);
+    int workers = env_int("WORKERS", 1);
+    int pin = env_int("PIN_CPUS", 0);
+    if (workers > MAX_WORKERS) {
+        workers = MAX_WORKERS;
+    }
+
+    printf("Starting Priority Social Media Web Server on port %d\n", port);
+    printf("Server listening on port %d (backlog %d, %d worker%s%s)\n", port, backlog,
+           workers, workers == 1 ? "" : "s", pin ? ", pinned" : "");
+    fflush(stdout);
+    signal(SIGPIPE, SIG_IGN);
+    if (!session_init()) {
+        perror("session_init");
+        return 1;
+    }
+
+    if (workers == 1) {
+        run_worker(0, port, backlog, pin);
+        return 0;
+    }
+
+    fold_log_into_snapshot();
+    install_handler(SIGTERM, supervisor_stop);
+    install_handler(SIGINT, supervisor_stop);
+    for (int i = 0; i < workers; i++) {
+        worker_pids[i] = spawn_worker(i, port, backlog, pin);
+        worker_total = i + 1;
+    }
+
+    // Restart workers that die, until asked to stop; then wait for the drain
+    int alive = workers;
+    while (alive > 0) {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < worker_total; i++) {
+            if (worker_pids[i] != pid) {
+                continue;
+            }
+            worker_pids[i] = 0;
+            if (stopping) {
+                alive--;
+            } else {
+                printf("Worker %d exited (status %d), restarting\n", i, status);
+                fflush(stdout);
+                worker_pids[i] = spawn_worker(i, port, backlog, pin);
+                if (worker_pids[i] < 0) {
+                    alive--;
+                }
+            }
+        }
+    }
+    printf("Server stopped\n");
     return 0;
-}
\ No newline at end of file
+}